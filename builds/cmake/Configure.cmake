@@ -135,6 +135,7 @@ set(include_files_list
     langinfo.h
     libio.h
     linux/falloc.h
+    linux/io_uring.h
     limits.h
     locale.h
     math.h
@@ -159,6 +160,7 @@ set(include_files_list
     string.h
     strings.h
     sys/dir.h
+    sys/epoll.h
     sys/file.h
     sys/ioctl.h
     sys/ipc.h
@@ -188,6 +190,8 @@ set(include_files_list
     vfork.h
     winsock2.h
     zlib.h
+    zstd.h
+    lz4frame.h
 )
 check_includes(include_files_list)
 
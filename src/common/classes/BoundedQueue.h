@@ -0,0 +1,142 @@
+/*
+ *	PROGRAM:	Client/Server Common Code
+ *	MODULE:		BoundedQueue.h
+ *	DESCRIPTION:	Bounded lock-free queue with many producers and single consumer
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#ifndef CLASSES_BOUNDED_QUEUE_H
+#define CLASSES_BOUNDED_QUEUE_H
+
+#include "../common/classes/alloc.h"
+#include <atomic>
+
+
+namespace Firebird
+{
+
+// Queue of pointers with fixed capacity, rounded up to the power of two.
+// Every cell has a sequence number telling whether it's free for the given
+// enqueue position or holds a value for the given dequeue position, thus
+// producers never wait for each other nor for the consumer. Any number of
+// threads may push, only one thread at a time may pop.
+
+template <typename T>
+class BoundedQueue
+{
+public:
+	BoundedQueue(MemoryPool& pool, ULONG size)
+		: m_cells(NULL),
+		  m_mask(0),
+		  m_enqueuePos(0),
+		  m_dequeuePos(0)
+	{
+		FB_SIZE_T capacity = 2;
+		while (capacity < size && capacity < MAX_SLONG / 2)
+			capacity *= 2;
+
+		m_cells = FB_NEW_POOL(pool) Cell[capacity];
+		m_mask = capacity - 1;
+
+		for (FB_SIZE_T i = 0; i < capacity; i++)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+			m_cells[i].value = NULL;
+		}
+	}
+
+	~BoundedQueue()
+	{
+		delete[] m_cells;
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	FB_SIZE_T getCapacity() const
+	{
+		return m_mask + 1;
+	}
+
+	// Approximate number of values in the queue
+	FB_SIZE_T getCount() const
+	{
+		return m_enqueuePos.load(std::memory_order_relaxed) -
+			m_dequeuePos.load(std::memory_order_relaxed);
+	}
+
+	// Returns false if the queue is full
+	bool push(T* value)
+	{
+		FB_SIZE_T pos = m_enqueuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+
+		while (true)
+		{
+			cell = &m_cells[pos & m_mask];
+			const FB_SIZE_T sequence = cell->sequence.load(std::memory_order_acquire);
+
+			if (sequence == pos)
+			{
+				// The cell is free, try to take it
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if ((SLONG) (sequence - pos) < 0)
+				return false;	// queue is full
+			else
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+
+		cell->value = value;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns NULL if the queue is empty or the next value is not put yet
+	T* pop()
+	{
+		const FB_SIZE_T pos = m_dequeuePos.load(std::memory_order_relaxed);
+		Cell* const cell = &m_cells[pos & m_mask];
+
+		if (cell->sequence.load(std::memory_order_acquire) != pos + 1)
+			return NULL;
+
+		T* const value = cell->value;
+		m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+		cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+
+		return value;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<FB_SIZE_T> sequence;
+		T* value;
+	};
+
+	Cell* m_cells;
+	FB_SIZE_T m_mask;
+	std::atomic<FB_SIZE_T> m_enqueuePos;
+	std::atomic<FB_SIZE_T> m_dequeuePos;
+};
+
+} // namespace Firebird
+
+#endif // CLASSES_BOUNDED_QUEUE_H
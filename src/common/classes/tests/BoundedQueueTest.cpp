@@ -0,0 +1,164 @@
+#include "firebird.h"
+#include "boost/test/unit_test.hpp"
+#include "../common/classes/BoundedQueue.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Firebird;
+
+BOOST_AUTO_TEST_SUITE(CommonSuite)
+BOOST_AUTO_TEST_SUITE(BoundedQueueSuite)
+
+
+BOOST_AUTO_TEST_SUITE(BoundedQueueTests)
+
+BOOST_AUTO_TEST_CASE(CapacityTest)
+{
+	BoundedQueue<int> queue1(*getDefaultMemoryPool(), 0);
+	BOOST_TEST(queue1.getCapacity() == 2u);
+
+	BoundedQueue<int> queue2(*getDefaultMemoryPool(), 4);
+	BOOST_TEST(queue2.getCapacity() == 4u);
+
+	BoundedQueue<int> queue3(*getDefaultMemoryPool(), 5);
+	BOOST_TEST(queue3.getCapacity() == 8u);
+}
+
+BOOST_AUTO_TEST_CASE(WraparoundTest)
+{
+	BoundedQueue<int> queue(*getDefaultMemoryPool(), 4);
+	int values[10];
+
+	// Positions pass over the cells many times, values keep their order
+
+	int n = 0;
+
+	for (unsigned round = 0; round < 100; round++)
+	{
+		const int first = n;
+
+		for (unsigned i = 0; i < 3; i++, n++)
+		{
+			values[n % 10] = n;
+			BOOST_TEST(queue.push(&values[n % 10]));
+		}
+
+		BOOST_TEST(queue.getCount() == 3u);
+
+		for (int expected = first; expected < n; expected++)
+		{
+			const int* const value = queue.pop();
+			BOOST_TEST_REQUIRE(value);
+			BOOST_TEST(*value == expected);
+		}
+
+		BOOST_TEST(!queue.pop());
+		BOOST_TEST(queue.getCount() == 0u);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FullTest)
+{
+	BoundedQueue<int> queue(*getDefaultMemoryPool(), 4);
+	int values[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+	// Start from the middle of the cells, so the full queue wraps around them
+
+	BOOST_TEST(queue.push(&values[0]));
+	BOOST_TEST(queue.push(&values[1]));
+	BOOST_TEST(queue.pop() == &values[0]);
+	BOOST_TEST(queue.pop() == &values[1]);
+
+	for (int i = 2; i < 6; i++)
+		BOOST_TEST(queue.push(&values[i]));
+
+	// Value is rejected when the queue is full, the queue is not changed
+
+	BOOST_TEST(!queue.push(&values[6]));
+	BOOST_TEST(queue.getCount() == 4u);
+
+	BOOST_TEST(queue.pop() == &values[2]);
+
+	// ... and accepted when there is the free cell again
+
+	BOOST_TEST(queue.push(&values[6]));
+	BOOST_TEST(!queue.push(&values[7]));
+
+	for (int i = 3; i < 7; i++)
+		BOOST_TEST(queue.pop() == &values[i]);
+
+	BOOST_TEST(!queue.pop());
+}
+
+BOOST_AUTO_TEST_CASE(ProducersTest)
+{
+	const unsigned PRODUCERS = 4;
+	const unsigned VALUES = 10000;
+
+	BoundedQueue<unsigned> queue(*getDefaultMemoryPool(), 64);
+
+	std::vector<unsigned> values(PRODUCERS * VALUES);
+	std::vector<unsigned> rejected(PRODUCERS, 0);
+
+	std::atomic<unsigned> finished(0);
+	std::vector<std::thread> producers;
+
+	for (unsigned p = 0; p < PRODUCERS; p++)
+	{
+		producers.emplace_back([&, p]() {
+			for (unsigned i = 0; i < VALUES; i++)
+			{
+				unsigned* const value = &values[p * VALUES + i];
+				*value = p * VALUES + i;
+
+				if (!queue.push(value))
+					rejected[p]++;
+			}
+
+			++finished;
+		});
+	}
+
+	// Every accepted value is popped once, values of the same producer keep their order
+
+	std::vector<unsigned> last(PRODUCERS, 0);
+	std::vector<bool> seen(PRODUCERS * VALUES, false);
+	unsigned popped = 0;
+	bool ordered = true;
+
+	const auto consume = [&]()
+	{
+		for (unsigned* value; (value = queue.pop()); popped++)
+		{
+			const unsigned producer = *value / VALUES;
+			const unsigned number = *value % VALUES + 1;
+
+			ordered = ordered && !seen[*value] && number > last[producer];
+			seen[*value] = true;
+			last[producer] = number;
+		}
+	};
+
+	while (finished < PRODUCERS)
+		consume();
+
+	for (auto& producer : producers)
+		producer.join();
+
+	consume();
+
+	unsigned totalRejected = 0;
+	for (const auto count : rejected)
+		totalRejected += count;
+
+	BOOST_TEST(ordered);
+	BOOST_TEST(popped + totalRejected == PRODUCERS * VALUES);
+	BOOST_TEST(queue.getCount() == 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()	// BoundedQueueTests
+
+
+BOOST_AUTO_TEST_SUITE_END()	// BoundedQueueSuite
+BOOST_AUTO_TEST_SUITE_END()	// CommonSuite
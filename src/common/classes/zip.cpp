@@ -1,7 +1,7 @@
 /*
  *	PROGRAM:	Common class definition
  *	MODULE:		zip.cpp
- *	DESCRIPTION:	ZIP compression library loader.
+ *	DESCRIPTION:	Compression libraries loader.
  *
  *  The contents of this file are subject to the Initial
  *  Developer's Public License Version 1.0 (the "License");
@@ -74,3 +74,69 @@ void ZLib::freeFunc(void*, void* address)
 }
 
 #endif // HAVE_ZLIB_H
+
+#ifdef HAVE_ZSTD_H
+
+using namespace Firebird;
+
+ZStd::ZStd(Firebird::MemoryPool&)
+{
+#ifdef WIN_NT
+	Firebird::PathName name("libzstd.dll");
+#else
+	Firebird::PathName name("libzstd." SHRLIB_EXT ".1");
+#endif
+	z.reset(ModuleLoader::fixAndLoadModule(status, name));
+	if (z)
+		symbols();
+}
+
+void ZStd::symbols()
+{
+#define FB_ZSYMB(A) z->findSymbol(status, STRINGIZE(A), A); if (!A) { z.reset(NULL); return; }
+	FB_ZSYMB(ZSTD_createCCtx)
+	FB_ZSYMB(ZSTD_freeCCtx)
+	FB_ZSYMB(ZSTD_CCtx_setParameter)
+	FB_ZSYMB(ZSTD_compressStream2)
+	FB_ZSYMB(ZSTD_createDCtx)
+	FB_ZSYMB(ZSTD_freeDCtx)
+	FB_ZSYMB(ZSTD_decompressStream)
+	FB_ZSYMB(ZSTD_isError)
+#undef FB_ZSYMB
+}
+
+#endif // HAVE_ZSTD_H
+
+#ifdef HAVE_LZ4FRAME_H
+
+using namespace Firebird;
+
+LZ4::LZ4(Firebird::MemoryPool&)
+{
+#ifdef WIN_NT
+	Firebird::PathName name("liblz4.dll");
+#else
+	Firebird::PathName name("liblz4." SHRLIB_EXT ".1");
+#endif
+	z.reset(ModuleLoader::fixAndLoadModule(status, name));
+	if (z)
+		symbols();
+}
+
+void LZ4::symbols()
+{
+#define FB_ZSYMB(A) z->findSymbol(status, STRINGIZE(A), A); if (!A) { z.reset(NULL); return; }
+	FB_ZSYMB(LZ4F_createCompressionContext)
+	FB_ZSYMB(LZ4F_freeCompressionContext)
+	FB_ZSYMB(LZ4F_compressBound)
+	FB_ZSYMB(LZ4F_compressBegin)
+	FB_ZSYMB(LZ4F_compressUpdate)
+	FB_ZSYMB(LZ4F_flush)
+	FB_ZSYMB(LZ4F_createDecompressionContext)
+	FB_ZSYMB(LZ4F_freeDecompressionContext)
+	FB_ZSYMB(LZ4F_decompress)
+	FB_ZSYMB(LZ4F_isError)
+#undef FB_ZSYMB
+}
+
+#endif // HAVE_LZ4FRAME_H
@@ -1,7 +1,7 @@
 /*
  *	PROGRAM:	Common class definition
  *	MODULE:		zip.h
- *	DESCRIPTION:	ZIP compression library loader.
+ *	DESCRIPTION:	Compression libraries loader.
  *
  *  The contents of this file are subject to the Initial
  *  Developer's Public License Version 1.0 (the "License");
@@ -62,4 +62,79 @@ namespace Firebird {
 }
 #endif // HAVE_ZLIB_H
 
+#ifdef HAVE_ZSTD_H
+#include <zstd.h>
+
+#include "../common/classes/auto.h"
+#include "../common/os/mod_loader.h"
+
+namespace Firebird {
+	class ZStd
+	{
+	public:
+		explicit ZStd(Firebird::MemoryPool&);
+
+		ZSTD_CCtx* (*ZSTD_createCCtx)();
+		size_t (*ZSTD_freeCCtx)(ZSTD_CCtx* cctx);
+		size_t (*ZSTD_CCtx_setParameter)(ZSTD_CCtx* cctx, ZSTD_cParameter param, int value);
+		size_t (*ZSTD_compressStream2)(ZSTD_CCtx* cctx, ZSTD_outBuffer* output, ZSTD_inBuffer* input,
+			ZSTD_EndDirective endOp);
+		ZSTD_DCtx* (*ZSTD_createDCtx)();
+		size_t (*ZSTD_freeDCtx)(ZSTD_DCtx* dctx);
+		size_t (*ZSTD_decompressStream)(ZSTD_DCtx* dctx, ZSTD_outBuffer* output, ZSTD_inBuffer* input);
+		unsigned (*ZSTD_isError)(size_t code);
+
+		operator bool() { return z.hasData(); }
+		bool operator!() { return !z.hasData(); }
+
+		ISC_STATUS_ARRAY status;
+
+	private:
+		AutoPtr<ModuleLoader::Module> z;
+
+		void symbols();
+	};
+}
+#endif // HAVE_ZSTD_H
+
+#ifdef HAVE_LZ4FRAME_H
+#include <lz4frame.h>
+
+#include "../common/classes/auto.h"
+#include "../common/os/mod_loader.h"
+
+namespace Firebird {
+	class LZ4
+	{
+	public:
+		explicit LZ4(Firebird::MemoryPool&);
+
+		LZ4F_errorCode_t (*LZ4F_createCompressionContext)(LZ4F_cctx** cctx, unsigned version);
+		LZ4F_errorCode_t (*LZ4F_freeCompressionContext)(LZ4F_cctx* cctx);
+		size_t (*LZ4F_compressBound)(size_t srcSize, const LZ4F_preferences_t* prefs);
+		size_t (*LZ4F_compressBegin)(LZ4F_cctx* cctx, void* dst, size_t dstCapacity,
+			const LZ4F_preferences_t* prefs);
+		size_t (*LZ4F_compressUpdate)(LZ4F_cctx* cctx, void* dst, size_t dstCapacity,
+			const void* src, size_t srcSize, const LZ4F_compressOptions_t* options);
+		size_t (*LZ4F_flush)(LZ4F_cctx* cctx, void* dst, size_t dstCapacity,
+			const LZ4F_compressOptions_t* options);
+		LZ4F_errorCode_t (*LZ4F_createDecompressionContext)(LZ4F_dctx** dctx, unsigned version);
+		LZ4F_errorCode_t (*LZ4F_freeDecompressionContext)(LZ4F_dctx* dctx);
+		size_t (*LZ4F_decompress)(LZ4F_dctx* dctx, void* dst, size_t* dstSize,
+			const void* src, size_t* srcSize, const LZ4F_decompressOptions_t* options);
+		unsigned (*LZ4F_isError)(LZ4F_errorCode_t code);
+
+		operator bool() { return z.hasData(); }
+		bool operator!() { return !z.hasData(); }
+
+		ISC_STATUS_ARRAY status;
+
+	private:
+		AutoPtr<ModuleLoader::Module> z;
+
+		void symbols();
+	};
+}
+#endif // HAVE_LZ4FRAME_H
+
 #endif // COMMON_ZIP_H
@@ -141,6 +141,9 @@ const char*	GCPolicyCooperative	= "cooperative";
 const char*	GCPolicyBackground	= "background";
 const char*	GCPolicyCombined	= "combined";
 
+const char*	CachePolicyLRU		= "LRU";
+const char*	CachePolicy2Q		= "2Q";
+
 ConfigValue Config::defaults[MAX_CONFIG_KEY];
 
 /******************************************************************************
@@ -352,6 +355,11 @@ void Config::checkValues()
 
 	checkIntForLoBound(KEY_LOCK_MEM_SIZE, 256 * 1024, false);
 
+	checkIntForLoBound(KEY_MAX_INLINE_BLOB_SIZE, 0, true);
+	checkIntForHiBound(KEY_MAX_INLINE_BLOB_SIZE, MAX_USHORT, false);
+
+	checkIntForLoBound(KEY_CLIENT_PREFETCH_BUFFER, 0, true);
+
 	const char* strVal = values[KEY_GC_POLICY].strVal;
 	if (strVal)
 	{
@@ -365,6 +373,17 @@ void Config::checkValues()
 		}
 	}
 
+	strVal = values[KEY_CACHE_POLICY].strVal;
+	if (strVal)
+	{
+		NoCaseString cachePolicy(strVal);
+		if (cachePolicy != CachePolicyLRU && cachePolicy != CachePolicy2Q)
+		{
+			// user-provided value is invalid - fail to default
+			values[KEY_CACHE_POLICY] = defaults[KEY_CACHE_POLICY];
+		}
+	}
+
 	strVal = values[KEY_WIRE_CRYPT].strVal;
 	if (strVal)
 	{
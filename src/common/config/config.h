@@ -78,6 +78,9 @@ extern const char*	GCPolicyCooperative;
 extern const char*	GCPolicyBackground;
 extern const char*	GCPolicyCombined;
 
+extern const char*	CachePolicyLRU;
+extern const char*	CachePolicy2Q;
+
 const int WIRE_CRYPT_DISABLED = 0;
 const int WIRE_CRYPT_ENABLED = 1;
 const int WIRE_CRYPT_REQUIRED = 2;
@@ -192,6 +195,10 @@ enum ConfigKey
 	KEY_MAX_STATEMENT_CACHE_SIZE,
 	KEY_PARALLEL_WORKERS,
 	KEY_MAX_PARALLEL_WORKERS,
+	KEY_CACHE_POLICY,
+	KEY_MAX_INLINE_BLOB_SIZE,
+	KEY_CLIENT_PREFETCH_BUFFER,
+	KEY_PARTIAL_MON_SNAPSHOTS,
 	MAX_CONFIG_KEY		// keep it last
 };
 
@@ -281,7 +288,7 @@ constexpr ConfigEntry entries[MAX_CONFIG_KEY] =
 	{TYPE_STRING,	"KeyHolderPlugin",			false,	""},
 	{TYPE_BOOLEAN,	"RemoteAccess",				false,	true},
 	{TYPE_BOOLEAN,	"IPv6V6Only",				false,	false},
-	{TYPE_BOOLEAN,	"WireCompression",			false,	false},
+	{TYPE_STRING,	"WireCompression",			false,	"lz4, zstd"},
 	{TYPE_INTEGER,	"MaxIdentifierByteLength",	false,	(int)MAX_SQL_IDENTIFIER_LEN},
 	{TYPE_INTEGER,	"MaxIdentifierCharLength",	false,	(int)METADATA_IDENTIFIER_CHAR_LEN},
 	{TYPE_BOOLEAN,	"AllowEncryptedSecurityDatabase",	false,	false},
@@ -310,7 +317,11 @@ constexpr ConfigEntry entries[MAX_CONFIG_KEY] =
 	{TYPE_STRING,	"TempTableDirectory",		false,	""},
 	{TYPE_INTEGER,	"MaxStatementCacheSize",	false,	2 * 1048576},	// bytes
 	{TYPE_INTEGER,	"ParallelWorkers",			true,	1},
-	{TYPE_INTEGER,	"MaxParallelWorkers",		true,	1}
+	{TYPE_INTEGER,	"MaxParallelWorkers",		true,	1},
+	{TYPE_STRING,	"CachePolicy",				false,	"LRU"},		// page cache replacement policy
+	{TYPE_INTEGER,	"MaxInlineBlobSize",		false,	16384},		// bytes
+	{TYPE_INTEGER,	"ClientPrefetchBuffer",		false,	4 * 1048576},	// bytes
+	{TYPE_BOOLEAN,	"PartialMonitoringSnapshots",	false,	false}
 };
 
 
@@ -592,7 +603,7 @@ public:
 
 	CONFIG_GET_PER_DB_BOOL(getRemoteAccess, KEY_REMOTE_ACCESS);
 
-	CONFIG_GET_PER_DB_BOOL(getWireCompression, KEY_WIRE_COMPRESSION);
+	CONFIG_GET_PER_DB_STR(getWireCompression, KEY_WIRE_COMPRESSION);
 
 	CONFIG_GET_PER_DB_INT(getMaxIdentifierByteLength, KEY_MAX_IDENTIFIER_BYTE_LENGTH);
 
@@ -638,6 +649,14 @@ public:
 	CONFIG_GET_GLOBAL_INT(getParallelWorkers, KEY_PARALLEL_WORKERS);
 
 	CONFIG_GET_GLOBAL_INT(getMaxParallelWorkers, KEY_MAX_PARALLEL_WORKERS);
+
+	CONFIG_GET_PER_DB_STR(getCachePolicy, KEY_CACHE_POLICY);
+
+	CONFIG_GET_PER_DB_KEY(ULONG, getMaxInlineBlobSize, KEY_MAX_INLINE_BLOB_SIZE, getInt);
+
+	CONFIG_GET_PER_DB_KEY(ULONG, getClientPrefetchBuffer, KEY_CLIENT_PREFETCH_BUFFER, getInt);
+
+	CONFIG_GET_PER_DB_BOOL(getPartialMonitoringSnapshots, KEY_PARTIAL_MON_SNAPSHOTS);
 };
 
 // Implementation of interface to access master configuration file
@@ -26,6 +26,8 @@
 
 #include "../jrd/EngineInterface.h"
 #include "../jrd/jrd.h"
+#include "../jrd/btr.h"
+#include "../jrd/tra.h"
 #include "../jrd/status.h"
 #include "../jrd/exe_proto.h"
 #include "../dsql/dsql.h"
@@ -58,6 +60,32 @@ namespace {
 	private:
 		thread_db* m_tdbb;
 	};
+
+	// Deferred keys are not seen by the index lookups of the statement itself,
+	// thus they are deferred only if it calls no routines (which may read the
+	// table) and doesn't search the table using its indices
+	bool canDeferKeys(const Statement* statement, const jrd_rel* relation)
+	{
+		for (const auto& resource : statement->resources)
+		{
+			switch (resource.rsc_type)
+			{
+			case Resource::rsc_procedure:
+			case Resource::rsc_function:
+				return false;
+
+			case Resource::rsc_index:
+				if (resource.rsc_rel == relation)
+					return false;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		return true;
+	}
 }
 
 DsqlBatch::DsqlBatch(DsqlDmlRequest* req, const dsql_msg* /*message*/, IMessageMetadata* inMeta, ClumpletReader& pb)
@@ -659,6 +687,48 @@ private:
 	AutoPtr<BatchCompletionState, SimpleDispose> completionState
 		(FB_NEW BatchCompletionState(m_flags & (1 << IBatch::TAG_RECORD_COUNTS), m_detailed));
 	AutoSetRestore<bool> batchFlag(&req->req_batch_mode, true);
+
+	// Plain insert into a single table defers the insertion of keys
+	// into its non-unique indices and does it sorted at once
+	AutoPtr<BatchIndexKeys> batchKeys;
+	if (m_dsqlRequest->getDsqlStatement()->getType() == DsqlStatement::TYPE_INSERT &&
+		req->req_rpb.getCount() == 1 && req->req_rpb[0].rpb_relation &&
+		canDeferKeys(req->getStatement(), req->req_rpb[0].rpb_relation))
+	{
+		batchKeys = FB_NEW_POOL(m_dsqlRequest->getPool())
+			BatchIndexKeys(m_dsqlRequest->getPool(), req->req_rpb[0].rpb_relation);
+	}
+	AutoSetRestore<BatchIndexKeys*> batchKeysSet(&req->req_batch_keys, batchKeys);
+
+	// Records of the messages already processed are stored, their keys can't be lost
+	// whatever happens with the rest of batch, otherwise transaction must be rolled back
+	auto flushKeys = [&]()
+	{
+		try
+		{
+			batchKeys->flush(tdbb, transaction);
+		}
+		catch (const Exception&)
+		{
+			batchKeys->clear();
+			transaction->tra_flags |= TRA_invalidated;
+			throw;
+		}
+	};
+
+	Cleanup keysCleanup([&]()
+	{
+		if (batchKeys && batchKeys->hasData())
+		{
+			try
+			{
+				flushKeys();
+			}
+			catch (const Exception&)
+			{} // no-op
+		}
+	});
+
 	const dsql_msg* message = m_dsqlRequest->getDsqlStatement()->getSendMsg();
 	bool startRequest = true;
 
@@ -725,6 +795,7 @@ private:
 			remains -= m_messageSize;
 
 			UCHAR* msgBuffer = m_dsqlRequest->req_msg_buffers[message->msg_buffer_number];
+			const auto keysMark = batchKeys ? batchKeys->mark() : BatchIndexKeys::Mark();
 			try
 			{
 				// runsend data to request and collect stats
@@ -740,6 +811,10 @@ private:
 			}
 			catch (const Exception& ex)
 			{
+				// Failed message is undone together with its keys
+				if (batchKeys)
+					batchKeys->rollback(keysMark);
+
 				FbLocalStatus status;
 				ex.stuffException(&status);
 				tdbb->tdbb_status_vector->init();
@@ -756,12 +831,18 @@ private:
 
 				startRequest = true;
 			}
+
+			if (batchKeys && batchKeys->isFull())
+				flushKeys();
 		}
 
 		UCHAR* alignedData = FB_ALIGN(data, m_alignment);
 		m_messages.remained(remains, alignedData - data);
 	}
 
+	if (batchKeys)
+		flushKeys();
+
 	DEB_BATCH(fprintf(stderr, "Sent %d messages\n", completionState->getSize(tdbb->tdbb_status_vector)));
 
 	// make sure all blobs were used in messages
@@ -632,6 +632,8 @@
 #define isc_spb_nbk_clean_history	9
 #define isc_spb_nbk_keep_days		10
 #define isc_spb_nbk_keep_rows		11
+#define isc_spb_nbk_compress		12
+#define isc_spb_nbk_parallel_workers	13
 #define isc_spb_nbk_no_triggers		0x01
 #define isc_spb_nbk_inplace			0x02
 #define isc_spb_nbk_sequence		0x04
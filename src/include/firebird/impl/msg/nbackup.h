@@ -86,3 +86,10 @@ FB_IMPL_MSG(NBACKUP, 85, nbackup_clean_hist_misuse, -901, "00", "000", "Switch -
 FB_IMPL_MSG(NBACKUP, 86, nbackup_clean_hist_missed, -901, "00", "000", "-KEEP can be used only with -CLEAN_HISTORY")
 FB_IMPL_MSG(NBACKUP, 87, nbackup_keep_hist_missed, -901, "00", "000", "-KEEP is required with -CLEAN_HISTORY")
 FB_IMPL_MSG(NBACKUP, 88, nbackup_second_keep_switch, -901, "00", "000", "-KEEP can be used one time only")
+FB_IMPL_MSG(NBACKUP, 89, nbackup_zstd_unavail, -901, "00", "000", "Compression library zstd is not available")
+FB_IMPL_MSG(NBACKUP, 90, nbackup_err_codec, -901, "00", "000", "Error compressing or decompressing backup file: @1")
+FB_IMPL_MSG(NBACKUP, 91, nbackup_err_seektable, -901, "00", "000", "Missing or invalid frame index of compressed backup file: @1")
+FB_IMPL_MSG_NO_SYMBOL(NBACKUP, 92, "  -COM(PRESS) <level>                    Compress backup with zstd using given level (1-22)")
+FB_IMPL_MSG_NO_SYMBOL(NBACKUP, 93, "  -PAR(ALLEL) <n>                        Number of parallel threads used by backup and restore")
+FB_IMPL_MSG(NBACKUP, 94, nbackup_compress_misuse, -901, "00", "000", "Switch -COMPRESS can be used only with -BACKUP")
+FB_IMPL_MSG(NBACKUP, 95, nbackup_parallel_misuse, -901, "00", "000", "Switch -PARALLEL can be used only with -BACKUP or -RESTORE")
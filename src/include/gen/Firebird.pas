@@ -4316,6 +4316,8 @@ const
 	isc_spb_nbk_clean_history = byte(9);
 	isc_spb_nbk_keep_days = byte(10);
 	isc_spb_nbk_keep_rows = byte(11);
+	isc_spb_nbk_compress = byte(12);
+	isc_spb_nbk_parallel_workers = byte(13);
 	isc_spb_nbk_no_triggers = $01;
 	isc_spb_nbk_inplace = $02;
 	isc_spb_nbk_sequence = $04;
@@ -5700,6 +5702,7 @@ const
 	 isc_bad_par_workers = 335545286;
 	 isc_idx_expr_not_found = 335545287;
 	 isc_idx_cond_not_found = 335545288;
+	 isc_repl_applied = 335545289;
 	 isc_gfix_db_name = 335740929;
 	 isc_gfix_invalid_sw = 335740930;
 	 isc_gfix_incmp_sw = 335740932;
@@ -6186,6 +6189,11 @@ const
 	 isc_nbackup_clean_hist_missed = 337117270;
 	 isc_nbackup_keep_hist_missed = 337117271;
 	 isc_nbackup_second_keep_switch = 337117272;
+	 isc_nbackup_zstd_unavail = 337117273;
+	 isc_nbackup_err_codec = 337117274;
+	 isc_nbackup_err_seektable = 337117275;
+	 isc_nbackup_compress_misuse = 337117278;
+	 isc_nbackup_parallel_misuse = 337117279;
 	 isc_trace_conflict_acts = 337182750;
 	 isc_trace_act_notfound = 337182751;
 	 isc_trace_switch_once = 337182752;
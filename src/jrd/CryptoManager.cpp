@@ -1347,6 +1347,33 @@ namespace Jrd {
 		return false;
 	}
 
+	bool CryptoManager::writePlain(thread_db* tdbb, FbStatusVector* sv, IOBatchCallback* io, bool& done)
+	{
+		done = false;
+
+		try
+		{
+			// Encryption state can't change while we hold the shared lock.
+			// In slow mode or when encrypted let pages be written one by one.
+			if (!slowIO && !crypt)
+			{
+				BarSync::IoGuard ioGuard(tdbb, sync);
+				if (!slowIO && !crypt)
+				{
+					done = true;
+					return io->callback(tdbb, sv);
+				}
+			}
+
+			return true;
+		}
+		catch (const Exception& ex)
+		{
+			ex.stuffException(sv);
+		}
+		return false;
+	}
+
 	CryptoManager::IoResult CryptoManager::internalWrite(thread_db* tdbb, FbStatusVector* sv,
 		Ods::pag* page, IOCallback* io)
 	{
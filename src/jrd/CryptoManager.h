@@ -292,6 +292,16 @@ public:
 	bool read(thread_db* tdbb, FbStatusVector* sv, Ods::pag* page, IOCallback* io);
 	bool write(thread_db* tdbb, FbStatusVector* sv, Ods::pag* page, IOCallback* io);
 
+	class IOBatchCallback
+	{
+	public:
+		virtual bool callback(thread_db* tdbb, FbStatusVector* sv) = 0;
+	};
+
+	// Calls back to write a number of pages as is if the database is not encrypted,
+	// otherwise "done" is false and pages should be written one by one
+	bool writePlain(thread_db* tdbb, FbStatusVector* sv, IOBatchCallback* io, bool& done);
+
 	void cryptThread();
 
 	bool checkValidation(Firebird::IDbCryptPlugin* crypt);
@@ -0,0 +1,420 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		Histogram.cpp
+ *	DESCRIPTION:	Index key distribution statistics
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "../jrd/Histogram.h"
+#include "../jrd/ods.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+namespace
+{
+	const UCHAR HISTOGRAM_VERSION = 1;
+
+	template <typename T>
+	void put(UCharBuffer& buffer, const T& value)
+	{
+		buffer.add(reinterpret_cast<const UCHAR*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	bool get(const UCHAR*& ptr, const UCHAR* end, T& value)
+	{
+		if (end - ptr < (ptrdiff_t) sizeof(T))
+			return false;
+
+		memcpy(&value, ptr, sizeof(T));
+		ptr += sizeof(T);
+		return true;
+	}
+}
+
+
+IndexHistogram::IndexHistogram(MemoryPool& pool)
+	: PermanentStorage(pool),
+	  m_bounds(pool),
+	  m_density(pool),
+	  m_nodes(0),
+	  m_nulls(0),
+	  m_selectivity(0),
+	  m_runs(pool),
+	  m_squares(pool),
+	  m_step(1),
+	  m_segments(0),
+	  m_descending(false),
+	  m_priorNull(false)
+{
+}
+
+void IndexHistogram::start(USHORT segments, bool descending)
+{
+	m_bounds.clear();
+	m_density.clear();
+	m_nodes = m_nulls = 0;
+	m_selectivity = 0;
+
+	m_runs.clear();
+	m_runs.grow(segments);
+	m_squares.clear();
+	m_squares.grow(segments);
+
+	for (USHORT i = 0; i < segments; i++)
+	{
+		m_runs[i] = 0;
+		m_squares[i] = 0;
+	}
+
+	m_step = 1;
+	m_segments = segments;
+	m_descending = descending;
+	m_priorNull = false;
+}
+
+void IndexHistogram::add(const UCHAR* key, USHORT length, USHORT equalSegments, bool null)
+{
+	Bound bound;
+	extract(key, length, bound);
+
+	// NULLs never match anything, thus exclude them from the densities
+
+	if (null)
+		m_nulls++;
+
+	for (USHORT i = 0; i < m_segments; i++)
+	{
+		if (!null && !m_priorNull && i < equalSegments)
+			m_runs[i]++;
+		else
+		{
+			const double run = (double) m_runs[i];
+			m_squares[i] += run * run;
+			m_runs[i] = null ? 0 : 1;
+		}
+	}
+
+	m_priorNull = null;
+
+	// Keep every step-th node as a bound. When there are too many of them,
+	// drop every second one and double the step, so the buckets remain
+	// of equal depth whatever the number of nodes is.
+
+	if (m_nodes % m_step == 0)
+	{
+		if (m_bounds.getCount() == 2 * MAX_BUCKETS)
+		{
+			FB_SIZE_T count = 0;
+
+			for (FB_SIZE_T i = 0; i < m_bounds.getCount(); i += 2)
+				m_bounds[count++] = m_bounds[i];
+
+			m_bounds.shrink(count);
+			m_step *= 2;
+		}
+
+		if (m_nodes % m_step == 0)
+		{
+			bound.rank = m_nodes;
+			m_bounds.add(bound);
+		}
+	}
+
+	m_nodes++;
+}
+
+void IndexHistogram::finish(const UCHAR* lastKey, USHORT lastLength, float selectivity)
+{
+	m_selectivity = selectivity;
+
+	if (!m_nodes)
+	{
+		m_bounds.clear();
+		return;
+	}
+
+	// Flush the pending runs and calculate the densities
+
+	const double nodes = (double) m_nodes;
+	m_density.grow(m_segments);
+
+	for (USHORT i = 0; i < m_segments; i++)
+	{
+		const double run = (double) m_runs[i];
+		m_squares[i] += run * run;
+		m_density[i] = m_squares[i] / (nodes * nodes);
+	}
+
+	m_runs.free();
+	m_squares.free();
+
+	// The last node closes the last bucket
+
+	if (m_bounds.back().rank != m_nodes - 1)
+	{
+		Bound bound;
+		extract(lastKey, lastLength, bound);
+		bound.rank = m_nodes - 1;
+		m_bounds.add(bound);
+	}
+
+	// Descending index is walked from the highest value to the lowest one
+
+	if (m_descending)
+	{
+		const FB_SIZE_T count = m_bounds.getCount();
+
+		for (FB_SIZE_T i = 0; i < count / 2; i++)
+		{
+			const Bound temp = m_bounds[i];
+			m_bounds[i] = m_bounds[count - 1 - i];
+			m_bounds[count - 1 - i] = temp;
+		}
+
+		for (auto& bound : m_bounds)
+			bound.rank = m_nodes - 1 - bound.rank;
+	}
+}
+
+void IndexHistogram::serialize(UCharBuffer& buffer) const
+{
+	buffer.clear();
+
+	put(buffer, HISTOGRAM_VERSION);
+	put(buffer, (UCHAR) m_density.getCount());
+	put(buffer, m_selectivity);
+	put(buffer, m_nodes);
+	put(buffer, m_nulls);
+
+	for (const auto density : m_density)
+		put(buffer, density);
+
+	put(buffer, (USHORT) m_bounds.getCount());
+
+	for (const auto& bound : m_bounds)
+	{
+		put(buffer, bound.rank);
+		put(buffer, (UCHAR) bound.length);
+		buffer.add(bound.data, bound.length);
+	}
+}
+
+bool IndexHistogram::parse(const UCHAR* data, ULONG length)
+{
+	const UCHAR* ptr = data;
+	const UCHAR* const end = data + length;
+
+	m_bounds.clear();
+	m_density.clear();
+	m_nodes = m_nulls = 0;
+
+	UCHAR version, segments;
+	USHORT count;
+
+	if (!get(ptr, end, version) || version != HISTOGRAM_VERSION ||
+		!get(ptr, end, segments) ||
+		!get(ptr, end, m_selectivity) ||
+		!get(ptr, end, m_nodes) ||
+		!get(ptr, end, m_nulls))
+	{
+		m_nodes = 0;
+		return false;
+	}
+
+	m_density.grow(segments);
+
+	for (auto& density : m_density)
+	{
+		if (!get(ptr, end, density))
+			return false;
+	}
+
+	if (!get(ptr, end, count))
+		return false;
+
+	m_bounds.grow(count);
+
+	for (auto& bound : m_bounds)
+	{
+		UCHAR boundLength;
+
+		if (!get(ptr, end, bound.rank) ||
+			!get(ptr, end, boundLength) ||
+			boundLength > MAX_BOUND_LENGTH ||
+			end - ptr < boundLength)
+		{
+			m_bounds.clear();
+			return false;
+		}
+
+		bound.length = boundLength;
+		memcpy(bound.data, ptr, boundLength);
+		ptr += boundLength;
+	}
+
+	return true;
+}
+
+double IndexHistogram::getFraction(const UCHAR* lower, USHORT lowerLength,
+	const UCHAR* upper, USHORT upperLength) const
+{
+	if (isEmpty())
+		return 0;
+
+	UCHAR buffer[MAX_BOUND_LENGTH];
+
+	// NULLs are the lowest values, but never match a range
+
+	double from = (double) m_nulls;
+	double to = (double) m_nodes;
+
+	if (lower)
+		from = MAX(from, position(buffer, normalize(lower, lowerLength, buffer), false));
+
+	if (upper)
+		to = position(buffer, normalize(upper, upperLength, buffer), true);
+
+	return (to > from) ? (to - from) / m_nodes : 0;
+}
+
+double IndexHistogram::getFrequency(const UCHAR* key, USHORT length) const
+{
+	if (isEmpty())
+		return 0;
+
+	UCHAR buffer[MAX_BOUND_LENGTH];
+	length = normalize(key, length, buffer);
+
+	// The value is frequent if it repeats in a few bounds, otherwise
+	// the selectivity tells more about it than the histogram
+
+	unsigned matches = 0;
+
+	for (const auto& bound : m_bounds)
+	{
+		const int result = compare(bound, buffer, length);
+
+		if (result > 0)
+			break;
+
+		if (!result)
+			matches++;
+	}
+
+	if (matches < 2)
+		return 0;
+
+	const double count = position(buffer, length, true) - position(buffer, length, false);
+	return count / m_nodes;
+}
+
+USHORT IndexHistogram::normalize(const UCHAR* key, USHORT length, UCHAR* buffer)
+{
+	// Bounds are truncated and the zero padding of the compound key
+	// is indistinguishable from the trailing zeroes of the segment value,
+	// so keys are compared without them
+
+	length = MIN(length, MAX_BOUND_LENGTH);
+
+	while (length && !key[length - 1])
+		length--;
+
+	memcpy(buffer, key, length);
+	return length;
+}
+
+int IndexHistogram::compare(const Bound& bound, const UCHAR* key, USHORT length)
+{
+	const int result = memcmp(bound.data, key, MIN(bound.length, length));
+
+	if (result)
+		return result;
+
+	return (bound.length > length) ? 1 : (bound.length < length) ? -1 : 0;
+}
+
+void IndexHistogram::extract(const UCHAR* key, USHORT length, Bound& bound) const
+{
+	const UCHAR mask = m_descending ? 0xFF : 0;
+	USHORT count = 0;
+
+	if (m_segments == 1)
+	{
+		count = MIN(length, MAX_BOUND_LENGTH);
+
+		for (USHORT i = 0; i < count; i++)
+			bound.data[i] = key[i] ^ mask;
+	}
+	else
+	{
+		// Compound key is made of groups of the segment number followed
+		// by STUFF_COUNT bytes of the segment value, the first segment
+		// has the highest number
+
+		for (USHORT pos = 0; pos < length && count < MAX_BOUND_LENGTH; pos += Ods::STUFF_COUNT + 1)
+		{
+			if ((key[pos] ^ mask) != m_segments)
+				break;
+
+			for (USHORT i = pos + 1;
+				 i <= pos + Ods::STUFF_COUNT && i < length && count < MAX_BOUND_LENGTH; i++)
+			{
+				bound.data[count++] = key[i] ^ mask;
+			}
+		}
+	}
+
+	while (count && !bound.data[count - 1])
+		count--;
+
+	bound.length = count;
+}
+
+double IndexHistogram::position(const UCHAR* key, USHORT length, bool inclusive) const
+{
+	// Estimate the number of nodes less than (or equal to) the key.
+	// The key is located between two adjacent bounds, assume it
+	// in the middle of them.
+
+	FB_SIZE_T lo = 0, hi = m_bounds.getCount();
+
+	while (lo < hi)
+	{
+		const FB_SIZE_T mid = (lo + hi) / 2;
+		const int result = compare(m_bounds[mid], key, length);
+
+		if (result < 0 || (inclusive && !result))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0)
+		return 0;
+
+	if (lo == m_bounds.getCount())
+		return (double) m_nodes;
+
+	const double prior = (double) (m_bounds[lo - 1].rank + 1);
+	const double next = (double) m_bounds[lo].rank;
+
+	return (prior + next) / 2;
+}
@@ -0,0 +1,121 @@
+/*
+ *	PROGRAM:	JRD Access Method
+ *	MODULE:		Histogram.h
+ *	DESCRIPTION:	Index key distribution statistics
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#ifndef JRD_HISTOGRAM_H
+#define JRD_HISTOGRAM_H
+
+#include "firebird.h"
+#include "../common/classes/alloc.h"
+#include "../common/classes/array.h"
+
+namespace Jrd
+{
+
+// Equi-depth histogram of the first index segment and densities of all
+// segment prefixes. It's gathered while walking the index leaf level when
+// the index statistics are recalculated (see BTR_selectivity) and stored
+// in RDB$INDICES.RDB$HISTOGRAM.
+//
+// Bounds are kept as first segment keys in the ascending order, i.e. not
+// complemented for descending indices and without segment numbers for
+// compound ones. Density of a segment prefix is the sum of squared counts
+// of every distinct non-NULL value divided by the squared number of nodes,
+// i.e. the probability for two random nodes to match. Unlike the selectivity
+// it's not fooled by a few values that cover most of the index.
+
+class IndexHistogram : public Firebird::PermanentStorage
+{
+public:
+	static const unsigned MAX_BUCKETS = 64;
+	static const unsigned MAX_BOUND_LENGTH = 64;
+
+	explicit IndexHistogram(MemoryPool& pool);
+
+	// Gathering, keys are passed as they're stored in the index
+	void start(USHORT segments, bool descending);
+	void add(const UCHAR* key, USHORT length, USHORT equalSegments, bool null);
+	void finish(const UCHAR* lastKey, USHORT lastLength, float selectivity);
+
+	void serialize(Firebird::UCharBuffer& buffer) const;
+	bool parse(const UCHAR* data, ULONG length);
+
+	bool isEmpty() const
+	{
+		return !m_nodes || m_bounds.isEmpty();
+	}
+
+	// Selectivity of the last segment the histogram was gathered with,
+	// used to detect whether it's still in sync with the index root page
+	float getSelectivity() const
+	{
+		return m_selectivity;
+	}
+
+	// Estimations, keys are first segment keys made by BTR_make_value_key
+
+	// Fraction of non-NULL nodes between the given bounds (both inclusive),
+	// missing key means no bound
+	double getFraction(const UCHAR* lower, USHORT lowerLength,
+					   const UCHAR* upper, USHORT upperLength) const;
+
+	// Fraction of nodes equal to the given value if it's frequent enough
+	// to be noticed by the histogram, zero otherwise
+	double getFrequency(const UCHAR* key, USHORT length) const;
+
+	// Density of the segment prefix (see above), zero if not known
+	double getDensity(USHORT segment) const
+	{
+		return (segment < m_density.getCount()) ? m_density[segment] : 0;
+	}
+
+private:
+	struct Bound
+	{
+		FB_UINT64 rank;					// number of nodes before this one
+		USHORT length;
+		UCHAR data[MAX_BOUND_LENGTH];
+	};
+
+	static USHORT normalize(const UCHAR* key, USHORT length, UCHAR* buffer);
+	static int compare(const Bound& bound, const UCHAR* key, USHORT length);
+
+	void extract(const UCHAR* key, USHORT length, Bound& bound) const;
+	double position(const UCHAR* key, USHORT length, bool inclusive) const;
+
+	Firebird::Array<Bound> m_bounds;
+	Firebird::HalfStaticArray<double, 4> m_density;
+	FB_UINT64 m_nodes;
+	FB_UINT64 m_nulls;
+	float m_selectivity;
+
+	// Gathering state
+	Firebird::HalfStaticArray<FB_UINT64, 4> m_runs;
+	Firebird::HalfStaticArray<double, 4> m_squares;
+	FB_UINT64 m_step;
+	USHORT m_segments;
+	bool m_descending;
+	bool m_priorNull;
+};
+
+} // namespace Jrd
+
+#endif // JRD_HISTOGRAM_H
@@ -47,6 +47,8 @@
 #include "../jrd/Monitoring.h"
 #include "../jrd/Function.h"
 #include "../jrd/optimizer/Optimizer.h"
+#include "../dsql/BoolNodes.h"
+#include "../dsql/ExprNodes.h"
 
 #ifdef WIN_NT
 #include <process.h>
@@ -103,12 +105,252 @@ namespace
 
 	const ULONG HEADER_SIZE = FB_ALIGN(sizeof(MonitoringHeader), FB_ALIGNMENT);
 
+	// Kinds of object identifiers linking rows of different monitoring relations
+
+	enum ObjectKind
+	{
+		KIND_NONE,
+		KIND_ATTACHMENT,
+		KIND_TRANSACTION,
+		KIND_STATEMENT,
+		KIND_STATISTICS
+	};
+
+	ObjectKind getObjectKind(int rel_id, USHORT field_id)
+	{
+		switch (rel_id)
+		{
+		case rel_mon_database:
+			if (field_id == f_mon_db_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_attachments:
+			if (field_id == f_mon_att_id)
+				return KIND_ATTACHMENT;
+			if (field_id == f_mon_att_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_transactions:
+			if (field_id == f_mon_tra_id)
+				return KIND_TRANSACTION;
+			if (field_id == f_mon_tra_att_id)
+				return KIND_ATTACHMENT;
+			if (field_id == f_mon_tra_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_statements:
+			if (field_id == f_mon_stmt_id)
+				return KIND_STATEMENT;
+			if (field_id == f_mon_stmt_att_id)
+				return KIND_ATTACHMENT;
+			if (field_id == f_mon_stmt_tra_id)
+				return KIND_TRANSACTION;
+			if (field_id == f_mon_stmt_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_calls:
+			if (field_id == f_mon_call_stmt_id)
+				return KIND_STATEMENT;
+			if (field_id == f_mon_call_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_compiled_statements:
+			if (field_id == f_mon_cmp_stmt_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_ctx_vars:
+			if (field_id == f_mon_ctx_var_att_id)
+				return KIND_ATTACHMENT;
+			if (field_id == f_mon_ctx_var_tra_id)
+				return KIND_TRANSACTION;
+			break;
+
+		case rel_mon_io_stats:
+			if (field_id == f_mon_io_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_rec_stats:
+			if (field_id == f_mon_rec_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_tab_stats:
+			if (field_id == f_mon_tab_stat_id)
+				return KIND_STATISTICS;
+			break;
+
+		case rel_mon_mem_usage:
+			if (field_id == f_mon_mem_stat_id)
+				return KIND_STATISTICS;
+			break;
+		}
+
+		return KIND_NONE;
+	}
+
+	bool isStatGroup(int rel_id, USHORT field_id)
+	{
+		return (rel_id == rel_mon_io_stats && field_id == f_mon_io_stat_group) ||
+			(rel_id == rel_mon_rec_stats && field_id == f_mon_rec_stat_group) ||
+			(rel_id == rel_mon_tab_stats && field_id == f_mon_tab_stat_group) ||
+			(rel_id == rel_mon_mem_usage && field_id == f_mon_mem_stat_group);
+	}
+
+	bool isInteger(const ValueExprNode* node, SLONG value)
+	{
+		const auto literal = nodeAs<LiteralNode>(node);
+
+		return literal && literal->litDesc.dsc_dtype == dtype_long &&
+			!literal->litDesc.dsc_scale && literal->getSlong() == value;
+	}
+
+	bool isConnectionId(const ValueExprNode* node)
+	{
+		const auto infoNode = nodeAs<InternalInfoNode>(node);
+		return infoNode && isInteger(infoNode->arg, INFO_TYPE_CONNECTION_ID);
+	}
+
 } // namespace
 
 
+// MonitoringFilter class
+
+void MonitoringFilter::addStream(StreamType stream, int rel_id, const BooleanList& booleans)
+{
+	m_relations |= getRelationBit(rel_id);
+
+	StreamScope item;
+	item.stream = stream;
+	item.rel_id = rel_id;
+	item.scope = (rel_id == rel_mon_database) ? SCOPE_DATABASE : SCOPE_ALL;
+	item.master = INVALID_STREAM;
+
+	for (const auto boolean : booleans)
+	{
+		const auto cmpNode = nodeAs<ComparativeBoolNode>(boolean);
+
+		if (!cmpNode || cmpNode->blrOp != blr_eql)
+			continue;
+
+		for (int i = 0; i < 2; i++)
+		{
+			const ValueExprNode* const arg1 = i ? cmpNode->arg2 : cmpNode->arg1;
+			const ValueExprNode* const arg2 = i ? cmpNode->arg1 : cmpNode->arg2;
+
+			const auto field = nodeAs<FieldNode>(arg1);
+
+			if (!field || field->fieldStream != stream)
+				continue;
+
+			const auto kind = getObjectKind(rel_id, field->fieldId);
+
+			if (isStatGroup(rel_id, field->fieldId) && isInteger(arg2, stat_database))
+				item.scope = SCOPE_DATABASE;
+			else if (kind == KIND_ATTACHMENT && isConnectionId(arg2))
+				item.scope = MIN(item.scope, SCOPE_SELF);
+			else if (kind != KIND_NONE && item.master == INVALID_STREAM)
+			{
+				// Stream may be restricted by the other monitoring stream,
+				// if they're joined by the identifier of the same object kind
+
+				const auto masterField = nodeAs<FieldNode>(arg2);
+
+				if (!masterField || masterField->fieldStream == stream)
+					continue;
+
+				for (const auto& master : m_streams)
+				{
+					if (master.stream == masterField->fieldStream &&
+						getObjectKind(master.rel_id, masterField->fieldId) == kind)
+					{
+						item.master = master.stream;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	// The same stream may be passed again, keep the widest of its scopes then
+
+	for (auto& existing : m_streams)
+	{
+		if (existing.stream == stream)
+		{
+			existing.scope = MAX(existing.scope, item.scope);
+
+			if (existing.master != item.master)
+				existing.master = INVALID_STREAM;
+
+			return;
+		}
+	}
+
+	m_streams.add(item);
+}
+
+
+MonitoringFilter::Scope MonitoringFilter::getScope() const
+{
+	Scope scope = SCOPE_DATABASE;
+
+	for (FB_SIZE_T i = 0; i < m_streams.getCount(); i++)
+		scope = MAX(scope, getScope(i));
+
+	return scope;
+}
+
+
+MonitoringFilter::Scope MonitoringFilter::getScope(FB_SIZE_T pos) const
+{
+	const auto& item = m_streams[pos];
+
+	if (item.master != INVALID_STREAM)
+	{
+		// Master is always registered before the streams depending on it
+
+		for (FB_SIZE_T i = 0; i < pos; i++)
+		{
+			if (m_streams[i].stream == item.master)
+				return MIN(item.scope, getScope(i));
+		}
+	}
+
+	return item.scope;
+}
+
+
+// MonitoringTableScan class
+
+MonitoringTableScan::MonitoringTableScan(CompilerScratch* csb, const string& alias,
+										 StreamType stream, jrd_rel* relation,
+										 const MonitoringFilter::BooleanList& booleans)
+	: VirtualTableScan(csb, alias, stream, relation)
+{
+	if (!csb->csb_mon_filter)
+		csb->csb_mon_filter = FB_NEW_POOL(csb->csb_pool) MonitoringFilter(csb->csb_pool);
+
+	csb->csb_mon_filter->addStream(stream, relation->rel_id, booleans);
+
+	m_filter = csb->csb_mon_filter;
+	m_snapshotImpure = csb->allocImpure<MonitoringSnapshot*>();
+}
+
+
 const Format* MonitoringTableScan::getFormat(thread_db* tdbb, jrd_rel* relation) const
 {
-	MonitoringSnapshot* const snapshot = MonitoringSnapshot::create(tdbb);
+	// The scan is being opened, choose the snapshot to use until it's closed
+
+	MonitoringSnapshot* const snapshot = MonitoringSnapshot::create(tdbb, m_filter);
+	*tdbb->getRequest()->getImpure<MonitoringSnapshot*>(m_snapshotImpure) = snapshot;
+
 	return snapshot->getData(relation)->getFormat();
 }
 
@@ -116,7 +358,9 @@ const Format* MonitoringTableScan::getFormat(thread_db* tdbb, jrd_rel* relation)
 bool MonitoringTableScan::retrieveRecord(thread_db* tdbb, jrd_rel* relation,
 										 FB_UINT64 position, Record* record) const
 {
-	MonitoringSnapshot* const snapshot = MonitoringSnapshot::create(tdbb);
+	MonitoringSnapshot* const snapshot =
+		*tdbb->getRequest()->getImpure<MonitoringSnapshot*>(m_snapshotImpure);
+
 	if (!snapshot->getData(relation)->fetch(position, record))
 		return false;
 
@@ -279,11 +523,12 @@ void MonitoringData::enumerate(const char* userName, ULONG generation, SessionLi
 }
 
 
-void MonitoringData::read(const char* userName, TempSpace& temp)
+void MonitoringData::read(const char* userName, FB_UINT64 relations, TempSpace& temp)
 {
 	offset_t position = temp.getSize();
 
-	// Copy data of all permitted sessions
+	// Copy data of all permitted sessions, skipping records of relations not asked for.
+	// Every record is prefixed with its length and starts with the relation id.
 
 	for (ULONG offset = HEADER_SIZE; offset < m_sharedMemory->getHeader()->used;)
 	{
@@ -293,8 +538,38 @@ void MonitoringData::read(const char* userName, TempSpace& temp)
 
 		if (!userName || !strcmp(element->userName, userName)) // permitted
 		{
-			temp.write(position, ptr + sizeof(Element), element->length);
-			position += element->length;
+			const UCHAR* const end = ptr + sizeof(Element) + element->length;
+			const UCHAR* run = ptr + sizeof(Element);
+
+			for (const UCHAR* record = run; record < end;)
+			{
+				ULONG recordLength;
+				memcpy(&recordLength, record, sizeof(ULONG));
+
+				const UCHAR* const next = record + sizeof(ULONG) + recordLength;
+
+				if (!recordLength ||
+					!(relations & MonitoringFilter::getRelationBit(record[sizeof(ULONG)])))
+				{
+					// Copy the preceding records at once and skip this one
+
+					if (record > run)
+					{
+						temp.write(position, run, record - run);
+						position += record - run;
+					}
+
+					run = next;
+				}
+
+				record = next;
+			}
+
+			if (end > run)
+			{
+				temp.write(position, run, end - run);
+				position += end - run;
+			}
 		}
 
 		offset += length;
@@ -424,25 +699,42 @@ bool MonitoringData::initialize(SharedMemoryBase* sm, bool initialize)
 // MonitoringSnapshot class
 
 
-MonitoringSnapshot* MonitoringSnapshot::create(thread_db* tdbb)
+MonitoringSnapshot* MonitoringSnapshot::create(thread_db* tdbb, const MonitoringFilter* filter)
 {
 	const auto transaction = tdbb->getTransaction();
 	fb_assert(transaction);
 
-	if (!transaction->tra_mon_snapshot)
+	// Unless partial snapshots are allowed, the complete snapshot is taken,
+	// so all the statements of the transaction see the same data
+
+	const bool partial = tdbb->getDatabase()->dbb_config->getPartialMonitoringSnapshots();
+
+	const auto relations = partial ? filter->getRelations() : MonitoringFilter::ALL_RELATIONS;
+	const auto scope = partial ? filter->getScope() : MonitoringFilter::SCOPE_ALL;
+
+	for (auto snapshot = transaction->tra_mon_snapshot; snapshot; snapshot = snapshot->m_next)
 	{
-		// Create a database snapshot and store it
-		// in the transaction block
-		MemoryPool& pool = *transaction->tra_pool;
-		transaction->tra_mon_snapshot = FB_NEW_POOL(pool) MonitoringSnapshot(tdbb, pool);
+		if ((snapshot->m_relations & relations) == relations && snapshot->m_scope >= scope)
+			return snapshot;
 	}
 
-	return transaction->tra_mon_snapshot;
+	// Create a database snapshot and store it
+	// in the transaction block
+	MemoryPool& pool = *transaction->tra_pool;
+	const auto snapshot = FB_NEW_POOL(pool) MonitoringSnapshot(tdbb, pool, relations, scope);
+	snapshot->m_next = transaction->tra_mon_snapshot;
+	transaction->tra_mon_snapshot = snapshot;
+
+	return snapshot;
 }
 
 
-MonitoringSnapshot::MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool)
-	: SnapshotData(pool)
+MonitoringSnapshot::MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool, FB_UINT64 relations,
+									   MonitoringFilter::Scope scope)
+	: SnapshotData(pool),
+	  m_relations(relations),
+	  m_scope(scope),
+	  m_next(nullptr)
 {
 	PAG_header(tdbb, true);
 
@@ -451,77 +743,89 @@ MonitoringSnapshot::MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool)
 
 	const auto selfAttId = attachment->att_attachment_id;
 
-	// Initialize record buffers
-	const auto dbb_buffer = allocBuffer(tdbb, pool, rel_mon_database);
-	const auto att_buffer = allocBuffer(tdbb, pool, rel_mon_attachments);
-	const auto tra_buffer = allocBuffer(tdbb, pool, rel_mon_transactions);
+	// Initialize record buffers of the relations asked for
+
+	const auto allocRelation = [&](int rel_id) -> RecordBuffer*
+	{
+		return (relations & MonitoringFilter::getRelationBit(rel_id)) ?
+			allocBuffer(tdbb, pool, rel_id) : nullptr;
+	};
+
+	const auto dbb_buffer = allocRelation(rel_mon_database);
+	const auto att_buffer = allocRelation(rel_mon_attachments);
+	const auto tra_buffer = allocRelation(rel_mon_transactions);
 	const auto cmp_stmt_buffer = dbb->getEncodedOdsVersion() >= ODS_13_1 ?
-		allocBuffer(tdbb, pool, rel_mon_compiled_statements) :
+		allocRelation(rel_mon_compiled_statements) :
 		nullptr;
-	const auto stmt_buffer = allocBuffer(tdbb, pool, rel_mon_statements);
-	const auto call_buffer = allocBuffer(tdbb, pool, rel_mon_calls);
-	const auto io_stat_buffer = allocBuffer(tdbb, pool, rel_mon_io_stats);
-	const auto rec_stat_buffer = allocBuffer(tdbb, pool, rel_mon_rec_stats);
-	const auto ctx_var_buffer = allocBuffer(tdbb, pool, rel_mon_ctx_vars);
-	const auto mem_usage_buffer = allocBuffer(tdbb, pool, rel_mon_mem_usage);
-	const auto tab_stat_buffer = allocBuffer(tdbb, pool, rel_mon_tab_stats);
+	const auto stmt_buffer = allocRelation(rel_mon_statements);
+	const auto call_buffer = allocRelation(rel_mon_calls);
+	const auto io_stat_buffer = allocRelation(rel_mon_io_stats);
+	const auto rec_stat_buffer = allocRelation(rel_mon_rec_stats);
+	const auto ctx_var_buffer = allocRelation(rel_mon_ctx_vars);
+	const auto mem_usage_buffer = allocRelation(rel_mon_mem_usage);
+	const auto tab_stat_buffer = allocRelation(rel_mon_tab_stats);
 
-	// Increment the global monitor generation
+	const auto locksmith = attachment->locksmith(tdbb, MONITOR_ANY_ATTACHMENT);
+	const auto userName = attachment->getEffectiveUserName();
+	const auto userNamePtr = locksmith ? nullptr : userName.c_str();
 
-	const auto generation = dbb->newMonitorGeneration();
+	if (scope == MonitoringFilter::SCOPE_ALL)
+	{
+		// Increment the global monitor generation
 
-	// Dump state of our own attachment
+		const auto generation = dbb->newMonitorGeneration();
 
-	Monitoring::dumpAttachment(tdbb, attachment, generation);
+		// Dump state of our own attachment
 
-	// Enumerate active sessions and ensure they have dumped their state.
-	// Check that by comparing the session generation with the current one.
+		Monitoring::dumpAttachment(tdbb, attachment, generation);
 
-	const auto locksmith = attachment->locksmith(tdbb, MONITOR_ANY_ATTACHMENT);
-	const auto userName = attachment->getEffectiveUserName();
-	const auto userNamePtr = locksmith ? nullptr : userName.c_str();
+		// Enumerate active sessions and ensure they have dumped their state.
+		// Check that by comparing the session generation with the current one.
+		// Note that the whole state is always dumped, as the dump of an idle
+		// session is reused by the subsequent snapshots.
 
-	Lock temp_lock(tdbb, sizeof(AttNumber), LCK_monitor), *lock = &temp_lock;
-	MonitoringData::SessionList sessions(pool);
+		Lock temp_lock(tdbb, sizeof(AttNumber), LCK_monitor), *lock = &temp_lock;
+		MonitoringData::SessionList sessions(pool);
 
-	do
-	{
-		ThreadStatusGuard tempStatus(tdbb);
+		do
+		{
+			ThreadStatusGuard tempStatus(tdbb);
 
-		{ // scope for the guard
+			{ // scope for the guard
 
-			MonitoringData::Guard guard(dbb->dbb_monitoring_data);
-			dbb->dbb_monitoring_data->enumerate(userNamePtr, generation, sessions);
-		}
+				MonitoringData::Guard guard(dbb->dbb_monitoring_data);
+				dbb->dbb_monitoring_data->enumerate(userNamePtr, generation, sessions);
+			}
 
-		if (!sessions.hasData())
-			break;
+			if (!sessions.hasData())
+				break;
 
-		const auto attId = sessions.pop();
-		fb_assert(attId != selfAttId);
-		lock->setKey(attId);
+			const auto attId = sessions.pop();
+			fb_assert(attId != selfAttId);
+			lock->setKey(attId);
 
-		// Try getting an exclusive lock first.
-		// Success means session is dead and must be garbage collected.
+			// Try getting an exclusive lock first.
+			// Success means session is dead and must be garbage collected.
 
-		if (LCK_lock(tdbb, lock, LCK_EX, LCK_NO_WAIT))
-		{
-			LCK_release(tdbb, lock);
-			dbb->dbb_monitoring_data->cleanup(attId);
-			continue;
-		}
+			if (LCK_lock(tdbb, lock, LCK_EX, LCK_NO_WAIT))
+			{
+				LCK_release(tdbb, lock);
+				dbb->dbb_monitoring_data->cleanup(attId);
+				continue;
+			}
 
-		// Ping the session via AST to dump its state
+			// Ping the session via AST to dump its state
 
-		if (!LCK_lock(tdbb, lock, LCK_SR, LCK_WAIT))
-		{
-			fb_assert(false);
-			ERR_punt();
-		}
+			if (!LCK_lock(tdbb, lock, LCK_SR, LCK_WAIT))
+			{
+				fb_assert(false);
+				ERR_punt();
+			}
 
-		LCK_release(tdbb, lock);
+			LCK_release(tdbb, lock);
 
-	} while (sessions.hasData());
+		} while (sessions.hasData());
+	}
 
 	// Collect monitoring data. Start by gathering database-level info,
 	// it goes directly to the temporary space (as it's not stored in the shared dump).
@@ -536,13 +840,25 @@ MonitoringSnapshot::MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool)
 		Monitoring::putDatabase(tdbb, tempRecord);
 	}
 
-	// Read the dump into a temporary space
+	if (scope == MonitoringFilter::SCOPE_SELF)
+	{
+		// Nothing but our own attachment is asked for, so dump its state
+		// directly into the temporary space, other sessions are not bothered
+
+		attachment->mergeStats();
 
-	{ // scope for the guard
+		TempWriter writer(temp_space);
+		SnapshotData::DumpRecord tempRecord(pool, writer);
+
+		Monitoring::dumpAttachment(tdbb, attachment, tempRecord);
+	}
+	else if (scope == MonitoringFilter::SCOPE_ALL)
+	{
+		// Read the dump into a temporary space
 
 		MonitoringData::Guard guard(dbb->dbb_monitoring_data);
 
-		dbb->dbb_monitoring_data->read(userNamePtr, temp_space);
+		dbb->dbb_monitoring_data->read(userNamePtr, relations, temp_space);
 	}
 
 	// Parse the dump
@@ -620,6 +936,12 @@ MonitoringSnapshot::MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool)
 }
 
 
+MonitoringSnapshot::~MonitoringSnapshot()
+{
+	delete m_next;
+}
+
+
 void SnapshotData::clearSnapshot()
 {
 	for (FB_SIZE_T i = 0; i < m_snapshot.getCount(); i++)
@@ -1477,6 +1799,17 @@ void Monitoring::dumpAttachment(thread_db* tdbb, Attachment* attachment, ULONG g
 	DumpWriter writer(dbb->dbb_monitoring_data, attId, userName.c_str(), generation);
 	SnapshotData::DumpRecord record(pool, writer);
 
+	dumpAttachment(tdbb, attachment, record);
+}
+
+
+void Monitoring::dumpAttachment(thread_db* tdbb, Attachment* attachment, SnapshotData::DumpRecord& record)
+{
+	if (!attachment->att_user)
+		return;
+
+	const auto dbb = tdbb->getDatabase();
+
 	putAttachment(record, attachment);
 
 	jrd_tra* transaction = nullptr;
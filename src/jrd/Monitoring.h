@@ -35,6 +35,7 @@
 namespace Jrd {
 
 // forward declarations
+class BoolExprNode;
 class jrd_rel;
 class Record;
 class RecordBuffer;
@@ -336,7 +337,7 @@ public:
 	void release();
 
 	void enumerate(const char*, ULONG, SessionList&);
-	void read(const char*, TempSpace&);
+	void read(const char*, FB_UINT64, TempSpace&);
 	ULONG setup(AttNumber, const char*, ULONG);
 	void write(ULONG, ULONG, const void*);
 
@@ -355,28 +356,107 @@ private:
 };
 
 
+// Monitoring data asked for by the statement. Every monitoring table scan
+// registers its stream here, along with the scope of data it may return
+// according to the booleans applied to the stream directly:
+//
+//	database	MON$DATABASE or statistics with MON$STAT_GROUP = 0
+//	self		MON$ATTACHMENT_ID = CURRENT_CONNECTION
+//	all			anything else
+//
+// Stream joined to another monitoring stream by an object identifier
+// (MON$STAT_ID, MON$ATTACHMENT_ID, etc) cannot return more than its master.
+// The widest scope among the streams is used for the snapshot.
+
+class MonitoringFilter
+{
+public:
+	enum Scope
+	{
+		SCOPE_DATABASE,
+		SCOPE_SELF,
+		SCOPE_ALL
+	};
+
+	typedef Firebird::HalfStaticArray<BoolExprNode*, 8> BooleanList;
+
+	explicit MonitoringFilter(MemoryPool& pool)
+		: m_streams(pool), m_relations(0)
+	{}
+
+	static const FB_UINT64 ALL_RELATIONS = ~((FB_UINT64) 0);
+
+	static FB_UINT64 getRelationBit(int rel_id)
+	{
+		fb_assert(rel_id >= 0 && rel_id < 64);
+		return ((FB_UINT64) 1) << rel_id;
+	}
+
+	void addStream(StreamType stream, int rel_id, const BooleanList& booleans);
+
+	FB_UINT64 getRelations() const
+	{
+		return m_relations;
+	}
+
+	Scope getScope() const;
+
+private:
+	struct StreamScope
+	{
+		StreamType stream;
+		int rel_id;
+		Scope scope;
+		StreamType master;	// stream restricting this one, if any
+	};
+
+	Scope getScope(FB_SIZE_T pos) const;
+
+	Firebird::HalfStaticArray<StreamScope, 4> m_streams;
+	FB_UINT64 m_relations;
+};
+
+
 class MonitoringTableScan: public VirtualTableScan
 {
 public:
 	MonitoringTableScan(CompilerScratch* csb, const Firebird::string& alias,
-						StreamType stream, jrd_rel* relation)
-		: VirtualTableScan(csb, alias, stream, relation)
-	{}
+						StreamType stream, jrd_rel* relation,
+						const MonitoringFilter::BooleanList& booleans);
 
 protected:
 	const Format* getFormat(thread_db* tdbb, jrd_rel* relation) const override;
 	bool retrieveRecord(thread_db* tdbb, jrd_rel* relation, FB_UINT64 position,
 		Record* record) const override;
+
+private:
+	const MonitoringFilter* m_filter;
+	ULONG m_snapshotImpure;
 };
 
 
+// Snapshots are kept in the transaction block until its end. By default, the
+// complete snapshot is created once and used by all the statements of the
+// transaction. If PartialMonitoringSnapshots is enabled, data asked for by
+// the statement is taken from the latest snapshot covering it, otherwise
+// a new snapshot is created and the older ones are kept intact, as they may
+// be still in use by the open cursors.
+
 class MonitoringSnapshot : public SnapshotData
 {
 public:
-	static MonitoringSnapshot* create(thread_db* tdbb);
+	static MonitoringSnapshot* create(thread_db* tdbb, const MonitoringFilter* filter);
+
+	~MonitoringSnapshot();
 
 protected:
-	MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool);
+	MonitoringSnapshot(thread_db* tdbb, MemoryPool& pool, FB_UINT64 relations,
+		MonitoringFilter::Scope scope);
+
+private:
+	const FB_UINT64 m_relations;
+	const MonitoringFilter::Scope m_scope;
+	MonitoringSnapshot* m_next;
 };
 
 
@@ -399,6 +479,7 @@ public:
 	static SnapshotData* getSnapshot(thread_db* tdbb);
 
 	static void dumpAttachment(thread_db* tdbb, Attachment* attachment, ULONG generation);
+	static void dumpAttachment(thread_db* tdbb, Attachment* attachment, SnapshotData::DumpRecord&);
 
 	static void publishAttachment(thread_db* tdbb);
 	static void cleanupAttachment(thread_db* tdbb);
@@ -581,6 +581,62 @@ void jrd_rel::GCExclusive::release()
 }
 
 
+/// FreeSpaceMap
+
+void FreeSpaceMap::clear()
+{
+	for (unsigned n = 0; n < SLOTS; n++)
+	{
+		for (auto& page : getSlot(n).pages)
+			page.store(0, std::memory_order_relaxed);
+	}
+}
+
+int FreeSpaceMap::getBucket(ULONG pageSize, ULONG size)
+{
+	int bucket = BUCKETS - 1;
+
+	while (bucket >= 0 && (pageSize >> (bucket + 1)) < size)
+		bucket--;
+
+	return bucket;
+}
+
+void FreeSpaceMap::put(ULONG pageSize, ULONG page, ULONG space, unsigned slot)
+{
+	// Nearly full pages are not worth to remember
+
+	unsigned bucket = 0;
+	while (bucket < BUCKETS && space < (pageSize >> (bucket + 1)))
+		bucket++;
+
+	std::atomic<ULONG>* const target = (bucket < BUCKETS) ? &getSlot(slot).pages[bucket] : nullptr;
+
+	remove(page, target);
+
+	if (target && target->load(std::memory_order_relaxed) != page)
+		target->store(page, std::memory_order_relaxed);
+}
+
+// Forget the page everywhere except of the given entry. Entries are read first
+// and only the matching ones are changed, thus the cache lines of other slots
+// are not written to.
+void FreeSpaceMap::remove(ULONG page, const std::atomic<ULONG>* keep)
+{
+	for (unsigned n = 0; n < SLOTS; n++)
+	{
+		for (auto& entry : getSlot(n).pages)
+		{
+			if (&entry == keep || entry.load(std::memory_order_relaxed) != page)
+				continue;
+
+			ULONG expected = page;
+			entry.compare_exchange_strong(expected, 0, std::memory_order_relaxed);
+		}
+	}
+}
+
+
 /// RelationPages
 
 void RelationPages::free(RelationPages*& nextFree)
@@ -593,7 +649,8 @@ void RelationPages::free(RelationPages*& nextFree)
 
 	rel_index_root = rel_data_pages = 0;
 	rel_slot_space = rel_pri_data_space = rel_sec_data_space = 0;
-	rel_last_free_pri_dp = rel_last_free_blb_dp = 0;
+	rel_pri_space.clear();
+	rel_blb_space.clear();
 	rel_instance_id = 0;
 
 	dpMap.clear();
@@ -28,6 +28,7 @@
 #include "../jrd/pag.h"
 #include "../jrd/val.h"
 #include "../jrd/Attachment.h"
+#include <atomic>
 
 namespace Jrd
 {
@@ -66,6 +67,78 @@ typedef Firebird::SortedArray<ViewContext*, Firebird::EmptyStorage<ViewContext*>
 		USHORT, ViewContext> ViewContexts;
 
 
+// Data pages known to have free space. Pages are grouped into buckets by the
+// amount of free space and every bucket has a few slots. Inserters prefer the
+// slot derived from their attachment, thus concurrent attachments put records
+// into different pages instead of competing for the same page and for its
+// pointer page. Map is just a hint, every page got from it must be verified.
+
+class FreeSpaceMap
+{
+public:
+	// Pages with at least 1/2, 1/4, 1/8 and 1/16 of the page size free
+	static const unsigned BUCKETS = 4;
+	static const unsigned SLOTS = 8;
+
+	FreeSpaceMap()
+	{
+		for (unsigned n = 0; n < SLOTS; n++)
+			new(&getSlot(n)) Slot;
+
+		clear();
+	}
+
+	// Slots are placed depending on the object address
+	FreeSpaceMap(const FreeSpaceMap&) = delete;
+	FreeSpaceMap& operator=(const FreeSpaceMap&) = delete;
+
+	void clear();
+
+	// Last bucket whose pages have room for the given size, -1 if there is no such bucket
+	static int getBucket(ULONG pageSize, ULONG size);
+
+	ULONG getPage(unsigned bucket, unsigned slot) const
+	{
+		return getSlot(slot).pages[bucket].load(std::memory_order_relaxed);
+	}
+
+	// Remember the page at the given slot of a bucket matching its free space
+	void put(ULONG pageSize, ULONG page, ULONG space, unsigned slot);
+
+	void remove(ULONG page)
+	{
+		remove(page, nullptr);
+	}
+
+private:
+	static const unsigned CACHE_LINE = 64;
+
+	// Pages of all buckets for a slot. Slots are used by different attachments,
+	// so every slot is kept at its own cache line.
+	struct Slot
+	{
+		std::atomic<ULONG> pages[BUCKETS];
+	};
+
+	static_assert(sizeof(Slot) <= CACHE_LINE, "Slot must fit cache line");
+
+	// Pool memory is not aligned at the cache line, thus align it manually
+	Slot& getSlot(unsigned slot)
+	{
+		return *reinterpret_cast<Slot*>(FB_ALIGN(m_buffer, CACHE_LINE) + (slot % SLOTS) * CACHE_LINE);
+	}
+
+	const Slot& getSlot(unsigned slot) const
+	{
+		return const_cast<FreeSpaceMap*>(this)->getSlot(slot);
+	}
+
+	void remove(ULONG page, const std::atomic<ULONG>* keep);
+
+	UCHAR m_buffer[(SLOTS + 1) * CACHE_LINE];
+};
+
+
 class RelationPages
 {
 public:
@@ -83,15 +156,14 @@ public:
 	ULONG rel_slot_space;		// lowest pointer page with slot space
 	ULONG rel_pri_data_space;	// lowest pointer page with primary data page space
 	ULONG rel_sec_data_space;	// lowest pointer page with secondary data page space
-	ULONG rel_last_free_pri_dp;	// last primary data page found with space
-	ULONG rel_last_free_blb_dp;	// last blob data page found with space
+	FreeSpaceMap rel_pri_space;	// primary data pages with free space
+	FreeSpaceMap rel_blb_space;	// blob data pages with free space
 	USHORT rel_pg_space_id;
 
 	RelationPages(Firebird::MemoryPool& pool)
 		: rel_pages(NULL), rel_instance_id(0),
 		  rel_index_root(0), rel_data_pages(0), rel_slot_space(0),
 		  rel_pri_data_space(0), rel_sec_data_space(0),
-		  rel_last_free_pri_dp(0), rel_last_free_blb_dp(0),
 		  rel_pg_space_id(DB_PAGE_SPACE), rel_next_free(NULL),
 		  useCount(0),
 		  dpMap(pool),
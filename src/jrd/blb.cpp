@@ -2382,10 +2382,6 @@ blob_page* blb::get_next_page(thread_db* tdbb, WIN* window)
 	}
 
 	SET_TDBB(tdbb);
-#ifdef SUPERSERVER_V2
-	Database* dbb = tdbb->getDatabase();
-	ULONG pages[PREFETCH_MAX_PAGES];
-#endif
 
 	const vcl& vector = *blb_pages;
 
@@ -2393,21 +2389,8 @@ blob_page* blb::get_next_page(thread_db* tdbb, WIN* window)
 	// Level 1 blobs are much easier -- page number is in vector.
 	if (blb_level == 1)
 	{
-#ifdef SUPERSERVER_V2
-		// Perform prefetch of blob level 1 data pages.
+		read_ahead(tdbb, vector.begin(), 0, blb_max_sequence + 1);
 
-		if (!(blb_sequence % dbb->dbb_prefetch_sequence))
-		{
-			USHORT sequence = blb_sequence;
-			USHORT i = 0;
-			while (i < dbb->dbb_prefetch_pages && sequence <= blb_max_sequence)
-			{
-				 pages[i++] = vector[sequence++];
-			}
-
-			CCH_PREFETCH(tdbb, pages, i);
-		}
-#endif
 		window->win_page = vector[blb_sequence];
 		page = (blob_page*) CCH_FETCH(tdbb, window, LCK_read, pag_blob);
 	}
@@ -2415,24 +2398,12 @@ blob_page* blb::get_next_page(thread_db* tdbb, WIN* window)
 	{
 		window->win_page = vector[blb_sequence / blb_pointers];
 		page = (blob_page*) CCH_FETCH(tdbb, window, LCK_read, pag_blob);
-#ifdef SUPERSERVER_V2
-		// Perform prefetch of blob level 2 data pages.
 
-		USHORT sequence = blb_sequence % blb_pointers;
-		if (!(sequence % dbb->dbb_prefetch_sequence))
-		{
-			ULONG abs_sequence = blb_sequence;
-			USHORT i = 0;
-			while (i < dbb->dbb_prefetch_pages && sequence < blb_pointers &&
-				abs_sequence <= blb_max_sequence)
-			{
-				pages[i++] = page->blp_page[sequence++];
-				abs_sequence++;
-			}
+		// Read ahead the data pages of this pointer page
+
+		const ULONG base = blb_sequence - blb_sequence % blb_pointers;
+		read_ahead(tdbb, page->blp_page, base, MIN(base + blb_pointers, blb_max_sequence + 1));
 
-			CCH_PREFETCH(tdbb, pages, i);
-		}
-#endif
 		page = (blob_page*) CCH_HANDOFF(tdbb, window,
 										page->blp_page[blb_sequence % blb_pointers],
 										LCK_read, pag_blob);
@@ -2447,6 +2418,40 @@ blob_page* blb::get_next_page(thread_db* tdbb, WIN* window)
 }
 
 
+void blb::read_ahead(thread_db* tdbb, const ULONG* pages, ULONG base, ULONG end)
+{
+/**************************************
+ *
+ *      r e a d _ a h e a d
+ *
+ **************************************
+ *
+ * Functional description
+ *      Page of the current blob sequence is about to be fetched.
+ *      Read ahead the next pages, if it's time to. Page of
+ *      sequence N is pages[N - base], valid for N < end.
+ *
+ **************************************/
+	ULONG from, to;
+	if (!blb_read_ahead.check(blb_sequence, from, to))
+		return;
+
+	ULONG numbers[ReadAhead::MAX_PAGES];
+	ULONG count = 0;
+
+	ULONG sequence = from;
+	for (; sequence < to && sequence < end; sequence++)
+	{
+		if (pages[sequence - base])
+			numbers[count++] = pages[sequence - base];
+	}
+
+	const ULONG read = count ? CCH_read_ahead(tdbb, blb_pg_space_id, numbers, count) : 0;
+
+	blb_read_ahead.done(sequence - 1, count, read);
+}
+
+
 void blb::insert_page(thread_db* tdbb)
 {
 /**************************************
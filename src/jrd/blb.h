@@ -30,6 +30,7 @@
 #include "../include/fb_blk.h"
 
 #include "../jrd/RecordNumber.h"
+#include "../jrd/pag.h"
 #include "../jrd/EngineInterface.h"
 #include "../common/classes/array.h"
 #include "../common/classes/File.h"
@@ -138,6 +139,7 @@ private:
 	void delete_blob(thread_db*, ULONG);
 	Ods::blob_page* get_next_page(thread_db*, win*);
 	void insert_page(thread_db*);
+	void read_ahead(thread_db*, const ULONG*, ULONG, ULONG);
 	void destroy(const bool purge_flag);
 
 	FB_SIZE_T blb_temp_size;		// size stored in transaction temp space
@@ -150,6 +152,7 @@ private:
 	vcl*		blb_pages;			// Vector of pages
 
 	Firebird::Array<SLONG> blb_buffer;	// buffer used in opened blobs - must be longword aligned
+	ReadAhead blb_read_ahead;		// read-ahead of blob pages
 
 	ULONG blb_temp_id;				// ID of newly created blob in transaction
 	ULONG blb_sequence;				// Blob page sequence
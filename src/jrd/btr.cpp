@@ -45,6 +45,7 @@
 #include "../jrd/lck.h"
 #include "../jrd/cch.h"
 #include "../jrd/sort.h"
+#include "../jrd/Histogram.h"
 #include "../common/gdsassert.h"
 #include "../jrd/btr_proto.h"
 #include "../jrd/cch_proto.h"
@@ -212,6 +213,7 @@ static void generate_jump_nodes(thread_db*, btree_page*, JumpNodeList*, USHORT,
 static ULONG insert_node(thread_db*, WIN*, index_insertion*, temporary_key*,
 						 RecordNumber*, ULONG*, ULONG*);
 
+static USHORT leading_segment(const UCHAR*, USHORT, USHORT, bool);
 static INT64_KEY make_int64_key(SINT64, SSHORT);
 #ifdef DEBUG_INDEXKEY
 static void print_int64_key(SINT64, SSHORT, INT64_KEY);
@@ -1834,6 +1836,32 @@ idx_e BTR_make_key(thread_db* tdbb,
 }
 
 
+void BTR_make_value_key(thread_db* tdbb, const dsc* desc, const index_desc* idx, temporary_key* key)
+{
+/**************************************
+ *
+ *	B T R _ m a k e _ v a l u e _ k e y
+ *
+ **************************************
+ *
+ * Functional description
+ *	Construct a key of the first index segment
+ *	for the given value, as it's kept by the
+ *	index histogram, i.e. neither stuffed with
+ *	segment numbers nor complemented.
+ *
+ **************************************/
+	fb_assert(idx && key);
+
+	key->key_flags = key_empty;
+	key->key_nulls = desc ? 0 : 1;
+	key->key_length = 0;
+
+	compress(tdbb, desc, key, idx->idx_rpt[0].idx_itype, (idx->idx_flags & idx_descending),
+		(idx->idx_flags & idx_unique) ? INTL_KEY_UNIQUE : INTL_KEY_SORT);
+}
+
+
 void BTR_make_null_key(thread_db* tdbb, const index_desc* idx, temporary_key* key)
 {
 /**************************************
@@ -2188,7 +2216,8 @@ void BTR_reserve_slot(thread_db* tdbb, IndexCreation& creation)
 }
 
 
-void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityList& selectivity)
+void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityList& selectivity,
+	IndexHistogram* histogram)
 {
 /**************************************
  *
@@ -2202,6 +2231,8 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
  *	without visiting data pages. Thus the
  *	effects of uncommitted transactions
  *	will be included in the calculation.
+ *	If asked, gather the key distribution
+ *	histogram during the same walk.
  *
  **************************************/
 
@@ -2223,6 +2254,35 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 	const bool descending = (root->irt_rpt[id].irt_flags & irt_descending);
 	const ULONG segments = root->irt_rpt[id].irt_keys;
 
+	// The histogram should tell NULLs from values, but the leaf nodes don't
+	// carry the NULL flags, so compare the first segment with its NULL key.
+	// Ascending NULLs and empty strings are both stored with no data, such
+	// nodes cannot be told apart and are counted as values, as the index
+	// scan for an empty string visits them anyway.
+
+	temporary_key nullKey;
+	USHORT nullLength = 0;
+	bool nullAmbiguous = false;
+
+	if (histogram)
+	{
+		index_desc idx;
+		idx.idx_count = segments;
+		idx.idx_flags = root->irt_rpt[id].irt_flags;
+
+		const irtd* keyDesc = (irtd*) ((UCHAR*) root + root->irt_rpt[id].irt_desc);
+		for (USHORT i = 0; i < segments; i++)
+			idx.idx_rpt[i].idx_itype = keyDesc[i].irtd_itype;
+
+		BTR_make_null_key(tdbb, &idx, &nullKey);
+		nullLength = leading_segment(nullKey.key_data, nullKey.key_length, segments, descending);
+
+		const USHORT itype = keyDesc->irtd_itype;
+		nullAmbiguous = !nullLength &&
+			(itype == idx_string || itype == idx_byte_array || itype == idx_metadata ||
+			 itype >= idx_first_intl_string);
+	}
+
 	window.win_flags = WIN_large_scan;
 	window.win_scans = 1;
 	btree_page* bucket = (btree_page*) CCH_HANDOFF(tdbb, &window, page, LCK_read, pag_index);
@@ -2251,6 +2311,9 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 	duplicatesList.grow(segments);
 	memset(duplicatesList.begin(), 0, segments * sizeof(FB_UINT64));
 
+	if (histogram)
+		histogram->start(segments, descending);
+
 	//const Database* dbb = tdbb->getDatabase();
 
 	// go through all the leaf nodes and count them;
@@ -2270,6 +2333,9 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 			++nodes;
 			l = node.length + node.prefix;
 
+			// number of leading segments equal to the prior key
+			USHORT equalSegments = 0;
+
 			if (segments > 1 && !firstNode)
 			{
 
@@ -2343,6 +2409,8 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 
 				for (ULONG i = count + 1; i <= segments; i++)
 					duplicatesList[segments - i]++;
+
+				equalSegments = (USHORT) (segments - count);
 			}
 
 			// figure out if this is a duplicate
@@ -2353,14 +2421,28 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 				dup = (!node.length && (l == key.key_length));
 
 			if (dup && !firstNode)
+			{
 				++duplicates;
 
+				if (segments == 1)
+					equalSegments = 1;
+			}
+
 			if (firstNode)
 				firstNode = false;
 
 			// keep the key value current for comparison with the next key
 			key.key_length = l;
 			memcpy(key.key_data + node.prefix, node.data, node.length);
+
+			if (histogram)
+			{
+				const bool null = !nullAmbiguous &&
+					leading_segment(key.key_data, key.key_length, segments, descending) == nullLength &&
+					!memcmp(key.key_data, nullKey.key_data, nullLength);
+
+				histogram->add(key.key_data, key.key_length, equalSegments, null);
+			}
 			pointer = node.readNode(pointer, true);
 		}
 
@@ -2383,6 +2465,9 @@ void BTR_selectivity(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityL
 	else
 		selectivity[0] = (float) (nodes ? 1.0 / (float) (nodes - duplicates) : 0.0);
 
+	if (histogram)
+		histogram->finish(key.key_data, key.key_length, selectivity.back());
+
 	// Store the selectivity on the root page
 	window.win_page = relPages->rel_index_root;
 	window.win_flags = 0;
@@ -6140,6 +6225,36 @@ static ULONG insert_node(thread_db* tdbb,
 }
 
 
+static USHORT leading_segment(const UCHAR* key, USHORT length, USHORT segments, bool descending)
+{
+/**************************************
+ *
+ *	l e a d i n g _ s e g m e n t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Return the length of the leading part of the
+ *	index key that belongs to its first segment.
+ *
+ **************************************/
+	if (segments == 1)
+		return length;
+
+	// Compound key is made of groups of the segment number followed
+	// by STUFF_COUNT bytes of the segment value, the first segment
+	// has the highest number
+
+	const UCHAR mask = descending ? 0xFF : 0;
+	USHORT pos = 0;
+
+	while (pos < length && (key[pos] ^ mask) == segments)
+		pos += STUFF_COUNT + 1;
+
+	return MIN(pos, length);
+}
+
+
 static INT64_KEY make_int64_key(SINT64 q, SSHORT scale)
 {
 /**************************************
@@ -29,6 +29,7 @@
 
 #include "../jrd/constants.h"
 #include "../common/classes/array.h"
+#include "../common/classes/objects_array.h"
 #include "../include/fb_blk.h"
 
 #include "../jrd/err_proto.h"    // Index error types
@@ -46,6 +47,7 @@ template <typename T> class vec;
 class Statement;
 struct temporary_key;
 class thread_db;
+class IndexHistogram;
 class BtrPageGCLock;
 class Sort;
 class PartitionedSort;
@@ -467,6 +469,79 @@ private:
 	AutoIndexExpression m_localExpression;
 };
 
+// Keys of the records stored by a batch, which are added into the non-unique
+// indices of the relation when the batch is done. Keys are sorted before, thus
+// index pages are modified in key order and mostly once per batch, instead of
+// a random index page per every stored record. Unique and foreign key indices
+// are maintained by every store as usual, as they check constraints.
+
+class BatchIndexKeys
+{
+public:
+	// Keys memory to flush them before the batch is done
+	static const ULONG MAX_KEYS_LENGTH = 32 * 1024 * 1024;
+
+	BatchIndexKeys(MemoryPool& pool, jrd_rel* relation)
+		: m_relation(relation),
+		  m_entries(pool),
+		  m_chunks(pool),
+		  m_length(0)
+	{}
+
+	bool isDeferred(thread_db* tdbb, jrd_rel* relation, const index_desc* idx) const;
+	void add(const index_desc* idx, RecordNumber number, const temporary_key* key);
+
+	// Keys of the records stored since the mark are dropped if the store failed
+	struct Mark
+	{
+		FB_SIZE_T entries;
+		FB_SIZE_T chunks;
+		FB_SIZE_T chunkLength;		// used part of the last chunk
+		ULONG length;
+	};
+
+	Mark mark() const;
+	void rollback(const Mark& mark);
+	void clear();
+
+	bool hasData() const
+	{
+		return m_entries.hasData();
+	}
+
+	bool isFull() const
+	{
+		return m_length >= MAX_KEYS_LENGTH;
+	}
+
+	// Order keys by index, key value and record number
+	void sort();
+	void flush(thread_db* tdbb, jrd_tra* transaction);
+
+	struct Entry
+	{
+		const UCHAR* data;
+		SINT64 number;
+		USHORT idxId;
+		USHORT length;
+		USHORT nulls;
+		UCHAR flags;
+	};
+
+	const Firebird::Array<Entry>& getEntries() const
+	{
+		return m_entries;
+	}
+
+private:
+	static const ULONG CHUNK_LENGTH = 1024 * 1024;
+
+	jrd_rel* const m_relation;
+	Firebird::Array<Entry> m_entries;
+	Firebird::ObjectsArray<Firebird::UCharBuffer> m_chunks;
+	ULONG m_length;
+};
+
 } //namespace Jrd
 
 #endif // JRD_BTR_H
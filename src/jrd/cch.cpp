@@ -135,7 +135,7 @@ static void check_precedence(thread_db*, WIN*, PageNumber);
 static void clear_precedence(thread_db*, BufferDesc*);
 static void down_grade(thread_db*, BufferDesc*, int high = 0);
 static bool expand_buffers(thread_db*, ULONG);
-static BufferDesc* get_buffer(thread_db*, const PageNumber, SyncType, int);
+static BufferDesc* get_buffer(thread_db*, const PageNumber, SyncType, int, bool = false);
 static int get_related(BufferDesc*, PagesArray&, int, const ULONG);
 static ULONG get_prec_walk_mark(BufferControl*);
 static LockState lock_buffer(thread_db*, BufferDesc*, const SSHORT, const SCHAR);
@@ -143,9 +143,12 @@ static ULONG memory_init(thread_db*, BufferControl*, ULONG);
 static void page_validation_error(thread_db*, win*, SSHORT);
 static void purgePrecedence(BufferControl*, BufferDesc*);
 static SSHORT related(BufferDesc*, const BufferDesc*, SSHORT, const ULONG);
+static void set_free_minimum(BufferControl*);
 static int write_buffer(thread_db*, BufferDesc*, const PageNumber, const bool, FbStatusVector* const,
 	const bool);
 static bool write_page(thread_db*, BufferDesc*, FbStatusVector* const, const bool);
+static bool write_pages(thread_db*, BufferDesc**, FB_SIZE_T, FbStatusVector* const);
+static void page_written(thread_db*, BufferDesc*);
 static bool set_diff_page(thread_db*, BufferDesc*);
 static void clear_dirty_flag_and_nbak_state(thread_db*, BufferDesc*);
 
@@ -190,7 +193,10 @@ static void flushAll(thread_db* tdbb, USHORT flush_flag);
 static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, FB_SIZE_T count);
 
 static void recentlyUsed(BufferDesc* bdb);
-static void requeueRecentlyUsed(BufferControl* bcb);
+static void requeueRecentlyUsed(BufferShard* shard);
+static void lruRemove(BufferShard* shard, BufferDesc* bdb);
+static void lruInsert(BufferShard* shard, BufferDesc* bdb, bool probation);
+static void lruAppend(BufferShard* shard, BufferDesc* bdb);
 
 
 const ULONG MIN_BUFFER_SEGMENT = 65536;
@@ -347,14 +353,14 @@ void CCH_clean_page(thread_db* tdbb, PageNumber page)
 	}
 
 	{
-		Sync lruSync(&bcb->bcb_syncLRU, "CCH_release");
+		BufferShard* const shard = bdb->bdb_shard;
+		Sync lruSync(&shard->bsh_syncLRU, "CCH_release");
 		lruSync.lock(SYNC_EXCLUSIVE);
 
 		if (bdb->bdb_flags & BDB_lru_chained)
-			requeueRecentlyUsed(bcb);
+			requeueRecentlyUsed(shard);
 
-		QUE_DELETE(bdb->bdb_in_use);
-		QUE_APPEND(bcb->bcb_in_use, bdb->bdb_in_use);
+		lruAppend(shard, bdb);
 	}
 
 	bdb->release(tdbb, true);
@@ -752,7 +758,7 @@ pag* CCH_fake(thread_db* tdbb, WIN* window, int wait)
 	fb_assert((bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) == 0);
 	fb_assert(bdb->bdb_page == window->win_page);
 
-	bdb->bdb_flags &= BDB_lru_chained;	// yes, clear all except BDB_lru_chained
+	bdb->bdb_flags &= (BDB_lru_chained | BDB_probation | BDB_new_page);	// yes, clear all except LRU state
 	bdb->bdb_flags |= (BDB_writer | BDB_faked);
 	bdb->bdb_scan_count = 0;
 
@@ -869,7 +875,8 @@ LockState CCH_fetch_lock(thread_db* tdbb, WIN* window, int lock_type, int wait,
 	// Look for the page in the cache.
 
 	BufferDesc* bdb = get_buffer(tdbb, window->win_page,
-		((lock_type >= LCK_write) ? SYNC_EXCLUSIVE : SYNC_SHARED), wait);
+		((lock_type >= LCK_write) ? SYNC_EXCLUSIVE : SYNC_SHARED), wait,
+		(window->win_flags & (WIN_large_scan | WIN_low_priority)));
 
 	if (wait != 1 && bdb == 0)
 		return lsLatchTimeout; // latch timeout
@@ -1095,11 +1102,13 @@ void CCH_forget_page(thread_db* tdbb, WIN* window)
 
 	removeDirty(bcb, bdb);
 
+	BufferShard* const shard = bdb->bdb_shard;
+
 	// remove from LRU list
 	{
-		SyncLockGuard lruSync(&bcb->bcb_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
-		requeueRecentlyUsed(bcb);
-		QUE_DELETE(bdb->bdb_in_use);
+		SyncLockGuard lruSync(&shard->bsh_syncLRU, SYNC_EXCLUSIVE, FB_FUNCTION);
+		requeueRecentlyUsed(shard);
+		lruRemove(shard, bdb);
 	}
 
 	// remove from hash table and put into empty list
@@ -1107,16 +1116,16 @@ void CCH_forget_page(thread_db* tdbb, WIN* window)
 	{
 		SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_EXCLUSIVE, FB_FUNCTION);
 		bcb->bcb_hashTable->remove(bdb);
-		QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-		bcb->bcb_inuse--;
+		QUE_INSERT(shard->bsh_empty, bdb->bdb_que);
+		shard->bsh_inuse--;
 	}
 #else
 	bcb->bcb_hashTable->remove(bdb);
 
 	{
-		SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-		QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-		bcb->bcb_inuse--;
+		SyncLockGuard syncEmpty(&shard->bsh_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+		QUE_INSERT(shard->bsh_empty, bdb->bdb_que);
+		shard->bsh_inuse--;
 	}
 #endif
 
@@ -1600,15 +1609,26 @@ void CCH_init(thread_db* tdbb, ULONG number)
 	bcb->bcb_flags = shared ? BCB_exclusive : 0;
 	//bcb->bcb_flags = BCB_exclusive;	// TODO detect real state using LM
 
-	QUE_INIT(bcb->bcb_in_use);
+	if (fb_utils::stricmp(dbb->dbb_config->getCachePolicy(), CachePolicy2Q) == 0)
+		bcb->bcb_flags |= BCB_scan_resistant;
+
 	QUE_INIT(bcb->bcb_dirty);
 	bcb->bcb_dirty_count = 0;
-	QUE_INIT(bcb->bcb_empty);
+
+	// Split big cache into shards to reduce contention on the LRU and free lists.
+	// Number of shards is a power of 2 and doesn't change when cache is expanded.
+
+	ULONG shards = 1;
+	while (shards < BufferControl::MAX_SHARDS && shards * 2 * BufferControl::MIN_SHARD_BUFFERS <= number)
+		shards *= 2;
+
+	bcb->bcb_shards = FB_NEW_POOL(*bcb->bcb_bufferpool) BufferShard[shards];
+	bcb->bcb_shard_count = shards;
 
 	// initialization of memory is system-specific
 
 	bcb->bcb_count = memory_init(tdbb, bcb, number);
-	bcb->bcb_free_minimum = (SSHORT) MIN(bcb->bcb_count / 4, 128);
+	set_free_minimum(bcb);
 
 	if (bcb->bcb_count < MIN_PAGE_BUFFERS)
 		ERR_post(Arg::Gds(isc_cache_too_small));
@@ -2008,6 +2028,151 @@ bool set_diff_page(thread_db* tdbb, BufferDesc* bdb)
 }
 
 
+ULONG CCH_read_ahead(thread_db* tdbb, USHORT pageSpaceId, const ULONG* pages, ULONG count)
+{
+/**************************************
+ *
+ *	C C H _ r e a d _ a h e a d
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read the given pages into the cache, unless they are
+ *	there already, queueing all the reads at once. This is
+ *	just a hint: pages which can't be latched or locked
+ *	immediately are skipped and read errors are ignored,
+ *	such pages are read again when really fetched.
+ *	Return the number of pages read.
+ *
+ **************************************/
+	SET_TDBB(tdbb);
+	Database* const dbb = tdbb->getDatabase();
+	BufferControl* const bcb = dbb->dbb_bcb;
+
+	PageSpace* const pageSpace = dbb->dbb_page_manager.findPageSpace(pageSpaceId);
+	if (!pageSpace || !pageSpace->file)
+		return 0;
+
+	// Don't let the read-ahead flush the whole cache
+
+	count = MIN(count, ReadAhead::MAX_PAGES);
+	count = MIN(count, bcb->bcb_count / 4);
+
+	// While the backup is in progress, pages could be in the difference file,
+	// let them be fetched one by one as usual
+
+	BackupManager::StateReadGuard stateGuard(tdbb);
+
+	if (!pageSpace->isTemporary() &&
+		dbb->dbb_backup_manager->getState() != Ods::hdr_nbak_normal)
+	{
+		return 0;
+	}
+
+	HalfStaticArray<PageIoRequest, ReadAhead::MAX_PAGES> requests;
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		const PageNumber page(pageSpaceId, pages[i]);
+
+		{	// scope
+#ifndef HASH_USE_CDS_LIST
+			SyncLockGuard bcbSync(&bcb->bcb_syncObject, SYNC_SHARED, FB_FUNCTION);
+#endif
+			if (bcb->bcb_hashTable->find(page))
+				continue;
+		}
+
+		BufferDesc* const bdb = get_buffer(tdbb, page, SYNC_EXCLUSIVE, LCK_NO_WAIT);
+		if (!bdb)
+			continue;
+
+		// Somebody could read the page while we were looking for a buffer
+
+		if (!(bdb->bdb_flags & BDB_read_pending))
+		{
+			bdb->release(tdbb, true);
+			continue;
+		}
+
+		if (!(bcb->bcb_flags & BCB_exclusive))
+		{
+			const LockState lockState = lock_buffer(tdbb, bdb, LCK_NO_WAIT, pag_undefined);
+
+			if (lockState == lsLockTimeout)
+				continue;	// buffer is released already
+
+			if (lockState != lsLocked)
+			{
+				bdb->release(tdbb, true);
+				continue;
+			}
+		}
+
+		bdb->bdb_incarnation = ++bcb->bcb_page_incarnation;
+
+		PageIoRequest& request = requests.add();
+		request.pio_bdb = bdb;
+		request.pio_page = bdb->bdb_buffer;
+	}
+
+	if (requests.isEmpty())
+		return 0;
+
+	// The pages are read already, just let the crypto manager decrypt them.
+	// If it needs to repeat the read, do it as usual.
+
+	class ReadAheadIo : public CryptoManager::IOCallback
+	{
+	public:
+		ReadAheadIo(jrd_file* f, BufferDesc* b)
+			: file(f), bdb(b), done(true)
+		{ }
+
+		bool callback(thread_db* tdbb, FbStatusVector* status, Ods::pag* page)
+		{
+			if (done)
+			{
+				done = false;
+				return true;
+			}
+
+			return PIO_read(tdbb, file, bdb, page, status);
+		}
+
+	private:
+		jrd_file* file;
+		BufferDesc* bdb;
+		bool done;
+	};
+
+	FbLocalStatus status;
+	const bool success = PIO_read_pages(tdbb, pageSpace->file, requests.begin(),
+		requests.getCount(), &status);
+
+	ULONG read = 0;
+
+	for (PageIoRequest* request = requests.begin(); request < requests.end(); request++)
+	{
+		BufferDesc* const bdb = request->pio_bdb;
+		ReadAheadIo io(pageSpace->file, bdb);
+
+		if (success && dbb->dbb_crypto_manager->read(tdbb, &status, request->pio_page, &io))
+		{
+			bdb->bdb_flags &= ~(BDB_not_valid | BDB_read_pending);
+			tdbb->bumpStats(RuntimeStatistics::PAGE_READS);
+			read++;
+		}
+		else if (!(bcb->bcb_flags & BCB_exclusive))
+			PAGE_LOCK_RELEASE(tdbb, bcb, bdb->bdb_lock);
+
+		bdb->release(tdbb, true);
+	}
+
+	return read;
+}
+
+
 void CCH_release(thread_db* tdbb, WIN* window, const bool release_tail)
 {
 /**************************************
@@ -2107,17 +2272,17 @@ void CCH_release(thread_db* tdbb, WIN* window, const bool release_tail)
 				if (window->win_flags & WIN_garbage_collector)
 					bdb->bdb_flags &= ~BDB_garbage_collect;
 
-				{ // bcb_syncLRU scope
-					Sync lruSync(&bcb->bcb_syncLRU, "CCH_release");
+				{ // bsh_syncLRU scope
+					BufferShard* const shard = bdb->bdb_shard;
+					Sync lruSync(&shard->bsh_syncLRU, "CCH_release");
 					lruSync.lock(SYNC_EXCLUSIVE);
 
 					if (bdb->bdb_flags & BDB_lru_chained)
 					{
-						requeueRecentlyUsed(bcb);
+						requeueRecentlyUsed(shard);
 					}
 
-					QUE_DELETE(bdb->bdb_in_use);
-					QUE_APPEND(bcb->bcb_in_use, bdb->bdb_in_use);
+					lruAppend(shard, bdb);
 				}
 
 				if ((bcb->bcb_flags & BCB_cache_writer) &&
@@ -2774,13 +2939,139 @@ extern "C" {
 } // extern C
 
 
+// Dirty pages collected by flushPages to be written at once. Pages are kept
+// latched and locked for IO until the batch is flushed. To not deadlock with
+// other threads, latches and IO locks of the pages after the first one are
+// only taken if they are free, else the batch is flushed before waiting.
+
+class WriteBatch
+{
+public:
+	static const FB_SIZE_T MAX_PAGES = 64;
+
+	WriteBatch(thread_db* tdbb, bool release, bool writeThru)
+		: m_tdbb(tdbb), m_release(release), m_writeThru(writeThru)
+	{ }
+
+	bool isEmpty() const
+	{
+		return m_held.isEmpty();
+	}
+
+	// Latch the page for the batch, false if it's in use and the batch is not empty
+	bool latch(BufferDesc* bdb)
+	{
+		const SyncType syncType = m_release ? SYNC_EXCLUSIVE : SYNC_SHARED;
+
+		if (isEmpty())
+			return bdb->addRef(m_tdbb, syncType);
+
+		return bdb->addRefConditional(m_tdbb, syncType);
+	}
+
+	// Take the latched page ready to be written, false if it must be written
+	// separately as its write needs extra care
+	bool add(BufferDesc* bdb);
+
+	// Write the pages and release them
+	void flush();
+
+private:
+	void releasePage(BufferDesc* bdb)
+	{
+		// release lock before losing control over bdb, it prevents
+		// concurrent operations on released lock
+		if (m_release)
+			PAGE_LOCK_RELEASE(m_tdbb, bdb->bdb_bcb, bdb->bdb_lock);
+
+		bdb->release(m_tdbb, !m_release && !(bdb->bdb_flags & BDB_dirty));
+	}
+
+	thread_db* const m_tdbb;
+	const bool m_release;
+	const bool m_writeThru;
+	HalfStaticArray<BufferDesc*, MAX_PAGES> m_pages;	// pages to write
+	HalfStaticArray<BufferDesc*, MAX_PAGES> m_held;		// pages to release
+};
+
+
+bool WriteBatch::add(BufferDesc* bdb)
+{
+#ifdef SUPERSERVER_V2
+	// write_buffer takes care of the deferred header page write
+	return false;
+#endif
+
+	// Header page and invalid buffer are written by write_page only
+
+	if (bdb->bdb_page == HEADER_PAGE_NUMBER || (bdb->bdb_flags & BDB_not_valid))
+		return false;
+
+	if (m_held.getCount() == MAX_PAGES ||
+		(m_pages.hasData() &&
+			m_pages[0]->bdb_page.getPageSpaceID() != bdb->bdb_page.getPageSpaceID()))
+	{
+		flush();
+	}
+
+	if (isEmpty())
+		bdb->lockIO(m_tdbb);
+	else if (!bdb->lockIOConditional(m_tdbb))
+		return false;
+
+	if ((bdb->bdb_flags & BDB_marked) && !(bdb->bdb_flags & BDB_faked))
+		BUGCHECK(217);	// msg 217 buffer marked for update
+
+	// Higher precedence page could appear while we were waiting for IO lock
+
+	if (QUE_NOT_EMPTY(bdb->bdb_higher))
+	{
+		bdb->unLockIO(m_tdbb);
+		return false;
+	}
+
+	if ((bdb->bdb_flags & BDB_dirty || (m_writeThru && bdb->bdb_flags & BDB_db_dirty)) &&
+		!(bdb->bdb_flags & BDB_marked))
+	{
+		m_pages.add(bdb);
+	}
+	else
+	{
+		bdb->unLockIO(m_tdbb);
+		clear_precedence(m_tdbb, bdb);
+	}
+
+	m_held.add(bdb);
+	return true;
+}
+
+
+void WriteBatch::flush()
+{
+	if (m_pages.hasData() &&
+		!write_pages(m_tdbb, m_pages.begin(), m_pages.getCount(), m_tdbb->tdbb_status_vector))
+	{
+		m_pages.clear();
+		m_held.clear();
+		CCH_unwind(m_tdbb, true);
+	}
+
+	for (FB_SIZE_T i = 0; i < m_held.getCount(); i++)
+		releasePage(m_held[i]);
+
+	m_pages.clear();
+	m_held.clear();
+}
+
+
 // Write array of pages to disk in efficient order.
 // First, sort pages by their numbers to make writes physically ordered and
 // thus faster. At every iteration of while loop write pages which have no high
 // precedence pages to ensure order preserved. If after some iteration there are
 // no such pages (i.e. all of not written yet pages have high precedence pages)
 // then write them all at last iteration (of course write_buffer will also check
-// for precedence before write).
+// for precedence before write). Pages of the same iteration are written at once
+// using WriteBatch.
 static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, FB_SIZE_T count)
 {
 	FbStatusVector* const status = tdbb->tdbb_status_vector;
@@ -2791,6 +3082,7 @@ static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, F
 	qsort(begin, count, sizeof(BufferDesc*), cmpBdbs);
 
 	MarkIterator<BufferDesc*> iter(begin, count);
+	WriteBatch batch(tdbb, release_flag, write_thru);
 
 	FB_SIZE_T written = 0;
 	bool writeAll = false;
@@ -2805,7 +3097,11 @@ static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, F
 			if (!bdb)
 				continue;
 
-			bdb->addRef(tdbb, release_flag ? SYNC_EXCLUSIVE : SYNC_SHARED);
+			if (!batch.latch(bdb))
+			{
+				batch.flush();
+				batch.latch(bdb);
+			}
 
 			BufferControl* bcb = bdb->bdb_bcb;
 			if (!writeAll)
@@ -2821,6 +3117,19 @@ static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, F
 
 				if (!all_flag || bdb->bdb_flags & (BDB_db_dirty | BDB_dirty))
 				{
+					// Pages without precedence are written together,
+					// precedence is left to write_buffer
+
+					if (!writeAll && batch.add(bdb))
+					{
+						iter.mark();
+						found = true;
+						written++;
+						continue;
+					}
+
+					batch.flush();
+
 					if (!write_buffer(tdbb, bdb, bdb->bdb_page, write_thru, status, true))
 						CCH_unwind(tdbb, true);
 				}
@@ -2842,6 +3151,9 @@ static void flushPages(thread_db* tdbb, USHORT flush_flag, BufferDesc** begin, F
 			}
 		}
 
+		// Pages of the next pass may depend on the ones just collected
+		batch.flush();
+
 		if (!found)
 			writeAll = true;
 
@@ -3578,16 +3890,32 @@ static bool expand_buffers(thread_db* tdbb, ULONG number)
 	if ((tdbb->getAttachment()->att_flags & ATT_exclusive) || !(bcb->bcb_flags & BCB_exclusive))
 		bcb->bcb_hashTable->resize(number);
 
-	SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
 	ULONG allocated = memory_init(tdbb, bcb, number - bcb->bcb_count);
 
 	bcb->bcb_count += allocated;
-	bcb->bcb_free_minimum = (SSHORT) MIN(bcb->bcb_count / 4, 128);	// 25% clean page reserve
+	set_free_minimum(bcb);
 
 	return true;
 }
 
 
+static void set_free_minimum(BufferControl* bcb)
+{
+/**************************************
+ *
+ *	s e t _ f r e e _ m i n i m u m
+ *
+ **************************************
+ *
+ * Functional description
+ *	Set threshold to activate cache writer for every shard.
+ *
+ **************************************/
+	for (BufferShard* shard = bcb->bcb_shards; shard < bcb->bcb_shards + bcb->bcb_shard_count; shard++)
+		shard->bsh_free_minimum = (SSHORT) MIN(shard->bsh_count / 4, 128);	// 25% clean page reserve
+}
+
+
 static BufferDesc* get_dirty_buffer(thread_db* tdbb)
 {
 	// This code is only used by the background I/O threads:
@@ -3596,111 +3924,144 @@ static BufferDesc* get_dirty_buffer(thread_db* tdbb)
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
 	BufferControl* bcb = dbb->dbb_bcb;
-	int walk = bcb->bcb_free_minimum;
-	int chained = walk;
+	bool requeued = false;
 
-	Sync lruSync(&bcb->bcb_syncLRU, FB_FUNCTION);
-	lruSync.lock(SYNC_SHARED);
-
-	for (QUE que_inst = bcb->bcb_in_use.que_backward;
-		 que_inst != &bcb->bcb_in_use; que_inst = que_inst->que_backward)
+	for (BufferShard* shard = bcb->bcb_shards; shard < bcb->bcb_shards + bcb->bcb_shard_count; shard++)
 	{
-		BufferDesc* bdb = BLOCK(que_inst, BufferDesc, bdb_in_use);
+		int walk = shard->bsh_free_minimum;
+		int chained = walk;
 
-		if (bdb->bdb_flags & BDB_lru_chained)
+		Sync lruSync(&shard->bsh_syncLRU, FB_FUNCTION);
+		lruSync.lock(SYNC_SHARED);
+
+		// Buffers of the probation que (2Q policy only) are the first candidates
+		// for replacement, so look for dirty ones there first
+
+		que* const queues[] = {&shard->bsh_probation, &shard->bsh_in_use};
+
+		for (que* const lru : queues)
 		{
-			if (!--chained)
+			for (QUE que_inst = lru->que_backward; que_inst != lru; que_inst = que_inst->que_backward)
+			{
+				BufferDesc* bdb = BLOCK(que_inst, BufferDesc, bdb_in_use);
+
+				if (bdb->bdb_flags & BDB_lru_chained)
+				{
+					if (!--chained)
+						break;
+					continue;
+				}
+
+				if (bdb->bdb_use_count || (bdb->bdb_flags & BDB_free_pending))
+					continue;
+
+				if (bdb->bdb_flags & BDB_db_dirty)
+				{
+					//tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES); shouldn't it be here?
+					return bdb;
+				}
+
+				if (!--walk)
+					break;
+			}
+
+			if (!chained || !walk)
 				break;
-			continue;
 		}
 
-		if (bdb->bdb_use_count || (bdb->bdb_flags & BDB_free_pending))
-			continue;
-
-		if (bdb->bdb_flags & BDB_db_dirty)
+		if (!chained)
 		{
-			//tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES); shouldn't it be here?
-			return bdb;
+			lruSync.unlock();
+			lruSync.lock(SYNC_EXCLUSIVE);
+			requeueRecentlyUsed(shard);
+			requeued = true;
 		}
-
-		if (!--walk)
-			break;
 	}
 
-	if (!chained)
-	{
-		lruSync.unlock();
-		lruSync.lock(SYNC_EXCLUSIVE);
-		requeueRecentlyUsed(bcb);
-	}
-	else
+	if (!requeued)
 		bcb->bcb_flags &= ~BCB_free_pending;
 
 	return NULL;
 }
 
 
-static BufferDesc* get_oldest_buffer(thread_db* tdbb, BufferControl* bcb)
+static BufferDesc* get_oldest_buffer(thread_db* tdbb, BufferControl* bcb, BufferShard* shard)
 {
 /**************************************
  * Function description:
- *       Get candidate for preemption
+ *       Get candidate for preemption from the given shard
  *       Found page buffer must have SYNC_EXCLUSIVE lock.
  **************************************/
 
-	int walk = bcb->bcb_free_minimum;
+	int walk = shard->bsh_free_minimum;
 	BufferDesc* bdb = nullptr;
 
-	Sync lruSync(&bcb->bcb_syncLRU, FB_FUNCTION);
-	if (bcb->bcb_lru_chain.load() != NULL)
+	Sync lruSync(&shard->bsh_syncLRU, FB_FUNCTION);
+	if (shard->bsh_lru_chain.load() != NULL)
 	{
 		lruSync.lock(SYNC_EXCLUSIVE);
-		requeueRecentlyUsed(bcb);
+		requeueRecentlyUsed(shard);
 		lruSync.downgrade(SYNC_SHARED);
 	}
 	else
 		lruSync.lock(SYNC_SHARED);
 
-	for (QUE que_inst = bcb->bcb_in_use.que_backward;
-		 que_inst != &bcb->bcb_in_use;
-		 que_inst = que_inst->que_backward)
+	// get the oldest buffer as the least recently used -- note
+	// that since there are no empty buffers the queues cannot be empty
+
+	if (QUE_EMPTY(shard->bsh_in_use) && QUE_EMPTY(shard->bsh_probation))
+		BUGCHECK(213);	// msg 213 insufficient cache size
+
+	// With 2Q policy, newly read pages are replaced first unless the probation
+	// que is small enough, then the main que is used. If nothing could be
+	// taken from the preferred que, try the other one.
+
+	que* queues[] = {&shard->bsh_in_use, &shard->bsh_probation};
+
+	if (shard->bsh_probation_count > shard->bsh_count / 4 || QUE_EMPTY(shard->bsh_in_use))
 	{
-		bdb = nullptr;
+		queues[0] = &shard->bsh_probation;
+		queues[1] = &shard->bsh_in_use;
+	}
 
-		// get the oldest buffer as the least recently used -- note
-		// that since there are no empty buffers this queue cannot be empty
+	for (que* const lru : queues)
+	{
+		for (QUE que_inst = lru->que_backward; que_inst != lru; que_inst = que_inst->que_backward)
+		{
+			bdb = nullptr;
 
-		if (bcb->bcb_in_use.que_forward == &bcb->bcb_in_use)
-			BUGCHECK(213);	// msg 213 insufficient cache size
+			BufferDesc* oldest = BLOCK(que_inst, BufferDesc, bdb_in_use);
 
-		BufferDesc* oldest = BLOCK(que_inst, BufferDesc, bdb_in_use);
+			if (oldest->bdb_flags & BDB_lru_chained)
+				continue;
 
-		if (oldest->bdb_flags & BDB_lru_chained)
-			continue;
+			if (oldest->bdb_use_count || !oldest->addRefConditional(tdbb, SYNC_EXCLUSIVE))
+				continue;
 
-		if (oldest->bdb_use_count || !oldest->addRefConditional(tdbb, SYNC_EXCLUSIVE))
-			continue;
+			/*if (!writeable(oldest))
+			{
+				oldest->release(tdbb, true);
+				continue;
+			}*/
 
-		/*if (!writeable(oldest))
-		{
-			oldest->release(tdbb, true);
-			continue;
-		}*/
+			bdb = oldest;
+			if (!(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) || !walk)
+				break;
 
-		bdb = oldest;
-		if (!(bdb->bdb_flags & (BDB_dirty | BDB_db_dirty)) || !walk)
-			break;
+			if (!(bcb->bcb_flags & BCB_cache_writer))
+				break;
 
-		if (!(bcb->bcb_flags & BCB_cache_writer))
-			break;
+			bcb->bcb_flags |= BCB_free_pending;
+			if (!(bcb->bcb_flags & BCB_writer_active))
+				bcb->bcb_writer_sem.release();
 
-		bcb->bcb_flags |= BCB_free_pending;
-		if (!(bcb->bcb_flags & BCB_writer_active))
-			bcb->bcb_writer_sem.release();
+			bdb->release(tdbb, true);
+			bdb = nullptr;
+			--walk;
+		}
 
-		bdb->release(tdbb, true);
-		bdb = nullptr;
-		--walk;
+		if (bdb)
+			break;
 	}
 
 	lruSync.unlock();
@@ -3751,7 +4112,8 @@ static BufferDesc* get_oldest_buffer(thread_db* tdbb, BufferControl* bcb)
 }
 
 
-static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType syncType, int wait)
+static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType syncType, int wait,
+	bool lowPriority)
 {
 /**************************************
  *
@@ -3772,6 +4134,8 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
  *			0 => If the lock can't be acquired immediately,
  *				give up and return 0;
  *			<negative number> => Latch timeout interval in seconds.
+ *	lowPriority:	page is fetched by a large scan, with 2Q policy
+ *				don't move it from probation into the main LRU que.
  *
  * return
  *	BufferDesc pointer if successful.
@@ -3782,6 +4146,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 	SET_TDBB(tdbb);
 	Database* dbb = tdbb->getDatabase();
 	BufferControl* bcb = dbb->dbb_bcb;
+	BufferShard* const shard = bcb->getShard(page);
 
 	while (true)
 	{
@@ -3809,7 +4174,8 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				// ensure the found page buffer is still for the same page after latch
 				if (bdb->bdb_page == page)
 				{
-					recentlyUsed(bdb);
+					if (!lowPriority || !(bdb->bdb_flags & BDB_probation))
+						recentlyUsed(bdb);
 					tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 					return bdb;
 				}
@@ -3821,17 +4187,17 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 			}
 
 			// try empty list
-			if (QUE_NOT_EMPTY(bcb->bcb_empty))
+			if (QUE_NOT_EMPTY(shard->bsh_empty))
 			{
-				SyncLockGuard bcbSync(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-				if (QUE_NOT_EMPTY(bcb->bcb_empty))
+				SyncLockGuard syncEmpty(&shard->bsh_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+				if (QUE_NOT_EMPTY(shard->bsh_empty))
 				{
-					QUE que_inst = bcb->bcb_empty.que_forward;
+					QUE que_inst = shard->bsh_empty.que_forward;
 					QUE_DELETE(*que_inst);
 					QUE_INIT(*que_inst);
 					bdb = BLOCK(que_inst, BufferDesc, bdb_que);
 
-					bcb->bcb_inuse++;
+					shard->bsh_inuse++;
 					is_empty = true;
 				}
 			}
@@ -3840,7 +4206,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				bdb->addRef(tdbb, SYNC_EXCLUSIVE);
 			else
 			{
-				bdb = get_oldest_buffer(tdbb, bcb);
+				bdb = get_oldest_buffer(tdbb, bcb, shard);
 				if (!bdb)
 				{
 					Thread::yield();
@@ -3871,7 +4237,7 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 				if (!bdb2)
 				{
 					bdb->bdb_page = page;
-					bdb->bdb_flags &= BDB_lru_chained; // yes, clear all except BDB_lru_chained
+					bdb->bdb_flags &= (BDB_lru_chained | BDB_probation | BDB_new_page); // yes, clear all except LRU state
 					bdb->bdb_flags |= BDB_read_pending;
 					bdb->bdb_scan_count = 0;
 					if (bdb->bdb_lock)
@@ -3881,17 +4247,26 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 					bcbSync.unlock();
 #endif
 
+					// with 2Q policy newly read page starts in the probation que
+
+					const bool probation = (bcb->bcb_flags & BCB_scan_resistant);
+
+					fb_assert(bdb->bdb_shard == shard);
+
 					if (!(bdb->bdb_flags & BDB_lru_chained))
 					{
-						Sync syncLRU(&bcb->bcb_syncLRU, FB_FUNCTION);
+						Sync syncLRU(&shard->bsh_syncLRU, FB_FUNCTION);
 						if (syncLRU.lockConditional(SYNC_EXCLUSIVE))
-						{
-							QUE_DELETE(bdb->bdb_in_use);
-							QUE_INSERT(bcb->bcb_in_use, bdb->bdb_in_use);
-						}
+							lruInsert(shard, bdb, probation);
 						else
+						{
+							if (probation)
+								bdb->bdb_flags |= BDB_new_page;
 							recentlyUsed(bdb);
+						}
 					}
+					else if (probation)
+						bdb->bdb_flags |= BDB_new_page;
 					tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 					return bdb;
 				}
@@ -3908,7 +4283,8 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 					bdb2->release(tdbb, true);
 					continue;
 				}
-				recentlyUsed(bdb2);
+				if (!lowPriority || !(bdb2->bdb_flags & BDB_probation))
+					recentlyUsed(bdb2);
 				tdbb->bumpStats(RuntimeStatistics::PAGE_FETCHES);
 			}
 			else
@@ -3917,9 +4293,9 @@ static BufferDesc* get_buffer(thread_db* tdbb, const PageNumber page, SyncType s
 			bdb->release(tdbb, true);
 			if (is_empty)
 			{
-				SyncLockGuard syncEmpty(&bcb->bcb_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
-				QUE_INSERT(bcb->bcb_empty, bdb->bdb_que);
-				bcb->bcb_inuse--;
+				SyncLockGuard syncEmpty(&shard->bsh_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+				QUE_INSERT(shard->bsh_empty, bdb->bdb_que);
+				shard->bsh_inuse--;
 			}
 
 			if (!bdb2 && wait > 0)
@@ -4251,7 +4627,10 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 			fb_assert(memory_end >= memory + page_size * to_alloc);
 		}
 
-		tail = ::new(tail) BufferDesc(bcb);
+		// spread buffers evenly over the shards
+		BufferShard* const shard = &bcb->bcb_shards[(bcb->bcb_count + buffers) % bcb->bcb_shard_count];
+
+		tail = ::new(tail) BufferDesc(bcb, shard);
 
 		if (!(bcb->bcb_flags & BCB_exclusive))
 		{
@@ -4264,7 +4643,11 @@ static ULONG memory_init(thread_db* tdbb, BufferControl* bcb, ULONG number)
 		tail->bdb_buffer = (pag*) memory;
 		memory += bcb->bcb_page_size;
 
-		QUE_INSERT(bcb->bcb_empty, tail->bdb_que);
+		{
+			SyncLockGuard syncEmpty(&shard->bsh_syncEmpty, SYNC_EXCLUSIVE, FB_FUNCTION);
+			QUE_INSERT(shard->bsh_empty, tail->bdb_que);
+			shard->bsh_count++;
+		}
 		tail++;
 
 		buffers++;				// Allocated buffers
@@ -4994,36 +5377,171 @@ static bool write_page(thread_db* tdbb, BufferDesc* bdb, FbStatusVector* const s
 		dbb->dbb_flags |= DBB_suspend_bgio;
 	}
 	else
+		page_written(tdbb, bdb);
+
+	return result;
+}
+
+
+static bool write_pages(thread_db* tdbb, BufferDesc** pages, FB_SIZE_T count,
+	FbStatusVector* const status)
+{
+/**************************************
+ *
+ *	w r i t e _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Write a number of dirty pages of the same page space
+ *	locked for IO by the caller, queueing all the writes
+ *	at once. When the pages need to be encrypted, shadowed
+ *	or written into the difference file, write them one by
+ *	one instead. IO locks are released in any case.
+ *
+ **************************************/
+	Database* const dbb = tdbb->getDatabase();
+
+	PageSpace* const pageSpace =
+		dbb->dbb_page_manager.findPageSpace(pages[0]->bdb_page.getPageSpaceID());
+	fb_assert(pageSpace);
+
+	// Page of the stable (not stalled nor merged) database is written
+	// into the main file only. Dirty pages keep the backup state locked.
+
+	const bool plain = pageSpace->isTemporary() ||
+		(!dbb->dbb_shadow && dbb->dbb_backup_manager->getState() == Ods::hdr_nbak_normal);
+
+	class BatchIo : public CryptoManager::IOBatchCallback
 	{
-		// clear the dirty bit vector, since the buffer is now
-		// clean regardless of which transactions have modified it
+	public:
+		BatchIo(jrd_file* f, BufferDesc** p, FB_SIZE_T c)
+			: file(f), pages(p), count(c)
+		{ }
 
-		// Destination difference page number is only valid between MARK and
-		// write_page so clean it now to avoid confusion
-		bdb->bdb_difference_page = 0;
-		bdb->bdb_transactions = 0;
-		bdb->bdb_mark_transaction = 0;
+		bool callback(thread_db* tdbb, FbStatusVector* status)
+		{
+			HalfStaticArray<PageIoRequest, WriteBatch::MAX_PAGES> requests;
 
-		if (!(bdb->bdb_bcb->bcb_flags & BCB_keep_pages))
-			removeDirty(bdb->bdb_bcb, bdb);
+			for (FB_SIZE_T i = 0; i < count; i++)
+			{
+				BufferDesc* const bdb = pages[i];
+				pag* const page = bdb->bdb_buffer;
 
-		bdb->bdb_flags &= ~(BDB_must_write | BDB_system_dirty);
-		clear_dirty_flag_and_nbak_state(tdbb, bdb);
+				CCH_TRACE(("WRITE   %d:%06d", bdb->bdb_page.getPageSpaceID(), bdb->bdb_page.getPageNum()));
+
+				page->pag_flags &= ~Ods::crypted_page;
+				page->pag_generation++;
+				page->pag_pageno = bdb->bdb_page.getPageNum();
+				tdbb->bumpStats(RuntimeStatistics::PAGE_WRITES);
 
-		if (bdb->bdb_flags & BDB_io_error)
+				PageIoRequest& request = requests.add();
+				request.pio_bdb = bdb;
+				request.pio_page = page;
+			}
+
+			return PIO_write_pages(tdbb, file, requests.begin(), count, status);
+		}
+
+	private:
+		jrd_file* file;
+		BufferDesc** pages;
+		FB_SIZE_T count;
+	};
+
+	bool done = false;
+	bool result = true;
+	FB_SIZE_T written = 0;
+
+	if (plain && count > 1)
+	{
+		BatchIo io(pageSpace->file, pages, count);
+		result = dbb->dbb_crypto_manager->writePlain(tdbb, status, &io, done);
+	}
+
+	if (done)
+	{
+		if (result)
+		{
+			for (; written < count; written++)
+			{
+				pages[written]->bdb_flags &= ~BDB_db_dirty;
+				page_written(tdbb, pages[written]);
+			}
+		}
+		else
 		{
-			// If a write error has cleared, signal background threads
-			// to resume their regular duties. If someone has freed up
-			// disk space these errors will spontaneously go away.
+			// We don't know which pages are written, they are dirty still
 
-			bdb->bdb_flags &= ~BDB_io_error;
-			dbb->dbb_flags &= ~DBB_suspend_bgio;
+			for (FB_SIZE_T i = 0; i < count; i++)
+				pages[i]->bdb_flags |= BDB_io_error;
+
+			dbb->dbb_flags |= DBB_suspend_bgio;
 		}
 	}
+	else if (result)
+	{
+		for (; written < count; written++)
+		{
+			if (!write_page(tdbb, pages[written], status, false))
+			{
+				result = false;
+				break;
+			}
+		}
+	}
+
+	for (FB_SIZE_T i = 0; i < count; i++)
+	{
+		pages[i]->unLockIO(tdbb);
+
+		if (i < written)
+			clear_precedence(tdbb, pages[i]);
+	}
 
 	return result;
 }
 
+
+static void page_written(thread_db* tdbb, BufferDesc* bdb)
+{
+/**************************************
+ *
+ *	p a g e _ w r i t t e n
+ *
+ **************************************
+ *
+ * Functional description
+ *	Mark the buffer clean after its page is written.
+ *
+ **************************************/
+
+	// clear the dirty bit vector, since the buffer is now
+	// clean regardless of which transactions have modified it
+
+	// Destination difference page number is only valid between MARK and
+	// write_page so clean it now to avoid confusion
+	bdb->bdb_difference_page = 0;
+	bdb->bdb_transactions = 0;
+	bdb->bdb_mark_transaction = 0;
+
+	if (!(bdb->bdb_bcb->bcb_flags & BCB_keep_pages))
+		removeDirty(bdb->bdb_bcb, bdb);
+
+	bdb->bdb_flags &= ~(BDB_must_write | BDB_system_dirty);
+	clear_dirty_flag_and_nbak_state(tdbb, bdb);
+
+	if (bdb->bdb_flags & BDB_io_error)
+	{
+		// If a write error has cleared, signal background threads
+		// to resume their regular duties. If someone has freed up
+		// disk space these errors will spontaneously go away.
+
+		bdb->bdb_flags &= ~BDB_io_error;
+		tdbb->getDatabase()->dbb_flags &= ~DBB_suspend_bgio;
+	}
+}
+
 static void clear_dirty_flag_and_nbak_state(thread_db* tdbb, BufferDesc* bdb)
 {
 	const AtomicCounter::counter_type oldFlags = bdb->bdb_flags.exchangeBitAnd(
@@ -5046,10 +5564,10 @@ void recentlyUsed(BufferDesc* bdb)
 	if (oldFlags & BDB_lru_chained)
 		return;
 
-	BufferControl* bcb = bdb->bdb_bcb;
+	BufferShard* const shard = bdb->bdb_shard;
 
 #ifdef DEV_BUILD
-	volatile BufferDesc* chain = bcb->bcb_lru_chain;
+	volatile BufferDesc* chain = shard->bsh_lru_chain;
 	for (; chain; chain = chain->bdb_lru_chain)
 	{
 		if (chain == bdb)
@@ -5058,14 +5576,14 @@ void recentlyUsed(BufferDesc* bdb)
 #endif
 	for (;;)
 	{
-		bdb->bdb_lru_chain = bcb->bcb_lru_chain;
-		if (bcb->bcb_lru_chain.compare_exchange_strong(bdb->bdb_lru_chain, bdb))
+		bdb->bdb_lru_chain = shard->bsh_lru_chain;
+		if (shard->bsh_lru_chain.compare_exchange_strong(bdb->bdb_lru_chain, bdb))
 			break;
 	}
 }
 
 
-void requeueRecentlyUsed(BufferControl* bcb)
+void requeueRecentlyUsed(BufferShard* shard)
 {
 	BufferDesc* chain = NULL;
 
@@ -5073,8 +5591,8 @@ void requeueRecentlyUsed(BufferControl* bcb)
 
 	for (;;)
 	{
-		chain = bcb->bcb_lru_chain;
-		if (bcb->bcb_lru_chain.compare_exchange_strong(chain, NULL))
+		chain = shard->bsh_lru_chain;
+		if (shard->bsh_lru_chain.compare_exchange_strong(chain, NULL))
 			break;
 	}
 
@@ -5096,14 +5614,63 @@ void requeueRecentlyUsed(BufferControl* bcb)
 	while ((bdb = reversed) != NULL)
 	{
 		reversed = bdb->bdb_lru_chain;
-		QUE_DELETE(bdb->bdb_in_use);
-		QUE_INSERT(bcb->bcb_in_use, bdb->bdb_in_use);
+		lruInsert(shard, bdb, (bdb->bdb_flags & BDB_new_page));
 
 		bdb->bdb_lru_chain = NULL;
-		bdb->bdb_flags &= ~BDB_lru_chained;
+		bdb->bdb_flags &= ~(BDB_lru_chained | BDB_new_page);
+	}
+
+	chain = shard->bsh_lru_chain;
+}
+
+
+// LRU ques manipulation, bsh_syncLRU must be locked exclusively by the caller
+
+void lruRemove(BufferShard* shard, BufferDesc* bdb)
+{
+	QUE_DELETE(bdb->bdb_in_use);
+
+	if (bdb->bdb_flags & BDB_probation)
+	{
+		fb_assert(shard->bsh_probation_count);
+		shard->bsh_probation_count--;
+		bdb->bdb_flags &= ~BDB_probation;
+	}
+}
+
+
+// Put buffer at the head of the probation or main LRU que
+
+void lruInsert(BufferShard* shard, BufferDesc* bdb, bool probation)
+{
+	lruRemove(shard, bdb);
+
+	if (probation)
+	{
+		QUE_INSERT(shard->bsh_probation, bdb->bdb_in_use);
+		shard->bsh_probation_count++;
+		bdb->bdb_flags |= BDB_probation;
 	}
+	else
+		QUE_INSERT(shard->bsh_in_use, bdb->bdb_in_use);
+}
+
+
+// Put buffer at the tail of LRU que to make it the first candidate for
+// replacement. With 2Q policy it's the tail of the probation que.
+
+void lruAppend(BufferShard* shard, BufferDesc* bdb)
+{
+	lruRemove(shard, bdb);
 
-	chain = bcb->bcb_lru_chain;
+	if (bdb->bdb_bcb->bcb_flags & BCB_scan_resistant)
+	{
+		QUE_APPEND(shard->bsh_probation, bdb->bdb_in_use);
+		shard->bsh_probation_count++;
+		bdb->bdb_flags |= BDB_probation;
+	}
+	else
+		QUE_APPEND(shard->bsh_in_use, bdb->bdb_in_use);
 }
 
 
@@ -5122,6 +5689,7 @@ void BufferControl::destroy(BufferControl* bcb)
 	MemoryPool* const pool = bcb->bcb_bufferpool;
 	MemoryStats temp_stats;
 	pool->setStatsGroup(temp_stats);
+	delete[] bcb->bcb_shards;
 	delete bcb;
 	dbb->deletePool(pool);
 }
@@ -5227,6 +5795,21 @@ void BufferDesc::lockIO(thread_db* tdbb)
 }
 
 
+bool BufferDesc::lockIOConditional(thread_db* tdbb)
+{
+	if (!bdb_syncIO.lockConditional(SYNC_EXCLUSIVE, FB_FUNCTION))
+		return false;
+
+	fb_assert(!bdb_io_locks && bdb_io != tdbb || bdb_io_locks && bdb_io == tdbb);
+
+	bdb_io = tdbb;
+	bdb_io->registerBdb(this);
+	++bdb_io_locks;
+	++bdb_use_count;
+	return true;
+}
+
+
 void BufferDesc::unLockIO(thread_db* tdbb)
 {
 	fb_assert(bdb_io && bdb_io == tdbb);
@@ -73,6 +73,45 @@ const ULONG MAX_PAGE_BUFFERS = 131072;
 const ULONG MAX_PAGE_BUFFERS = MAX_SLONG - 1;
 #endif
 
+// BufferShard -- part of page buffers cache with its own LRU and free lists.
+// Every page buffer belongs to exactly one shard for its whole life, and page
+// is always cached by a buffer of the shard selected by page number, thus
+// concurrent cache misses of different pages usually don't contend for the
+// same locks.
+
+class BufferShard
+{
+public:
+	BufferShard()
+	{
+		QUE_INIT(bsh_in_use);
+		QUE_INIT(bsh_probation);
+		QUE_INIT(bsh_empty);
+		bsh_lru_chain = nullptr;
+		bsh_probation_count = 0;
+		bsh_count = 0;
+		bsh_inuse = 0;
+		bsh_free_minimum = 0;
+	}
+
+	que			bsh_in_use;			// Que of buffers in use, main LRU que
+	que			bsh_probation;		// Que of newly read buffers, 2Q policy only
+	que			bsh_empty;			// Que of empty buffers
+
+	// Recently used buffer put there without locking common LRU que (bsh_in_use).
+	// When bsh_syncLRU is locked this chain is merged into bsh_in_use. See also
+	// requeueRecentlyUsed() and recentlyUsed()
+	std::atomic<BufferDesc*>	bsh_lru_chain;
+
+	ULONG		bsh_probation_count;	// Number of buffers in probation que
+	ULONG		bsh_count;			// Number of buffers allocated
+	ULONG		bsh_inuse;			// Number of buffers in use
+	SSHORT		bsh_free_minimum;	// Threshold to activate cache writer
+
+	Firebird::SyncObject	bsh_syncEmpty;
+	Firebird::SyncObject	bsh_syncLRU;
+};
+
 // BufferControl -- Buffer control block -- one per system
 
 class BufferControl : public pool_alloc<type_bcb>
@@ -85,16 +124,14 @@ class BufferControl : public pool_alloc<type_bcb>
 		  bcb_bdbBlocks(p)
 	{
 		bcb_database = NULL;
-		QUE_INIT(bcb_in_use);
 		QUE_INIT(bcb_pending);
-		QUE_INIT(bcb_empty);
 		QUE_INIT(bcb_dirty);
 		bcb_dirty_count = 0;
 		bcb_free = NULL;
 		bcb_flags = 0;
-		bcb_free_minimum = 0;
 		bcb_count = 0;
-		bcb_inuse = 0;
+		bcb_shards = nullptr;
+		bcb_shard_count = 0;
 		bcb_prec_walk_mark = 0;
 		bcb_page_size = 0;
 		bcb_page_incarnation = 0;
@@ -109,38 +146,40 @@ public:
 	static BufferControl* create(Database* dbb);
 	static void destroy(BufferControl*);
 
+	static const ULONG MAX_SHARDS = 16;
+	static const ULONG MIN_SHARD_BUFFERS = 1024;
+
+	BufferShard* getShard(const PageNumber& page) const
+	{
+		// page number bits are mixed to not put every Nth page into the same shard
+		const ULONG hash = (page.getPageNum() + page.getPageSpaceID()) * 0x9E3779B1u;
+		return &bcb_shards[(hash >> 16) & (bcb_shard_count - 1)];
+	}
+
 	Database*	bcb_database;
 
 	Firebird::MemoryPool* bcb_bufferpool;
 	Firebird::MemoryStats bcb_memory_stats;
 
 	UCharStack	bcb_memory;			// Large block partitioned into buffers
-	que			bcb_in_use;			// Que of buffers in use, main LRU que
 	que			bcb_pending;		// Que of buffers which are going to be freed and reassigned
-	que			bcb_empty;			// Que of empty buffers
 
-	// Recently used buffer put there without locking common LRU que (bcb_in_use).
-	// When bcb_syncLRU is locked this chain is merged into bcb_in_use. See also
-	// requeueRecentlyUsed() and recentlyUsed()
-	std::atomic<BufferDesc*>	bcb_lru_chain;
+	BufferShard*	bcb_shards;		// LRU and free lists, see getShard()
+	ULONG		bcb_shard_count;	// Number of shards, power of 2
 
 	que			bcb_dirty;			// que of dirty buffers
 	SLONG		bcb_dirty_count;	// count of pages in dirty page btree
 
 	Precedence*	bcb_free;			// Free precedence blocks
 	SSHORT		bcb_flags;			// see below
-	SSHORT		bcb_free_minimum;	// Threshold to activate cache writer
 	ULONG		bcb_count;			// Number of buffers allocated
-	ULONG		bcb_inuse;			// Number of buffers in use
 	ULONG		bcb_prec_walk_mark;	// mark value used in precedence graph walk
 	ULONG		bcb_page_size;		// Database page size in bytes
 	ULONG		bcb_page_incarnation;	// Cache page incarnation counter
 
 	Firebird::SyncObject	bcb_syncObject;
 	Firebird::SyncObject	bcb_syncDirtyBdbs;
-	Firebird::SyncObject	bcb_syncEmpty;
 	Firebird::SyncObject	bcb_syncPrecedence;
-	Firebird::SyncObject	bcb_syncLRU;
 
 	typedef ThreadFinishSync<BufferControl*> BcbThreadSync;
 
@@ -181,6 +220,7 @@ const int BCB_reader_active	= 32;	// cache reader not blocked on event
 #endif
 const int BCB_free_pending	= 64;	// request cache writer to free pages
 const int BCB_exclusive		= 128;	// there is only BCB in whole system
+const int BCB_scan_resistant	= 256;	// 2Q replacement policy, see CachePolicy in firebird.conf
 
 
 // BufferDesc -- Buffer descriptor block
@@ -188,8 +228,10 @@ const int BCB_exclusive		= 128;	// there is only BCB in whole system
 class BufferDesc : public pool_alloc<type_bdb>
 {
 public:
-	explicit BufferDesc(BufferControl* bcb)
+	// Temporary descriptors used for I/O outside the cache belong to no shard
+	explicit BufferDesc(BufferControl* bcb, BufferShard* shard = NULL)
 		: bdb_bcb(bcb),
+		  bdb_shard(shard),
 		  bdb_page(0, 0)
 	{
 		bdb_lock = NULL;
@@ -218,6 +260,7 @@ public:
 	void release(thread_db* tdbb, bool repost);
 
 	void lockIO(thread_db*);
+	bool lockIOConditional(thread_db*);
 	void unLockIO(thread_db*);
 
 	bool isLocked() const
@@ -236,9 +279,10 @@ public:
 	}
 
 	BufferControl*	bdb_bcb;
+	BufferShard*	bdb_shard;
 	Firebird::SyncObject	bdb_syncPage;
 	Lock*		bdb_lock;				// Lock block for buffer
-	que			bdb_que;				// Either mod que in hash table or bcb_empty que if never used
+	que			bdb_que;				// Either mod que in hash table or bsh_empty que if never used
 	que			bdb_in_use;				// queue of buffers in use
 	que			bdb_dirty;				// dirty pages LRU queue
 	BufferDesc*	bdb_lru_chain;			// pending LRU chain
@@ -288,6 +332,8 @@ const int BDB_prefetch			= 0x4000;	// page has been prefetched but not yet refer
 const int BDB_no_blocking_ast	= 0x8000;	// No blocking AST registered with page lock
 const int BDB_lru_chained		= 0x10000;	// buffer is in pending LRU chain
 const int BDB_nbak_state_lock	= 0x20000;	// nbak state lock should be released after buffer is written
+const int BDB_probation			= 0x40000;	// buffer is in probation que
+const int BDB_new_page			= 0x80000;	// pending LRU chain should put buffer into probation que
 
 // bdb_ast_flags
 
@@ -29,6 +29,7 @@
 #include <string.h>
 #include "iberror.h"
 #include "../common/classes/init.h"
+#include "../common/classes/Hash.h"
 #include "../common/config/config.h"
 #include "../common/ThreadStart.h"
 #include "../jrd/event.h"
@@ -308,6 +309,8 @@ SLONG EventManager::queEvents(SLONG session_id,
 
 	if (flag)
 	{
+		queue_request((evt_req*) SRQ_ABS_PTR(request_offset));
+
 		if (!post_process((prb*) SRQ_ABS_PTR(m_processOffset)))
 		{
 			release_shmem();
@@ -381,15 +384,9 @@ void EventManager::postEvent(USHORT length, const TEXT* string, USHORT count)
 		SRQ_LOOP(event->evnt_interests, event_srq)
 		{
 			req_int* const interest = (req_int*) ((UCHAR*) event_srq - offsetof(req_int, rint_interests));
-			if (interest->rint_request)
+			if (interest->rint_request && interest->rint_count <= event->evnt_count)
 			{
-				evt_req* const request = (evt_req*) SRQ_ABS_PTR(interest->rint_request);
-
-				if (interest->rint_count <= event->evnt_count)
-				{
-					prb* const process = (prb*) SRQ_ABS_PTR(request->req_process);
-					process->prb_flags |= PRB_wakeup;
-				}
+				queue_request((evt_req*) SRQ_ABS_PTR(interest->rint_request));
 			}
 		}
 	}
@@ -606,6 +603,7 @@ void EventManager::create_process()
 	process->prb_process_id = PID;
 	insert_tail(&m_sharedMemory->getHeader()->evh_processes, &process->prb_processes);
 	SRQ_INIT(process->prb_sessions);
+	SRQ_INIT(process->prb_requests);
 
 	if (m_sharedMemory->eventInit(&process->prb_event) != FB_SUCCESS)
 	{
@@ -717,6 +715,9 @@ void EventManager::delete_request(evt_req* request)
 		}
 	}
 
+	if (request->req_deliveries.srq_forward)
+		remove_que(&request->req_deliveries);
+
 	remove_que(&request->req_requests);
 	free_global((frb*) request);
 }
@@ -793,42 +794,32 @@ void EventManager::deliver()
 	prb* process = (prb*) SRQ_ABS_PTR(m_processOffset);
 	process->prb_flags &= ~PRB_pending;
 
-	srq* que2 = SRQ_NEXT(process->prb_sessions);
-	while (que2 != &process->prb_sessions)
+	// Only the requests queued by postEvent() and queEvents() may be satisfied,
+	// there's no need to look through all the sessions and their requests
+
+	while (!SRQ_EMPTY(process->prb_requests))
 	{
-		ses* session = (ses*) ((UCHAR*) que2 - offsetof(ses, ses_sessions));
+		evt_req* const request =
+			(evt_req*) ((UCHAR*) SRQ_NEXT(process->prb_requests) - offsetof(evt_req, req_deliveries));
+		remove_que(&request->req_deliveries);
+
+		if (!request_completed(request))
+			continue;
+
+		const SLONG session_offset = request->req_session;
+		ses* session = (ses*) SRQ_ABS_PTR(session_offset);
 		session->ses_flags |= SES_delivering;
-		const SLONG session_offset = SRQ_REL_PTR(session);
-		const SLONG que2_offset = SRQ_REL_PTR(que2);
-		for (bool flag = true; flag;)
-		{
-			flag = false;
-			srq* event_srq;
-			SRQ_LOOP(session->ses_requests, event_srq)
-			{
-				evt_req* request = (evt_req*) ((UCHAR*) event_srq - offsetof(evt_req, req_requests));
-				if (request_completed(request))
-				{
-					deliver_request(request);
-					process = (prb*) SRQ_ABS_PTR(m_processOffset);
-					session = (ses*) SRQ_ABS_PTR(session_offset);
-					que2 = (srq *) SRQ_ABS_PTR(que2_offset);
-					flag = !(session->ses_flags & SES_purge);
-					break;
-				}
-			}
-		}
+
+		// Shared region is released while the callback is executed
+
+		deliver_request(request);
+
+		process = (prb*) SRQ_ABS_PTR(m_processOffset);
+		session = (ses*) SRQ_ABS_PTR(session_offset);
 		session->ses_flags &= ~SES_delivering;
+
 		if (session->ses_flags & SES_purge)
-		{
-			que2 = SRQ_NEXT((*que2));
-			delete_session(SRQ_REL_PTR(session));
-			break;
-		}
-		else
-		{
-			que2 = SRQ_NEXT((*que2));
-		}
+			delete_session(session_offset);
 	}
 }
 
@@ -910,8 +901,10 @@ evnt* EventManager::find_event(USHORT length, const TEXT* string)
  *	Lookup an event.
  *
  **************************************/
+	srq* const hash_header = &m_sharedMemory->getHeader()->evh_events[hash_slot(length, string)];
+
 	srq* event_srq;
-	SRQ_LOOP(m_sharedMemory->getHeader()->evh_events, event_srq)
+	SRQ_LOOP((*hash_header), event_srq)
 	{
 		evnt* const event = (evnt*) ((UCHAR*) event_srq - offsetof(evnt, evnt_events));
 
@@ -980,6 +973,22 @@ void EventManager::free_global(frb* block)
 }
 
 
+USHORT EventManager::hash_slot(USHORT length, const TEXT* string)
+{
+/**************************************
+ *
+ *	h a s h _ s l o t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Compute the hash chain of an event.
+ *
+ **************************************/
+	return (USHORT) InternalHash::hash(length, reinterpret_cast<const UCHAR*>(string), EVENT_HASH_SLOTS);
+}
+
+
 req_int* EventManager::historical_interest(ses* session, SRQ_PTR event_offset)
 {
 /**************************************
@@ -1037,7 +1046,9 @@ bool EventManager::initialize(SharedMemoryBase* sm, bool init)
 		header->evh_request_id = 0;
 
 		SRQ_INIT(header->evh_processes);
-		SRQ_INIT(header->evh_events);
+
+		for (USHORT i = 0; i < EVENT_HASH_SLOTS; i++)
+			SRQ_INIT(header->evh_events[i]);
 
 		frb* const free = (frb*) ((UCHAR*) header + sizeof(evh));
 		free->frb_header.hdr_length = sm->sh_mem_length_mapped - sizeof(evh);
@@ -1086,7 +1097,8 @@ evnt* EventManager::make_event(USHORT length, const TEXT* string)
  **************************************/
 	evnt* const event = (evnt*) alloc_global(type_evnt, sizeof(evnt) + length, false);
 
-	insert_tail(&m_sharedMemory->getHeader()->evh_events, &event->evnt_events);
+	insert_tail(&m_sharedMemory->getHeader()->evh_events[hash_slot(length, string)],
+		&event->evnt_events);
 	SRQ_INIT(event->evnt_interests);
 	event->evnt_length = length;
 	memcpy(event->evnt_name, string, length);
@@ -1177,6 +1189,28 @@ void EventManager::punt(const TEXT* string)
 }
 
 
+void EventManager::queue_request(evt_req* request)
+{
+/**************************************
+ *
+ *	q u e u e _ r e q u e s t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Put the satisfied request into the delivery que
+ *	of its process and schedule a wakeup for the process.
+ *
+ **************************************/
+	prb* const process = (prb*) SRQ_ABS_PTR(request->req_process);
+
+	if (!request->req_deliveries.srq_forward)
+		insert_tail(&process->prb_requests, &request->req_deliveries);
+
+	process->prb_flags |= PRB_wakeup;
+}
+
+
 void EventManager::release_shmem()
 {
 /**************************************
@@ -33,17 +33,20 @@
 
 // Global section header
 
-const USHORT EVENT_VERSION = 4;
+const USHORT EVENT_VERSION = 5;
+
+// Number of hash chains of known events
+const USHORT EVENT_HASH_SLOTS = 1009;
 
 class evh : public Firebird::MemoryHeader
 {
 public:
 	ULONG evh_length;				// Current length of global section
-	srq evh_events;					// Known events
 	srq evh_processes;				// Known processes
 	SRQ_PTR evh_free;				// Free blocks
 	SRQ_PTR evh_current_process;	// Current process, if any
 	SLONG evh_request_id;			// Next request id
+	srq evh_events[EVENT_HASH_SLOTS];	// Known events hashed by name
 };
 
 // Common block header
@@ -78,6 +81,7 @@ struct prb
 	event_hdr prb_header;
 	srq prb_processes;				// Process que owned by header
 	srq prb_sessions;				// Sessions within process
+	srq prb_requests;				// Satisfied requests to be delivered
 	SLONG prb_process_id;			// Process id
 	Firebird::event_t prb_event;	// Event on which to wait
 	USHORT prb_flags;
@@ -105,7 +109,7 @@ const int SES_purge			= 2;	// delete session after delivering an event
 struct evnt
 {
 	event_hdr evnt_header;
-	srq evnt_events;				// System event que (owned by header)
+	srq evnt_events;				// Hash chain of events (owned by header)
 	srq evnt_interests;				// Que of request interests in event
 	SLONG evnt_count;				// Current event count
 	USHORT evnt_length;				// Length of event name
@@ -118,6 +122,7 @@ struct evt_req
 {
 	event_hdr req_header;
 	srq req_requests;				// Request que owned by session block
+	srq req_deliveries;				// Que of satisfied requests owned by process block
 	SRQ_PTR req_process;			// Parent process block
 	SRQ_PTR req_session;			// Parent session block
 	SRQ_PTR req_interests;			// First interest in request
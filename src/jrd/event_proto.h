@@ -78,11 +78,13 @@ private:
 	void exit_handler(void *);
 	evnt* find_event(USHORT, const TEXT*);
 	void free_global(frb*);
+	static USHORT hash_slot(USHORT, const TEXT*);
 	req_int* historical_interest(ses*, SLONG);
 	void insert_tail(srq*, srq*);
 	evnt* make_event(USHORT, const TEXT*);
 	bool post_process(prb*);
 	void probe_processes();
+	void queue_request(evt_req*);
 	void release_shmem();
 	void remove_que(srq*);
 	bool request_completed(evt_req*);
@@ -82,6 +82,7 @@ class DeclareSubFuncNode;
 class DeclareSubProcNode;
 class DeclareVariableNode;
 class MessageNode;
+class MonitoringFilter;
 class PlanNode;
 class RecordSource;
 class Select;
@@ -602,6 +603,8 @@ public:
 	ULONG		csb_nextCursorId = 1;
 	ULONG		csb_nextRecSourceId = 1;
 
+	MonitoringFilter* csb_mon_filter = nullptr;	// monitoring data asked for
+
 	struct csb_repeat
 	{
 		// We must zero-initialize this one
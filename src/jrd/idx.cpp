@@ -38,6 +38,7 @@
 #include "../jrd/ods.h"
 #include "../jrd/btr.h"
 #include "../jrd/sort.h"
+#include "../jrd/Histogram.h"
 #include "../jrd/lls.h"
 #include "../jrd/tra.h"
 #include "iberror.h"
@@ -1453,7 +1454,8 @@ void IDX_modify_flag_uk_modified(thread_db* tdbb,
 }
 
 
-void IDX_statistics(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityList& selectivity)
+void IDX_statistics(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityList& selectivity,
+	IndexHistogram* histogram)
 {
 /**************************************
  *
@@ -1463,13 +1465,185 @@ void IDX_statistics(thread_db* tdbb, jrd_rel* relation, USHORT id, SelectivityLi
  *
  * Functional description
  *	Scan index pages recomputing
- *	selectivity.
+ *	selectivity and, optionally,
+ *	the key distribution histogram.
  *
  **************************************/
 
 	SET_TDBB(tdbb);
 
-	BTR_selectivity(tdbb, relation, id, selectivity);
+	BTR_selectivity(tdbb, relation, id, selectivity, histogram);
+}
+
+
+// Used in qsort below
+extern "C" {
+	static int cmpBatchKeys(const void* a, const void* b)
+	{
+		const BatchIndexKeys::Entry* entryA = (const BatchIndexKeys::Entry*) a;
+		const BatchIndexKeys::Entry* entryB = (const BatchIndexKeys::Entry*) b;
+
+		if (entryA->idxId != entryB->idxId)
+			return (entryA->idxId > entryB->idxId) ? 1 : -1;
+
+		const int result = memcmp(entryA->data, entryB->data, MIN(entryA->length, entryB->length));
+		if (result)
+			return result;
+
+		if (entryA->length != entryB->length)
+			return (entryA->length > entryB->length) ? 1 : -1;
+
+		if (entryA->number != entryB->number)
+			return (entryA->number > entryB->number) ? 1 : -1;
+
+		return 0;
+	}
+} // extern C
+
+
+bool BatchIndexKeys::isDeferred(thread_db* tdbb, jrd_rel* relation, const index_desc* idx) const
+{
+	// Triggers may look up the relation by any of its indices, thus keys must be
+	// there as soon as the record is stored
+
+	if (relation != m_relation ||
+		(relation->rel_pre_store && relation->rel_pre_store->hasActive()) ||
+		(relation->rel_post_store && relation->rel_post_store->hasActive()))
+	{
+		return false;
+	}
+
+	return !(idx->idx_flags & (idx_unique | idx_primary | idx_foreign));
+}
+
+void BatchIndexKeys::add(const index_desc* idx, RecordNumber number, const temporary_key* key)
+{
+	fb_assert(!key->key_next);
+
+	if (m_chunks.isEmpty() ||
+		m_chunks[m_chunks.getCount() - 1].getCount() + key->key_length > CHUNK_LENGTH)
+	{
+		// Chunks are never reallocated as entries point into them
+		UCharBuffer& chunk = m_chunks.add();
+		chunk.getBuffer(CHUNK_LENGTH);
+		chunk.shrink(0);
+	}
+
+	UCharBuffer& chunk = m_chunks[m_chunks.getCount() - 1];
+	const FB_SIZE_T offset = chunk.getCount();
+	chunk.add(key->key_data, key->key_length);
+
+	Entry& entry = m_entries.add();
+	entry.data = chunk.begin() + offset;
+	entry.number = number.getValue();
+	entry.idxId = idx->idx_id;
+	entry.length = key->key_length;
+	entry.nulls = key->key_nulls;
+	entry.flags = key->key_flags;
+
+	m_length += key->key_length + sizeof(Entry);
+}
+
+BatchIndexKeys::Mark BatchIndexKeys::mark() const
+{
+	Mark mark;
+	mark.entries = m_entries.getCount();
+	mark.chunks = m_chunks.getCount();
+	mark.chunkLength = mark.chunks ? m_chunks[mark.chunks - 1].getCount() : 0;
+	mark.length = m_length;
+
+	return mark;
+}
+
+void BatchIndexKeys::rollback(const Mark& mark)
+{
+	fb_assert(mark.entries <= m_entries.getCount());
+	fb_assert(mark.chunks <= m_chunks.getCount());
+
+	// Chunks added since the mark are freed, the last one is refilled from there
+	m_entries.shrink(mark.entries);
+	m_chunks.shrink(mark.chunks);
+
+	if (mark.chunks)
+		m_chunks[mark.chunks - 1].shrink(mark.chunkLength);
+
+	m_length = mark.length;
+}
+
+void BatchIndexKeys::clear()
+{
+	m_entries.clear();
+	m_chunks.clear();
+	m_length = 0;
+}
+
+void BatchIndexKeys::sort()
+{
+	qsort(m_entries.begin(), m_entries.getCount(), sizeof(Entry), cmpBatchKeys);
+}
+
+void BatchIndexKeys::flush(thread_db* tdbb, jrd_tra* transaction)
+{
+	if (m_entries.hasData())
+	{
+		sort();
+
+		index_desc idx;
+		idx.idx_id = idx_invalid;
+
+		temporary_key key;
+
+		index_insertion insertion;
+		insertion.iib_relation = m_relation;
+		insertion.iib_descriptor = &idx;
+		insertion.iib_transaction = transaction;
+		insertion.iib_key = &key;
+
+		RelationPages* relPages = m_relation->getPages(tdbb);
+		WIN window(relPages->rel_pg_space_id, -1);
+
+		const Entry* entry = m_entries.begin();
+		const Entry* const end = m_entries.end();
+
+		while (entry < end && BTR_next_index(tdbb, m_relation, transaction, &idx, &window))
+		{
+			// Root page is fetched there, and it's released by every insertion
+
+			for (; entry < end && entry->idxId == idx.idx_id; entry++)
+			{
+				if (!window.win_bdb)
+				{
+					const index_root_page* root =
+						(index_root_page*) CCH_FETCH(tdbb, &window, LCK_read, pag_root);
+
+					// The top of index could be split by the prior insertion
+					idx.idx_root = root->irt_rpt[idx.idx_id].getRoot();
+				}
+
+				key.key_length = entry->length;
+				memcpy(key.key_data, entry->data, entry->length);
+				key.key_flags = entry->flags;
+				key.key_nulls = entry->nulls;
+
+				insertion.iib_number.setValue(entry->number);
+				insertion.iib_duplicates = NULL;
+				insertion.iib_btr_level = 0;
+
+				BTR_insert(tdbb, &window, &insertion);
+			}
+
+			if (!window.win_bdb)
+				CCH_FETCH(tdbb, &window, LCK_read, pag_root);
+		}
+
+		if (window.win_bdb)
+			CCH_RELEASE(tdbb, &window);
+
+		// Relation couldn't lose an index while records were stored
+		fb_assert(entry == end);
+	}
+
+	clear();
 }
 
 
@@ -1502,6 +1676,11 @@ void IDX_store(thread_db* tdbb, record_param* rpb, jrd_tra* transaction)
 	RelationPages* relPages = rpb->rpb_relation->getPages(tdbb);
 	WIN window(relPages->rel_pg_space_id, -1);
 
+	// Batch may defer the insertion of keys to do it in the sorted order
+	const Request* const request = tdbb->getRequest();
+	BatchIndexKeys* const batchKeys = (request && (rpb->rpb_stream_flags & RPB_s_bulk)) ?
+		request->req_batch_keys : NULL;
+
 	while (BTR_next_index(tdbb, rpb->rpb_relation, transaction, &idx, &window))
 	{
 		if (!BTR_check_condition(tdbb, &idx, rpb->rpb_record))
@@ -1521,6 +1700,12 @@ void IDX_store(thread_db* tdbb, record_param* rpb, jrd_tra* transaction)
 
 		expression.reset();
 
+		if (batchKeys && !key->key_next && batchKeys->isDeferred(tdbb, rpb->rpb_relation, &idx))
+		{
+			batchKeys->add(&idx, rpb->rpb_number, key);
+			continue;
+		}
+
 		insertion.iib_key = key;
 
 		if ( (error_code = insert_key(tdbb, rpb->rpb_relation, rpb->rpb_record, transaction,
@@ -2100,6 +2285,10 @@ static void release_index_block(thread_db* tdbb, IndexBlock* index_block)
 	}
 	index_block->idb_condition = nullptr;
 
+	delete index_block->idb_histogram;
+	index_block->idb_histogram = nullptr;
+	index_block->idb_histogram_selectivity = 0;
+
 	LCK_release(tdbb, index_block->idb_lock);
 }
 
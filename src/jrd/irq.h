@@ -184,6 +184,8 @@ enum irq_type_t
 	irq_dbb_ss_definer,		// get database sql security value
 	irq_out_proc_param_dep,	// check output procedure parameter dependency
 	irq_l_pub_tab_state,	// lookup publication state for a table
+	irq_m_index_hist,		// modify index histogram
+	irq_l_index_hist,		// lookup index histogram
 
 	irq_MAX
 };
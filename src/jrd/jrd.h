@@ -117,6 +117,7 @@ class jrd_rel;
 class ExternalFile;
 class ViewContext;
 class IndexBlock;
+class IndexHistogram;
 class IndexLock;
 class ArrayField;
 struct sort_context;
@@ -315,6 +316,8 @@ public:
 	dsc			idb_expression_desc;		// descriptor for expression result
 	BoolExprNode* idb_condition;			// node tree for index condition
 	Statement* idb_condition_statement;		// statement for index condition evaluation
+	IndexHistogram* idb_histogram;			// key distribution histogram
+	float		idb_histogram_selectivity;	// index selectivity the histogram was looked up for
 	Lock*		idb_lock;					// lock to synchronize changes to index
 	USHORT		idb_id;
 };
@@ -374,6 +377,7 @@ const USHORT WIN_large_scan			= 1;	// large sequential scan
 const USHORT WIN_secondary			= 2;	// secondary stream
 const USHORT WIN_garbage_collector	= 4;	// garbage collector's window
 const USHORT WIN_garbage_collect	= 8;	// scan left a page for garbage collector
+const USHORT WIN_low_priority		= 16;	// fetched pages should not displace working set
 
 
 #ifdef USE_ITIMER
@@ -123,6 +123,7 @@ NAME("RDB$GENERIC_TYPE", nam_gnr_type)
 NAME("RDB$GRANTOR", nam_grantor)
 NAME("RDB$GRANT_OPTION", nam_grant)
 NAME("RDB$GUID", nam_guid)
+NAME("RDB$HISTOGRAM", nam_histogram)
 NAME("RDB$HOST_NAME", nam_host_name)
 NAME("RDB$IDS", nam_ids)
 NAME("RDB$INDEX_ID", nam_i_id)
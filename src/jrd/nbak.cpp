@@ -46,6 +46,9 @@
 #include "../common/os/isc_i_proto.h"
 #include "../jrd/CryptoManager.h"
 #include "../jrd/replication/Publisher.h"
+#include "../jrd/WorkerAttachment.h"
+#include "../common/Task.h"
+#include "../common/utils_proto.h"
 
 #ifdef HAVE_SYS_TYPES_H
 #include <sys/types.h>
@@ -73,6 +76,249 @@ using namespace Jrd;
 using namespace Firebird;
 
 
+/******************************** MergeTask ******************************/
+
+namespace
+{
+
+// Pages of the difference file are merged in chunks of this size
+const ULONG MERGE_CHUNK = 512;
+
+void mergePages(thread_db* tdbb, const ULONG* pages, ULONG count, ULONG scn)
+{
+	for (const ULONG* const end = pages + count; pages < end; pages++)
+	{
+		JRD_reschedule(tdbb);
+
+		WIN window(DB_PAGE_SPACE, *pages);
+		NBAK_TRACE(("Merge page %d", *pages));
+		Ods::pag* page = CCH_FETCH(tdbb, &window, LCK_write, pag_undefined);
+		if (page->pag_scn != scn)
+		{
+			// Page is written into the database when it's released, thus the
+			// chunk is written page by page without flushing the whole cache
+			CCH_mark(tdbb, &window, true, true);
+			NBAK_TRACE(("Merge: page %d is marked", *pages));
+		}
+		CCH_RELEASE(tdbb, &window);
+	}
+}
+
+// Merges the difference file by several worker attachments. Every worker takes
+// the next chunk of the sorted page list and writes its pages in ascending
+// order, while chunks of different workers are written concurrently.
+
+class MergeTask : public Task
+{
+public:
+	MergeTask(thread_db* tdbb, MemoryPool* pool, const Array<ULONG>& pages, int workers)
+		: Task(),
+		  m_pool(pool),
+		  m_dbb(tdbb->getDatabase()),
+		  m_tdbb_flags(tdbb->tdbb_flags),
+		  m_pages(pages),
+		  m_scn(m_dbb->dbb_backup_manager->getCurrentSCN()),
+		  m_items(*m_pool),
+		  m_stop(false),
+		  m_next(0),
+		  m_merged(0),
+		  m_reported(0)
+	{
+		for (int i = 0; i < workers; i++)
+			m_items.add(FB_NEW_POOL(*m_pool) Item(this));
+
+		m_items[0]->m_ownAttach = false;
+		m_items[0]->m_attStable = tdbb->getAttachment()->getStable();
+	}
+
+	virtual ~MergeTask()
+	{
+		for (Item** p = m_items.begin(); p < m_items.end(); p++)
+			delete *p;
+	}
+
+	bool handler(WorkItem& _item);
+	bool getWorkItem(WorkItem** pItem);
+	bool getResult(IStatus* status);
+	int getMaxWorkers();
+
+	class Item : public Task::WorkItem
+	{
+	public:
+		Item(MergeTask* task) : Task::WorkItem(task),
+			m_inuse(false),
+			m_ownAttach(true),
+			m_first(0),
+			m_count(0)
+		{}
+
+		virtual ~Item()
+		{
+			if (!m_ownAttach || !m_attStable)
+				return;
+
+			FbLocalStatus status;
+			WorkerAttachment::releaseAttachment(&status, m_attStable);
+		}
+
+		bool init(thread_db* tdbb)
+		{
+			FbStatusVector* status = tdbb->tdbb_status_vector;
+			Attachment* att = NULL;
+
+			if (m_ownAttach && !m_attStable.hasData())
+				m_attStable = WorkerAttachment::getAttachment(status, getTask()->m_dbb);
+
+			if (m_attStable)
+				att = m_attStable->getHandle();
+
+			if (!att)
+			{
+				Arg::Gds(isc_bad_db_handle).copyTo(status);
+				return false;
+			}
+
+			tdbb->setDatabase(att->att_database);
+			tdbb->setAttachment(att);
+			return true;
+		}
+
+		MergeTask* getTask() const
+		{
+			return reinterpret_cast<MergeTask*> (m_task);
+		}
+
+		bool m_inuse;
+		bool m_ownAttach;
+		RefPtr<StableAttachmentPart> m_attStable;
+		ULONG m_first;
+		ULONG m_count;
+	};
+
+private:
+	void setError(IStatus* status)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+		if (m_status.isSuccess() && status && status->getState() == IStatus::STATE_ERRORS)
+			m_status.save(status);
+		m_stop = true;
+	}
+
+	void reportProgress(ULONG count)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		m_merged += count;
+		const ULONG percent = (ULONG) ((FB_UINT64) m_merged * 100 / m_pages.getCount());
+
+		if (percent >= m_reported + 10 && m_merged < m_pages.getCount())
+		{
+			m_reported = percent - percent % 10;
+			gds__log("Database: %s\n\tMerge of difference file: %" ULONGFORMAT "%% done",
+				m_dbb->dbb_filename.c_str(), m_reported);
+		}
+	}
+
+	MemoryPool* m_pool;
+	Database* m_dbb;
+	const ULONG m_tdbb_flags;
+	const Array<ULONG>& m_pages;
+	const ULONG m_scn;
+
+	Mutex m_mutex;
+	HalfStaticArray<Item*, 8> m_items;
+	StatusHolder m_status;
+
+	volatile bool m_stop;
+	ULONG m_next;
+	ULONG m_merged;
+	ULONG m_reported;
+};
+
+bool MergeTask::handler(WorkItem& _item)
+{
+	Item* item = reinterpret_cast<Item*>(&_item);
+
+	ThreadContextHolder tdbb(NULL);
+	tdbb->tdbb_flags = m_tdbb_flags;
+
+	if (!item->init(tdbb))
+	{
+		setError(tdbb->tdbb_status_vector);
+		return false;
+	}
+
+	try
+	{
+		WorkerContextHolder holder(tdbb, FB_FUNCTION);
+		mergePages(tdbb, m_pages.begin() + item->m_first, item->m_count, m_scn);
+	}
+	catch (const Exception& ex)
+	{
+		ex.stuffException(tdbb->tdbb_status_vector);
+		setError(tdbb->tdbb_status_vector);
+		return false;
+	}
+
+	reportProgress(item->m_count);
+	return true;
+}
+
+bool MergeTask::getWorkItem(WorkItem** pItem)
+{
+	Item* item = reinterpret_cast<Item*> (*pItem);
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (m_stop)
+		return false;
+
+	if (item == NULL)
+	{
+		for (Item** p = m_items.begin(); p < m_items.end(); p++)
+			if (!(*p)->m_inuse)
+			{
+				(*p)->m_inuse = true;
+				*pItem = item = *p;
+				break;
+			}
+	}
+
+	if (!item)
+		return false;
+
+	item->m_inuse = (m_next < m_pages.getCount());
+
+	if (item->m_inuse)
+	{
+		item->m_first = m_next;
+		item->m_count = MIN(MERGE_CHUNK, m_pages.getCount() - m_next);
+		m_next += item->m_count;
+	}
+
+	return item->m_inuse;
+}
+
+bool MergeTask::getResult(IStatus* status)
+{
+	if (status)
+	{
+		status->init();
+		status->setErrors(m_status.getErrors());
+	}
+
+	return m_status.isSuccess();
+}
+
+int MergeTask::getMaxWorkers()
+{
+	const ULONG chunks = (m_pages.getCount() + MERGE_CHUNK - 1) / MERGE_CHUNK;
+	return (int) MIN(m_items.getCount(), chunks);
+}
+
+} // namespace
+
+
 /******************************** NBackupStateLock ******************************/
 
 NBackupStateLock::NBackupStateLock(thread_db* tdbb, MemoryPool& p, BackupManager* bakMan):
@@ -542,32 +788,64 @@ void BackupManager::endBackup(thread_db* tdbb, bool recover)
 		LocalAllocReadGuard localAllocGuard(this);
 
 		NBAK_TRACE(("Merge. Alloc table is actualized."));
+
+		// Allocation table is ordered by the database page number, so the pages
+		// of every chunk are merged (and written into the database) in ascending order
+		Array<ULONG> pages(*tdbb->getDefaultPool());
 		AllocItemTree::Accessor all(alloc_table);
 
 		if (all.getFirst())
 		{
-			int n = 0;
 			do {
-				JRD_reschedule(tdbb);
+				pages.add(all.current().db_page);
+			} while (all.getNext());
+		}
 
-				WIN window2(DB_PAGE_SPACE, all.current().db_page);
-				NBAK_TRACE(("Merge page %d, diff=%d", all.current().db_page, all.current().diff_page));
-				Ods::pag* page = CCH_FETCH(tdbb, &window2, LCK_write, pag_undefined);
-				NBAK_TRACE(("Merge: page %d is fetched", all.current().db_page));
-				if (page->pag_scn != current_scn)
-				{
-					CCH_MARK_SYSTEM(tdbb, &window2);
-					NBAK_TRACE(("Merge: page %d is marked", all.current().db_page));
-				}
-				CCH_RELEASE(tdbb, &window2);
-				NBAK_TRACE(("Merge: page %d is released", all.current().db_page));
+		// Worker attachments can't be created while the database is being recovered
+		// at the first attachment, merge it in the current thread then
 
-				if (++n == 512)
-				{
-					CCH_flush(tdbb, FLUSH_SYSTEM, 0);
-					n = 0;
-				}
-			} while (all.getNext());
+		Attachment* const att = tdbb->getAttachment();
+		int workers = 1;
+		if (!recover && att->att_parallel_workers > 0)
+			workers = att->att_parallel_workers;
+
+		if (pages.hasData())
+		{
+			gds__log("Database: %s\n\tMerge of difference file started, %" ULONGFORMAT
+				" pages, %d worker(s)", database->dbb_filename.c_str(), pages.getCount(), workers);
+		}
+
+		const SINT64 started = fb_utils::query_performance_counter();
+
+		if (workers == 1)
+		{
+			for (ULONG first = 0; first < pages.getCount(); first += MERGE_CHUNK)
+			{
+				mergePages(tdbb, pages.begin() + first,
+					MIN(MERGE_CHUNK, pages.getCount() - first), current_scn);
+			}
+		}
+		else if (pages.hasData())
+		{
+			Coordinator coord(database->dbb_permanent);
+			MergeTask task(tdbb, database->dbb_permanent, pages, workers);
+
+			EngineCheckout cout(tdbb, FB_FUNCTION);
+
+			FbLocalStatus local_status;
+			coord.runSync(&task);
+
+			if (!task.getResult(&local_status))
+				local_status.raise();
+		}
+
+		if (pages.hasData())
+		{
+			const SINT64 elapsed = (fb_utils::query_performance_counter() - started) * 1000 /
+				fb_utils::query_performance_frequency();
+
+			gds__log("Database: %s\n\tMerge of difference file finished in %" SQUADFORMAT " ms",
+				database->dbb_filename.c_str(), elapsed);
 		}
 
 		CCH_flush(tdbb, FLUSH_ALL, 0);
@@ -2735,7 +2735,25 @@ RecordSource* Optimizer::generateRetrieval(StreamType stream,
 			break;
 
 		default:
-			rsb = FB_NEW_POOL(getPool()) MonitoringTableScan(csb, alias, stream, relation);
+			{
+				// Pass the booleans to be applied to the stream (see below),
+				// they may restrict the monitoring data to be collected
+
+				MonitoringFilter::BooleanList booleans;
+
+				for (auto iter = getConjuncts(outerFlag, innerFlag); iter.hasData(); ++iter)
+				{
+					if (!(iter & CONJUNCT_USED) &&
+						!(iter->nodFlags & ExprNode::FLAG_RESIDUAL) &&
+						iter->computable(csb, INVALID_STREAM, false) &&
+						iter->computable(csb, stream, true))
+					{
+						booleans.add(*iter);
+					}
+				}
+
+				rsb = FB_NEW_POOL(getPool()) MonitoringTableScan(csb, alias, stream, relation, booleans);
+			}
 			break;
 		}
 	}
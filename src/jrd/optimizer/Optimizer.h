@@ -623,6 +623,8 @@ protected:
 	bool checkIndexExpression(const index_desc* idx, ValueExprNode* node) const;
 	InversionNode* composeInversion(InversionNode* node1, InversionNode* node2,
 		InversionNode::Type node_type) const;
+	bool estimateSelectivity(const index_desc* idx, unsigned segmentNumber,
+		const IndexScratchSegment& segment, double& selectivity) const;
 	const Firebird::string& getAlias();
 	void getInversionCandidates(InversionCandidateList& inversions,
 		IndexScratchList& indexScratches, unsigned scope) const;
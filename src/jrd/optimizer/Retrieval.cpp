@@ -31,6 +31,7 @@
 #include "../jrd/intl.h"
 #include "../jrd/Collation.h"
 #include "../jrd/ods.h"
+#include "../jrd/Histogram.h"
 #include "../jrd/RecordSourceNodes.h"
 #include "../jrd/recsrc/RecordSource.h"
 #include "../dsql/BoolNodes.h"
@@ -104,6 +105,43 @@ namespace
 		return newValue;
 	}
 
+	bool makeValueKey(thread_db* tdbb, const index_desc* idx,
+					  const ValueExprNode* value, temporary_key& key)
+	{
+		// Only literals are known at this point. The int64 cast injected
+		// by injectCast() is evaluated here to deliver the scale.
+
+		const auto cast = nodeAs<CastNode>(value);
+		const auto literal = nodeAs<LiteralNode>(cast ? cast->source.getObject() : value);
+
+		if (!literal || (cast && cast->castDesc.dsc_dtype != dtype_int64))
+			return false;
+
+		try
+		{
+			SINT64 int64Value;
+			dsc desc = literal->litDesc;
+
+			if (cast)
+			{
+				dsc target = cast->castDesc;
+				target.dsc_address = (UCHAR*) &int64Value;
+				MOV_move(tdbb, &desc, &target);
+				desc = target;
+			}
+
+			BTR_make_value_key(tdbb, &desc, idx, &key);
+		}
+		catch (const Exception&)
+		{
+			// The value is not convertible, let the execution complain
+			fb_utils::init_status(tdbb->tdbb_status_vector);
+			return false;
+		}
+
+		return true;
+	}
+
 } // namespace
 
 
@@ -224,6 +262,82 @@ InversionNode* Retrieval::composeInversion(InversionNode* node1,
 	return FB_NEW_POOL(getPool()) InversionNode(node_type, node1, node2);
 }
 
+bool Retrieval::estimateSelectivity(const index_desc* idx, unsigned segmentNumber,
+									 const IndexScratchSegment& segment, double& selectivity) const
+{
+	// Estimate the selectivity of the matched segment using the key
+	// distribution histogram, if it's gathered for the index
+
+	if (!relation || (idx->idx_flags & idx_condition))
+		return false;
+
+	const auto histogram = MET_lookup_index_histogram(tdbb, relation, idx);
+
+	if (!histogram)
+		return false;
+
+	const double minimum = idx->idx_rpt[segmentNumber].idx_selectivity;
+	temporary_key lower, upper;
+
+	switch (segment.scanType)
+	{
+		case segmentScanEqual:
+		case segmentScanEquivalent:
+		{
+			// Joined values follow the distribution of the index keys,
+			// so the expected fraction of matches is the density.
+			// It's never less than the selectivity and grows with skew.
+
+			SortedStreamList streams;
+			segment.lowerValue->collectStreams(streams);
+
+			double estimation = 0;
+
+			if (streams.hasData())
+				estimation = histogram->getDensity(segmentNumber);
+			else if (!segmentNumber && makeValueKey(tdbb, idx, segment.lowerValue, lower))
+				estimation = histogram->getFrequency(lower.key_data, lower.key_length);
+
+			if (estimation <= minimum)
+				return false;
+
+			selectivity = estimation;
+			return true;
+		}
+
+		case segmentScanBetween:
+		case segmentScanLess:
+		case segmentScanGreater:
+		{
+			// Only the first segment values are known by the histogram
+
+			if (segmentNumber)
+				return false;
+
+			const bool hasLower = (segment.scanType != segmentScanLess);
+			const bool hasUpper = (segment.scanType != segmentScanGreater);
+
+			if ((hasLower && !makeValueKey(tdbb, idx, segment.lowerValue, lower)) ||
+				(hasUpper && !makeValueKey(tdbb, idx, segment.upperValue, upper)))
+			{
+				return false;
+			}
+
+			const double estimation = histogram->getFraction(
+				hasLower ? lower.key_data : nullptr, hasLower ? lower.key_length : 0,
+				hasUpper ? upper.key_data : nullptr, hasUpper ? upper.key_length : 0);
+
+			selectivity = MAX(estimation, minimum);
+			return true;
+		}
+
+		default:
+			break;
+	}
+
+	return false;
+}
+
 const string& Retrieval::getAlias()
 {
 	if (alias.isEmpty())
@@ -879,6 +993,16 @@ void Retrieval::getInversionCandidates(InversionCandidateList& inversions,
 					scratch.upperCount++;
 					scratch.selectivity = idx->idx_rpt[j].idx_selectivity;
 					scratch.nonFullMatchedSegments = idx->idx_count - (j + 1);
+
+					// The average selectivity underestimates the frequent values,
+					// ask the index histogram if it knows better
+					double estimation;
+					if (segment.scanType != segmentScanMissing &&
+						estimateSelectivity(idx, j, segment, estimation))
+					{
+						scratch.selectivity = estimation;
+					}
+
 					// Add matches for this segment to the main matches list
 					matches.join(segment.matches);
 
@@ -916,6 +1040,7 @@ void Retrieval::getInversionCandidates(InversionCandidateList& inversions,
 					// estimate the selectivity
 					double selectivity = scratch.selectivity;
 					double factor = 1;
+					bool range = false;
 
 					switch (segment.scanType)
 					{
@@ -924,18 +1049,21 @@ void Retrieval::getInversionCandidates(InversionCandidateList& inversions,
 							scratch.upperCount++;
 							selectivity = idx->idx_rpt[j].idx_selectivity;
 							factor = REDUCE_SELECTIVITY_FACTOR_BETWEEN;
+							range = true;
 							break;
 
 						case segmentScanLess:
 							scratch.upperCount++;
 							selectivity = idx->idx_rpt[j].idx_selectivity;
 							factor = REDUCE_SELECTIVITY_FACTOR_LESS;
+							range = true;
 							break;
 
 						case segmentScanGreater:
 							scratch.lowerCount++;
 							selectivity = idx->idx_rpt[j].idx_selectivity;
 							factor = REDUCE_SELECTIVITY_FACTOR_GREATER;
+							range = true;
 							break;
 
 						case segmentScanStarting:
@@ -952,13 +1080,22 @@ void Retrieval::getInversionCandidates(InversionCandidateList& inversions,
 							break;
 					}
 
-					// Adjust the compound selectivity using the reduce factor.
-					// It should be better than the previous segment but worse
-					// than a full match.
-					const double diffSelectivity = scratch.selectivity - selectivity;
-					selectivity += (diffSelectivity * factor);
-					fb_assert(selectivity <= scratch.selectivity);
-					scratch.selectivity = selectivity;
+					double estimation;
+					if (range && estimateSelectivity(idx, j, segment, estimation))
+					{
+						// The histogram knows how many keys are within the range
+						scratch.selectivity = MIN(estimation, scratch.selectivity);
+					}
+					else
+					{
+						// Adjust the compound selectivity using the reduce factor.
+						// It should be better than the previous segment but worse
+						// than a full match.
+						const double diffSelectivity = scratch.selectivity - selectivity;
+						selectivity += (diffSelectivity * factor);
+						fb_assert(selectivity <= scratch.selectivity);
+						scratch.selectivity = selectivity;
+					}
 
 					if (segment.scanType != segmentScanNone)
 					{
@@ -34,8 +34,14 @@
 #include "../common/classes/array.h"
 #include "../common/classes/File.h"
 
+namespace Ods {
+	struct pag;
+}
+
 namespace Jrd {
 
+class BufferDesc;
+
 #ifdef UNIX
 
 class jrd_file : public pool_alloc_rpt<SCHAR, type_fil>
@@ -90,6 +96,14 @@ const USHORT FIL_sh_write			= 8;	// file opened in shared write mode
 const USHORT FIL_no_fast_extend		= 16;	// file not supports fast extending
 const USHORT FIL_raw_device			= 32;	// file is raw device
 
+// Page I/O request, used to read or write a number of pages at once
+
+struct PageIoRequest
+{
+	BufferDesc* pio_bdb;		// Buffer descriptor of the page
+	Ods::pag* pio_page;			// Page image to read into / write from
+};
+
 // Physical IO trace events
 
 const SSHORT trace_create	= 1;
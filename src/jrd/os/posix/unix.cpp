@@ -48,6 +48,14 @@
 #ifdef HAVE_LINUX_FALLOC_H
 #include <linux/falloc.h>
 #endif
+#if defined(HAVE_LINUX_IO_URING_H) && defined(HAVE_SYS_SYSCALL_H)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef __NR_io_uring_setup
+#define USE_IO_URING
+#endif
+#endif
 
 #ifdef SUPPORT_RAW_DEVICES
 #include <sys/ioctl.h>
@@ -129,6 +137,7 @@ static void lockDatabaseFile(int& desc, const bool shareMode, const bool tempora
 							 const char* fileName, ISC_STATUS operation);
 static bool unix_error(const TEXT*, const jrd_file*, ISC_STATUS, FbStatusVector* = NULL);
 static bool block_size_error(const jrd_file*, off_t, FbStatusVector* = NULL);
+static bool transfer_pages(thread_db*, jrd_file*, PageIoRequest*, ULONG, const bool, FbStatusVector*);
 #if !(defined HAVE_PREAD && defined HAVE_PWRITE)
 static SLONG pread(int, SCHAR*, SLONG, SLONG);
 static SLONG pwrite(int, SCHAR*, SLONG, SLONG);
@@ -140,6 +149,345 @@ static int  raw_devices_unlink_database (const PathName&);
 static int	openFile(const Firebird::PathName&, const bool, const bool, const bool);
 static void	maybeCloseFile(int&);
 
+#ifdef USE_IO_URING
+namespace
+{
+	// Minimal io_uring wrapper used to queue a number of page transfers at
+	// once. The ring is set up using raw system calls, i.e. without liburing.
+
+	class IoRing
+	{
+	public:
+		static const unsigned RING_ENTRIES = 64;
+
+		struct Transfer
+		{
+			int desc;
+			void* buffer;
+			FB_UINT64 offset;
+			int result;			// bytes transferred or negated errno
+		};
+
+		IoRing()
+			: m_fd(-1), m_error(0), m_broken(false), m_opsMissing(false),
+			  m_sqRing(MAP_FAILED), m_cqRing(MAP_FAILED), m_sqes(MAP_FAILED),
+			  m_sqRingSize(0), m_cqRingSize(0), m_sqesSize(0)
+		{
+			io_uring_params params;
+			memset(&params, 0, sizeof(params));
+
+			m_fd = (int) syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+			if (m_fd < 0)
+			{
+				m_error = errno;
+				return;
+			}
+
+			m_entries = params.sq_entries;
+			m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+			const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP);
+			if (singleMap)
+				m_sqRingSize = m_cqRingSize = MAX(m_sqRingSize, m_cqRingSize);
+
+			m_sqRing = map(m_sqRingSize, IORING_OFF_SQ_RING);
+			m_cqRing = singleMap ? m_sqRing : map(m_cqRingSize, IORING_OFF_CQ_RING);
+			m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+			m_sqes = map(m_sqesSize, IORING_OFF_SQES);
+
+			if (m_sqRing == MAP_FAILED || m_cqRing == MAP_FAILED || m_sqes == MAP_FAILED)
+			{
+				m_error = errno;
+				release();
+				return;
+			}
+
+			UCHAR* const sq = static_cast<UCHAR*>(m_sqRing);
+			m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+			UCHAR* const cq = static_cast<UCHAR*>(m_cqRing);
+			m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+			// Kernels before 5.6 have io_uring but can't read or write
+			// without the vectors, check it once here
+
+			if (!probe())
+			{
+				m_opsMissing = true;
+				release();
+			}
+		}
+
+		~IoRing()
+		{
+			release();
+		}
+
+		bool isValid() const
+		{
+			return m_fd >= 0;
+		}
+
+		// Returns true if io_uring is not available at all (old kernel,
+		// disabled by sysctl or by the seccomp policy of a container)
+		// or if the kernel is too old to support read and write requests
+		bool isUnsupported() const
+		{
+			return m_error == ENOSYS || m_error == EPERM || m_error == EACCES || m_opsMissing;
+		}
+
+		// Ring failed and can't be reused
+		bool isBroken() const
+		{
+			return m_broken;
+		}
+
+		void run(Transfer* transfers, ULONG count, unsigned length, const bool write)
+		{
+			for (ULONG done = 0; done < count; )
+			{
+				const unsigned batch = MIN(count - done, m_entries);
+
+				// We are the only producer, no need to synchronize with ourselves
+
+				unsigned tail = *m_sqTail;
+				for (unsigned i = 0; i < batch; i++, tail++)
+				{
+					const Transfer& transfer = transfers[done + i];
+					const unsigned index = tail & m_sqMask;
+
+					io_uring_sqe* const sqe = static_cast<io_uring_sqe*>(m_sqes) + index;
+					memset(sqe, 0, sizeof(io_uring_sqe));
+					sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+					sqe->fd = transfer.desc;
+					sqe->off = transfer.offset;
+					sqe->addr = (IPTR) transfer.buffer;
+					sqe->len = length;
+					sqe->user_data = done + i;
+
+					m_sqArray[index] = index;
+				}
+
+				__atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+				unsigned submitted = 0, completed = 0;
+				while (completed < batch)
+				{
+					const int rc = (int) syscall(__NR_io_uring_enter, m_fd, batch - submitted, 1,
+						IORING_ENTER_GETEVENTS, NULL, 0);
+
+					if (rc < 0)
+					{
+						const int error = errno;
+
+						if (error != EINTR && error != EAGAIN && error != EBUSY)
+						{
+							// Requests already submitted may still transfer data into
+							// our buffers, wait for them. Requests not submitted remain
+							// in the queue, so the ring is not reused anymore.
+
+							m_broken = true;
+
+							while (completed < submitted)
+							{
+								if (syscall(__NR_io_uring_enter, m_fd, 0, submitted - completed,
+										IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+								{
+									break;
+								}
+
+								completed += reap(transfers);
+							}
+
+							system_call_failed::raise("io_uring_enter", error);
+						}
+					}
+					else
+						submitted += rc;
+
+					completed += reap(transfers);
+				}
+
+				done += batch;
+			}
+		}
+
+	private:
+		unsigned reap(Transfer* transfers)
+		{
+			unsigned head = *m_cqHead;
+			const unsigned cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+			unsigned count = 0;
+
+			for (; head != cqTail; head++, count++)
+			{
+				const io_uring_cqe* const cqe = m_cqes + (head & m_cqMask);
+				transfers[cqe->user_data].result = cqe->res;
+			}
+
+			__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+			return count;
+		}
+
+		bool probe()
+		{
+			const unsigned OPS_COUNT = 256;
+			UCHAR buffer[sizeof(io_uring_probe) + OPS_COUNT * sizeof(io_uring_probe_op)];
+			memset(buffer, 0, sizeof(buffer));
+
+			io_uring_probe* const ops = reinterpret_cast<io_uring_probe*>(buffer);
+
+			if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, ops, OPS_COUNT) < 0)
+				return false;
+
+			const unsigned required[] = {IORING_OP_READ, IORING_OP_WRITE};
+
+			for (const auto op : required)
+			{
+				if (op > ops->last_op || !(ops->ops[op].flags & IO_URING_OP_SUPPORTED))
+					return false;
+			}
+
+			return true;
+		}
+
+		void* map(size_t size, off_t offset)
+		{
+			return mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+		}
+
+		void release()
+		{
+			if (m_sqes != MAP_FAILED)
+				munmap(m_sqes, m_sqesSize);
+			if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+				munmap(m_cqRing, m_cqRingSize);
+			if (m_sqRing != MAP_FAILED)
+				munmap(m_sqRing, m_sqRingSize);
+
+			m_sqes = m_cqRing = m_sqRing = MAP_FAILED;
+
+			if (m_fd >= 0)
+			{
+				close(m_fd);
+				m_fd = -1;
+			}
+		}
+
+		int m_fd;
+		int m_error;
+		bool m_broken;
+		bool m_opsMissing;
+		unsigned m_entries;
+
+		void* m_sqRing;
+		void* m_cqRing;
+		void* m_sqes;
+		size_t m_sqRingSize;
+		size_t m_cqRingSize;
+		size_t m_sqesSize;
+
+		unsigned* m_sqTail;
+		unsigned m_sqMask;
+		unsigned* m_sqArray;
+
+		unsigned* m_cqHead;
+		unsigned* m_cqTail;
+		unsigned m_cqMask;
+		io_uring_cqe* m_cqes;
+	};
+
+	// Idle rings are cached to be reused by the next page transfers
+
+	class IoRingPool
+	{
+		static const FB_SIZE_T MAX_IDLE_RINGS = 16;
+
+	public:
+		explicit IoRingPool(MemoryPool& pool)
+			: m_rings(pool), m_unsupported(false)
+		{}
+
+		~IoRingPool()
+		{
+			while (m_rings.hasData())
+				delete m_rings.pop();
+		}
+
+		IoRing* acquire()
+		{
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				if (m_unsupported)
+					return NULL;
+
+				if (m_rings.hasData())
+					return m_rings.pop();
+			}
+
+			IoRing* const ring = FB_NEW_POOL(*getDefaultMemoryPool()) IoRing;
+			if (ring->isValid())
+				return ring;
+
+			if (ring->isUnsupported())
+			{
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+				m_unsupported = true;
+			}
+
+			delete ring;
+			return NULL;
+		}
+
+		void release(IoRing* ring)
+		{
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				if (!ring->isBroken() && m_rings.getCount() < MAX_IDLE_RINGS)
+				{
+					m_rings.push(ring);
+					return;
+				}
+			}
+
+			delete ring;
+		}
+
+	private:
+		Mutex m_mutex;
+		HalfStaticArray<IoRing*, MAX_IDLE_RINGS> m_rings;
+		bool m_unsupported;
+	};
+
+	GlobalPtr<IoRingPool> ioRings;
+
+	class IoRingHolder
+	{
+	public:
+		IoRingHolder()
+			: ring(ioRings->acquire())
+		{}
+
+		~IoRingHolder()
+		{
+			if (ring)
+				ioRings->release(ring);
+		}
+
+		IoRing* const ring;
+	};
+} // namespace
+#endif // USE_IO_URING
+
+
 int PIO_add_file(thread_db* tdbb, jrd_file* main_file, const PathName& file_name, SLONG start)
 {
 /**************************************
@@ -831,6 +1179,44 @@ bool PIO_write(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+bool PIO_read_pages(thread_db* tdbb, jrd_file* file, PageIoRequest* requests, ULONG count,
+	FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ r e a d _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read a number of data pages, queueing them all
+ *	at once if the OS allows that.
+ *
+ **************************************/
+
+	return transfer_pages(tdbb, file, requests, count, false, status_vector);
+}
+
+
+bool PIO_write_pages(thread_db* tdbb, jrd_file* file, PageIoRequest* requests, ULONG count,
+	FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ w r i t e _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Write a number of data pages, queueing them all
+ *	at once if the OS allows that.
+ *
+ **************************************/
+
+	return transfer_pages(tdbb, file, requests, count, true, status_vector);
+}
+
+
 static jrd_file* seek_file(jrd_file* file, BufferDesc* bdb, FB_UINT64* offset,
 	FbStatusVector* status_vector)
 {
@@ -1013,6 +1399,90 @@ static void lockDatabaseFile(int& desc, const bool share, const bool temporary,
 }
 
 
+static bool transfer_pages(thread_db* tdbb, jrd_file* file, PageIoRequest* requests, ULONG count,
+	const bool write, FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	t r a n s f e r _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read or write a set of pages. With io_uring all the requests are
+ *	queued at once, so the device sees them concurrently. Pages which
+ *	were not transferred completely (short I/O, errors, requests rejected
+ *	by the kernel) are retried using the synchronous calls,
+ *	they also take care of the error reporting.
+ *
+ **************************************/
+
+#ifdef USE_IO_URING
+	if (count > 1)
+	{
+		IoRingHolder holder;
+
+		if (holder.ring)
+		{
+			const unsigned size = tdbb->getDatabase()->dbb_page_size;
+
+			HalfStaticArray<IoRing::Transfer, IoRing::RING_ENTRIES> transfers;
+			IoRing::Transfer* const transfer = transfers.getBuffer(count);
+
+			for (ULONG i = 0; i < count; i++)
+			{
+				jrd_file* const pageFile = seek_file(file, requests[i].pio_bdb,
+					&transfer[i].offset, status_vector);
+
+				if (!pageFile)
+					return false;
+
+				transfer[i].desc = pageFile->fil_desc;
+				transfer[i].buffer = requests[i].pio_page;
+				transfer[i].result = -1;
+			}
+
+			{	// scope
+				EngineCheckout cout(tdbb, FB_FUNCTION, EngineCheckout::UNNECESSARY);
+				holder.ring->run(transfer, count, size, write);
+			}
+
+			for (ULONG i = 0; i < count; i++)
+			{
+				if (transfer[i].result == (int) size)
+					continue;
+
+				BufferDesc* const bdb = requests[i].pio_bdb;
+				Ods::pag* const page = requests[i].pio_page;
+
+				if (!(write ? PIO_write(tdbb, file, bdb, page, status_vector) :
+							  PIO_read(tdbb, file, bdb, page, status_vector)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+#endif
+
+	for (ULONG i = 0; i < count; i++)
+	{
+		BufferDesc* const bdb = requests[i].pio_bdb;
+		Ods::pag* const page = requests[i].pio_page;
+
+		if (!(write ? PIO_write(tdbb, file, bdb, page, status_vector) :
+					  PIO_read(tdbb, file, bdb, page, status_vector)))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 static bool unix_error(const TEXT* string,
 					   const jrd_file* file, ISC_STATUS operation,
 					   FbStatusVector* status_vector)
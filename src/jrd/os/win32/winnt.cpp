@@ -602,6 +602,29 @@ bool PIO_read(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+bool PIO_read_pages(thread_db* tdbb, jrd_file* file, PageIoRequest* requests, ULONG count,
+	FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ r e a d _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Read a number of data pages.
+ *
+ **************************************/
+	for (ULONG i = 0; i < count; i++)
+	{
+		if (!PIO_read(tdbb, file, requests[i].pio_bdb, requests[i].pio_page, status_vector))
+			return false;
+	}
+
+	return true;
+}
+
+
 #ifdef SUPERSERVER_V2
 bool PIO_read_ahead(thread_db*	tdbb,
 				   SLONG	start_page,
@@ -780,6 +803,29 @@ bool PIO_write(thread_db* tdbb, jrd_file* file, BufferDesc* bdb, Ods::pag* page,
 }
 
 
+bool PIO_write_pages(thread_db* tdbb, jrd_file* file, PageIoRequest* requests, ULONG count,
+	FbStatusVector* status_vector)
+{
+/**************************************
+ *
+ *	P I O _ w r i t e _ p a g e s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Write a number of data pages.
+ *
+ **************************************/
+	for (ULONG i = 0; i < count; i++)
+	{
+		if (!PIO_write(tdbb, file, requests[i].pio_bdb, requests[i].pio_page, status_vector))
+			return false;
+	}
+
+	return true;
+}
+
+
 ULONG PIO_get_number_of_pages(const jrd_file* file, const USHORT pagesize)
 {
 /**************************************
@@ -327,6 +327,60 @@ const PageNumber HEADER_PAGE_NUMBER(DB_PAGE_SPACE, HEADER_PAGE);
 
 typedef Firebird::Stack<PageNumber> PageStack;
 
+// Sequential read-ahead state of a chain of pages being scanned, i.e. data
+// pages of a relation or pages of a blob. Pages are read ahead in batches,
+// the read-ahead distance grows while the pages are missing in the cache
+// and shrinks when they are found there.
+
+class ReadAhead
+{
+public:
+	static const ULONG MIN_PAGES = 4;
+	static const ULONG MAX_PAGES = 64;
+
+	ReadAhead()
+		: m_last(MAX_ULONG), m_issued(0), m_pages(MIN_PAGES)
+	{}
+
+	// Given the sequence number of the page being fetched, return the range
+	// [from, to) of page sequences to be read ahead, if it's time to do it
+	bool check(ULONG sequence, ULONG& from, ULONG& to)
+	{
+		const bool sequential = (m_last != MAX_ULONG && sequence > m_last &&
+			sequence - m_last <= m_pages);
+		m_last = sequence;
+
+		if (!sequential)
+		{
+			m_issued = sequence;
+			return false;
+		}
+
+		if (m_issued > sequence + m_pages / 2)
+			return false;
+
+		from = MAX(m_issued, sequence) + 1;
+		to = sequence + 1 + m_pages;
+		return true;
+	}
+
+	// Remember the last page sequence read ahead and adjust the distance
+	void done(ULONG last, ULONG requested, ULONG read)
+	{
+		m_issued = last;
+
+		if (requested && read == requested)
+			m_pages = MIN(m_pages * 2, MAX_PAGES);
+		else if (read * 2 < requested)
+			m_pages = MAX(m_pages / 2, MIN_PAGES);
+	}
+
+private:
+	ULONG m_last;		// sequence of the last fetched page
+	ULONG m_issued;		// sequence of the last page read ahead
+	ULONG m_pages;		// read-ahead distance
+};
+
 } //namespace Jrd
 
 #endif // JRD_PAG_H
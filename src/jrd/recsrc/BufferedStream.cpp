@@ -160,8 +160,6 @@ bool BufferedStream::internalGetRecord(thread_db* tdbb) const
 	if (!(impure->irsb_flags & irsb_open))
 		return false;
 
-	dsc from, to;
-
 	Record* const buffer_record = impure->irsb_buffer->getTempRecord();
 
 	if (impure->irsb_flags & irsb_mustread)
@@ -175,133 +173,151 @@ bool BufferedStream::internalGetRecord(thread_db* tdbb) const
 			return false;
 		}
 
-		buffer_record->nullify();
+		packRecord(tdbb, buffer_record);
 
-		// Assign the fields to the record to be stored
-		for (FB_SIZE_T i = 0; i < m_map.getCount(); i++)
-		{
-			const FieldMap& map = m_map[i];
-
-			record_param* const rpb = &request->req_rpb[map.map_stream];
-			Record* const record = rpb->rpb_record;
+		// Put the record into the buffer
+		impure->irsb_buffer->store(buffer_record);
+	}
+	else
+	{
+		// Read the record from the buffer
+		if (!impure->irsb_buffer->fetch(impure->irsb_position, buffer_record))
+			return false;
 
-			if (map.map_type == FieldMap::REGULAR_FIELD)
-			{
-				if (!EVL_field(rpb->rpb_relation, record, map.map_id, &from))
-					continue;
-			}
+		unpackRecord(tdbb, buffer_record);
+	}
 
-			buffer_record->clearNull(i);
+	impure->irsb_position++;
+	return true;
+}
 
-			if (!EVL_field(rpb->rpb_relation, buffer_record, (USHORT) i, &to))
-				fb_assert(false);
+void BufferedStream::packRecord(thread_db* tdbb, Record* buffer_record) const
+{
+	Request* const request = tdbb->getRequest();
 
-			switch (map.map_type)
-			{
-			case FieldMap::REGULAR_FIELD:
-				MOV_move(tdbb, &from, &to);
-				break;
+	dsc from, to;
 
-			case FieldMap::TRANSACTION_ID:
-				*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_transaction_nr;
-				break;
+	buffer_record->nullify();
 
-			case FieldMap::DBKEY_NUMBER:
-				*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_number.getValue();
-				break;
+	// Assign the fields to the record to be stored
+	for (FB_SIZE_T i = 0; i < m_map.getCount(); i++)
+	{
+		const FieldMap& map = m_map[i];
 
-			case FieldMap::DBKEY_VALID:
-				*to.dsc_address = (UCHAR) rpb->rpb_number.isValid();
-				break;
+		record_param* const rpb = &request->req_rpb[map.map_stream];
+		Record* const record = rpb->rpb_record;
 
-			default:
-				fb_assert(false);
-			}
+		if (map.map_type == FieldMap::REGULAR_FIELD)
+		{
+			if (!EVL_field(rpb->rpb_relation, record, map.map_id, &from))
+				continue;
 		}
 
-		// Put the record into the buffer
-		impure->irsb_buffer->store(buffer_record);
-	}
-	else
-	{
-		// Read the record from the buffer
-		if (!impure->irsb_buffer->fetch(impure->irsb_position, buffer_record))
-			return false;
+		buffer_record->clearNull(i);
 
-		StreamType stream = INVALID_STREAM;
+		if (!EVL_field(rpb->rpb_relation, buffer_record, (USHORT) i, &to))
+			fb_assert(false);
 
-		// Assign fields back to their original streams
-		for (FB_SIZE_T i = 0; i < m_map.getCount(); i++)
+		switch (map.map_type)
 		{
-			const FieldMap& map = m_map[i];
+		case FieldMap::REGULAR_FIELD:
+			MOV_move(tdbb, &from, &to);
+			break;
 
-			record_param* const rpb = &request->req_rpb[map.map_stream];
-			jrd_rel* const relation = rpb->rpb_relation;
+		case FieldMap::TRANSACTION_ID:
+			*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_transaction_nr;
+			break;
 
-			rpb->rpb_runtime_flags &= ~RPB_CLEAR_FLAGS;
+		case FieldMap::DBKEY_NUMBER:
+			*reinterpret_cast<SINT64*>(to.dsc_address) = rpb->rpb_number.getValue();
+			break;
 
-			if (relation &&
-				!relation->rel_file &&
-				!relation->rel_view_rse &&
-				!relation->isVirtual())
-			{
-				rpb->rpb_runtime_flags |= RPB_refetch;
-			}
+		case FieldMap::DBKEY_VALID:
+			*to.dsc_address = (UCHAR) rpb->rpb_number.isValid();
+			break;
 
-			if (map.map_stream != stream)
-			{
-				stream = map.map_stream;
+		default:
+			fb_assert(false);
+		}
+	}
+}
 
-				// See SortedStream::mapData() for explanations why we need
-				// to upgrade the record format
+void BufferedStream::unpackRecord(thread_db* tdbb, Record* buffer_record) const
+{
+	Request* const request = tdbb->getRequest();
 
-				if (relation && !rpb->rpb_number.isValid())
-					VIO_record(tdbb, rpb, MET_current(tdbb, relation), tdbb->getDefaultPool());
-			}
+	dsc from, to;
 
-			const bool isNull = !EVL_field(relation, buffer_record, (USHORT) i, &from);
+	StreamType stream = INVALID_STREAM;
 
-			if (map.map_type == FieldMap::REGULAR_FIELD)
-			{
-				Record* const record = rpb->rpb_record;
-				record->reset();
-
-				if (isNull)
-					record->setNull(map.map_id);
-				else
-				{
-					EVL_field(relation, record, map.map_id, &to);
-					MOV_move(tdbb, &from, &to);
-					record->clearNull(map.map_id);
-				}
+	// Assign fields back to their original streams
+	for (FB_SIZE_T i = 0; i < m_map.getCount(); i++)
+	{
+		const FieldMap& map = m_map[i];
 
-				continue;
-			}
+		record_param* const rpb = &request->req_rpb[map.map_stream];
+		jrd_rel* const relation = rpb->rpb_relation;
 
-			fb_assert(!isNull);
+		rpb->rpb_runtime_flags &= ~RPB_CLEAR_FLAGS;
 
-			switch (map.map_type)
-			{
-			case FieldMap::TRANSACTION_ID:
-				rpb->rpb_transaction_nr = *reinterpret_cast<SINT64*>(from.dsc_address);
-				break;
+		if (relation &&
+			!relation->rel_file &&
+			!relation->rel_view_rse &&
+			!relation->isVirtual())
+		{
+			rpb->rpb_runtime_flags |= RPB_refetch;
+		}
+
+		if (map.map_stream != stream)
+		{
+			stream = map.map_stream;
 
-			case FieldMap::DBKEY_NUMBER:
-				rpb->rpb_number.setValue(*reinterpret_cast<SINT64*>(from.dsc_address));
-				break;
+			// See SortedStream::mapData() for explanations why we need
+			// to upgrade the record format
 
-			case FieldMap::DBKEY_VALID:
-				rpb->rpb_number.setValid(*from.dsc_address != 0);
-				break;
+			if (relation && !rpb->rpb_number.isValid())
+				VIO_record(tdbb, rpb, MET_current(tdbb, relation), tdbb->getDefaultPool());
+		}
+
+		const bool isNull = !EVL_field(relation, buffer_record, (USHORT) i, &from);
+
+		if (map.map_type == FieldMap::REGULAR_FIELD)
+		{
+			Record* const record = rpb->rpb_record;
+			record->reset();
 
-			default:
-				fb_assert(false);
+			if (isNull)
+				record->setNull(map.map_id);
+			else
+			{
+				EVL_field(relation, record, map.map_id, &to);
+				MOV_move(tdbb, &from, &to);
+				record->clearNull(map.map_id);
 			}
+
+			continue;
 		}
-	}
 
-	impure->irsb_position++;
-	return true;
+		fb_assert(!isNull);
+
+		switch (map.map_type)
+		{
+		case FieldMap::TRANSACTION_ID:
+			rpb->rpb_transaction_nr = *reinterpret_cast<SINT64*>(from.dsc_address);
+			break;
+
+		case FieldMap::DBKEY_NUMBER:
+			rpb->rpb_number.setValue(*reinterpret_cast<SINT64*>(from.dsc_address));
+			break;
+
+		case FieldMap::DBKEY_VALID:
+			rpb->rpb_number.setValid(*from.dsc_address != 0);
+			break;
+
+		default:
+			fb_assert(false);
+		}
+	}
 }
 
 bool BufferedStream::refetchRecord(thread_db* tdbb) const
@@ -62,6 +62,9 @@ void FullTableScan::internalOpen(thread_db* tdbb) const
 	record_param* const rpb = &request->req_rpb[m_stream];
 	rpb->getWindow(tdbb).win_flags = 0;
 
+	BufferControl* const bcb = dbb->dbb_bcb;
+	ULONG dataPages = 0;
+
 	// Unless this is the only attachment, limit the cache flushing
 	// effect of large sequential scans on the page working sets of
 	// other attachments
@@ -77,15 +80,29 @@ void FullTableScan::internalOpen(thread_db* tdbb) const
 		// because the cumulative effect of scanning all relations
 		// is equal to that of a single large relation.
 
-		BufferControl* const bcb = dbb->dbb_bcb;
+		if (!attachment->isGbak())
+			dataPages = DPM_data_pages(tdbb, m_relation);
 
-		if (attachment->isGbak() || DPM_data_pages(tdbb, m_relation) > bcb->bcb_count)
+		if (attachment->isGbak() || dataPages > bcb->bcb_count)
 		{
 			rpb->getWindow(tdbb).win_flags = WIN_large_scan;
 			rpb->rpb_org_scans = m_relation->rel_scan_count++;
 		}
 	}
 
+	// With scan resistant (2Q) page cache, pages read by a backup or by a scan
+	// of relation not fitting into the probation part of the cache are not
+	// allowed to displace the working set of the main LRU que
+
+	if (attachment && (bcb->bcb_flags & BCB_scan_resistant))
+	{
+		if (!attachment->isGbak() && !dataPages)
+			dataPages = DPM_data_pages(tdbb, m_relation);
+
+		if (attachment->isGbak() || dataPages > bcb->bcb_count / 4)
+			rpb->getWindow(tdbb).win_flags |= WIN_low_priority;
+	}
+
 	rpb->rpb_number.setValue(BOF_NUMBER);
 
 	if (m_dbkeyRanges.hasData())
@@ -23,6 +23,7 @@
 #include "firebird.h"
 #include "../common/classes/Aligner.h"
 #include "../common/classes/Hash.h"
+#include "../common/Task.h"
 #include "../jrd/jrd.h"
 #include "../jrd/req.h"
 #include "../jrd/intl.h"
@@ -31,6 +32,8 @@
 #include "../jrd/mov_proto.h"
 #include "../jrd/intl_proto.h"
 #include "../jrd/optimizer/Optimizer.h"
+#include "../jrd/Record.h"
+#include "../jrd/TempSpace.h"
 
 #include "RecordSource.h"
 
@@ -41,182 +44,516 @@ using namespace Jrd;
 // Data access: hash join
 // ----------------------
 
-// NS: FIXME - Why use static hash table here??? Hash table shall support dynamic resizing
-static const ULONG HASH_SIZE = 1009;
-static const ULONG BUCKET_PREALLOCATE_SIZE = 32;	// 256 bytes per slot
+// The hash table is organized as an array of bucket heads plus an array of
+// chain links (one per buffered record, indexed by the record position),
+// both allocated contiguously per stream. The links are collected while
+// the stream is being buffered and the buckets are built afterwards, when
+// the actual number of records is known. So the table is always sized to keep
+// the average chain length (and the probe cost) constant. For large streams,
+// buckets are built by multiple threads (up to the attachment's parallel
+// workers) in two phases. First, every worker scatters its own range of
+// records by the bucket class (bucket number modulo number of workers).
+// Then every worker links the records of its own class of buckets. So every
+// record is touched by a single worker in each phase.
+
+static const ULONG MIN_HASH_SIZE = 1024;				// 4KB of bucket heads
+static const ULONG MAX_HASH_SIZE = 1U << 28;			// keep both arrays addressable
+static const ULONG MAX_PREALLOCATE_SIZE = 1024 * 1024;	// don't trust large estimates blindly
+static const ULONG MIN_PARALLEL_BUILD_SIZE = 256 * 1024;	// records per worker thread
+
+// If the inner streams are not expected to fit the temporary space cache,
+// the join is performed in the partitioned (hybrid) mode. Both the inner and
+// the leading streams are split by the key hash into partitions stored inside
+// the temporary space. The first partition is joined on the fly while reading
+// the leading stream, the other ones are joined one by one afterwards, so that
+// only a single partition worth of hash table is kept in memory.
+
+static const ULONG MAX_HASH_PARTITIONS = 64;
+static const ULONG HASH_READ_BATCH = 1024;
+
+const char* const SCRATCH = "fb_hash_";
+
+static inline ULONG scrambleHash(ULONG hash)
+{
+	// Scramble the hash value before using its bits for the bucket or partition
+	// number, as the internal hash function does not guarantee their even distribution
+
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+
+	return hash;
+}
 
 unsigned HashJoin::maxCapacity()
 {
-	// Binary search across 1000 collisions is computationally similar to
-	// linear search across 10 collisions. We use this number as a rough
-	// estimation of whether the lookup performance is likely to be acceptable.
-	return HASH_SIZE * 1000;
+	// The table is sized dynamically, so the only limit is the maximum
+	// number of chain links (i.e. buffered records) we are able to address.
+	return MAX_HASH_SIZE;
 }
 
 
 class HashJoin::HashTable : public PermanentStorage
 {
-	class CollisionList
-	{
-		static const FB_SIZE_T INVALID_ITERATOR = FB_SIZE_T(~0);
+	static const ULONG END_OF_CHAIN = MAX_ULONG;
 
+	class CollisionChain
+	{
 		struct Entry
 		{
-			Entry()
-				: hash(0), position(0)
-			{}
-
-			Entry(ULONG h, ULONG pos)
-				: hash(h), position(pos)
-			{}
-
-			static const ULONG generate(const Entry& item)
-			{
-				return item.hash;
-			}
-
 			ULONG hash;
-			ULONG position;
+			ULONG next;
 		};
 
 	public:
-		CollisionList(MemoryPool& pool)
-			: m_collisions(pool, BUCKET_PREALLOCATE_SIZE),
-			  m_iterator(INVALID_ITERATOR)
+		CollisionChain(MemoryPool& pool)
+			: m_buckets(pool), m_entries(pool),
+			  m_mask(0), m_iterator(END_OF_CHAIN)
+		{}
+
+		void init(double cardinality)
 		{
-			m_collisions.setSortMode(FB_ARRAY_SORT_MANUAL);
+			const ULONG preallocate = (cardinality < MAX_PREALLOCATE_SIZE) ?
+				(ULONG) cardinality : MAX_PREALLOCATE_SIZE;
+
+			m_entries.clear();
+			m_entries.ensureCapacity(MAX(preallocate, MIN_HASH_SIZE), false);
 		}
 
-		void sort()
+		void add(ULONG hash, ULONG position)
 		{
-			m_collisions.sort();
+			fb_assert(position == m_entries.getCount());
+
+			Entry entry;
+			entry.hash = hash;
+			entry.next = END_OF_CHAIN;
+			m_entries.add(entry);
 		}
 
-		void add(ULONG hash, ULONG position)
+		ULONG getCount() const
+		{
+			return m_entries.getCount();
+		}
+
+		ULONG prepare()
+		{
+			const ULONG count = m_entries.getCount();
+
+			ULONG hashSize = MIN_HASH_SIZE;
+
+			while (hashSize < count && hashSize < MAX_HASH_SIZE)
+				hashSize <<= 1;
+
+			m_buckets.shrink(0);
+			m_buckets.resize(hashSize, END_OF_CHAIN);
+			m_mask = hashSize - 1;
+
+			return hashSize;
+		}
+
+		void link()
+		{
+			const ULONG count = m_entries.getCount();
+
+			for (ULONG position = 0; position < count; position++)
+				link(position);
+		}
+
+		void scatter(ULONG firstPosition, ULONG lastPosition, ObjectsArray<Array<ULONG> >& lists,
+			FB_SIZE_T firstList, ULONG classes)
+		{
+			// Distribute the given range of records between the bucket classes
+
+			for (ULONG position = firstPosition; position < lastPosition; position++)
+				lists[firstList + getSlot(m_entries[position].hash) % classes].add(position);
+		}
+
+		void link(const Array<ULONG>& positions)
 		{
-			m_collisions.add(Entry(hash, position));
+			// Positions are scattered in their natural order, so the resulting
+			// chains don't depend on how the records are split between workers
+
+			for (const auto position : positions)
+				link(position);
 		}
 
 		bool locate(ULONG hash)
 		{
-			if (m_collisions.find(hash, m_iterator))
-				return true;
+			m_iterator = m_buckets[getSlot(hash)];
+			skipCollisions(hash);
 
-			m_iterator = INVALID_ITERATOR;
-			return false;
+			return (m_iterator != END_OF_CHAIN);
 		}
 
 		bool iterate(ULONG hash, ULONG& position)
 		{
-			if (m_iterator >= m_collisions.getCount())
+			if (m_iterator == END_OF_CHAIN)
 				return false;
 
-			const Entry& collision = m_collisions[m_iterator++];
+			fb_assert(m_entries[m_iterator].hash == hash);
+
+			position = m_iterator;
+			m_iterator = m_entries[m_iterator].next;
+			skipCollisions(hash);
 
-			if (hash != collision.hash)
+			return true;
+		}
+
+	private:
+		ULONG getSlot(ULONG hash) const
+		{
+			return scrambleHash(hash) & m_mask;
+		}
+
+		void link(ULONG position)
+		{
+			Entry& entry = m_entries[position];
+			const ULONG slot = getSlot(entry.hash);
+
+			entry.next = m_buckets[slot];
+			m_buckets[slot] = position;
+		}
+
+		void skipCollisions(ULONG hash)
+		{
+			while (m_iterator != END_OF_CHAIN && m_entries[m_iterator].hash != hash)
+				m_iterator = m_entries[m_iterator].next;
+		}
+
+		Array<ULONG> m_buckets;
+		Array<Entry> m_entries;
+		ULONG m_mask;
+		ULONG m_iterator;
+	};
+
+	// Builds the buckets of a single stream using multiple workers
+
+	class BuildTask : public Task
+	{
+		class Item : public Task::WorkItem
+		{
+		public:
+			Item(BuildTask* task, ULONG worker)
+				: Task::WorkItem(task),
+				  m_worker(worker), m_inuse(false)
+			{}
+
+			const ULONG m_worker;
+			bool m_inuse;
+		};
+
+	public:
+		BuildTask(MemoryPool& pool, CollisionChain* collisions, ULONG workers)
+			: m_collisions(collisions), m_items(pool), m_lists(pool),
+			  m_workers(workers), m_scatter(true)
+		{
+			for (ULONG i = 0; i < workers; i++)
+				m_items.add(FB_NEW_POOL(pool) Item(this, i));
+
+			// List of positions per every pair of the scattering worker
+			// and the bucket class
+
+			for (ULONG i = 0; i < workers * workers; i++)
+				m_lists.add();
+		}
+
+		~BuildTask()
+		{
+			for (Item** p = m_items.begin(); p < m_items.end(); p++)
+				delete *p;
+		}
+
+		void linkPhase()
+		{
+			m_scatter = false;
+
+			for (Item** p = m_items.begin(); p < m_items.end(); p++)
+				(*p)->m_inuse = false;
+		}
+
+		bool handler(WorkItem& _item)
+		{
+			Item* const item = reinterpret_cast<Item*>(&_item);
+			const ULONG worker = item->m_worker;
+
+			if (m_scatter)
 			{
-				m_iterator = INVALID_ITERATOR;
-				return false;
+				const ULONG count = m_collisions->getCount();
+				const ULONG step = count / m_workers;
+				const ULONG lastPosition = (worker == m_workers - 1) ? count : step * (worker + 1);
+
+				m_collisions->scatter(step * worker, lastPosition, m_lists, worker * m_workers, m_workers);
+			}
+			else
+			{
+				for (ULONG i = 0; i < m_workers; i++)
+					m_collisions->link(m_lists[i * m_workers + worker]);
+			}
+
+			return true;
+		}
+
+		bool getWorkItem(WorkItem** pItem)
+		{
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+			// Every item is handled exactly once
+
+			for (Item** p = m_items.begin(); p < m_items.end(); p++)
+			{
+				if (!(*p)->m_inuse)
+				{
+					(*p)->m_inuse = true;
+					*pItem = *p;
+					return true;
+				}
 			}
 
-			position = collision.position;
+			return false;
+		}
+
+		bool getResult(IStatus* /*status*/)
+		{
 			return true;
 		}
 
+		int getMaxWorkers()
+		{
+			return (int) m_items.getCount();
+		}
+
 	private:
-		SortedArray<Entry, EmptyStorage<Entry>, ULONG, Entry> m_collisions;
-		FB_SIZE_T m_iterator;
+		CollisionChain* const m_collisions;
+		Mutex m_mutex;
+		HalfStaticArray<Item*, 8> m_items;
+		ObjectsArray<Array<ULONG> > m_lists;
+		const ULONG m_workers;
+		bool m_scatter;
 	};
 
 public:
-	HashTable(MemoryPool& pool, ULONG streamCount, ULONG tableSize = HASH_SIZE)
-		: PermanentStorage(pool), m_streamCount(streamCount),
-		  m_tableSize(tableSize), m_slot(0)
+	HashTable(MemoryPool& pool, ULONG streamCount)
+		: PermanentStorage(pool), m_streamCount(streamCount)
 	{
-		m_collisions = FB_NEW_POOL(pool) CollisionList*[streamCount * tableSize];
-		memset(m_collisions, 0, streamCount * tableSize * sizeof(CollisionList*));
+		m_collisions = FB_NEW_POOL(pool) CollisionChain*[streamCount];
+
+		for (ULONG i = 0; i < m_streamCount; i++)
+			m_collisions[i] = FB_NEW_POOL(pool) CollisionChain(pool);
 	}
 
 	~HashTable()
 	{
-		for (ULONG i = 0; i < m_streamCount * m_tableSize; i++)
+		for (ULONG i = 0; i < m_streamCount; i++)
 			delete m_collisions[i];
 
 		delete[] m_collisions;
 	}
 
-	void put(ULONG stream, ULONG hash, ULONG position)
+	void init(ULONG stream, double cardinality)
 	{
-		const ULONG slot = hash % m_tableSize;
+		fb_assert(stream < m_streamCount);
+		m_collisions[stream]->init(cardinality);
+	}
 
+	void put(ULONG stream, ULONG hash, ULONG position)
+	{
 		fb_assert(stream < m_streamCount);
-		fb_assert(slot < m_tableSize);
+		m_collisions[stream]->add(hash, position);
+	}
 
-		CollisionList* collisions = m_collisions[stream * m_tableSize + slot];
+	void build(thread_db* tdbb)
+	{
+		const Attachment* const attachment = tdbb->getAttachment();
+		const ULONG maxWorkers = (attachment->att_parallel_workers > 1) ?
+			(ULONG) attachment->att_parallel_workers : 1;
 
-		if (!collisions)
+		for (ULONG i = 0; i < m_streamCount; i++)
 		{
-			collisions = FB_NEW_POOL(getPool()) CollisionList(getPool());
-			m_collisions[stream * m_tableSize + slot] = collisions;
-		}
+			CollisionChain* const collisions = m_collisions[i];
+			collisions->prepare();
+
+			const ULONG workers = MIN(maxWorkers, collisions->getCount() / MIN_PARALLEL_BUILD_SIZE);
+
+			if (workers <= 1)
+			{
+				collisions->link();
+				continue;
+			}
 
-		collisions->add(hash, position);
+			Coordinator coord(&getPool());
+			BuildTask task(getPool(), collisions, workers);
+
+			EngineCheckout cout(tdbb, FB_FUNCTION);
+			coord.runSync(&task);
+
+			task.linkPhase();
+			coord.runSync(&task);
+		}
 	}
 
 	bool setup(ULONG hash)
 	{
-		const ULONG slot = hash % m_tableSize;
-
 		for (ULONG i = 0; i < m_streamCount; i++)
 		{
-			CollisionList* const collisions = m_collisions[i * m_tableSize + slot];
-
-			if (!collisions)
-				return false;
-
-			if (!collisions->locate(hash))
+			if (!m_collisions[i]->locate(hash))
 				return false;
 		}
 
-		m_slot = slot;
 		return true;
 	}
 
 	void reset(ULONG stream, ULONG hash)
 	{
 		fb_assert(stream < m_streamCount);
-
-		CollisionList* const collisions = m_collisions[stream * m_tableSize + m_slot];
-		collisions->locate(hash);
+		m_collisions[stream]->locate(hash);
 	}
 
 	bool iterate(ULONG stream, ULONG hash, ULONG& position)
 	{
 		fb_assert(stream < m_streamCount);
-
-		CollisionList* const collisions = m_collisions[stream * m_tableSize + m_slot];
-		return collisions->iterate(hash, position);
+		return m_collisions[stream]->iterate(hash, position);
 	}
 
-	void sort()
+private:
+	const ULONG m_streamCount;
+	CollisionChain** m_collisions;
+};
+
+
+class HashJoin::HashPartitions : public PermanentStorage
+{
+	// Records of a single stream that belong to a single partition.
+	// Hash values are stored separately to be read quickly in batches.
+
+	class Partition
+	{
+	public:
+		Partition(MemoryPool& pool, const Format* format)
+			: m_pool(pool), m_length(format->fmt_length), m_count(0)
+		{}
+
+		FB_UINT64 getCount() const
+		{
+			return m_count;
+		}
+
+		void store(ULONG hash, const Record* record)
+		{
+			fb_assert(record->getLength() == m_length);
+
+			if (!m_records)
+			{
+				m_records = FB_NEW_POOL(m_pool) TempSpace(m_pool, SCRATCH);
+				m_hashes = FB_NEW_POOL(m_pool) TempSpace(m_pool, SCRATCH);
+			}
+
+			m_hashes->write(m_count * sizeof(ULONG), &hash, sizeof(ULONG));
+			m_records->write(m_count * m_length, record->getData(), m_length);
+			m_count++;
+		}
+
+		bool fetch(FB_UINT64 position, Record* record)
+		{
+			fb_assert(record->getLength() == m_length);
+
+			if (position >= m_count)
+				return false;
+
+			m_records->read(position * m_length, record->getData(), m_length);
+			return true;
+		}
+
+		ULONG fetchHashes(FB_UINT64 position, ULONG* hashes, ULONG count)
+		{
+			if (position >= m_count)
+				return 0;
+
+			count = (ULONG) MIN(count, m_count - position);
+			m_hashes->read(position * sizeof(ULONG), hashes, count * sizeof(ULONG));
+			return count;
+		}
+
+	private:
+		MemoryPool& m_pool;
+		const ULONG m_length;
+		FB_UINT64 m_count;
+		AutoPtr<TempSpace> m_records;
+		AutoPtr<TempSpace> m_hashes;
+	};
+
+public:
+	HashPartitions(MemoryPool& pool, ULONG partitionCount, ULONG streamCount,
+				   const Format* const* formats)
+		: PermanentStorage(pool), m_partitionCount(partitionCount),
+		  m_streamCount(streamCount), m_shift(0)
 	{
-		for (ULONG i = 0; i < m_streamCount * m_tableSize; i++)
+		fb_assert(partitionCount > 1 && !(partitionCount & (partitionCount - 1)));
+
+		ULONG bits = 0;
+		while ((1U << bits) < partitionCount)
+			bits++;
+
+		m_shift = 32 - bits;
+
+		m_records = FB_NEW_POOL(pool) Record*[streamCount];
+		m_partitions = FB_NEW_POOL(pool) Partition*[partitionCount * streamCount];
+
+		for (ULONG i = 0; i < streamCount; i++)
 		{
-			CollisionList* const collisions = m_collisions[i];
+			m_records[i] = FB_NEW_POOL(pool) Record(pool, formats[i]);
 
-			if (collisions)
-				collisions->sort();
+			for (ULONG j = 0; j < partitionCount; j++)
+				m_partitions[j * streamCount + i] = FB_NEW_POOL(pool) Partition(pool, formats[i]);
 		}
 	}
 
+	~HashPartitions()
+	{
+		for (ULONG i = 0; i < m_streamCount; i++)
+			delete m_records[i];
+
+		for (ULONG i = 0; i < m_partitionCount * m_streamCount; i++)
+			delete m_partitions[i];
+
+		delete[] m_records;
+		delete[] m_partitions;
+	}
+
+	ULONG getCount() const
+	{
+		return m_partitionCount;
+	}
+
+	ULONG getPartition(ULONG hash) const
+	{
+		// Use the higher bits, the lower ones are used for the bucket number
+		return scrambleHash(hash) >> m_shift;
+	}
+
+	Record* getTempRecord(ULONG stream) const
+	{
+		fb_assert(stream < m_streamCount);
+		return m_records[stream];
+	}
+
+	Partition* get(ULONG partition, ULONG stream) const
+	{
+		fb_assert(partition < m_partitionCount);
+		fb_assert(stream < m_streamCount);
+
+		return m_partitions[partition * m_streamCount + stream];
+	}
+
 private:
+	const ULONG m_partitionCount;
 	const ULONG m_streamCount;
-	const ULONG m_tableSize;
-	CollisionList** m_collisions;
-	ULONG m_slot;
+	ULONG m_shift;
+	Record** m_records;
+	Partition** m_partitions;
 };
 
-
 HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 				   RecordSource* const* args, NestValueArray* const* keys,
 				   double selectivity)
@@ -235,6 +572,10 @@ HashJoin::HashJoin(thread_db* tdbb, CompilerScratch* csb, FB_SIZE_T count,
 
 	m_cardinality = m_leader.source->getCardinality();
 
+	// This buffer is never opened, it's used only to spill the leading stream
+	// records into the partitions (if necessary)
+	m_leaderBuffer = FB_NEW_POOL(csb->csb_pool) BufferedStream(csb, m_leader.source);
+
 	for (FB_SIZE_T j = 0; j < leaderKeyCount; j++)
 	{
 		dsc desc;
@@ -318,35 +659,85 @@ void HashJoin::internalOpen(thread_db* tdbb) const
 	impure->irsb_flags = irsb_open | irsb_mustread;
 
 	delete impure->irsb_hash_table;
+	impure->irsb_hash_table = NULL;
+
 	delete[] impure->irsb_leader_buffer;
 
+	delete impure->irsb_partitions;
+	impure->irsb_partitions = NULL;
+
 	MemoryPool& pool = *tdbb->getDefaultPool();
 
 	const FB_SIZE_T argCount = m_args.getCount();
 
-	impure->irsb_hash_table = FB_NEW_POOL(pool) HashTable(pool, argCount);
 	impure->irsb_leader_buffer = FB_NEW_POOL(pool) UCHAR[m_leader.totalKeyLength];
+	impure->irsb_partition = 0;
+	impure->irsb_leader_position = 0;
 
 	UCharBuffer buffer(pool);
 
-	for (FB_SIZE_T i = 0; i < argCount; i++)
+	const ULONG partitionCount = getPartitionCount(tdbb);
+
+	if (partitionCount > 1)
 	{
-		// Read and cache the inner streams. While doing that,
-		// hash the join condition values and populate hash tables.
+		HalfStaticArray<const Format*, OPT_STATIC_ITEMS> formats;
+		formats.add(m_leaderBuffer->getFormat());
 
-		m_args[i].buffer->open(tdbb);
+		for (FB_SIZE_T i = 0; i < argCount; i++)
+			formats.add(m_args[i].buffer->getFormat());
 
-		ULONG counter = 0;
-		UCHAR* const keyBuffer = buffer.getBuffer(m_args[i].totalKeyLength, false);
+		const auto partitions = FB_NEW_POOL(pool)
+			HashPartitions(pool, partitionCount, argCount + 1, formats.begin());
+		impure->irsb_partitions = partitions;
 
-		while (m_args[i].buffer->getRecord(tdbb))
+		for (FB_SIZE_T i = 0; i < argCount; i++)
 		{
-			const ULONG hash = computeHash(tdbb, request, m_args[i], keyBuffer);
-			impure->irsb_hash_table->put(i, hash, counter++);
+			// Read the inner streams bypassing their buffers, hash the join
+			// condition values and spill the records into the partitions
+
+			const auto next = m_args[i].buffer->getNext();
+			next->open(tdbb);
+
+			Record* const record = partitions->getTempRecord(i + 1);
+			UCHAR* const keyBuffer = buffer.getBuffer(m_args[i].totalKeyLength, false);
+
+			while (next->getRecord(tdbb))
+			{
+				const ULONG hash = computeHash(tdbb, request, m_args[i], keyBuffer);
+				m_args[i].buffer->packRecord(tdbb, record);
+				partitions->get(partitions->getPartition(hash), i + 1)->store(hash, record);
+			}
 		}
+
+		// Prepare the first partition to be joined on the fly
+
+		buildPartition(tdbb, impure);
 	}
+	else
+	{
+		impure->irsb_hash_table = FB_NEW_POOL(pool) HashTable(pool, argCount);
+
+		for (FB_SIZE_T i = 0; i < argCount; i++)
+		{
+			// Read and cache the inner streams. While doing that,
+			// hash the join condition values and populate hash tables.
+
+			m_args[i].buffer->open(tdbb);
+
+			impure->irsb_hash_table->init(i, m_args[i].buffer->getCardinality());
+
+			ULONG counter = 0;
+			UCHAR* const keyBuffer = buffer.getBuffer(m_args[i].totalKeyLength, false);
+
+			while (m_args[i].buffer->getRecord(tdbb))
+			{
+				const ULONG hash = computeHash(tdbb, request, m_args[i], keyBuffer);
+				impure->irsb_hash_table->put(i, hash, counter++);
+			}
+		}
 
-	impure->irsb_hash_table->sort();
+		impure->irsb_hash_table->build(tdbb);
+	}
 
 	m_leader.source->open(tdbb);
 }
@@ -368,8 +759,18 @@ void HashJoin::close(thread_db* tdbb) const
 		delete[] impure->irsb_leader_buffer;
 		impure->irsb_leader_buffer = NULL;
 
+		const bool partitioned = (impure->irsb_partitions != NULL);
+
+		delete impure->irsb_partitions;
+		impure->irsb_partitions = NULL;
+
 		for (FB_SIZE_T i = 0; i < m_args.getCount(); i++)
-			m_args[i].buffer->close(tdbb);
+		{
+			if (partitioned)
+				m_args[i].buffer->getNext()->close(tdbb);
+			else
+				m_args[i].buffer->close(tdbb);
+		}
 
 		m_leader.source->close(tdbb);
 	}
@@ -389,16 +790,12 @@ bool HashJoin::internalGetRecord(thread_db* tdbb) const
 	{
 		if (impure->irsb_flags & irsb_mustread)
 		{
-			// Fetch the record from the leading stream
+			// Fetch the record from the leading stream,
+			// compute and hash the comparison keys
 
-			if (!m_leader.source->getRecord(tdbb))
+			if (!fetchLeader(tdbb, impure))
 				return false;
 
-			// Compute and hash the comparison keys
-
-			impure->irsb_leader_hash =
-				computeHash(tdbb, request, m_leader, impure->irsb_leader_buffer);
-
 			// Ensure the every inner stream having matches for this hash slot.
 			// Setup the hash table for the iteration through collisions.
 
@@ -605,19 +1002,183 @@ ULONG HashJoin::computeHash(thread_db* tdbb,
 	return InternalHash::hash(sub.totalKeyLength, keyBuffer);
 }
 
-bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) const
+ULONG HashJoin::getPartitionCount(thread_db* tdbb) const
 {
-	HashTable* const hashTable = impure->irsb_hash_table;
+	// Estimate the size of the inner streams being buffered. If it's expected
+	// to exceed the temporary space cache, then split the streams into partitions,
+	// each of them fitting the cache (as far as the estimation is accurate).
+
+	const double limit = (double) tdbb->getDatabase()->dbb_config->getTempCacheLimit();
+
+	double size = 0;
+
+	for (FB_SIZE_T i = 0; i < m_args.getCount(); i++)
+	{
+		const double length = m_args[i].buffer->getFormat()->fmt_length + sizeof(ULONG);
+		size += m_args[i].buffer->getCardinality() * length;
+	}
+
+	if (limit <= 0 || size <= limit)
+		return 1;
 
+	ULONG count = 2;
+
+	while (count < MAX_HASH_PARTITIONS && count * limit < size)
+		count <<= 1;
+
+	return count;
+}
+
+bool HashJoin::buildPartition(thread_db* tdbb, Impure* impure) const
+{
+	// Populate the hash table using the inner streams records belonging to the
+	// current partition. Partitions where some stream has no records cannot
+	// produce any matches, so they're skipped.
+
+	HashPartitions* const partitions = impure->irsb_partitions;
+	fb_assert(partitions);
+
+	MemoryPool& pool = *tdbb->getDefaultPool();
+	const FB_SIZE_T argCount = m_args.getCount();
+
+	delete impure->irsb_hash_table;
+	impure->irsb_hash_table = NULL;
+
+	for (; impure->irsb_partition < partitions->getCount(); impure->irsb_partition++)
+	{
+		const ULONG partition = impure->irsb_partition;
+
+		// The first partition is joined while reading the leading stream,
+		// so we don't know yet whether it has any leading records
+		bool empty = (partition && !partitions->get(partition, 0)->getCount());
+
+		for (FB_SIZE_T i = 0; !empty && i < argCount; i++)
+			empty = !partitions->get(partition, i + 1)->getCount();
+
+		if (empty && partition)
+			continue;
+
+		impure->irsb_hash_table = FB_NEW_POOL(pool) HashTable(pool, argCount);
+
+		ULONG hashes[HASH_READ_BATCH];
+
+		for (FB_SIZE_T i = 0; i < argCount; i++)
+		{
+			const auto stream = partitions->get(partition, i + 1);
+			impure->irsb_hash_table->init(i, (double) stream->getCount());
+
+			ULONG position = 0, count;
+
+			while ( (count = stream->fetchHashes(position, hashes, HASH_READ_BATCH)) )
+			{
+				for (ULONG j = 0; j < count; j++, position++)
+					impure->irsb_hash_table->put(i, hashes[j], position);
+			}
+		}
+
+		impure->irsb_hash_table->build(tdbb);
+
+		impure->irsb_leader_position = 0;
+		return true;
+	}
+
+	return false;
+}
+
+bool HashJoin::fetchLeader(thread_db* tdbb, Impure* impure) const
+{
+	Request* const request = tdbb->getRequest();
+	HashPartitions* const partitions = impure->irsb_partitions;
+
+	if (!partitions)
+	{
+		if (!m_leader.source->getRecord(tdbb))
+			return false;
+
+		impure->irsb_leader_hash =
+			computeHash(tdbb, request, m_leader, impure->irsb_leader_buffer);
+
+		return true;
+	}
+
+	while (impure->irsb_partition < partitions->getCount())
+	{
+		Record* const record = partitions->getTempRecord(0);
+
+		if (impure->irsb_partition == 0)
+		{
+			// Join the first partition on the fly,
+			// spill the other leading records into their partitions
+
+			while (m_leader.source->getRecord(tdbb))
+			{
+				const ULONG hash =
+					computeHash(tdbb, request, m_leader, impure->irsb_leader_buffer);
+				const ULONG partition = partitions->getPartition(hash);
+
+				if (!partition)
+				{
+					impure->irsb_leader_hash = hash;
+					return true;
+				}
+
+				m_leaderBuffer->packRecord(tdbb, record);
+				partitions->get(partition, 0)->store(hash, record);
+			}
+		}
+		else
+		{
+			const auto stream = partitions->get(impure->irsb_partition, 0);
+			const FB_UINT64 position = impure->irsb_leader_position;
+
+			if (stream->fetch(position, record) &&
+				stream->fetchHashes(position, &impure->irsb_leader_hash, 1))
+			{
+				impure->irsb_leader_position++;
+				m_leaderBuffer->unpackRecord(tdbb, record);
+				return true;
+			}
+		}
+
+		// The current partition is exhausted, switch to the next one
+
+		impure->irsb_partition++;
+
+		if (!buildPartition(tdbb, impure))
+			break;
+	}
+
+	return false;
+}
+
+bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream, ULONG position) const
+{
 	const BufferedStream* const arg = m_args[stream].buffer;
 
-	ULONG position;
-	if (hashTable->iterate(stream, impure->irsb_leader_hash, position))
+	if (HashPartitions* const partitions = impure->irsb_partitions)
 	{
-		arg->locate(tdbb, position);
+		Record* const record = partitions->getTempRecord(stream + 1);
 
-		if (arg->getRecord(tdbb))
-			return true;
+		if (!partitions->get(impure->irsb_partition, stream + 1)->fetch(position, record))
+			return false;
+
+		arg->unpackRecord(tdbb, record);
+		return true;
+	}
+
+	arg->locate(tdbb, position);
+	return arg->getRecord(tdbb);
+}
+
+bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) const
+{
+	HashTable* const hashTable = impure->irsb_hash_table;
+
+	ULONG position;
+	if (hashTable->iterate(stream, impure->irsb_leader_hash, position) &&
+		fetchRecord(tdbb, impure, stream, position))
+	{
+		return true;
 	}
 
 	while (true)
@@ -627,12 +1188,10 @@ bool HashJoin::fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) co
 
 		hashTable->reset(stream, impure->irsb_leader_hash);
 
-		if (hashTable->iterate(stream, impure->irsb_leader_hash, position))
+		if (hashTable->iterate(stream, impure->irsb_leader_hash, position) &&
+			fetchRecord(tdbb, impure, stream, position))
 		{
-			arg->locate(tdbb, position);
-
-			if (arg->getRecord(tdbb))
-				return true;
+			return true;
 		}
 	}
 }
@@ -1100,6 +1100,22 @@ namespace Jrd
 			return impure->irsb_position;
 		}
 
+		// These methods allow the caller to manage the buffered records on its own
+		// (e.g. HashJoin spilling its partitions), bypassing the internal buffer
+
+		const RecordSource* getNext() const
+		{
+			return m_next;
+		}
+
+		const Format* getFormat() const
+		{
+			return m_format;
+		}
+
+		void packRecord(thread_db* tdbb, Record* record) const;
+		void unpackRecord(thread_db* tdbb, Record* record) const;
+
 	protected:
 		void internalOpen(thread_db* tdbb) const override;
 		bool internalGetRecord(thread_db* tdbb) const override;
@@ -1180,6 +1196,7 @@ namespace Jrd
 	class HashJoin : public RecordSource
 	{
 		class HashTable;
+		class HashPartitions;
 
 		struct SubStream
 		{
@@ -1199,6 +1216,9 @@ namespace Jrd
 			HashTable* irsb_hash_table;
 			UCHAR* irsb_leader_buffer;
 			ULONG irsb_leader_hash;
+			HashPartitions* irsb_partitions;
+			ULONG irsb_partition;
+			FB_UINT64 irsb_leader_position;
 		};
 
 	public:
@@ -1231,9 +1251,14 @@ namespace Jrd
 	private:
 		ULONG computeHash(thread_db* tdbb, Request* request,
 						  const SubStream& sub, UCHAR* buffer) const;
+		ULONG getPartitionCount(thread_db* tdbb) const;
+		bool buildPartition(thread_db* tdbb, Impure* impure) const;
+		bool fetchLeader(thread_db* tdbb, Impure* impure) const;
 		bool fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream) const;
+		bool fetchRecord(thread_db* tdbb, Impure* impure, FB_SIZE_T stream, ULONG position) const;
 
 		SubStream m_leader;
+		BufferedStream* m_leaderBuffer;
 		Firebird::Array<SubStream> m_args;
 	};
 
@@ -39,6 +39,7 @@
 #include "../jrd/rlck_proto.h"
 #include "../jrd/tra_proto.h"
 #include "../jrd/vio_proto.h"
+#include "../jrd/WorkerAttachment.h"
 #include "../dsql/dsql_proto.h"
 #include "firebird/impl/sqlda_pub.h"
 
@@ -84,12 +85,13 @@ namespace
 	{
 	public:
 		BlockReader(ULONG length, const UCHAR* data)
-			: m_header((Block*) data),
-			  m_data(data + sizeof(Block)),
+			: m_data(data + sizeof(Block)),
 			  m_end(data + length),
 			  m_atoms(getPool())
 		{
-			fb_assert(m_data + m_header->length == m_end);
+			// Blocks passed in a batch are not aligned
+			memcpy(&m_header, data, sizeof(Block));
+			fb_assert(m_data + m_header.length == m_end);
 		}
 
 		bool isEof() const
@@ -173,12 +175,17 @@ namespace
 
 		TraNumber getTransactionId() const
 		{
-			return m_header->traNumber;
+			return m_header.traNumber;
 		}
 
 		ULONG getProtocolVersion() const
 		{
-			return m_header->protocol;
+			return m_header.protocol;
+		}
+
+		bool isEndOfTransaction() const
+		{
+			return (m_header.flags & BLOCK_END_TRANS);
 		}
 
 		void defineAtom()
@@ -190,7 +197,7 @@ namespace
 		}
 
 	private:
-		const Block* const m_header;
+		Block m_header;
 		const UCHAR* m_data;
 		const UCHAR* const m_end;
 		HalfStaticArray<MetaString, 64> m_atoms;
@@ -221,9 +228,471 @@ namespace
 		thread_db* m_tdbb;
 	};
 
+	// Lock timeout of the applier transactions
+	const SSHORT APPLIER_LOCK_TIMEOUT = 1;		// seconds
+
+	// Workers of the parallel apply wait longer. Changes that may conflict are
+	// ordered by the dispatcher, but a worker may still wait for the transaction
+	// being committed by another worker, e.g. for the record versions cleanup.
+	const SSHORT WORKER_LOCK_TIMEOUT = 60;		// seconds
+
+	// Record changed by the blocks being dispatched
+	struct RecordRef
+	{
+		MetaName relName;
+		ULONG length;
+		const UCHAR* data;
+	};
+
+	typedef HalfStaticArray<RecordRef, 16> RecordList;
+
+	typedef GenericMap<Pair<NonPooled<TraNumber, FB_SIZE_T> > > EntryMap;
+
+	ULONG getBlockLength(const UCHAR* ptr, const UCHAR* end)
+	{
+		Block header;
+
+		if (end - ptr < (ptrdiff_t) sizeof(Block))
+			raiseError("Replication block is malformed");
+
+		memcpy(&header, ptr, sizeof(Block));
+
+		if (header.length > (ULONG) (end - ptr) - sizeof(Block))
+			raiseError("Replication block is malformed");
+
+		return sizeof(Block) + header.length;
+	}
+
 } // namespace
 
 
+namespace Jrd
+{
+	// Worker attachment with its own applier. Transaction is applied by the same
+	// slot from its start till its end, as it's bound to the attachment.
+
+	class Applier::Slot
+	{
+	public:
+		explicit Slot(MemoryPool& pool)
+			: m_applier(nullptr), m_queue(pool),
+			  m_next(0), m_transactions(0), m_busy(false)
+		{}
+
+		bool attach(thread_db* tdbb, Database* dbb);
+		void release();
+
+		RefPtr<StableAttachmentPart> m_attStable;
+		Applier* m_applier;					// applier of the worker attachment
+		Array<FB_SIZE_T> m_queue;			// entries of the current run, in the journal order
+		FB_SIZE_T m_next;					// next entry to be applied
+		ULONG m_transactions;				// active transactions assigned to the slot
+		bool m_busy;						// some worker is applying the entry
+	};
+
+	bool Applier::Slot::attach(thread_db* tdbb, Database* dbb)
+	{
+		FbStatusVector* const status = tdbb->tdbb_status_vector;
+
+		if (!m_attStable)
+		{
+			m_attStable = WorkerAttachment::getAttachment(status, dbb);
+
+			if (!m_attStable)
+				return false;
+		}
+
+		const auto att = m_attStable->getHandle();
+
+		if (!att)
+		{
+			Arg::Gds(isc_bad_db_handle).copyTo(status);
+			return false;
+		}
+
+		tdbb->setDatabase(att->att_database);
+		tdbb->setAttachment(att);
+
+		return true;
+	}
+
+	void Applier::Slot::release()
+	{
+		if (!m_attStable)
+			return;
+
+		Attachment* att = nullptr;
+		{
+			AttSyncLockGuard guard(*m_attStable->getSync(), FB_FUNCTION);
+			att = m_attStable->getHandle();
+		}
+
+		FbLocalStatus status;
+
+		// The applier is deleted together with its attachment, if it's gone already
+		if (att && m_applier)
+		{
+			BackgroundContextHolder tdbb(att->att_database, att, &status, FB_FUNCTION);
+
+			try
+			{
+				m_applier->shutdown(tdbb);
+			}
+			catch (const Exception& ex)
+			{
+				ex.stuffException(&status);
+			}
+		}
+
+		m_applier = nullptr;
+
+		WorkerAttachment::releaseAttachment(&status, m_attStable);
+		m_attStable = nullptr;
+	}
+
+
+	// Run of blocks applied by the slots. Blocks of the same transaction are applied
+	// one by one by its slot. Block changing the record that was changed by another
+	// transaction waits until that change is applied, or until that transaction
+	// is committed if its commit precedes the block in the journal. Otherwise, blocks
+	// are applied concurrently. Transactions are ended in the journal order, so the
+	// blocks applied before an error are always the leading ones.
+
+	class Applier::ApplyTask : public Task
+	{
+	public:
+		ApplyTask(MemoryPool& pool, Applier* applier, Database* dbb)
+			: m_pool(pool), m_applier(applier), m_dbb(dbb),
+			  m_entries(pool), m_depends(pool), m_items(pool),
+			  m_applied(0), m_leading(0), m_waiters(0), m_stop(false)
+		{
+			for (auto slot : m_applier->m_slots)
+			{
+				slot->m_queue.clear();
+				slot->m_next = 0;
+				slot->m_busy = false;
+			}
+		}
+
+		virtual ~ApplyTask()
+		{
+			for (auto item : m_items)
+				delete item;
+		}
+
+		bool handler(WorkItem& item);
+		bool getWorkItem(WorkItem** pItem);
+		bool getResult(IStatus* status);
+		int getMaxWorkers();
+
+		void add(Slot* slot, const UCHAR* data, ULONG length, bool endTrans)
+		{
+			Entry entry;
+			entry.slot = slot;
+			entry.data = data;
+			entry.length = length;
+			entry.depStart = m_depends.getCount();
+			entry.depCount = 0;
+			entry.endTrans = endTrans;
+			entry.done = false;
+
+			slot->m_queue.add(m_entries.getCount());
+			m_entries.add(entry);
+		}
+
+		// The last added entry is applied after the given one
+		void addDependency(FB_SIZE_T pos)
+		{
+			auto& entry = m_entries.back();
+			fb_assert(pos < m_entries.getCount() - 1);
+
+			// Order of the slot entries is implied
+			if (m_entries[pos].slot != entry.slot)
+			{
+				m_depends.add(pos);
+				entry.depCount++;
+			}
+		}
+
+		FB_SIZE_T getCount() const
+		{
+			return m_entries.getCount();
+		}
+
+		bool isEmpty() const
+		{
+			return m_entries.isEmpty();
+		}
+
+		// End of the leading blocks applied
+		const UCHAR* getAppliedEnd() const
+		{
+			fb_assert(m_entries.hasData());
+
+			if (m_leading < m_entries.getCount())
+				return m_entries[m_leading].data;
+
+			const Entry& last = m_entries.back();
+			return last.data + last.length;
+		}
+
+		class Item : public Task::WorkItem
+		{
+		public:
+			explicit Item(ApplyTask* task)
+				: Task::WorkItem(task),
+				  m_slot(nullptr), m_entry(0), m_inuse(false)
+			{}
+
+			Slot* m_slot;
+			FB_SIZE_T m_entry;
+			bool m_inuse;
+		};
+
+	private:
+		struct Entry
+		{
+			Slot* slot;
+			const UCHAR* data;
+			ULONG length;
+			FB_SIZE_T depStart;		// entries to be applied before this one
+			FB_SIZE_T depCount;		// are stored in m_depends
+			bool endTrans;			// applied after all the preceding entries
+			bool done;
+		};
+
+		bool isReady(FB_SIZE_T pos) const
+		{
+			const Entry& entry = m_entries[pos];
+
+			if (entry.endTrans && m_leading < pos)
+				return false;
+
+			for (FB_SIZE_T i = 0; i < entry.depCount; i++)
+			{
+				if (!m_entries[m_depends[entry.depStart + i]].done)
+					return false;
+			}
+
+			return true;
+		}
+
+		void complete(Item* item, bool success);
+		void setError(IStatus* status);
+
+		// Must be called under m_mutex
+		void wakeup()
+		{
+			if (m_waiters)
+			{
+				m_wakeup.release(m_waiters);
+				m_waiters = 0;
+			}
+		}
+
+		MemoryPool& m_pool;
+		Applier* const m_applier;
+		Database* const m_dbb;
+		Array<Entry> m_entries;
+		Array<FB_SIZE_T> m_depends;
+		HalfStaticArray<Item*, 8> m_items;
+
+		Mutex m_mutex;
+		Semaphore m_wakeup;
+		StatusHolder m_status;
+		FB_SIZE_T m_applied;
+		FB_SIZE_T m_leading;		// number of the leading entries applied
+		ULONG m_waiters;
+		bool m_stop;
+	};
+
+	bool Applier::ApplyTask::handler(WorkItem& _item)
+	{
+		const auto item = reinterpret_cast<Item*>(&_item);
+		const auto slot = item->m_slot;
+		const Entry& entry = m_entries[item->m_entry];
+
+		ThreadContextHolder tdbb(NULL);
+		tdbb->tdbb_flags = TDBB_replicator;
+
+		if (!slot->attach(tdbb, m_dbb))
+		{
+			setError(tdbb->tdbb_status_vector);
+			complete(item, false);
+			return false;
+		}
+
+		try
+		{
+			WorkerContextHolder holder(tdbb, FB_FUNCTION);
+
+			if (!slot->m_applier)
+			{
+				slot->m_applier = Applier::create(tdbb, m_applier->m_enableCascade,
+												  WORKER_LOCK_TIMEOUT, 0);
+			}
+
+			slot->m_applier->processBlock(tdbb, entry.length, entry.data);
+		}
+		catch (const Exception& ex)
+		{
+			ex.stuffException(tdbb->tdbb_status_vector);
+			setError(tdbb->tdbb_status_vector);
+			complete(item, false);
+			return false;
+		}
+
+		complete(item, true);
+		return true;
+	}
+
+	bool Applier::ApplyTask::getWorkItem(WorkItem** pItem)
+	{
+		auto item = reinterpret_cast<Item*>(*pItem);
+
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (!item)
+		{
+			for (auto free : m_items)
+			{
+				if (!free->m_inuse)
+				{
+					item = free;
+					break;
+				}
+			}
+
+			if (!item)
+			{
+				item = FB_NEW_POOL(m_pool) Item(this);
+				m_items.add(item);
+			}
+
+			item->m_inuse = true;
+			*pItem = item;
+		}
+
+		while (!m_stop && m_applied < m_entries.getCount())
+		{
+			// Prefer the earliest entry, others are likely to wait for it
+
+			Slot* found = nullptr;
+			FB_SIZE_T first = 0;
+
+			for (const auto slot : m_applier->m_slots)
+			{
+				if (slot->m_busy || slot->m_next >= slot->m_queue.getCount())
+					continue;
+
+				const auto pos = slot->m_queue[slot->m_next];
+
+				if ((!found || pos < first) && isReady(pos))
+				{
+					found = slot;
+					first = pos;
+				}
+			}
+
+			if (found)
+			{
+				found->m_busy = true;
+				item->m_slot = found;
+				item->m_entry = first;
+				return true;
+			}
+
+			// Nothing to do until some entry being applied is completed.
+			// The earliest entry not applied yet is always ready,
+			// so somebody is applying it now.
+
+			m_waiters++;
+
+			MutexUnlockGuard unlock(m_mutex, FB_FUNCTION);
+			m_wakeup.enter();
+		}
+
+		return false;
+	}
+
+	bool Applier::ApplyTask::getResult(IStatus* status)
+	{
+		if (status)
+		{
+			status->init();
+			status->setErrors(m_status.getErrors());
+		}
+
+		return m_status.isSuccess();
+	}
+
+	int Applier::ApplyTask::getMaxWorkers()
+	{
+		int count = 0;
+
+		for (const auto slot : m_applier->m_slots)
+		{
+			if (slot->m_queue.hasData())
+				count++;
+		}
+
+		return MAX(count, 1);
+	}
+
+	void Applier::ApplyTask::complete(Item* item, bool success)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		const auto slot = item->m_slot;
+
+		if (success)
+		{
+			m_entries[item->m_entry].done = true;
+			m_applied++;
+			slot->m_next++;
+
+			while (m_leading < m_entries.getCount() && m_entries[m_leading].done)
+				m_leading++;
+		}
+
+		slot->m_busy = false;
+		item->m_slot = nullptr;
+
+		wakeup();
+	}
+
+	void Applier::ApplyTask::setError(IStatus* status)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (!m_stop)
+			m_status.save(status);
+
+		m_stop = true;
+
+		wakeup();
+	}
+
+} // namespace Jrd
+
+
+Applier::Applier(MemoryPool& pool,
+				 const PathName& database,
+				 Request* request, bool cascade,
+				 SSHORT lockTimeout, ULONG workers)
+	: PermanentStorage(pool),
+	  m_txnMap(pool), m_database(pool, database),
+	  m_request(request), m_interface(nullptr),
+	  m_enableCascade(cascade), m_lockTimeout(lockTimeout),
+	  m_slots(pool), m_slotMap(pool), m_keyMap(pool), m_keyLists(pool), m_ended(pool)
+{
+	if (workers > 1)
+	{
+		for (ULONG i = 0; i < workers; i++)
+			m_slots.add(FB_NEW_POOL(pool) Slot(pool));
+	}
+}
+
 Applier* Applier::create(thread_db* tdbb)
 {
 	const auto dbb = tdbb->getDatabase();
@@ -236,6 +705,25 @@ Applier* Applier::create(thread_db* tdbb)
 	if (!attachment->locksmith(tdbb, REPLICATE_INTO_DATABASE))
 		status_exception::raise(Arg::Gds(isc_miss_prvlg) << "REPLICATE_INTO_DATABASE");
 
+	const auto config = dbb->replConfig();
+	const bool cascade = (config && config->cascadeReplication);
+
+	// Every worker keeps its own worker attachment while the replication goes on
+
+	ULONG workers = config ? config->applyParallelWorkers : 1;
+	const int maxWorkers = Firebird::Config::getMaxParallelWorkers();
+
+	if (maxWorkers > 0 && workers > (ULONG) maxWorkers)
+		workers = maxWorkers;
+
+	return create(tdbb, cascade, APPLIER_LOCK_TIMEOUT, workers);
+}
+
+Applier* Applier::create(thread_db* tdbb, bool cascade, SSHORT lockTimeout, ULONG workers)
+{
+	const auto dbb = tdbb->getDatabase();
+	const auto attachment = tdbb->getAttachment();
+
 	Request* request = nullptr;
 	const auto req_pool = attachment->createPool();
 
@@ -258,11 +746,8 @@ Applier* Applier::create(thread_db* tdbb)
 		throw;
 	}
 
-	const auto config = dbb->replConfig();
-	const bool cascade = (config && config->cascadeReplication);
-
 	const auto applier = FB_NEW_POOL(*attachment->att_pool)
-		Applier(*attachment->att_pool, dbb->dbb_filename, request, cascade);
+		Applier(*attachment->att_pool, dbb->dbb_filename, request, cascade, lockTimeout, workers);
 
 	attachment->att_repl_appliers.add(applier);
 
@@ -275,6 +760,17 @@ void Applier::shutdown(thread_db* tdbb)
 
 	cleanupTransactions(tdbb);
 
+	for (auto slot : m_slots)
+	{
+		slot->release();
+		delete slot;
+	}
+
+	m_slots.clear();
+	m_slotMap.clear();
+	releaseKeys(true);
+	m_coordinator.reset();
+
 	CMP_release(tdbb, m_request);
 	m_request = nullptr;	// already deleted by pool
 	m_record = nullptr;		// already deleted by pool
@@ -300,6 +796,421 @@ void Applier::process(thread_db* tdbb, ULONG length, const UCHAR* data)
 
 	tdbb->tdbb_flags |= TDBB_replicator;
 
+	// The replication server may pass a few blocks at once. If some of them
+	// fail, tell it how many leading ones are applied, so it continues after them.
+
+	const UCHAR* applied = data;
+
+	try
+	{
+		if (m_slots.hasData())
+			processParallel(tdbb, length, data, applied);
+		else
+		{
+			const UCHAR* const end = data + length;
+
+			while (applied < end)
+			{
+				const ULONG blockLength = getBlockLength(applied, end);
+				processBlock(tdbb, blockLength, applied);
+				applied += blockLength;
+			}
+		}
+	}
+	catch (const Exception& ex)
+	{
+		if (applied == data)
+			throw;
+
+		Arg::StatusVector error(ex);
+		error << Arg::Gds(isc_repl_applied) << Arg::Num((SLONG) (applied - data));
+		error.raise();
+	}
+}
+
+void Applier::processParallel(thread_db* tdbb, ULONG length, const UCHAR* data,
+							  const UCHAR*& applied)
+{
+	const auto dbb = tdbb->getDatabase();
+
+	if (!m_coordinator)
+		m_coordinator = FB_NEW_POOL(getPool()) Coordinator(&getPool());
+
+	const UCHAR* ptr = data;
+	const UCHAR* const end = data + length;
+
+	while (ptr < end)
+	{
+		ApplyTask task(getPool(), this, dbb);
+		ptr = dispatch(tdbb, task, ptr, end);
+
+		if (task.isEmpty())
+		{
+			applied = ptr;
+			continue;
+		}
+
+		EngineCheckout cout(tdbb, FB_FUNCTION);
+
+		m_coordinator->runSync(&task);
+
+		applied = task.getAppliedEnd();
+
+		FbLocalStatus status;
+		if (!task.getResult(&status))
+			status.raise();
+
+		releaseKeys(false);
+	}
+}
+
+const UCHAR* Applier::dispatch(thread_db* tdbb, ApplyTask& task, const UCHAR* ptr, const UCHAR* end)
+{
+	// Records changed by the transactions are remembered until their end blocks
+	// are applied, thus the following runs don't overtake the changes.
+	// Entries of the previous runs are applied already.
+
+	EntryMap ends(getPool());		// transactions ended in this run
+	RecordList records(getPool());
+	string key;
+
+	m_run++;
+
+	while (ptr < end)
+	{
+		const ULONG blockLength = getBlockLength(ptr, end);
+
+		BlockReader reader(blockLength, ptr);
+
+		const auto traNum = reader.getTransactionId();
+		const auto protocol = reader.getProtocolVersion();
+		const bool endTrans = reader.isEndOfTransaction();
+
+		if (protocol != PROTOCOL_CURRENT_VERSION)
+			raiseError("Unsupported replication protocol version %u", protocol);
+
+		bool ddl = false, cleanup = false;
+		records.clear();
+
+		while (!reader.isEof() && !ddl)
+		{
+			const auto op = reader.getTag();
+
+			switch (op)
+			{
+			case opCleanupTransaction:
+				cleanup = !traNum;
+				break;
+
+			case opInsertRecord:
+			case opDeleteRecord:
+				{
+					RecordRef record;
+					record.relName = reader.getMetaName();
+					record.length = reader.getInt32();
+					record.data = reader.getBinary(record.length);
+					records.add(record);
+				}
+				break;
+
+			case opUpdateRecord:
+				{
+					// Both old and new keys are changed
+
+					RecordRef record;
+					record.relName = reader.getMetaName();
+					record.length = reader.getInt32();
+					record.data = reader.getBinary(record.length);
+					records.add(record);
+
+					record.length = reader.getInt32();
+					record.data = reader.getBinary(record.length);
+					records.add(record);
+				}
+				break;
+
+			case opStoreBlob:
+				reader.getInt32();
+				reader.getInt32();
+				do {
+					const ULONG length = (USHORT) reader.getInt16();
+					if (!length)
+						break;
+					reader.getBinary(length);
+				} while (!reader.isEof());
+				break;
+
+			case opExecuteSql:
+			case opExecuteSqlIntl:
+				ddl = true;
+				break;
+
+			case opSetSequence:
+				// Sequences are only advanced, so the order does not matter
+				reader.getMetaName();
+				reader.getInt64();
+				break;
+
+			case opDefineAtom:
+				reader.defineAtom();
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		auto assignment = traNum ? m_slotMap.get(traNum) : nullptr;
+
+		if (assignment && ddl)
+			assignment->ddl = true;
+
+		// Blocks executing DDL, committing it or cleaning up all the transactions
+		// are applied alone, so the metadata is up to date for the following ones
+
+		const bool exclusive = ddl || cleanup || (assignment && assignment->ddl && endTrans);
+
+		if (exclusive && !task.isEmpty())
+			break;
+
+		if (cleanup)
+		{
+			// Every slot rolls back its own transactions
+
+			for (auto slot : m_slots)
+			{
+				if (slot->m_applier)
+					task.add(slot, ptr, blockLength, false);
+
+				slot->m_transactions = 0;
+			}
+
+			m_slotMap.clear();
+			releaseKeys(true);
+
+			return ptr + blockLength;
+		}
+
+		Slot* slot = assignment ? assignment->slot : nullptr;
+
+		if (!slot)
+		{
+			// New transaction goes to the least loaded slot
+
+			slot = m_slots[0];
+
+			for (const auto candidate : m_slots)
+			{
+				if (candidate->m_transactions < slot->m_transactions ||
+					(candidate->m_transactions == slot->m_transactions &&
+						candidate->m_queue.getCount() < slot->m_queue.getCount()))
+				{
+					slot = candidate;
+				}
+			}
+
+			if (traNum && !endTrans)
+			{
+				SlotAssignment newAssignment;
+				newAssignment.slot = slot;
+				newAssignment.ddl = ddl;
+				m_slotMap.put(traNum, newAssignment);
+
+				slot->m_transactions++;
+			}
+		}
+
+		task.add(slot, ptr, blockLength, endTrans);
+		const FB_SIZE_T pos = task.getCount() - 1;
+
+		if (!exclusive)
+		{
+			for (const auto& record : records)
+			{
+				composeKey(tdbb, record.relName, record.length, record.data, key);
+
+				auto owner = m_keyMap.get(key);
+				bool acquired = true;
+
+				if (owner)
+				{
+					acquired = (owner->traNum != traNum);
+
+					if (acquired)
+					{
+						// Apply after the end of the previous owner or, while it's
+						// open, after its change, unless they are applied already
+
+						FB_SIZE_T endPos;
+						if (ends.get(owner->traNum, endPos))
+							task.addDependency(endPos);
+						else if (owner->run == m_run)
+							task.addDependency(owner->entry);
+					}
+				}
+				else
+					owner = m_keyMap.put(key);
+
+				if (acquired)
+				{
+					KeyList* list = nullptr;
+					if (!m_keyLists.get(traNum, list))
+					{
+						list = FB_NEW_POOL(getPool()) KeyList(getPool());
+						m_keyLists.put(traNum, list);
+					}
+
+					list->add(key);
+				}
+
+				owner->traNum = traNum;
+				owner->entry = pos;
+				owner->run = m_run;
+			}
+		}
+
+		if (endTrans || !traNum)
+			m_ended.add(traNum);
+
+		if (endTrans && traNum)
+		{
+			ends.put(traNum, pos);
+
+			if (assignment)
+			{
+				slot->m_transactions--;
+				m_slotMap.remove(traNum);
+			}
+		}
+
+		ptr += blockLength;
+
+		if (exclusive)
+			break;
+	}
+
+	return ptr;
+}
+
+void Applier::releaseKeys(bool all)
+{
+	// Forget the records changed by the transactions ended in the applied run
+	// or by all the transactions
+
+	if (all)
+	{
+		KeyListMap::Accessor accessor(&m_keyLists);
+
+		if (accessor.getFirst())
+		{
+			do {
+				delete accessor.current()->second;
+			} while (accessor.getNext());
+		}
+
+		m_keyLists.clear();
+		m_keyMap.clear();
+		m_ended.clear();
+		return;
+	}
+
+	for (const auto traNum : m_ended)
+	{
+		KeyList* list = nullptr;
+		if (!m_keyLists.get(traNum, list))
+			continue;
+
+		for (const auto& key : *list)
+		{
+			const auto owner = m_keyMap.get(key);
+
+			if (owner && owner->traNum == traNum)
+				m_keyMap.remove(key);
+		}
+
+		delete list;
+		m_keyLists.remove(traNum);
+	}
+
+	m_ended.clear();
+}
+
+void Applier::composeKey(thread_db* tdbb, const MetaName& relName,
+						 ULONG length, const UCHAR* data, string& key)
+{
+	// Record is identified by the primary/unique key, like lookupRecord() does.
+	// If it's impossible, the whole table is treated as a single record.
+	// Changes of tables having other unique keys or taking part in foreign
+	// keys may conflict on other columns or with other tables, so all of them
+	// share the empty key and are applied in the journal order.
+
+	key = relName.c_str();
+
+	Jrd::ContextPoolHolder context(tdbb, m_request->req_pool);
+
+	try
+	{
+		const auto relation = MET_lookup_relation(tdbb, relName);
+		if (!relation)
+			return;
+
+		if (!(relation->rel_flags & REL_scanned))
+			MET_scan_relation(tdbb, relation);
+
+		MET_scan_partners(tdbb, relation);
+
+		const auto foreignRefs = relation->rel_foreign_refs.frgn_reference_ids;
+		const auto primaryDeps = relation->rel_primary_dpnds.prim_reference_ids;
+
+		if ((foreignRefs && foreignRefs->count()) || (primaryDeps && primaryDeps->count()))
+		{
+			key = "";
+			return;
+		}
+
+		index_desc idx;
+		USHORT uniqueKeys = 0;
+
+		if (!lookupKey(tdbb, relation, idx, &uniqueKeys))
+			return;
+
+		if (uniqueKeys > 1)
+		{
+			key = "";
+			return;
+		}
+
+		if (idx.idx_flags & (idx_expression | idx_condition))
+			return;
+
+		const auto format = findFormat(tdbb, relation, length);
+
+		record_param rpb;
+		rpb.rpb_relation = relation;
+
+		rpb.rpb_record = m_record;
+		const auto record = m_record =
+			VIO_record(tdbb, &rpb, format, tdbb->getDefaultPool());
+
+		record->copyDataFrom(data);
+
+		IndexKey indexKey(tdbb, relation, &idx);
+		if (indexKey.compose(record) == idx_e_ok)
+		{
+			key += '\0';
+			key.append((const char*) indexKey->key_data, indexKey->key_length);
+		}
+	}
+	catch (const Exception&)
+	{
+		// The error is reported when the block is applied
+		CCH_unwind(tdbb, false);
+		fb_utils::init_status(tdbb->tdbb_status_vector);
+	}
+}
+
+void Applier::processBlock(thread_db* tdbb, ULONG length, const UCHAR* data)
+{
 	BlockReader reader(length, data);
 
 	const auto traNum = reader.getTransactionId();
@@ -445,7 +1356,7 @@ void Applier::startTransaction(thread_db* tdbb, TraNumber traNum)
 	if (m_txnMap.exist(traNum))
 		raiseError("Transaction %" SQUADFORMAT" already exists", traNum);
 
-	const auto transaction = TRA_start(tdbb, TRA_read_committed | TRA_rec_version, 1);
+	const auto transaction = TRA_start(tdbb, TRA_read_committed | TRA_rec_version, m_lockTimeout);
 
 	m_txnMap.put(traNum, transaction);
 }
@@ -978,7 +1889,7 @@ void Applier::executeSql(thread_db* tdbb,
 						   NULL, NULL, NULL, NULL, false);
 }
 
-bool Applier::lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& key)
+bool Applier::lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& key, USHORT* uniqueKeys)
 {
 	RelationPages* const relPages = relation->getPages(tdbb);
 	auto page = relPages->rel_index_root;
@@ -995,17 +1906,28 @@ bool Applier::lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& key)
 	index_desc idx;
 	idx.idx_id = key.idx_id = idx_invalid;
 
+	bool primary = false;
+	USHORT count = 0;
+
 	for (USHORT i = 0; i < root->irt_count; i++)
 	{
 		if (BTR_description(tdbb, relation, root, &idx, i))
 		{
+			if (idx.idx_flags & (idx_primary | idx_unique))
+				count++;
+
+			if (primary)
+				continue;
+
 			if (idx.idx_flags & idx_primary)
 			{
 				key = idx;
-				break;
-			}
+				primary = true;
 
-			if (idx.idx_flags & idx_unique)
+				if (!uniqueKeys)
+					break;
+			}
+			else if (idx.idx_flags & idx_unique)
 			{
 				if (key.idx_id == idx_invalid)
 					key = idx;
@@ -1037,6 +1959,9 @@ bool Applier::lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& key)
 
 	CCH_RELEASE(tdbb, &window);
 
+	if (uniqueKeys)
+		*uniqueKeys = count;
+
 	return (key.idx_id != idx_invalid);
 }
 
@@ -26,6 +26,8 @@
 
 #include "../common/classes/array.h"
 #include "../common/classes/GenericMap.h"
+#include "../common/classes/objects_array.h"
+#include "../common/Task.h"
 #include "../jrd/jrd.h"
 #include "../jrd/tra.h"
 
@@ -37,6 +39,32 @@ namespace Jrd
 	{
 		typedef Firebird::GenericMap<Firebird::Pair<Firebird::NonPooled<TraNumber, jrd_tra*> > > TransactionMap;
 		typedef Firebird::HalfStaticArray<bid, 16> BlobList;
+
+		// Parallel apply, see processParallel()
+		class Slot;
+		class ApplyTask;
+
+		struct SlotAssignment
+		{
+			Slot* slot;
+			bool ddl;				// transaction executes DDL statements
+		};
+
+		typedef Firebird::GenericMap<Firebird::Pair<Firebird::NonPooled<TraNumber, SlotAssignment> > > SlotMap;
+
+		// Transaction that changed the record last and the entry it did that in
+		struct KeyOwner
+		{
+			TraNumber traNum;
+			FB_SIZE_T entry;
+			ULONG run;				// dispatch run the entry belongs to
+		};
+
+		typedef Firebird::GenericMap<Firebird::Pair<Firebird::Left<Firebird::string, KeyOwner> > > KeyMap;
+
+		// Records changed by the transaction, to forget when it's applied
+		typedef Firebird::ObjectsArray<Firebird::string> KeyList;
+		typedef Firebird::GenericMap<Firebird::Pair<Firebird::NonPooled<TraNumber, KeyList*> > > KeyListMap;
 /*
 		class ReplicatedTransaction : public Firebird::IReplicatedTransaction
 		{
@@ -125,11 +153,8 @@ namespace Jrd
 	public:
 		Applier(Firebird::MemoryPool& pool,
 				const Firebird::PathName& database,
-				Request* request, bool cascade)
-			: PermanentStorage(pool),
-			  m_txnMap(pool), m_database(pool, database),
-			  m_request(request), m_enableCascade(cascade)
-		{}
+				Request* request, bool cascade,
+				SSHORT lockTimeout, ULONG workers);
 
 		static Applier* create(thread_db* tdbb);
 
@@ -155,6 +180,26 @@ namespace Jrd
 		Record* m_record = nullptr;
 		JReplicator* m_interface;
 		const bool m_enableCascade;
+		const SSHORT m_lockTimeout;
+
+		Firebird::HalfStaticArray<Slot*, 8> m_slots;
+		SlotMap m_slotMap;
+		KeyMap m_keyMap;
+		KeyListMap m_keyLists;
+		Firebird::HalfStaticArray<TraNumber, 16> m_ended;	// transactions ended in the current run
+		ULONG m_run = 0;
+		Firebird::AutoPtr<Firebird::Coordinator> m_coordinator;
+
+		static Applier* create(thread_db* tdbb, bool cascade, SSHORT lockTimeout, ULONG workers);
+
+		void processBlock(thread_db* tdbb, ULONG length, const UCHAR* data);
+		void processParallel(thread_db* tdbb, ULONG length, const UCHAR* data,
+							 const UCHAR*& applied);
+		const UCHAR* dispatch(thread_db* tdbb, ApplyTask& task, const UCHAR* ptr, const UCHAR* end);
+		void releaseKeys(bool all);
+		void composeKey(thread_db* tdbb, const MetaName& relName,
+						ULONG length, const UCHAR* data,
+						Firebird::string& key);
 
 		void startTransaction(thread_db* tdbb, TraNumber traNum);
 		void prepareTransaction(thread_db* tdbb, TraNumber traNum);
@@ -185,7 +230,8 @@ namespace Jrd
 						const Firebird::string& sql,
 						const MetaName& owner);
 
-		bool lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& idx);
+		bool lookupKey(thread_db* tdbb, jrd_rel* relation, index_desc& idx,
+					   USHORT* uniqueKeys = nullptr);
 		bool compareKey(thread_db* tdbb, jrd_rel* relation,
 						const index_desc& idx,
 						Record* record1, Record* record2);
@@ -58,6 +58,7 @@ namespace
 	const ULONG DEFAULT_GROUP_FLUSH_DELAY = 0;
 	const ULONG DEFAULT_APPLY_IDLE_TIMEOUT = 10;				// seconds
 	const ULONG DEFAULT_APPLY_ERROR_TIMEOUT = 60;				// seconds
+	const ULONG DEFAULT_APPLY_PARALLEL_WORKERS = 1;
 
 	void parseLong(const string& input, ULONG& output)
 	{
@@ -123,6 +124,7 @@ Config::Config()
 	  verboseLogging(false),
 	  applyIdleTimeout(DEFAULT_APPLY_IDLE_TIMEOUT),
 	  applyErrorTimeout(DEFAULT_APPLY_ERROR_TIMEOUT),
+	  applyParallelWorkers(DEFAULT_APPLY_PARALLEL_WORKERS),
 	  pluginName(getPool()),
 	  logErrors(true),
 	  reportErrors(false),
@@ -150,6 +152,7 @@ Config::Config(const Config& other)
 	  verboseLogging(other.verboseLogging),
 	  applyIdleTimeout(other.applyIdleTimeout),
 	  applyErrorTimeout(other.applyErrorTimeout),
+	  applyParallelWorkers(other.applyParallelWorkers),
 	  pluginName(getPool(), other.pluginName),
 	  logErrors(other.logErrors),
 	  reportErrors(other.reportErrors),
@@ -290,6 +293,10 @@ Config* Config::get(const PathName& lookupName)
 				{
 					parseBoolean(value, config->cascadeReplication);
 				}
+				else if (key == "apply_parallel_workers")
+				{
+					parseLong(value, config->applyParallelWorkers);
+				}
 			}
 
 			if (exactMatch)
@@ -406,6 +413,10 @@ void Config::enumerate(ReplicaList& replicas)
 				{
 					parseLong(value, config->applyErrorTimeout);
 				}
+				else if (key == "apply_parallel_workers")
+				{
+					parseLong(value, config->applyParallelWorkers);
+				}
 			}
 
 			if (dbName.hasData() && config->sourceDirectory.hasData())
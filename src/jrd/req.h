@@ -50,6 +50,7 @@ class ValueListNode;
 class jrd_tra;
 class Savepoint;
 class Cursor;
+class BatchIndexKeys;
 class thread_db;
 
 // record parameter block
@@ -91,6 +92,7 @@ struct record_param
 	USHORT rpb_stream_flags;		// stream flags
 	USHORT rpb_runtime_flags;		// runtime flags
 	SSHORT rpb_org_scans;			// relation scan count at stream open
+	ReadAhead rpb_read_ahead;		// read-ahead of data pages
 
 	inline WIN& getWindow(thread_db* tdbb)
 	{
@@ -318,7 +320,8 @@ public:
 		  req_auto_trans(*req_pool),
 		  req_sorts(*req_pool, attachment->att_database),
 		  req_rpb(*req_pool),
-		  impureArea(*req_pool)
+		  impureArea(*req_pool),
+		  req_batch_keys(NULL)
 	{
 		fb_assert(statement);
 		setAttachment(attachment);
@@ -442,6 +445,7 @@ public:
 	SnapshotData req_snapshot;
 	StatusXcp req_last_xcp;			// last known exception
 	bool req_batch_mode;
+	BatchIndexKeys* req_batch_keys;	// keys of non-unique indices deferred by the batch
 
 	enum req_s {
 		req_evaluate,
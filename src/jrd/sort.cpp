@@ -37,6 +37,7 @@
 #include "../jrd/intl.h"
 #include "../common/TimeZoneUtil.h"
 #include "../common/gdsassert.h"
+#include "../common/Task.h"
 #include "../jrd/req.h"
 #include "../jrd/val.h"
 #include "../jrd/err_proto.h"
@@ -79,6 +80,25 @@ using namespace Firebird;
 const ULONG MAX_SORT_BUFFER_SIZE = 1024 * 128;	// 128KB
 const ULONG MIN_RECORDS_TO_ALLOC = 8;
 
+// Big sort buffers are sorted by multiple threads (up to the attachment's
+// parallel workers). The buffer is split into key ranges using a sample
+// of records, each range is then sorted by its own thread.
+
+const ULONG MIN_PARALLEL_SORT_RECORDS = 8192;	// records per thread
+const ULONG PARALLEL_SORT_RANGES = 4;			// key ranges per thread
+const ULONG PARALLEL_SORT_SAMPLES = 16;		// samples per key range
+const ULONG MAX_PARALLEL_SORT_THREADS = 64;
+
+// Buffers with short keys are sorted using the LSD radix sort by key bytes.
+// Digits which are the same for all records (null flags, padding, high bytes
+// of small numbers) are skipped, if too many passes remain the quick sort
+// is used instead.
+
+const ULONG MIN_RADIX_SORT_RECORDS = 1024;
+const ULONG MAX_RADIX_KEY_LONGS = 4;
+const ULONG MAX_RADIX_PASSES = 8;
+const ULONG RADIX_SIZE = 256;
+
 // the size of sr_bckptr (everything before sort_record) in bytes
 #define SIZEOF_SR_BCKPTR offsetof(sr, sr_sort_record)
 // the size of sr_bckptr in # of 32 bit longwords
@@ -147,9 +167,94 @@ namespace
 		*a = *b;
 		*b = temp;
 	}
+
+	// Compare two keys the same way Sort::quick() does
+	inline bool greater(const SORTP* p, const SORTP* q, ULONG length)
+	{
+		ULONG tl = length - 1;
+		while (tl && *p == *q)
+		{
+			p++;
+			q++;
+			tl--;
+		}
+
+		return (tl && *p > *q);
+	}
 } // namespace
 
 
+// Sorts the key ranges of the sort buffer using multiple threads
+class Sort::SortRangesTask : public Task
+{
+public:
+	class Item : public Task::WorkItem
+	{
+	public:
+		Item(SortRangesTask* task)
+			: Task::WorkItem(task), m_pointers(NULL), m_size(0)
+		{}
+
+		SORTP** m_pointers;
+		ULONG m_size;
+	};
+
+	SortRangesTask(MemoryPool& pool, Sort* sort, ULONG workers)
+		: m_sort(sort), m_workers(workers), m_items(pool), m_next(0)
+	{}
+
+	~SortRangesTask()
+	{
+		for (Item** p = m_items.begin(); p < m_items.end(); p++)
+			delete *p;
+	}
+
+	void addRange(MemoryPool& pool, SORTP** pointers, ULONG size)
+	{
+		Item* const item = FB_NEW_POOL(pool) Item(this);
+		item->m_pointers = pointers;
+		item->m_size = size;
+		m_items.add(item);
+	}
+
+	bool handler(WorkItem& _item)
+	{
+		Item* const item = reinterpret_cast<Item*>(&_item);
+
+		m_sort->sortRange(item->m_pointers, item->m_size);
+		return true;
+	}
+
+	bool getWorkItem(WorkItem** pItem)
+	{
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (m_next >= m_items.getCount())
+			return false;
+
+		*pItem = m_items[m_next++];
+		return true;
+	}
+
+	bool getResult(IStatus* /*status*/)
+	{
+		return true;
+	}
+
+	int getMaxWorkers()
+	{
+		return (int) MIN(m_workers, m_items.getCount());
+	}
+
+private:
+	Sort* const m_sort;
+	const ULONG m_workers;
+	Mutex m_mutex;
+	HalfStaticArray<Item*, 16> m_items;
+	FB_SIZE_T m_next;
+};
+
+
 Sort::Sort(Database* dbb,
 		   SortOwner* owner,
 		   ULONG record_length,
@@ -163,6 +268,7 @@ Sort::Sort(Database* dbb,
 	  m_last_record(NULL), m_next_pointer(NULL), m_records(0),
 	  m_runs(NULL), m_merge(NULL), m_free_runs(NULL),
 	  m_flags(0), m_merge_pool(NULL),
+	  m_workers(1), m_cache_size(0), m_coordinator(NULL),
 	  m_description(m_owner->getPool(), keys)
 {
 /**************************************
@@ -293,6 +399,8 @@ Sort::~Sort()
 	}
 
 	delete[] m_merge_pool;
+
+	delete m_coordinator;
 }
 
 
@@ -665,6 +773,33 @@ void Sort::releaseBuffer()
 	}
 	else
 		delete[] m_memory;
+
+	releaseCache(m_cache_size);
+	m_cache_size = 0;
+}
+
+
+bool Sort::reserveCache(ULONG size)
+{
+	// Account memory of the parallel sort buffer against TempCacheLimit
+
+	MutexLockGuard guard(m_dbb->dbb_temp_cache_mutex, FB_FUNCTION);
+
+	if (m_dbb->dbb_temp_cache_size + size > m_dbb->dbb_config->getTempCacheLimit())
+		return false;
+
+	m_dbb->dbb_temp_cache_size += size;
+	return true;
+}
+
+
+void Sort::releaseCache(ULONG size)
+{
+	if (!size)
+		return;
+
+	MutexLockGuard guard(m_dbb->dbb_temp_cache_mutex, FB_FUNCTION);
+	m_dbb->dbb_temp_cache_size -= size;
 }
 
 
@@ -1394,13 +1529,27 @@ void Sort::init()
 	{
 		const ULONG mem_size = m_max_alloc_size * RUN_GROUP;
 
+		// If the buffer has been sorted in parallel, give every thread its
+		// own share of memory. The extra memory is counted as temp cache.
+
+		ULONG extra_size = 0;
+
+		if (m_workers > 1)
+		{
+			extra_size = mem_size * (m_workers - 1);
+
+			if (!reserveCache(extra_size))
+				extra_size = 0;
+		}
+
 		try
 		{
-			UCHAR* const mem = FB_NEW_POOL(m_owner->getPool()) UCHAR[mem_size];
+			UCHAR* const mem = FB_NEW_POOL(m_owner->getPool()) UCHAR[mem_size + extra_size];
 
 			releaseBuffer();
 
-			m_size_memory = mem_size;
+			m_size_memory = mem_size + extra_size;
+			m_cache_size = extra_size;
 			m_memory = mem;
 
 			m_end_memory = m_memory + m_size_memory;
@@ -1410,7 +1559,9 @@ void Sort::init()
 				run->run_depth--;
 		}
 		catch (const BadAlloc&)
-		{} // no-op
+		{
+			releaseCache(extra_size);
+		}
 	}
 
 	m_next_pointer = m_first_pointer;
@@ -2051,6 +2202,10 @@ void Sort::sortBuffer(thread_db* tdbb)
  * been requested, detect and handle them.
  *
  **************************************/
+	const Attachment* const attachment = tdbb->getAttachment();
+	const ULONG workers = (attachment && !attachment->isWorker() && attachment->att_parallel_workers > 1) ?
+		(ULONG) attachment->att_parallel_workers : 1;
+
 	EngineCheckout cout(tdbb, FB_FUNCTION);
 
 	// First, insert a pointer to the high key
@@ -2063,30 +2218,10 @@ void Sort::sortBuffer(thread_db* tdbb)
 	SORTP** j = (SORTP**) (m_first_pointer) + 1;
 	const ULONG n = (SORTP**) (m_next_pointer) - j;	// calculate # of records
 
-	quick(n, j, m_longs);
-
-	// Scream through and correct any out of order pairs
-	// hvlad: don't compare user keys against high_key
-	while (j < (SORTP**) m_next_pointer - 1)
-	{
-		SORTP** i = j;
-		j++;
-		if (**i >= **j)
-		{
-			const SORTP* p = *i;
-			const SORTP* q = *j;
-			ULONG tl = m_longs - 1;
-			while (tl && *p == *q)
-			{
-				p++;
-				q++;
-				tl--;
-			}
-			if (tl && *p > *q) {
-				swap(i, j);
-			}
-		}
-	}
+	if (workers > 1 && n >= MIN_PARALLEL_SORT_RECORDS * 2)
+		sortParallel(j, n, workers);
+	else
+		sortRange(j, n);
 
 	// If duplicate handling hasn't been requested, we're done
 
@@ -2134,6 +2269,276 @@ void Sort::sortBuffer(thread_db* tdbb)
 }
 
 
+void Sort::straighten(SLONG size, SORTP** pointers, ULONG length)
+{
+/**************************************
+ *
+ * Quicksort, by design, doesn't order partitions of length 2,
+ * so make a pass thru the data to straighten out pairs.
+ *
+ **************************************/
+	SORTP** j = pointers;
+	SORTP** const end = pointers + size - 1;
+
+	// hvlad: don't compare user keys against high_key
+	while (j < end)
+	{
+		SORTP** i = j;
+		j++;
+		if (**i >= **j && greater(*i, *j, length))
+			swap(i, j);
+	}
+}
+
+
+void Sort::sortParallel(SORTP** pointers, ULONG n, ULONG maxWorkers)
+{
+/**************************************
+ *
+ * Sort the buffer using multiple threads. Pick up a sample of keys
+ * to split the buffer into key ranges of (roughly) equal size,
+ * distribute record pointers between the ranges and then sort
+ * every range independently.
+ *
+ **************************************/
+	MemoryPool& pool = m_owner->getPool();
+
+	const ULONG workers = MIN(MIN(maxWorkers, n / MIN_PARALLEL_SORT_RECORDS), MAX_PARALLEL_SORT_THREADS);
+	m_workers = MAX(m_workers, workers);
+
+	const ULONG rangeCount = workers * PARALLEL_SORT_RANGES;
+
+	// Pick up the sample and sort it using the insertion sort, it's small enough
+
+	const ULONG sampleCount = rangeCount * PARALLEL_SORT_SAMPLES;
+	HalfStaticArray<SORTP*, 1024> samples(pool);
+	SORTP** const sample = samples.getBuffer(sampleCount);
+
+	for (ULONG i = 0; i < sampleCount; i++)
+	{
+		SORTP* const key = pointers[(FB_UINT64) i * n / sampleCount];
+
+		ULONG k = i;
+		for (; k && greater(sample[k - 1], key, m_longs); k--)
+			sample[k] = sample[k - 1];
+
+		sample[k] = key;
+	}
+
+	// Every range contains keys greater than the previous splitter
+	// and not greater than its own splitter. Thus all keys of a range are
+	// not less than the last key of the previous range and not greater
+	// than the first key of the next range.
+
+	HalfStaticArray<SORTP*, 64> splitters(pool);
+	for (ULONG i = 1; i < rangeCount; i++)
+		splitters.add(sample[i * PARALLEL_SORT_SAMPLES - 1]);
+
+	Array<USHORT> ranges(pool);
+	USHORT* const range = ranges.getBuffer(n);
+
+	HalfStaticArray<ULONG, 64> counts(pool);
+	counts.grow(rangeCount);
+
+	for (ULONG i = 0; i < n; i++)
+	{
+		const SORTP* const key = pointers[i];
+
+		// Binary search for the first splitter not less than the key
+
+		ULONG lo = 0, hi = rangeCount - 1;
+		while (lo < hi)
+		{
+			const ULONG mid = (lo + hi) / 2;
+
+			if (greater(key, splitters[mid], m_longs))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		range[i] = (USHORT) lo;
+		counts[lo]++;
+	}
+
+	// Distribute the pointers between ranges. Ranges are sorted apart
+	// from the buffer, each one between its own guard records, so the
+	// threads never read pointers being moved by another thread.
+
+	HalfStaticArray<ULONG, 64> offsets(pool);
+	offsets.grow(rangeCount);
+
+	for (ULONG i = 1; i < rangeCount; i++)
+		offsets[i] = offsets[i - 1] + counts[i - 1] + 2;
+
+	Array<SORTP*> guardedRanges(pool);
+	SORTP** const guarded = guardedRanges.getBuffer(n + rangeCount * 2);
+
+	for (ULONG i = 0; i < rangeCount; i++)
+	{
+		guarded[offsets[i]++] = reinterpret_cast<SORTP*>(low_key);
+		guarded[offsets[i] + counts[i]] = reinterpret_cast<SORTP*>(high_key);
+	}
+
+	for (ULONG i = 0; i < n; i++)
+	{
+		SORTP** const slot = guarded + offsets[range[i]]++;
+		*slot = pointers[i];
+		((SORTP***) (*slot))[BACK_OFFSET] = slot;
+	}
+
+	// Sort the ranges in parallel
+
+	SortRangesTask task(pool, this, workers);
+
+	for (ULONG i = 0, offset = 1; i < rangeCount; offset += counts[i++] + 2)
+	{
+		if (counts[i] > 1)
+			task.addRange(pool, guarded + offset, counts[i]);
+	}
+
+	if (!m_coordinator)
+		m_coordinator = FB_NEW_POOL(pool) Coordinator(&pool);
+
+	m_coordinator->runSync(&task);
+
+	// And put them back into the buffer
+
+	SORTP** slot = pointers;
+
+	for (ULONG i = 0, offset = 1; i < rangeCount; offset += counts[i++] + 2)
+	{
+		for (SORTP** ptr = guarded + offset; ptr < guarded + offset + counts[i]; ptr++, slot++)
+		{
+			*slot = *ptr;
+			((SORTP***) (*slot))[BACK_OFFSET] = slot;
+		}
+	}
+
+	fb_assert(slot == pointers + n);
+}
+
+
+void Sort::sortRange(SORTP** pointers, ULONG n)
+{
+/**************************************
+ *
+ * Sort a part of the buffer (or the whole one). Short keys
+ * are sorted by radix, the others by the good old quick sort.
+ *
+ **************************************/
+	if (n >= MIN_RADIX_SORT_RECORDS && m_key_length <= MAX_RADIX_KEY_LONGS &&
+		radix(n, pointers, m_key_length, m_owner->getPool()))
+	{
+		return;
+	}
+
+	quick(n, pointers, m_longs);
+
+	// Scream through and correct any out of order pairs
+	straighten(n, pointers, m_longs);
+}
+
+
+bool Sort::radix(ULONG size, SORTP** pointers, ULONG length, MemoryPool& pool)
+{
+/**************************************
+ *
+ * Sort an array of record pointers by the first "length" longwords
+ * of their keys using the LSD radix sort, one key byte per pass.
+ * Unlike quick sort, records with equal keys are not ordered by
+ * the rest of record, it's not needed as runs are merged by keys only.
+ *
+ * Returns false (and leaves the array untouched) if the keys have
+ * too many distinct digits for the radix sort to be profitable.
+ *
+ **************************************/
+	const ULONG digits = length * sizeof(ULONG);
+
+	// Count all the digits in a single pass. Digit 0 is the least
+	// significant byte of the last key longword.
+
+	Array<ULONG> histograms(pool);
+	ULONG* const counts = histograms.getBuffer(digits * RADIX_SIZE);
+	memset(counts, 0, digits * RADIX_SIZE * sizeof(ULONG));
+
+	for (ULONG i = 0; i < size; i++)
+	{
+		const SORTP* const key = pointers[i];
+		ULONG* count = counts;
+
+		for (ULONG w = length; w--; )
+		{
+			const ULONG value = key[w];
+
+			for (ULONG shift = 0; shift < 32; shift += 8, count += RADIX_SIZE)
+				count[(value >> shift) & 0xFF]++;
+		}
+	}
+
+	// Skip the digits which are the same for all the records
+
+	UCHAR passes[MAX_RADIX_PASSES];
+	ULONG passCount = 0;
+
+	const SORTP* const first = pointers[0];
+	for (ULONG d = 0; d < digits; d++)
+	{
+		const ULONG value = first[length - 1 - d / sizeof(ULONG)];
+		const ULONG digit = (value >> (d % sizeof(ULONG) * 8)) & 0xFF;
+
+		if (counts[d * RADIX_SIZE + digit] == size)
+			continue;
+
+		if (passCount == MAX_RADIX_PASSES)
+			return false;
+
+		passes[passCount++] = (UCHAR) d;
+	}
+
+	Array<SORTP*> buffer(pool);
+	SORTP** from = pointers;
+	SORTP** to = passCount ? buffer.getBuffer(size) : NULL;
+
+	for (ULONG pass = 0; pass < passCount; pass++)
+	{
+		const ULONG d = passes[pass];
+		const ULONG word = length - 1 - d / sizeof(ULONG);
+		const ULONG shift = d % sizeof(ULONG) * 8;
+
+		// Convert counts into the starting offsets of the buckets
+
+		ULONG* const offsets = counts + d * RADIX_SIZE;
+		for (ULONG i = 0, offset = 0; i < RADIX_SIZE; i++)
+		{
+			const ULONG count = offsets[i];
+			offsets[i] = offset;
+			offset += count;
+		}
+
+		for (ULONG i = 0; i < size; i++)
+		{
+			SORTP* const key = from[i];
+			to[offsets[(key[word] >> shift) & 0xFF]++] = key;
+		}
+
+		SORTP** const temp = from;
+		from = to;
+		to = temp;
+	}
+
+	if (from != pointers)
+		memcpy(pointers, from, size * sizeof(SORTP*));
+
+	// Records were moved, fix their back pointers
+
+	for (ULONG i = 0; i < size; i++)
+		((SORTP***) (pointers[i]))[BACK_OFFSET] = pointers + i;
+
+	return true;
+}
+
+
 void Sort::sortRunsBySeek(int n)
 {
 /**************************************
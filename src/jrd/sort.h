@@ -29,6 +29,12 @@
 #include "../jrd/TempSpace.h"
 #include "../jrd/align.h"
 
+namespace Firebird {
+
+class Coordinator;
+
+} // namespace Firebird
+
 namespace Jrd {
 
 // Forward declaration
@@ -276,6 +282,7 @@ const int scb_reuse_buffer	= 2;	// reuse buffer if possible
 class Sort
 {
 	friend class PartitionedSort;
+	class SortRangesTask;
 public:
 	Sort(Database*, SortOwner*,
 		 ULONG, FB_SIZE_T, FB_SIZE_T, const sort_key_def*,
@@ -308,6 +315,8 @@ public:
 private:
 	void allocateBuffer(MemoryPool&);
 	void releaseBuffer();
+	bool reserveCache(ULONG);
+	void releaseCache(ULONG);
 
 	void diddleKey(UCHAR*, bool, bool);
 	sort_record* getMerge(merge_control*);
@@ -319,6 +328,8 @@ private:
 	void orderAndSave(Jrd::thread_db*);
 	void putRun(Jrd::thread_db*);
 	void sortBuffer(Jrd::thread_db*);
+	void sortParallel(SORTP**, ULONG, ULONG);
+	void sortRange(SORTP**, ULONG);
 	void sortRunsBySeek(int);
 
 #ifdef DEV_BUILD
@@ -326,6 +337,8 @@ private:
 #endif
 
 	static void quick(SLONG, SORTP**, ULONG);
+	static bool radix(ULONG, SORTP**, ULONG, MemoryPool&);
+	static void straighten(SLONG, SORTP**, ULONG);
 
 	Database* m_dbb;							// Database
 	SortOwner* m_owner;							// Sort owner
@@ -352,6 +365,10 @@ private:
 	ULONG m_min_alloc_size;						// MIN and MAX values
 	ULONG m_max_alloc_size;						// for the run buffer size
 
+	ULONG m_workers;							// Max number of threads the buffer was sorted by
+	ULONG m_cache_size;							// Part of the buffer counted against TempCacheLimit
+	Firebird::Coordinator* m_coordinator;		// ALLOC: Parallel sort threads
+
 	Firebird::Array<sort_key_def> m_description;
 };
 
@@ -2704,6 +2704,15 @@ bool Service::process_switches(ClumpletReader& spb, string& switches)
 				keepHistory = true;
 				break;
 
+			case isc_spb_nbk_compress:
+			case isc_spb_nbk_parallel_workers:
+				if (!get_action_svc_parameter(spb.getClumpTag(), nbackup_action_in_sw_table, switches))
+				{
+					return false;
+				}
+				get_action_svc_data(spb, switches, false);
+				break;
+
 			default:
 				return false;
 			}
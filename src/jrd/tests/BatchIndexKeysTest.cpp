@@ -0,0 +1,165 @@
+#include "firebird.h"
+#include "boost/test/unit_test.hpp"
+#include "../jrd/jrd.h"
+#include "../jrd/btr.h"
+#include <string>
+
+using namespace Firebird;
+using namespace Jrd;
+
+BOOST_AUTO_TEST_SUITE(EngineSuite)
+BOOST_AUTO_TEST_SUITE(BatchIndexKeysSuite)
+
+
+namespace
+{
+	void addKey(BatchIndexKeys& keys, USHORT idxId, const std::string& value, SINT64 number)
+	{
+		index_desc idx;
+		idx.idx_id = idxId;
+
+		temporary_key key;
+		key.key_length = (USHORT) value.length();
+		memcpy(key.key_data, value.data(), value.length());
+		key.key_flags = 0;
+		key.key_nulls = 0;
+
+		keys.add(&idx, RecordNumber(number), &key);
+	}
+
+	std::string keyValue(const BatchIndexKeys::Entry& entry)
+	{
+		return std::string((const char*) entry.data, entry.length);
+	}
+}
+
+
+BOOST_AUTO_TEST_SUITE(BatchIndexKeysTests)
+
+BOOST_AUTO_TEST_CASE(SortOrderTest)
+{
+	BatchIndexKeys keys(*getDefaultMemoryPool(), nullptr);
+
+	addKey(keys, 2, "a", 1);
+	addKey(keys, 1, "b", 2);
+	addKey(keys, 1, "ab", 3);
+	addKey(keys, 1, "a", 5);
+	addKey(keys, 1, "a", 4);
+	addKey(keys, 1, "", 6);
+	addKey(keys, 0, "z", 7);
+
+	keys.sort();
+
+	// Index first, then key with the shorter one before its extension,
+	// then record number
+
+	const struct
+	{
+		USHORT idxId;
+		const char* value;
+		SINT64 number;
+	} expected[] = {
+		{0, "z", 7},
+		{1, "", 6},
+		{1, "a", 4},
+		{1, "a", 5},
+		{1, "ab", 3},
+		{1, "b", 2},
+		{2, "a", 1}
+	};
+
+	const auto& entries = keys.getEntries();
+	BOOST_TEST_REQUIRE(entries.getCount() == (FB_SIZE_T) FB_NELEM(expected));
+
+	for (FB_SIZE_T i = 0; i < entries.getCount(); i++)
+	{
+		BOOST_TEST(entries[i].idxId == expected[i].idxId);
+		BOOST_TEST(keyValue(entries[i]) == expected[i].value);
+		BOOST_TEST(entries[i].number == expected[i].number);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(RollbackTest)
+{
+	BatchIndexKeys keys(*getDefaultMemoryPool(), nullptr);
+
+	addKey(keys, 1, "c", 1);
+	addKey(keys, 1, "a", 2);
+
+	const auto mark = keys.mark();
+
+	addKey(keys, 1, "b", 3);
+	addKey(keys, 0, "d", 4);
+
+	keys.rollback(mark);
+
+	const auto restored = keys.mark();
+	BOOST_TEST(restored.entries == mark.entries);
+	BOOST_TEST(restored.chunks == mark.chunks);
+	BOOST_TEST(restored.chunkLength == mark.chunkLength);
+	BOOST_TEST(restored.length == mark.length);
+
+	// Keys added after the rollback reuse the chunk space
+	addKey(keys, 1, "bb", 5);
+
+	keys.sort();
+
+	const auto& entries = keys.getEntries();
+	BOOST_TEST_REQUIRE(entries.getCount() == 3u);
+	BOOST_TEST(keyValue(entries[0]) == "a");
+	BOOST_TEST(entries[0].number == 2);
+	BOOST_TEST(keyValue(entries[1]) == "bb");
+	BOOST_TEST(entries[1].number == 5);
+	BOOST_TEST(keyValue(entries[2]) == "c");
+	BOOST_TEST(entries[2].number == 1);
+}
+
+BOOST_AUTO_TEST_CASE(RollbackChunksTest)
+{
+	BatchIndexKeys keys(*getDefaultMemoryPool(), nullptr);
+
+	const std::string value(MAX_KEY, 'x');
+
+	addKey(keys, 1, "first", 0);
+	const auto mark = keys.mark();
+
+	// Keys added since the mark take a few chunks
+	SINT64 number = 0;
+	while (keys.mark().chunks < mark.chunks + 2)
+		addKey(keys, 1, value, ++number);
+
+	BOOST_TEST(keys.isFull() == false);
+
+	keys.rollback(mark);
+
+	BOOST_TEST(keys.mark().chunks == mark.chunks);
+	BOOST_TEST(keys.mark().chunkLength == mark.chunkLength);
+	BOOST_TEST(keys.mark().length == mark.length);
+
+	addKey(keys, 1, "second", 1);
+	keys.sort();
+
+	const auto& entries = keys.getEntries();
+	BOOST_TEST_REQUIRE(entries.getCount() == 2u);
+	BOOST_TEST(keyValue(entries[0]) == "first");
+	BOOST_TEST(keyValue(entries[1]) == "second");
+
+	// Rollback to the empty batch
+	keys.rollback(BatchIndexKeys::Mark());
+	BOOST_TEST(!keys.hasData());
+	BOOST_TEST(keys.mark().chunks == 0u);
+	BOOST_TEST(keys.mark().length == 0u);
+
+	addKey(keys, 1, "third", 1);
+	BOOST_TEST(keys.hasData());
+	BOOST_TEST(keyValue(keys.getEntries()[0]) == "third");
+
+	keys.clear();
+	BOOST_TEST(!keys.hasData());
+}
+
+BOOST_AUTO_TEST_SUITE_END()	// BatchIndexKeysTests
+
+
+BOOST_AUTO_TEST_SUITE_END()	// BatchIndexKeysSuite
+BOOST_AUTO_TEST_SUITE_END()	// EngineSuite
@@ -0,0 +1,166 @@
+#include "firebird.h"
+#include "boost/test/unit_test.hpp"
+#include "../jrd/jrd.h"
+#include "../jrd/Relation.h"
+
+using namespace Firebird;
+using namespace Jrd;
+
+BOOST_AUTO_TEST_SUITE(EngineSuite)
+BOOST_AUTO_TEST_SUITE(FreeSpaceMapSuite)
+
+
+namespace
+{
+	const ULONG PAGE_SIZE = 8192;
+
+	// Bucket of the page at the given slot, -1 if it's not there
+	int findBucket(const FreeSpaceMap& map, ULONG page, unsigned slot)
+	{
+		for (unsigned bucket = 0; bucket < FreeSpaceMap::BUCKETS; bucket++)
+		{
+			if (map.getPage(bucket, slot) == page)
+				return bucket;
+		}
+
+		return -1;
+	}
+}
+
+
+BOOST_AUTO_TEST_SUITE(FreeSpaceMapTests)
+
+BOOST_AUTO_TEST_CASE(GetBucketTest)
+{
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, 1) == 3);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 16) == 3);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 16 + 1) == 2);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 8) == 2);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 8 + 1) == 1);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 4) == 1);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 4 + 1) == 0);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 2) == 0);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE / 2 + 1) == -1);
+	BOOST_TEST(FreeSpaceMap::getBucket(PAGE_SIZE, PAGE_SIZE) == -1);
+}
+
+BOOST_AUTO_TEST_CASE(PutBucketBoundariesTest)
+{
+	FreeSpaceMap map;
+
+	const struct
+	{
+		ULONG space;
+		int bucket;
+	} tests[] = {
+		{PAGE_SIZE, 0},
+		{PAGE_SIZE / 2, 0},
+		{PAGE_SIZE / 2 - 1, 1},
+		{PAGE_SIZE / 4, 1},
+		{PAGE_SIZE / 4 - 1, 2},
+		{PAGE_SIZE / 8, 2},
+		{PAGE_SIZE / 8 - 1, 3},
+		{PAGE_SIZE / 16, 3},
+		{PAGE_SIZE / 16 - 1, -1},
+		{0, -1}
+	};
+
+	ULONG page = 100;
+
+	for (const auto& test : tests)
+	{
+		map.put(PAGE_SIZE, ++page, test.space, 0);
+		BOOST_TEST(findBucket(map, page, 0) == test.bucket);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(PutAndFindTest)
+{
+	FreeSpaceMap map;
+
+	// Page found in a bucket has room for the size asked for
+
+	for (ULONG space = 0; space <= PAGE_SIZE; space += 64)
+	{
+		map.clear();
+		map.put(PAGE_SIZE, 1, space, 0);
+
+		for (ULONG size = 1; size <= PAGE_SIZE; size += 63)
+		{
+			const int lastBucket = FreeSpaceMap::getBucket(PAGE_SIZE, size);
+
+			bool found = false;
+			for (int bucket = lastBucket; bucket >= 0; bucket--)
+				found |= (map.getPage(bucket, 0) == 1);
+
+			if (found)
+				BOOST_TEST(space >= size);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(MovePageTest)
+{
+	FreeSpaceMap map;
+
+	// Page is moved between buckets as its free space changes
+	map.put(PAGE_SIZE, 10, PAGE_SIZE / 2, 1);
+	BOOST_TEST(findBucket(map, 10, 1) == 0);
+
+	map.put(PAGE_SIZE, 10, PAGE_SIZE / 8, 1);
+	BOOST_TEST(findBucket(map, 10, 1) == 2);
+
+	// Putting the page into the same entry again keeps it there
+	map.put(PAGE_SIZE, 10, PAGE_SIZE / 8, 1);
+	BOOST_TEST(findBucket(map, 10, 1) == 2);
+
+	// ... and between slots
+	map.put(PAGE_SIZE, 10, PAGE_SIZE / 8, 2);
+	BOOST_TEST(findBucket(map, 10, 1) == -1);
+	BOOST_TEST(findBucket(map, 10, 2) == 2);
+
+	// Nearly full page is forgotten
+	map.put(PAGE_SIZE, 10, PAGE_SIZE / 16 - 1, 2);
+	BOOST_TEST(findBucket(map, 10, 2) == -1);
+}
+
+BOOST_AUTO_TEST_CASE(RemoveTest)
+{
+	FreeSpaceMap map;
+
+	for (unsigned slot = 0; slot < FreeSpaceMap::SLOTS; slot++)
+		map.put(PAGE_SIZE, slot + 1, PAGE_SIZE, slot);
+
+	map.remove(3);
+
+	for (unsigned slot = 0; slot < FreeSpaceMap::SLOTS; slot++)
+		BOOST_TEST(findBucket(map, slot + 1, slot) == (slot + 1 == 3 ? -1 : 0));
+
+	map.clear();
+
+	for (unsigned slot = 0; slot < FreeSpaceMap::SLOTS; slot++)
+	{
+		for (unsigned bucket = 0; bucket < FreeSpaceMap::BUCKETS; bucket++)
+			BOOST_TEST(map.getPage(bucket, slot) == 0u);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SlotWrapTest)
+{
+	FreeSpaceMap map;
+
+	// Slot numbers are taken modulo the number of slots
+	map.put(PAGE_SIZE, 5, PAGE_SIZE, FreeSpaceMap::SLOTS + 3);
+	BOOST_TEST(map.getPage(0, 3) == 5u);
+	BOOST_TEST(map.getPage(0, 2 * FreeSpaceMap::SLOTS + 3) == 5u);
+
+	map.put(PAGE_SIZE, 6, PAGE_SIZE, 3);
+	BOOST_TEST(map.getPage(0, FreeSpaceMap::SLOTS + 3) == 6u);
+	BOOST_TEST(findBucket(map, 5, 3) == -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()	// FreeSpaceMapTests
+
+
+BOOST_AUTO_TEST_SUITE_END()	// FreeSpaceMapSuite
+BOOST_AUTO_TEST_SUITE_END()	// EngineSuite
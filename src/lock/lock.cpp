@@ -143,6 +143,9 @@ const SLONG HASH_MIN_SLOTS	= 101;
 const SLONG HASH_MAX_SLOTS	= 65521;
 const USHORT HISTORY_BLOCKS	= 256;
 
+// Attempts to take a busy bucket latch before going the long way
+const ULONG LATCH_SPINS		= 100;
+
 const ULONG MAX_TABLE_LENGTH = SLONG_MAX;
 
 // SRQ_ABS_PTR uses this macro.
@@ -162,6 +165,40 @@ static const bool compatibility[LCK_max][LCK_max] =
 /* EX */	{true,	true,	false,	false,	false,	false,	false}
 };
 
+namespace
+{
+	// Holds a latch of the lock table up to the end of the scope
+
+	class LatchGuard
+	{
+	public:
+		// Adopts a latch already taken
+		explicit LatchGuard(lch* latch)
+			: m_latch(latch)
+		{}
+
+		// Takes a latch which is held for a short time by this process only
+		LatchGuard(lch* latch, int process)
+			: m_latch(latch)
+		{
+			while (!m_latch->tryLatch(process))
+				Thread::yield();
+		}
+
+		~LatchGuard()
+		{
+			m_latch->unlatch();
+		}
+
+	private:
+		// Forbid copying
+		LatchGuard(const LatchGuard&);
+		LatchGuard& operator=(const LatchGuard&);
+
+		lch* const m_latch;
+	};
+} // namespace
+
 
 namespace Jrd {
 
@@ -461,6 +498,17 @@ SRQ_PTR LockManager::enqueue(thread_db* tdbb,
 	if (!owner_offset)
 		return 0;
 
+	// Most requests are granted at once, try it without the lock table mutex
+
+	if (!prior_request && !data)
+	{
+		const SRQ_PTR request_offset =
+			fast_enqueue(series, value, length, type, ast_routine, ast_argument, owner_offset);
+
+		if (request_offset)
+			return request_offset;
+	}
+
 	LockTableGuard guard(this, FB_FUNCTION, owner_offset);
 
 	own* owner = (own*) SRQ_ABS_PTR(owner_offset);
@@ -480,23 +528,14 @@ SRQ_PTR LockManager::enqueue(thread_db* tdbb,
 
 	// Allocate or reuse a lock request block
 
-	lrq* request;
-
-	ASSERT_ACQUIRED;
-	if (SRQ_EMPTY(m_sharedMemory->getHeader()->lhb_free_requests))
+	lrq* request = get_free_request();
+	if (!request)
 	{
 		if (!(request = (lrq*) alloc(sizeof(lrq), statusVector)))
 			return 0;
 
 		owner = (own*) SRQ_ABS_PTR(owner_offset);
 	}
-	else
-	{
-		ASSERT_ACQUIRED;
-		request = (lrq*) ((UCHAR*) SRQ_NEXT(m_sharedMemory->getHeader()->lhb_free_requests) -
-						 offsetof(lrq, lrq_lbl_requests));
-		remove_que(&request->lrq_lbl_requests);
-	}
 
 	post_history(his_enq, owner_offset, (SRQ_PTR)0, SRQ_REL_PTR(request), true);
 
@@ -516,8 +555,8 @@ SRQ_PTR LockManager::enqueue(thread_db* tdbb,
 
 	// See if the lock already exists
 
-	USHORT hash_slot;
-	lbl* lock = find_lock(series, value, length, &hash_slot);
+	const USHORT hash_slot = get_hash_slot(value, length);
+	lbl* lock = find_lock(series, value, length, hash_slot);
 	if (lock)
 	{
 		if (series < LCK_MAX_SERIES)
@@ -604,6 +643,9 @@ bool LockManager::convert(thread_db* tdbb,
  **************************************/
 	LOCK_TRACE(("LM::convert (%d, %d)\n", type, lck_wait));
 
+	if (fast_convert(request_offset, type, ast_routine, ast_argument))
+		return true;
+
 	LockTableGuard guard(this, FB_FUNCTION, DUMMY_OWNER);
 
 	lrq* const request = get_request(request_offset);
@@ -647,6 +689,10 @@ UCHAR LockManager::downgrade(thread_db* tdbb,
  **************************************/
 	LOCK_TRACE(("LM::downgrade (%ld)\n", request_offset));
 
+	UCHAR state;
+	if (fast_downgrade(request_offset, &state))
+		return state;
+
 	LockTableGuard guard(this, FB_FUNCTION, DUMMY_OWNER);
 
 	lrq* const request = get_request(request_offset);
@@ -677,7 +723,7 @@ UCHAR LockManager::downgrade(thread_db* tdbb,
 		}
 	}
 
-	UCHAR state = request->lrq_state;
+	state = request->lrq_state;
 	while (state > LCK_none && !compatibility[pending_state][state])
 		--state;
 
@@ -710,6 +756,9 @@ bool LockManager::dequeue(const SRQ_PTR request_offset)
  **************************************/
 	LOCK_TRACE(("LM::dequeue (%ld)\n", request_offset));
 
+	if (fast_dequeue(request_offset))
+		return true;
+
 	LockTableGuard guard(this, FB_FUNCTION, DUMMY_OWNER);
 
 	lrq* const request = get_request(request_offset);
@@ -756,23 +805,14 @@ void LockManager::repost(thread_db* tdbb, lock_ast_t ast, void* arg, SRQ_PTR own
 
 	// Allocate or reuse a lock request block
 
-	lrq* request;
-
-	ASSERT_ACQUIRED;
-	if (SRQ_EMPTY(m_sharedMemory->getHeader()->lhb_free_requests))
+	lrq* request = get_free_request();
+	if (!request)
 	{
 		if (!(request = (lrq*) alloc(sizeof(lrq), NULL)))
 		{
 			return;
 		}
 	}
-	else
-	{
-		ASSERT_ACQUIRED;
-		request = (lrq*) ((UCHAR*) SRQ_NEXT(m_sharedMemory->getHeader()->lhb_free_requests) -
-						 offsetof(lrq, lrq_lbl_requests));
-		remove_que(&request->lrq_lbl_requests);
-	}
 
 	request->lrq_type = type_lrq;
 	request->lrq_flags = LRQ_repost;
@@ -983,8 +1023,7 @@ LOCK_DATA_T LockManager::readData2(USHORT series,
 	else
 		++(m_sharedMemory->getHeader()->lhb_operations[0]);
 
-	USHORT junk;
-	const lbl* const lock = find_lock(series, value, length, &junk);
+	const lbl* const lock = find_lock(series, value, length, get_hash_slot(value, length));
 
 	return lock ? lock->lbl_data : 0;
 }
@@ -1152,24 +1191,62 @@ void LockManager::acquire_shmem(SRQ_PTR owner_offset)
 	if (prior_active > 0)
 	{
 		post_history(his_active, owner_offset, prior_active, (SRQ_PTR) 0, false);
-		shb* const recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
-		if (recover->shb_remove_node)
+		recover_que(NULL);
+	}
+
+	acquire_buckets();
+}
+
+
+void LockManager::acquire_buckets()
+{
+/**************************************
+ *
+ *	a c q u i r e _ b u c k e t s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Take the latches of all hash buckets, so the lock table
+ *	mutex owner is the only one changing the lock table.
+ *	A latch of a dead process is taken over after finishing
+ *	its queue operation.  Counters of the operations done
+ *	under the latches are moved to the lock header.
+ *
+ **************************************/
+	lhb* const header = m_sharedMemory->getHeader();
+	lbk* const buckets = (lbk*) SRQ_ABS_PTR(header->lhb_buckets);
+
+	for (lbk* bucket = buckets; bucket < buckets + LHB_BUCKETS; bucket++)
+	{
+		lch* const latch = &bucket->lbk_latch;
+
+		for (ULONG spins = 0; !latch->tryLatch(PID); spins++)
 		{
-			// There was a remove_que operation in progress when the prior_owner died
-			DEBUG_MSG(0, ("Got to the funky shb_remove_node code\n"));
-			remove_que((SRQ) SRQ_ABS_PTR(recover->shb_remove_node));
+			if (spins < LATCH_SPINS)
+				continue;
+
+			int holder = latch->lch_process.load(std::memory_order_relaxed);
+			if (holder && holder != PID && !ISC_check_process_existence(holder) &&
+				latch->lch_process.compare_exchange_strong(holder, PID, std::memory_order_acquire))
+			{
+				recover_que(latch);
+				break;
+			}
+
+			Thread::yield();
 		}
-		else if (recover->shb_insert_que && recover->shb_insert_prior)
-		{
-			// There was a insert_que operation in progress when the prior_owner died
-			DEBUG_MSG(0, ("Got to the funky shb_insert_que code\n"));
 
-			SRQ lock_srq = (SRQ) SRQ_ABS_PTR(recover->shb_insert_que);
-			lock_srq->srq_backward = recover->shb_insert_prior;
-			lock_srq = (SRQ) SRQ_ABS_PTR(recover->shb_insert_prior);
-			lock_srq->srq_forward = recover->shb_insert_que;
-			recover->shb_insert_que = 0;
-			recover->shb_insert_prior = 0;
+		header->lhb_enqs += bucket->lbk_enqs;
+		header->lhb_converts += bucket->lbk_converts;
+		header->lhb_downgrades += bucket->lbk_downgrades;
+		header->lhb_deqs += bucket->lbk_deqs;
+		bucket->lbk_enqs = bucket->lbk_converts = bucket->lbk_downgrades = bucket->lbk_deqs = 0;
+
+		for (int i = 0; i < LCK_MAX_SERIES; i++)
+		{
+			header->lhb_operations[i] += bucket->lbk_operations[i];
+			bucket->lbk_operations[i] = 0;
 		}
 	}
 }
@@ -1307,20 +1384,32 @@ lbl* LockManager::alloc_lock(USHORT length, CheckStatusWrapper* statusVector)
 	length = FB_ALIGN(length, 8);
 
 	ASSERT_ACQUIRED;
-	srq* lock_srq;
-	SRQ_LOOP(m_sharedMemory->getHeader()->lhb_free_locks, lock_srq)
+	lhb* const header = m_sharedMemory->getHeader();
+
+	// Look at the locks released under the lock table mutex first,
+	// then at the ones released under the bucket latches
+
+	lbk* bucket = (lbk*) SRQ_ABS_PTR(header->lhb_buckets);
+	const lbk* const end = bucket + LHB_BUCKETS;
+
+	for (srq* free_locks = &header->lhb_free_locks; free_locks;
+		 free_locks = (bucket < end) ? &(bucket++)->lbk_free_locks : NULL)
 	{
-		lbl* lock = (lbl*) ((UCHAR*) lock_srq - offsetof(lbl, lbl_lhb_hash));
-		// Here we use the "first fit" approach which costs us some memory,
-		// but works fast. The "best fit" one is proven to be unacceptably slow.
-		// Maybe there could be some compromise, e.g. limiting the number of "best fit"
-		// iterations before defaulting to a "first fit" match. Another idea could be
-		// to introduce yet another hash table for the free locks queue.
-		if (lock->lbl_size >= length)
-		{
-			remove_que(&lock->lbl_lhb_hash);
-			lock->lbl_type = type_lbl;
-			return lock;
+		srq* lock_srq;
+		SRQ_LOOP((*free_locks), lock_srq)
+		{
+			lbl* lock = (lbl*) ((UCHAR*) lock_srq - offsetof(lbl, lbl_lhb_hash));
+			// Here we use the "first fit" approach which costs us some memory,
+			// but works fast. The "best fit" one is proven to be unacceptably slow.
+			// Maybe there could be some compromise, e.g. limiting the number of "best fit"
+			// iterations before defaulting to a "first fit" match. Another idea could be
+			// to introduce yet another hash table for the free locks queue.
+			if (lock->lbl_size >= length)
+			{
+				remove_que(&lock->lbl_lhb_hash);
+				lock->lbl_type = type_lbl;
+				return lock;
+			}
 		}
 	}
 
@@ -2045,10 +2134,304 @@ void LockManager::debug_delay(ULONG lineno)
 }
 #endif
 
+SRQ_PTR LockManager::fast_enqueue(USHORT series,
+								  const UCHAR* value,
+								  USHORT length,
+								  UCHAR type,
+								  lock_ast_t ast_routine,
+								  void* ast_argument,
+								  SRQ_PTR owner_offset)
+{
+/**************************************
+ *
+ *	f a s t _ e n q u e u e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Enqueue on a lock holding just the latch of its hash bucket.
+ *	This is possible if the request is granted at once and
+ *	the bucket has spare blocks for it.  Otherwise return zero
+ *	and let the caller do the job under the lock table mutex.
+ *
+ **************************************/
+	ReadLockGuard remapGuard(m_remapSync, FB_FUNCTION);
+
+	const USHORT hash_slot = get_hash_slot(value, length);
+	lbk* const bucket = latch_bucket(hash_slot);
+	if (!bucket)
+		return 0;
+
+	LatchGuard bucketGuard(&bucket->lbk_latch);
+
+	own* const owner = (own*) SRQ_ABS_PTR(owner_offset);
+	if (!owner->own_count)
+		return 0;
+
+	// Requests of others can't be blocked or waken up here, see grant_or_que()
+
+	lbl* lock = find_lock(series, value, length, hash_slot);
+	if (lock && (lock->lbl_pending_lrq_count || !compatibility[type][lock->lbl_state]))
+		return 0;
+
+	if (SRQ_EMPTY(bucket->lbk_free_requests))
+		return 0;
+
+	if (!lock)
+	{
+		const USHORT size = FB_ALIGN(length, 8);
+
+		srq* lock_srq;
+		SRQ_LOOP(bucket->lbk_free_locks, lock_srq)
+		{
+			lbl* const free_lock = (lbl*) ((UCHAR*) lock_srq - offsetof(lbl, lbl_lhb_hash));
+			if (free_lock->lbl_size >= size)
+			{
+				lock = free_lock;
+				break;
+			}
+		}
+
+		if (!lock)
+			return 0;
+
+		remove_que(&lock->lbl_lhb_hash, &bucket->lbk_latch);
+
+		lock->lbl_type = type_lbl;
+		lock->lbl_state = type;
+		fb_assert(series <= MAX_UCHAR);
+		lock->lbl_series = (UCHAR) series;
+		SRQ_INIT(lock->lbl_lhb_data);
+		lock->lbl_data = 0;
+		lock->lbl_flags = 0;
+		lock->lbl_pending_lrq_count = 0;
+		memset(lock->lbl_counts, 0, sizeof(lock->lbl_counts));
+		lock->lbl_length = length;
+		memcpy(lock->lbl_key, value, length);
+		SRQ_INIT(lock->lbl_requests);
+
+		insert_tail(&m_sharedMemory->getHeader()->lhb_hash[hash_slot], &lock->lbl_lhb_hash,
+			&bucket->lbk_latch);
+	}
+
+	lrq* const request = (lrq*) ((UCHAR*) SRQ_NEXT(bucket->lbk_free_requests) -
+		offsetof(lrq, lrq_lbl_requests));
+	remove_que(&request->lrq_lbl_requests, &bucket->lbk_latch);
+
+	request->lrq_type = type_lrq;
+	request->lrq_flags = 0;
+	request->lrq_requested = type;
+	request->lrq_state = LCK_none;
+	request->lrq_data = 0;
+	request->lrq_owner = owner_offset;
+	request->lrq_lock = SRQ_REL_PTR(lock);
+	request->lrq_ast_routine = ast_routine;
+	request->lrq_ast_argument = ast_argument;
+	SRQ_INIT(request->lrq_own_blocks);
+	SRQ_INIT(request->lrq_own_pending);
+
+	{ // owner latch scope
+		LatchGuard ownerGuard(&owner->own_latch, PID);
+		insert_tail(&owner->own_requests, &request->lrq_own_requests, &owner->own_latch);
+	}
+
+	insert_tail(&lock->lbl_requests, &request->lrq_lbl_requests, &bucket->lbk_latch);
+
+	++lock->lbl_counts[type];
+	request->lrq_state = type;
+	lock->lbl_state = lock_state(lock);
+
+	++bucket->lbk_enqs;
+	++bucket->lbk_operations[series < LCK_MAX_SERIES ? series : 0];
+
+	return SRQ_REL_PTR(request);
+}
+
+
+bool LockManager::fast_convert(SRQ_PTR request_offset,
+							   UCHAR type,
+							   lock_ast_t ast_routine,
+							   void* ast_argument)
+{
+/**************************************
+ *
+ *	f a s t _ c o n v e r t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Convert a lock holding just the latch of its hash bucket.
+ *	This is possible if the conversion is compatible with
+ *	other granted requests and nobody waits for the lock.
+ *
+ **************************************/
+	ReadLockGuard remapGuard(m_remapSync, FB_FUNCTION);
+
+	lbk* const bucket = latch_request(request_offset);
+	if (!bucket)
+		return false;
+
+	LatchGuard bucketGuard(&bucket->lbk_latch);
+
+	lrq* const request = (lrq*) SRQ_ABS_PTR(request_offset);
+	lbl* const lock = (lbl*) SRQ_ABS_PTR(request->lrq_lock);
+
+	// Compute the state of the lock without the request, see internal_convert()
+
+	--lock->lbl_counts[request->lrq_state];
+
+	if (!compatibility[type][lock_state(lock)])
+	{
+		++lock->lbl_counts[request->lrq_state];
+		return false;
+	}
+
+	request->lrq_requested = type;
+	request->lrq_flags &= ~LRQ_blocking_seen;
+	request->lrq_ast_routine = ast_routine;
+	request->lrq_ast_argument = ast_argument;
+
+	++lock->lbl_counts[type];
+	request->lrq_state = type;
+	lock->lbl_state = lock_state(lock);
+
+	++bucket->lbk_converts;
+	++bucket->lbk_operations[lock->lbl_series < LCK_MAX_SERIES ? lock->lbl_series : 0];
+
+	return true;
+}
+
+
+bool LockManager::fast_downgrade(SRQ_PTR request_offset, UCHAR* state)
+{
+/**************************************
+ *
+ *	f a s t _ d o w n g r a d e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Downgrade a lock holding just the latch of its hash bucket.
+ *	Nobody waits for the lock, so the request keeps its state,
+ *	unless it's already less than shared read.
+ *
+ **************************************/
+	ReadLockGuard remapGuard(m_remapSync, FB_FUNCTION);
+
+	lbk* const bucket = latch_request(request_offset);
+	if (!bucket)
+		return false;
+
+	LatchGuard bucketGuard(&bucket->lbk_latch);
+
+	lrq* const request = (lrq*) SRQ_ABS_PTR(request_offset);
+	lbl* const lock = (lbl*) SRQ_ABS_PTR(request->lrq_lock);
+
+	if (request->lrq_state > LCK_null)
+	{
+		request->lrq_requested = request->lrq_state;
+		request->lrq_flags &= ~LRQ_blocking_seen;
+		*state = request->lrq_state;
+	}
+	else
+	{
+		if (!fast_release(bucket, request, lock))
+			return false;
+
+		*state = LCK_none;
+	}
+
+	++bucket->lbk_downgrades;
+
+	return true;
+}
+
+
+bool LockManager::fast_dequeue(SRQ_PTR request_offset)
+{
+/**************************************
+ *
+ *	f a s t _ d e q u e u e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Release a lock holding just the latch of its hash bucket.
+ *	This is possible if nobody waits for the lock.
+ *
+ **************************************/
+	ReadLockGuard remapGuard(m_remapSync, FB_FUNCTION);
+
+	lbk* const bucket = latch_request(request_offset);
+	if (!bucket)
+		return false;
+
+	LatchGuard bucketGuard(&bucket->lbk_latch);
+
+	lrq* const request = (lrq*) SRQ_ABS_PTR(request_offset);
+	lbl* const lock = (lbl*) SRQ_ABS_PTR(request->lrq_lock);
+	const UCHAR series = lock->lbl_series;
+
+	if (!fast_release(bucket, request, lock))
+		return false;
+
+	++bucket->lbk_deqs;
+	++bucket->lbk_operations[series < LCK_MAX_SERIES ? series : 0];
+
+	return true;
+}
+
+
+bool LockManager::fast_release(lbk* bucket, lrq* request, lbl* lock)
+{
+/**************************************
+ *
+ *	f a s t _ r e l e a s e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Release a granted request holding the latch of
+ *	its hash bucket, see release_request().  Requests
+ *	posted as blocking and locks in the series data
+ *	queue are left for the lock table mutex owner.
+ *
+ **************************************/
+	if ((request->lrq_flags & LRQ_blocking) || !SRQ_EMPTY(lock->lbl_lhb_data))
+		return false;
+
+	remove_que(&request->lrq_lbl_requests, &bucket->lbk_latch);
+
+	{ // owner latch scope
+		own* const owner = (own*) SRQ_ABS_PTR(request->lrq_owner);
+		LatchGuard ownerGuard(&owner->own_latch, PID);
+		remove_que(&request->lrq_own_requests, &owner->own_latch);
+	}
+
+	request->lrq_type = type_null;
+	request->lrq_ast_routine = NULL;
+	request->lrq_flags &= ~(LRQ_blocking_seen | LRQ_just_granted);
+	insert_tail(&bucket->lbk_free_requests, &request->lrq_lbl_requests, &bucket->lbk_latch);
+
+	if (SRQ_EMPTY(lock->lbl_requests))
+	{
+		remove_que(&lock->lbl_lhb_hash, &bucket->lbk_latch);
+		lock->lbl_type = type_null;
+		insert_tail(&bucket->lbk_free_locks, &lock->lbl_lhb_hash, &bucket->lbk_latch);
+		return true;
+	}
+
+	if (request->lrq_state != LCK_none && !(--lock->lbl_counts[request->lrq_state]))
+		lock->lbl_state = lock_state(lock);
+
+	return true;
+}
+
+
 lbl* LockManager::find_lock(USHORT series,
 							const UCHAR* value,
 							USHORT length,
-							USHORT* slot)
+							USHORT hash_slot)
 {
 /**************************************
  *
@@ -2058,18 +2441,12 @@ lbl* LockManager::find_lock(USHORT series,
  *
  * Functional description
  *	Find a lock block given a resource
- *	name. If it doesn't exist, the hash
- *	slot will be useful for enqueing a
- *	lock.
+ *	name and its hash slot.
  *
  **************************************/
 
 	// See if the lock already exists
 
-	const USHORT hash_slot = *slot =
-		(USHORT) InternalHash::hash(length, value, m_sharedMemory->getHeader()->lhb_hash_slots);
-
-	ASSERT_ACQUIRED;
 	srq* const hash_header = &m_sharedMemory->getHeader()->lhb_hash[hash_slot];
 
 	for (srq* lock_srq = (SRQ) SRQ_ABS_PTR(hash_header->srq_forward);
@@ -2089,6 +2466,75 @@ lbl* LockManager::find_lock(USHORT series,
 }
 
 
+lbk* LockManager::get_bucket(USHORT hash_slot)
+{
+/**************************************
+ *
+ *	g e t _ b u c k e t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Locate the bucket of a hash slot.
+ *
+ **************************************/
+	lbk* const buckets = (lbk*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_buckets);
+	return buckets + hash_slot % LHB_BUCKETS;
+}
+
+
+lrq* LockManager::get_free_request()
+{
+/**************************************
+ *
+ *	g e t _ f r e e _ r e q u e s t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Reuse a free request block, either released under
+ *	the lock table mutex or under a bucket latch.
+ *	Return NULL if there are none.
+ *
+ **************************************/
+	ASSERT_ACQUIRED;
+	lhb* const header = m_sharedMemory->getHeader();
+	srq* free_requests = &header->lhb_free_requests;
+
+	lbk* bucket = (lbk*) SRQ_ABS_PTR(header->lhb_buckets);
+	const lbk* const end = bucket + LHB_BUCKETS;
+
+	while (SRQ_EMPTY((*free_requests)))
+	{
+		if (bucket == end)
+			return NULL;
+
+		free_requests = &(bucket++)->lbk_free_requests;
+	}
+
+	lrq* const request = (lrq*) ((UCHAR*) SRQ_NEXT((*free_requests)) - offsetof(lrq, lrq_lbl_requests));
+	remove_que(&request->lrq_lbl_requests);
+
+	return request;
+}
+
+
+USHORT LockManager::get_hash_slot(const UCHAR* value, USHORT length)
+{
+/**************************************
+ *
+ *	g e t _ h a s h _ s l o t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Compute the hash slot of a resource name.
+ *
+ **************************************/
+	return (USHORT) InternalHash::hash(length, value, m_sharedMemory->getHeader()->lhb_hash_slots);
+}
+
+
 lrq* LockManager::get_request(SRQ_PTR offset)
 {
 /**************************************
@@ -2249,6 +2695,7 @@ bool LockManager::init_owner_block(CheckStatusWrapper* statusVector, own* owner,
 	owner->own_acquire_time = 0;
 	owner->own_waits = 0;
 	owner->own_ast_count = 0;
+	owner->own_latch.init();
 
 	if (m_sharedMemory->eventInit(&owner->own_wakeup) != FB_SUCCESS)
 	{
@@ -2347,6 +2794,25 @@ bool LockManager::initialize(SharedMemoryBase* sm, bool initializeMemory)
 	secondary_header->shb_insert_que = 0;
 	secondary_header->shb_insert_prior = 0;
 
+	// Allocate the latched buckets of hash slots
+
+	lbk* const buckets = (lbk*) alloc(LHB_BUCKETS * sizeof(lbk), NULL);
+	if (!buckets)
+	{
+		fb_utils::logAndDie("Fatal lock manager error: lock manager out of room");
+	}
+
+	hdr->lhb_buckets = SRQ_REL_PTR(buckets);
+
+	for (lbk* bucket = buckets; bucket < buckets + LHB_BUCKETS; bucket++)
+	{
+		bucket->lbk_latch.init();
+		SRQ_INIT(bucket->lbk_free_locks);
+		SRQ_INIT(bucket->lbk_free_requests);
+		bucket->lbk_enqs = bucket->lbk_converts = bucket->lbk_downgrades = bucket->lbk_deqs = 0;
+		memset(bucket->lbk_operations, 0, sizeof(bucket->lbk_operations));
+	}
+
 	// Allocate a sufficiency of history blocks
 
 	his* history = NULL;
@@ -2410,7 +2876,7 @@ void LockManager::insert_data_que(lbl* lock)
 }
 
 
-void LockManager::insert_tail(SRQ lock_srq, SRQ node)
+void LockManager::insert_tail(SRQ lock_srq, SRQ node, lch* latch)
 {
 /**************************************
  *
@@ -2429,14 +2895,29 @@ void LockManager::insert_tail(SRQ lock_srq, SRQ node)
  *	will notice the uncompleted work and undo it,
  *	eg: it will put the queue back to the state
  *	prior to the insertion being started.
+ *	A queue changed under a latch is recorded in the latch.
  *
  **************************************/
-	ASSERT_ACQUIRED;
-	shb* const recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
+	SRQ_PTR* insert_que;
+	SRQ_PTR* insert_prior;
+
+	if (latch)
+	{
+		insert_que = &latch->lch_insert_que;
+		insert_prior = &latch->lch_insert_prior;
+	}
+	else
+	{
+		ASSERT_ACQUIRED;
+		shb* const recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
+		insert_que = &recover->shb_insert_que;
+		insert_prior = &recover->shb_insert_prior;
+	}
+
 	DEBUG_DELAY;
-	recover->shb_insert_que = SRQ_REL_PTR(lock_srq);
+	*insert_que = SRQ_REL_PTR(lock_srq);
 	DEBUG_DELAY;
-	recover->shb_insert_prior = lock_srq->srq_backward;
+	*insert_prior = lock_srq->srq_backward;
 	DEBUG_DELAY;
 
 	node->srq_forward = SRQ_REL_PTR(lock_srq);
@@ -2451,9 +2932,9 @@ void LockManager::insert_tail(SRQ lock_srq, SRQ node)
 	lock_srq->srq_backward = SRQ_REL_PTR(node);
 	DEBUG_DELAY;
 
-	recover->shb_insert_que = 0;
+	*insert_que = 0;
 	DEBUG_DELAY;
-	recover->shb_insert_prior = 0;
+	*insert_prior = 0;
 	DEBUG_DELAY;
 }
 
@@ -2575,6 +3056,82 @@ void LockManager::internal_dequeue(SRQ_PTR request_offset)
 }
 
 
+lbk* LockManager::latch_bucket(USHORT hash_slot)
+{
+/**************************************
+ *
+ *	l a t c h _ b u c k e t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Take the latch of the bucket of a hash slot.  Give up
+ *	if the latch stays busy or the lock table was extended
+ *	and this process has not mapped it yet, the lock table
+ *	mutex owner takes care of both.
+ *
+ **************************************/
+#ifdef USE_SHMEM_EXT
+	// Extents are mapped under the lock table mutex only
+	return NULL;
+#else
+	lbk* const bucket = get_bucket(hash_slot);
+
+	for (ULONG spins = 0; !bucket->lbk_latch.tryLatch(PID); spins++)
+	{
+		if (spins >= LATCH_SPINS)
+			return NULL;
+	}
+
+	if (m_sharedMemory->getHeader()->lhb_length > m_sharedMemory->sh_mem_length_mapped)
+	{
+		bucket->lbk_latch.unlatch();
+		return NULL;
+	}
+
+	return bucket;
+#endif
+}
+
+
+lbk* LockManager::latch_request(SRQ_PTR request_offset)
+{
+/**************************************
+ *
+ *	l a t c h _ r e q u e s t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Take the latch of the bucket of a granted request
+ *	if nobody waits for its lock.  The request and its
+ *	lock stay in place while the caller holds the request,
+ *	so the bucket may be found before taking the latch.
+ *
+ **************************************/
+	const lrq* const request = (lrq*) SRQ_ABS_PTR(request_offset);
+	if (request_offset == -1 || request->lrq_type != type_lrq)
+		return NULL;
+
+	const lbl* const lock = (lbl*) SRQ_ABS_PTR(request->lrq_lock);
+	if (lock->lbl_type != type_lbl)
+		return NULL;
+
+	lbk* const bucket = latch_bucket(get_hash_slot(lock->lbl_key, lock->lbl_length));
+	if (!bucket)
+		return NULL;
+
+	const own* const owner = (own*) SRQ_ABS_PTR(request->lrq_owner);
+	if (!owner->own_count || lock->lbl_pending_lrq_count)
+	{
+		bucket->lbk_latch.unlatch();
+		return NULL;
+	}
+
+	return bucket;
+}
+
+
 USHORT LockManager::lock_state(const lbl* lock)
 {
 /**************************************
@@ -2881,6 +3438,14 @@ void LockManager::purge_owner(SRQ_PTR purging_owner_offset, own* owner)
 
 	post_history(his_del_owner, purging_owner_offset, SRQ_REL_PTR(owner), 0, false);
 
+	// The owner's process may have died holding the owner latch
+
+	if (owner->own_latch.lch_process.load(std::memory_order_relaxed))
+	{
+		recover_que(&owner->own_latch);
+		owner->own_latch.unlatch();
+	}
+
 	// Release any locks that are active
 
 	SRQ lock_srq;
@@ -2947,6 +3512,47 @@ void LockManager::purge_process(prc* process)
 }
 
 
+void LockManager::recover_que(lch* latch)
+{
+/**************************************
+ *
+ *	r e c o v e r _ q u e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Finish the queue operation of a process died in the middle
+ *	of it, see insert_tail() and remove_que().  The operation
+ *	is recorded either in the latch or in the shb.
+ *
+ **************************************/
+	shb* const recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
+
+	SRQ_PTR& remove_node = latch ? latch->lch_remove_node : recover->shb_remove_node;
+	SRQ_PTR& insert_que = latch ? latch->lch_insert_que : recover->shb_insert_que;
+	SRQ_PTR& insert_prior = latch ? latch->lch_insert_prior : recover->shb_insert_prior;
+
+	if (remove_node)
+	{
+		// There was a remove_que operation in progress when the prior_owner died
+		DEBUG_MSG(0, ("Got to the funky shb_remove_node code\n"));
+		remove_que((SRQ) SRQ_ABS_PTR(remove_node), latch);
+	}
+	else if (insert_que && insert_prior)
+	{
+		// There was a insert_que operation in progress when the prior_owner died
+		DEBUG_MSG(0, ("Got to the funky shb_insert_que code\n"));
+
+		SRQ lock_srq = (SRQ) SRQ_ABS_PTR(insert_que);
+		lock_srq->srq_backward = insert_prior;
+		lock_srq = (SRQ) SRQ_ABS_PTR(insert_prior);
+		lock_srq->srq_forward = insert_que;
+		insert_que = 0;
+		insert_prior = 0;
+	}
+}
+
+
 void LockManager::remap_local_owners()
 {
 /**************************************
@@ -2985,7 +3591,7 @@ void LockManager::remap_local_owners()
 }
 
 
-void LockManager::remove_que(SRQ node)
+void LockManager::remove_que(SRQ node, lch* latch)
 {
 /**************************************
  *
@@ -3007,11 +3613,22 @@ void LockManager::remove_que(SRQ node)
  *	nodes may have changed prior to the crash, we need to redo the
  *	work only based on what is in <node>.
  *
+ *	A queue changed under a latch is recorded in the latch.
+ *
  **************************************/
-	ASSERT_ACQUIRED;
-	shb* recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
+	SRQ_PTR* remove_node;
+
+	if (latch)
+		remove_node = &latch->lch_remove_node;
+	else
+	{
+		ASSERT_ACQUIRED;
+		shb* const recover = (shb*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_secondary);
+		remove_node = &recover->shb_remove_node;
+	}
+
 	DEBUG_DELAY;
-	recover->shb_remove_node = SRQ_REL_PTR(node);
+	*remove_node = SRQ_REL_PTR(node);
 	DEBUG_DELAY;
 
 	SRQ lock_srq = (SRQ) SRQ_ABS_PTR(node->srq_forward);
@@ -3036,7 +3653,7 @@ void LockManager::remove_que(SRQ node)
 	lock_srq->srq_forward = node->srq_forward;
 
 	DEBUG_DELAY;
-	recover->shb_remove_node = 0;
+	*remove_node = 0;
 	DEBUG_DELAY;
 
 	// To prevent trying to remove this entry a second time, which could occur
@@ -3049,6 +3666,28 @@ void LockManager::remove_que(SRQ node)
 }
 
 
+void LockManager::release_buckets()
+{
+/**************************************
+ *
+ *	r e l e a s e _ b u c k e t s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Release the latches taken by acquire_buckets().
+ *
+ **************************************/
+	lbk* const buckets = (lbk*) SRQ_ABS_PTR(m_sharedMemory->getHeader()->lhb_buckets);
+
+	for (lbk* bucket = buckets; bucket < buckets + LHB_BUCKETS; bucket++)
+	{
+		if (bucket->lbk_latch.lch_process.load(std::memory_order_relaxed) == PID)
+			bucket->lbk_latch.unlatch();
+	}
+}
+
+
 void LockManager::release_shmem(SRQ_PTR owner_offset)
 {
 /**************************************
@@ -3081,6 +3720,8 @@ void LockManager::release_shmem(SRQ_PTR owner_offset)
 
 	DEBUG_DELAY;
 
+	release_buckets();
+
 	m_sharedMemory->getHeader()->lhb_active_owner = 0;
 
 	m_sharedMemory->mutexUnlock();
@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 #include <sys/types.h>
+#include <atomic>
 
 #include "../common/classes/semaphore.h"
 #include "../common/classes/rwlock.h"
@@ -93,7 +94,7 @@ const UCHAR type_lpr	= 7;
 
 // Version number of the lock table.
 // Must be increased every time the shmem layout is changed.
-const USHORT BASE_LHB_VERSION = 19;
+const USHORT BASE_LHB_VERSION = 20;
 const USHORT PLATFORM_LHB_VERSION = 128;	// 64-bit target
 
 #if SIZEOF_VOID_P == 8
@@ -119,6 +120,7 @@ struct lhb : public Firebird::MemoryHeader
 	ULONG lhb_length;				// Size of lock table
 	ULONG lhb_used;					// Bytes of lock table in use
 	USHORT lhb_hash_slots;			// Number of hash slots allocated
+	SRQ_PTR lhb_buckets;			// Latched buckets of hash slots
 
 	SRQ_PTR lhb_history;
 	ULONG lhb_scan_interval;		// Deadlock scan interval (secs)
@@ -158,6 +160,55 @@ struct shb
 	SRQ_PTR shb_insert_prior;		// Prior of inserting queue
 };
 
+// Latch over a part of the lock table changed outside the lock table mutex.
+// It's held by a process (not by an owner), so the recovery fields below
+// play the same role as in the shb when the holder dies.
+
+struct lch
+{
+	std::atomic<int> lch_process;	// Process holding the latch, zero if free
+	SRQ_PTR lch_remove_node;		// Node removing itself
+	SRQ_PTR lch_insert_que;			// Queue inserting into
+	SRQ_PTR lch_insert_prior;		// Prior of inserting queue
+
+	void init()
+	{
+		lch_process.store(0, std::memory_order_relaxed);
+		lch_remove_node = 0;
+		lch_insert_que = 0;
+		lch_insert_prior = 0;
+	}
+
+	bool tryLatch(int process)
+	{
+		int expected = 0;
+		return lch_process.load(std::memory_order_relaxed) == 0 &&
+			lch_process.compare_exchange_strong(expected, process, std::memory_order_acquire);
+	}
+
+	void unlatch()
+	{
+		lch_process.store(0, std::memory_order_release);
+	}
+};
+
+// Bucket of hash slots. Locks hashed into the bucket are granted, converted
+// and released under its latch when nobody waits for them, see lock.cpp.
+
+const USHORT LHB_BUCKETS = 32;
+
+struct lbk
+{
+	lch lbk_latch;
+	srq lbk_free_locks;				// Free lock blocks released under the latch
+	srq lbk_free_requests;			// Free lock requests released under the latch
+	FB_UINT64 lbk_enqs;				// Counters not yet moved to the lhb
+	FB_UINT64 lbk_converts;
+	FB_UINT64 lbk_downgrades;
+	FB_UINT64 lbk_deqs;
+	FB_UINT64 lbk_operations[LCK_MAX_SERIES];
+};
+
 // Lock block
 
 struct lbl
@@ -239,6 +290,7 @@ struct own
 	USHORT own_ast_count;			// Number of ASTs being delivered
 	Firebird::event_t own_wakeup;	// Wakeup event block
 	USHORT own_flags;				// Misc stuff
+	lch own_latch;					// Latch over own_requests
 };
 
 // Flags in own_flags
@@ -414,6 +466,7 @@ public:
 	void exceptionHandler(const Firebird::Exception& ex, ThreadFinishSync<LockManager*>::ThreadRoutine* routine);
 
 private:
+	void acquire_buckets();
 	void acquire_shmem(SRQ_PTR);
 	UCHAR* alloc(USHORT, Firebird::CheckStatusWrapper*);
 	lbl* alloc_lock(USHORT, Firebird::CheckStatusWrapper*);
@@ -427,16 +480,26 @@ private:
 	lrq* deadlock_scan(own*, lrq*);
 	lrq* deadlock_walk(lrq*, bool*);
 	void debug_delay(ULONG);
-	lbl* find_lock(USHORT, const UCHAR*, USHORT, USHORT*);
+	SRQ_PTR fast_enqueue(USHORT, const UCHAR*, USHORT, UCHAR, lock_ast_t, void*, SRQ_PTR);
+	bool fast_convert(SRQ_PTR, UCHAR, lock_ast_t, void*);
+	bool fast_downgrade(SRQ_PTR, UCHAR*);
+	bool fast_dequeue(SRQ_PTR);
+	bool fast_release(lbk*, lrq*, lbl*);
+	lbl* find_lock(USHORT, const UCHAR*, USHORT, USHORT);
+	lbk* get_bucket(USHORT);
+	lrq* get_free_request();
+	USHORT get_hash_slot(const UCHAR*, USHORT);
 	lrq* get_request(SRQ_PTR);
 	void grant(lrq*, lbl*);
 	bool grant_or_que(thread_db*, lrq*, lbl*, SSHORT);
 	bool init_owner_block(Firebird::CheckStatusWrapper*, own*, UCHAR, LOCK_OWNER_T);
 	void insert_data_que(lbl*);
-	void insert_tail(SRQ, SRQ);
+	void insert_tail(SRQ, SRQ, lch* = NULL);
 	bool internal_convert(thread_db* database, Firebird::CheckStatusWrapper*, SRQ_PTR, UCHAR, SSHORT,
 		lock_ast_t, void*);
 	void internal_dequeue(SRQ_PTR);
+	lbk* latch_bucket(USHORT);
+	lbk* latch_request(SRQ_PTR);
 	static USHORT lock_state(const lbl*);
 	void post_blockage(thread_db*, lrq*, lbl*);
 	void post_history(USHORT, SRQ_PTR, SRQ_PTR, SRQ_PTR, bool);
@@ -445,8 +508,10 @@ private:
 	bool probe_processes();
 	void purge_owner(SRQ_PTR, own*);
 	void purge_process(prc*);
+	void recover_que(lch*);
 	void remap_local_owners();
-	void remove_que(SRQ);
+	void remove_que(SRQ, lch* = NULL);
+	void release_buckets();
 	void release_shmem(SRQ_PTR);
 	void release_request(lrq*);
 	bool signal_owner(thread_db*, own*);
@@ -95,6 +95,10 @@ enum lck_owner_t {
 #include <unistd.h>
 #endif
 
+#ifdef WIN_NT
+#include <process.h>
+#endif
+
 #include <sys/stat.h>
 
 #ifdef HAVE_SYS_PARAM_H
@@ -644,7 +648,27 @@ int CLIB_ROUTINE main( int argc, char *argv[])
 				return FINI_OK;
 			}
 
+			// Operations done under the bucket latches bypass the
+			// lock file mutex, so wait for them as well
+
+			lbk* const buckets = (lbk*) SRQ_ABS_PTR(LOCK_header->lhb_buckets);
+			const int pid = getpid();
+
+			for (lbk* bucket = buckets; bucket < buckets + LHB_BUCKETS; bucket++)
+			{
+				// Don't hang on a latch of a dead process
+				for (int n = 0; n < 1000 && !bucket->lbk_latch.tryLatch(pid); n++)
+					Thread::yield();
+			}
+
 			memcpy((UCHAR*) buffer, LOCK_header, LOCK_header->lhb_length);
+
+			for (lbk* bucket = buckets; bucket < buckets + LHB_BUCKETS; bucket++)
+			{
+				if (bucket->lbk_latch.lch_process.load(std::memory_order_relaxed) == pid)
+					bucket->lbk_latch.unlatch();
+			}
+
 			LOCK_header = (lhb*)(UCHAR*) buffer;
 #endif
 
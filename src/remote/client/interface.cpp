@@ -201,6 +201,9 @@ private:
 	void freeClientData(CheckStatusWrapper* status, bool force = false);
 	void internalCancel(Firebird::CheckStatusWrapper* status);
 	void internalClose(Firebird::CheckStatusWrapper* status);
+	void getInlineInfo(unsigned int itemsLength, const unsigned char* items,
+		unsigned int bufferLength, unsigned char* buffer);
+	int seekInline(int mode, int offset);
 
 	Rbl* blob;
 };
@@ -1090,6 +1093,7 @@ static rem_port* analyze(ClntAuthBlock& cBlock, PathName& attach_name, unsigned
 	Firebird::ICryptKeyCallback* cryptCb);
 static void batch_gds_receive(rem_port*, struct rmtque *, USHORT);
 static void batch_dsql_fetch(rem_port*, struct rmtque *, USHORT);
+static void cache_inline_blob(rem_port*, P_INLINE_BLOB*);
 static void clear_queue(rem_port*);
 static void clear_stmt_que(rem_port*, Rsr*);
 static void finalize(rem_port* port);
@@ -1112,6 +1116,7 @@ static void receive_packet_noqueue(rem_port*, PACKET *);
 static void receive_queued_packet(rem_port*, USHORT);
 static void receive_response(IStatus*, Rdb*, PACKET *);
 static void release_blob(Rbl*);
+static void release_inline_blobs(Rsr*);
 static void release_event(Rvnt*);
 static void release_object(IStatus*, Rdb*, P_OP, USHORT);
 static void release_request(Rrq*);
@@ -1292,6 +1297,12 @@ void Blob::getInfo(CheckStatusWrapper* status,
 		rem_port* port = rdb->rdb_port;
 		RefMutexGuard portGuard(*port->port_sync, FB_FUNCTION);
 
+		if (blob->rbl_flags & Rbl::INLINE)
+		{
+			getInlineInfo(itemsLength, items, bufferLength, buffer);
+			return;
+		}
+
 		info(status, rdb, op_info_blob, blob->rbl_id, 0,
 			 itemsLength, items, 0, 0, bufferLength, buffer);
 	}
@@ -1302,6 +1313,59 @@ void Blob::getInfo(CheckStatusWrapper* status,
 }
 
 
+void Blob::getInlineInfo(unsigned int itemsLength, const unsigned char* items,
+	unsigned int bufferLength, unsigned char* buffer)
+{
+/**************************************
+ *
+ *	g e t I n l i n e I n f o
+ *
+ **************************************
+ *
+ * Functional description
+ *	Provide information on blob received inline
+ *	using the info sent by server along with it.
+ *
+ **************************************/
+	ClumpletReader it(ClumpletReader::InfoItems, items, itemsLength);
+	ClumpletReader info(ClumpletReader::InfoResponse, blob->rbl_info.begin(), blob->rbl_info.getCount());
+	ClumpletWriter out(ClumpletReader::InfoResponse, bufferLength - 1);		// place for isc_info_end / isc_info_truncated
+
+	for (it.rewind(); !it.isEof(); it.moveNext())
+	{
+		const UCHAR item = it.getClumpTag();
+		if (item == isc_info_end)
+			break;
+
+		try
+		{
+			if (info.find(item))
+				out.insertBytes(item, info.getBytes(), info.getClumpLength());
+			else
+				out.insertInt(isc_info_error, isc_infunk);
+		}
+		catch (const fatal_exception&)
+		{
+			if (out.hasOverflow())
+			{
+				memcpy(buffer, out.getBuffer(), out.getBufferLength());
+				buffer += out.getBufferLength();
+				*buffer++ = isc_info_truncated;
+				if (out.getBufferLength() <= bufferLength - 2)
+					*buffer++ = isc_info_end;
+				return;
+			}
+			else
+				throw;
+		}
+	}
+
+	memcpy(buffer, out.getBuffer(), out.getBufferLength());
+	buffer += out.getBufferLength();
+	*buffer++ = isc_info_end;
+}
+
+
 void Blob::freeClientData(CheckStatusWrapper* status, bool force)
 {
 /**************************************
@@ -1330,7 +1394,8 @@ void Blob::freeClientData(CheckStatusWrapper* status, bool force)
 
 		try
 		{
-			release_object(status, rdb, op_cancel_blob, blob->rbl_id);
+			if (!(blob->rbl_flags & Rbl::INLINE))
+				release_object(status, rdb, op_cancel_blob, blob->rbl_id);
 		}
 		catch (const Exception&)
 		{
@@ -1406,7 +1471,9 @@ void Blob::internalClose(CheckStatusWrapper* status)
 			send_blob(status, blob, 0, NULL);
 		}
 
-		release_object(status, rdb, op_close_blob, blob->rbl_id);
+		if (!(blob->rbl_flags & Rbl::INLINE))
+			release_object(status, rdb, op_close_blob, blob->rbl_id);
+
 		release_blob(blob);
 		blob = NULL;
 	}
@@ -3479,6 +3546,7 @@ ITransaction* Statement::execute(CheckStatusWrapper* status, ITransaction* apiTr
 		sqldata->p_sqldata_out_message_number = 0;	// out_msg_type
 		sqldata->p_sqldata_timeout = statement->rsr_timeout;
 		sqldata->p_sqldata_cursor_flags = 0;
+		sqldata->p_sqldata_inline_blob_size = 0;
 
 		send_packet(port, packet);
 
@@ -3645,6 +3713,7 @@ ResultSet* Statement::openCursor(CheckStatusWrapper* status, Firebird::ITransact
 		sqldata->p_sqldata_out_message_number = 0;	// out_msg_type
 		sqldata->p_sqldata_timeout = statement->rsr_timeout;
 		sqldata->p_sqldata_cursor_flags = flags;
+		sqldata->p_sqldata_inline_blob_size = port->getPortConfig()->getMaxInlineBlobSize();
 
 		{
 			Firebird::Cleanup msgClean([&message] {
@@ -3957,6 +4026,7 @@ void Statement::freeClientData(CheckStatusWrapper* status, bool force)
 		else
 		{
 			statement->rsr_flags.clear(Rsr::FETCHED);
+			release_inline_blobs(statement);
 			statement->rsr_rtr = NULL;
 
 			clear_queue(rdb->rdb_port);
@@ -4567,6 +4637,9 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 
 	RefMutexGuard portGuard(*port->port_sync, FB_FUNCTION);
 
+	// Measure how fast the application consumes rows
+	statement->rsr_prefetch.fetchStarted();
+
 	if (!statement->rsr_flags.test(Rsr::FETCHED))
 	{
 		// On first fetch, clear the end-of-stream flag & reset the message buffers
@@ -4721,6 +4794,7 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 			sqldata->p_sqldata_messages = statement->rsr_select_format ? 1 : 0;
 			sqldata->p_sqldata_fetch_op = fetch_relative;
 			sqldata->p_sqldata_fetch_pos = adjustment;
+			sqldata->p_sqldata_inline_blob_space = 0;
 
 			send_packet(port, packet);
 
@@ -4769,9 +4843,8 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 
 	if ((!statement->rsr_flags.test(Rsr::STREAM_END | Rsr::STREAM_ERR) &&
 		!statement->rsr_message->msg_address && !statement->rsr_rows_pending) ||
-		(	// Low in inventory
-			(statement->rsr_rows_pending <= statement->rsr_reorder_level) &&
-			(statement->rsr_msgs_waiting <= statement->rsr_reorder_level) &&
+		(	// Low in inventory or less than required to cover the round trip
+			statement->needPrefetch() &&
 			// Pipelining causes both server & client to
 			// write at the same time. In XNET, writes
 			// block for the other end to read -  and so when both
@@ -4798,12 +4871,26 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 		sqldata->p_sqldata_fetch_op = operation;
 		sqldata->p_sqldata_fetch_pos = position;
 
+		// Let the server know how many inline blobs we're able to keep
+
+		const Rtr* const transaction = statement->rsr_rtr;
+		sqldata->p_sqldata_inline_blob_space = transaction ?
+			Rtr::MAX_INLINE_CACHE_SIZE - transaction->rtr_inline_size : 0;
+
 		if (statement->rsr_select_format)
 		{
 			if (operation == fetch_next || operation == fetch_prior)
 			{
-				sqldata->p_sqldata_messages = REMOTE_compute_batch_size(
+				const USHORT batchSize = REMOTE_compute_batch_size(
 					port, 0, op_fetch_response, statement->rsr_select_format);
+
+				// XNET does not pipeline batches, see above
+				const ULONG prefetchBuffer = (port->port_type == rem_port::XNET) ? 0 :
+					port->getPortConfig()->getClientPrefetchBuffer();
+
+				statement->rsr_prefetch.setup(prefetchBuffer,
+					statement->rsr_select_format->fmt_length, batchSize);
+				sqldata->p_sqldata_messages = statement->getPrefetchBatch();
 			}
 
 			// Reorder data when the local buffer is half empty
@@ -4833,6 +4920,10 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 
 		send_packet(port, packet);
 
+		// Response to the first batch includes the statement execution time,
+		// don't take it as the round trip time
+		statement->rsr_prefetch.batchSent(sqldata->p_sqldata_messages,
+			statement->rsr_flags.test(Rsr::FETCHED));
 		statement->rsr_batch_count++;
 		statement->rsr_fetch_operation = operation;
 		statement->rsr_fetch_position = position;
@@ -4927,6 +5018,8 @@ bool ResultSet::fetch(CheckStatusWrapper* status, void* buffer, P_FETCH operatio
 	}
 
 	message->msg_address = NULL;
+	statement->rsr_prefetch.fetchDone();
+
 	return true;
 }
 
@@ -5178,6 +5271,7 @@ void ResultSet::freeClientData(CheckStatusWrapper* status, bool force)
 		if (statement->rsr_flags.test(Rsr::LAZY))
 		{
 			statement->rsr_flags.clear(Rsr::FETCHED);
+			release_inline_blobs(statement);
 			statement->rsr_rtr = NULL;
 
 			clear_queue(rdb->rdb_port);
@@ -5213,6 +5307,7 @@ void ResultSet::freeClientData(CheckStatusWrapper* status, bool force)
 		}
 
 		statement->rsr_flags.clear(Rsr::FETCHED);
+		release_inline_blobs(statement);
 		statement->rsr_rtr = NULL;
 		clear_queue(rdb->rdb_port);
 		REMOTE_reset_statement(statement);
@@ -5582,6 +5677,31 @@ IBlob* Attachment::openBlob(CheckStatusWrapper* status, ITransaction* apiTra, IS
 
 		CHECK_LENGTH(port, bpb_length);
 
+		// The blob may be received already together with the fetched row.
+		// It can be used unless some filter or transliteration is requested.
+
+		// Once the blob is opened, its cache entry is not needed anymore.
+
+		FB_SIZE_T pos;
+		if (transaction->rtr_inline_blobs.find(Rbl::generate(*id), pos))
+		{
+			Rbl* blob = transaction->rtr_inline_blobs[pos];
+			transaction->rtr_inline_blobs.remove(pos);
+			transaction->rtr_inline_size -= blob->rbl_data.getCount() + blob->rbl_info.getCount();
+
+			if (bpb_length && (bpb_length != 1 || bpb[0] != isc_bpb_version1))
+				delete blob;
+			else
+			{
+				blob->rbl_next = transaction->rtr_blobs;
+				transaction->rtr_blobs = blob;
+
+				Firebird::IBlob* b = FB_NEW Blob(blob);
+				b->addRef();
+				return b;
+			}
+		}
+
 		PACKET* packet = &rdb->rdb_packet;
 		packet->p_operation = op_open_blob2;
 		P_BLOB* p_blob = &packet->p_blob;
@@ -5702,6 +5822,9 @@ void Blob::putSegment(CheckStatusWrapper* status, unsigned int segment_length, c
 
 		if (!(blob->rbl_flags & Rbl::CREATE))
 		{
+			if (blob->rbl_flags & Rbl::INLINE)
+				Arg::Gds(isc_segstr_no_write).raise();
+
 			send_blob(status, blob, segment_length, segmentPtr);
 			fb_assert(false);
 		}
@@ -6425,6 +6548,9 @@ int Blob::seek(CheckStatusWrapper* status, int mode, int offset)
 		rem_port* port = rdb->rdb_port;
 		RefMutexGuard portGuard(*port->port_sync, FB_FUNCTION);
 
+		if (blob->rbl_flags & Rbl::INLINE)
+			return seekInline(mode, offset);
+
 		PACKET* packet = &rdb->rdb_packet;
 		packet->p_operation = op_seek_blob;
 		P_SEEK* seek = &packet->p_seek;
@@ -6455,6 +6581,69 @@ int Blob::seek(CheckStatusWrapper* status, int mode, int offset)
 }
 
 
+int Blob::seekInline(int mode, int offset)
+{
+/**************************************
+ *
+ *	s e e k I n l i n e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Seek into a blob received inline. As in the engine,
+ *	only stream blobs may be positioned.
+ *
+ **************************************/
+	ClumpletReader info(ClumpletReader::InfoResponse, blob->rbl_info.begin(), blob->rbl_info.getCount());
+
+	if (!info.find(isc_info_blob_type) || info.getInt() != isc_bpb_type_stream)
+		Arg::Gds(isc_bad_segstr_type).raise();
+
+	const SLONG total = info.find(isc_info_blob_total_length) ? info.getInt() : 0;
+
+	SLONG position = offset;
+	if (mode == 1)
+		position += blob->rbl_offset;
+	else if (mode == 2)
+		position += total;
+
+	position = MIN(MAX(position, 0), total);
+
+	// Walk the length-prefixed segments up to the requested position
+
+	UCHAR* p = blob->rbl_data.begin();
+	ULONG length = blob->rbl_data.getCount();
+	ULONG skip = position;
+
+	blob->rbl_fragment_length = 0;
+
+	while (skip && length >= 2)
+	{
+		const USHORT l = p[0] | (p[1] << 8);
+
+		if (l > skip)
+		{
+			blob->rbl_fragment_length = l - skip;
+			p += 2 + skip;
+			length -= 2 + skip;
+			break;
+		}
+
+		p += 2 + l;
+		length -= 2 + l;
+		skip -= l;
+	}
+
+	blob->rbl_ptr = p;
+	blob->rbl_length = length;
+	blob->rbl_offset = position;
+	blob->rbl_flags &= ~(Rbl::EOF_SET | Rbl::SEGMENT);
+	blob->rbl_flags |= Rbl::EOF_PENDING;
+
+	return position;
+}
+
+
 void Request::send(CheckStatusWrapper* status, int level, unsigned int msg_type,
 				   unsigned int /*length*/, const void* msg)
 {
@@ -7506,10 +7695,10 @@ static void clear_stmt_que(rem_port* port, Rsr* statement)
  * Functional description
  *
  * Receive and handle all queued packets for a completely fetched statement.
- * There must be no more than one such packet.
+ * There may be a few such packets when rows are prefetched.
  *
  **************************************/
-	fb_assert(statement->rsr_batch_count <= 1);
+	fb_assert(statement->rsr_batch_count <= Rsr::Prefetch::MAX_BATCHES);
 
 	while (statement->rsr_batch_count)
 		receive_queued_packet(port, statement->rsr_id);
@@ -7603,6 +7792,7 @@ static void batch_dsql_fetch(rem_port*	port,
 		{
 			// Must be a network error
 			statement->rsr_rows_pending = 0;
+			statement->rsr_prefetch.batchDone();
 			--statement->rsr_batch_count;
 			dequeue_receive(port);
 
@@ -7625,15 +7815,20 @@ static void batch_dsql_fetch(rem_port*	port,
 			}
 
 			statement->rsr_rows_pending = 0;
+			statement->rsr_prefetch.batchDone();
 			--statement->rsr_batch_count;
 			dequeue_receive(port);
 
 			break;
 		}
 
+		const bool endOfBatch =
+			(packet->p_sqldata.p_sqldata_status || !packet->p_sqldata.p_sqldata_messages);
+		statement->rsr_prefetch.responseReceived(!endOfBatch);
+
 		// See if we're at end of the batch
 
-		if (packet->p_sqldata.p_sqldata_status || !packet->p_sqldata.p_sqldata_messages)
+		if (endOfBatch)
 		{
 			if (packet->p_sqldata.p_sqldata_status == 100)
 			{
@@ -7656,6 +7851,10 @@ static void batch_dsql_fetch(rem_port*	port,
 #endif
 			}
 
+			// Forget the rows server did not send in this batch
+			const ULONG rest = statement->rsr_prefetch.batchDone();
+			statement->rsr_rows_pending -= MIN(rest, statement->rsr_rows_pending);
+
 			if (--statement->rsr_batch_count == 0)
 				statement->rsr_rows_pending = 0;
 
@@ -7832,6 +8031,57 @@ static void batch_gds_receive(rem_port*		port,
 }
 
 
+static void cache_inline_blob(rem_port* port, P_INLINE_BLOB* p_blob)
+{
+/**************************************
+ *
+ *	c a c h e _ i n l i n e _ b l o b
+ *
+ **************************************
+ *
+ * Functional description
+ *	Keep the blob sent by server together with the
+ *	fetched row until it's opened by the user.
+ *
+ **************************************/
+	Rtr* transaction = NULL;
+
+	try
+	{
+		port->getHandle(transaction, p_blob->p_tran_id);
+	}
+	catch (const Exception&)
+	{
+		// Transaction is already gone, nobody will open this blob
+		return;
+	}
+
+	const ULONG length = p_blob->p_blob_data.cstr_length + p_blob->p_blob_info.cstr_length;
+
+	FB_SIZE_T pos;
+	if (transaction->rtr_inline_blobs.find(Rbl::generate(p_blob->p_blob_id), pos) ||
+		transaction->rtr_inline_size + length > Rtr::MAX_INLINE_CACHE_SIZE)
+	{
+		return;
+	}
+
+	Rbl* blob = FB_NEW Rbl;
+	blob->rbl_rdb = port->port_context;
+	blob->rbl_rtr = transaction;
+	blob->rbl_id = INVALID_OBJECT;
+	blob->rbl_blob_id = p_blob->p_blob_id;
+	blob->rbl_stmt_id = p_blob->p_stmt_id;
+	blob->rbl_flags = Rbl::INLINE | Rbl::EOF_PENDING;
+	blob->rbl_info.assign(p_blob->p_blob_info.cstr_address, p_blob->p_blob_info.cstr_length);
+	blob->rbl_data.assign(p_blob->p_blob_data.cstr_address, p_blob->p_blob_data.cstr_length);
+	blob->rbl_buffer = blob->rbl_ptr = blob->rbl_data.begin();
+	blob->rbl_buffer_length = blob->rbl_length = p_blob->p_blob_data.cstr_length;
+
+	transaction->rtr_inline_blobs.add(blob);
+	transaction->rtr_inline_size += length;
+}
+
+
 static void clear_queue(rem_port* port)
 {
 /**************************************
@@ -8280,7 +8530,7 @@ static void authReceiveResponse(bool havePacket, ClntAuthBlock& cBlock, rem_port
 				n->cstr_length, n->cstr_address, n->cstr_address ? n->cstr_address[0] : 0));
 			if (packet->p_acpd.p_acpt_type & pflag_compress)
 			{
-				port->initCompression();
+				port->initCompression(packet->p_acpd.p_acpt_type);
 				port->port_flags |= PORT_compressed;
 			}
 			packet->p_acpd.p_acpt_type &= ptype_MASK;
@@ -8678,6 +8928,12 @@ static void receive_packet_with_callback(rem_port* port, PACKET* packet)
 				port->send(packet);
 			}
 			break;
+
+		case op_inline_blob:
+			cache_inline_blob(port, &packet->p_inline_blob);
+			REMOTE_free_packet(port, packet, true);
+			break;
+
 		default:
 			return;
 		}
@@ -8928,6 +9184,41 @@ static void release_blob( Rbl* blob)
 }
 
 
+static void release_inline_blobs(Rsr* statement)
+{
+/**************************************
+ *
+ *	r e l e a s e _ i n l i n e _ b l o b s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Release inline blobs fetched by the statement
+ *	which were not opened before its cursor is closed.
+ *
+ **************************************/
+	Rtr* const transaction = statement->rsr_rtr;
+
+	if (!transaction)
+		return;
+
+	for (FB_SIZE_T pos = 0; pos < transaction->rtr_inline_blobs.getCount(); )
+	{
+		Rbl* const blob = transaction->rtr_inline_blobs[pos];
+
+		if (blob->rbl_stmt_id != statement->rsr_id)
+		{
+			pos++;
+			continue;
+		}
+
+		transaction->rtr_inline_blobs.remove(pos);
+		transaction->rtr_inline_size -= blob->rbl_data.getCount() + blob->rbl_info.getCount();
+		delete blob;
+	}
+}
+
+
 static void release_event( Rvnt* event)
 {
 /**************************************
@@ -9050,6 +9341,7 @@ static void release_sql_request( Rsr* statement)
  *
  **************************************/
 	Rdb* rdb = statement->rsr_rdb;
+	release_inline_blobs(statement);
 	rdb->rdb_port->releaseObject(statement->rsr_id);
 
 	for (Rsr** p = &rdb->rdb_sql_requests; *p; p = &(*p)->rsr_next)
@@ -9083,6 +9375,12 @@ static void release_transaction( Rtr* transaction)
 	while (transaction->rtr_blobs)
 		release_blob(transaction->rtr_blobs);
 
+	for (Rbl** iter = transaction->rtr_inline_blobs.begin();
+		 iter < transaction->rtr_inline_blobs.end(); ++iter)
+	{
+		delete *iter;
+	}
+
 	for (Rtr** p = &rdb->rdb_transactions; *p; p = &(*p)->rtr_next)
 	{
 		if (*p == transaction)
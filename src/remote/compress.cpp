@@ -0,0 +1,535 @@
+/*
+ *	PROGRAM:	JRD Remote Interface/Server
+ *	MODULE:		compress.cpp
+ *	DESCRIPTION:	Wire compression algorithms
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "ibase.h"
+#include "../remote/compress.h"
+#include "../remote/protocol.h"
+#include "../common/classes/init.h"
+#include "../common/classes/zip.h"
+#include "../common/classes/fb_string.h"
+#include "../common/StatusArg.h"
+
+using namespace Firebird;
+
+namespace {
+
+#ifdef HAVE_ZLIB_H
+InitInstance<ZLib> zlib;
+
+class ZLibCompressor : public WireCompressor
+{
+public:
+	explicit ZLibCompressor(int level)
+	{
+		memset(&sendStream, 0, sizeof(sendStream));
+		sendStream.zalloc = ZLib::allocFunc;
+		sendStream.zfree = ZLib::freeFunc;
+		sendStream.opaque = Z_NULL;
+		int ret = zlib().deflateInit(&sendStream, level ? level : Z_DEFAULT_COMPRESSION);
+		if (ret != Z_OK)
+			(Arg::Gds(isc_deflate_init) << Arg::Num(ret)).raise();
+
+		memset(&recvStream, 0, sizeof(recvStream));
+		recvStream.zalloc = ZLib::allocFunc;
+		recvStream.zfree = ZLib::freeFunc;
+		recvStream.opaque = Z_NULL;
+		recvStream.avail_in = 0;
+		recvStream.next_in = Z_NULL;
+		ret = zlib().inflateInit(&recvStream);
+		if (ret != Z_OK)
+		{
+			zlib().deflateEnd(&sendStream);
+			(Arg::Gds(isc_inflate_init) << Arg::Num(ret)).raise();
+		}
+	}
+
+	~ZLibCompressor()
+	{
+		zlib().deflateEnd(&sendStream);
+		zlib().inflateEnd(&recvStream);
+	}
+
+	bool deflate(Stream& strm, bool flush) override
+	{
+		sendStream.next_in = const_cast<Bytef*>(strm.next_in);
+		sendStream.avail_in = strm.avail_in;
+		sendStream.next_out = strm.next_out;
+		sendStream.avail_out = strm.avail_out;
+
+		const int ret = zlib().deflate(&sendStream, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+
+		strm.next_in = sendStream.next_in;
+		strm.avail_in = sendStream.avail_in;
+		strm.next_out = sendStream.next_out;
+		strm.avail_out = sendStream.avail_out;
+
+		return ret == Z_OK || ret == Z_BUF_ERROR;
+	}
+
+	bool inflate(Stream& strm) override
+	{
+		recvStream.next_in = const_cast<Bytef*>(strm.next_in);
+		recvStream.avail_in = strm.avail_in;
+		recvStream.next_out = strm.next_out;
+		recvStream.avail_out = strm.avail_out;
+
+		const int ret = zlib().inflate(&recvStream, Z_NO_FLUSH);
+
+		strm.next_in = recvStream.next_in;
+		strm.avail_in = recvStream.avail_in;
+		strm.next_out = recvStream.next_out;
+		strm.avail_out = recvStream.avail_out;
+
+		return ret == Z_OK;
+	}
+
+private:
+	z_stream sendStream, recvStream;
+};
+#endif // HAVE_ZLIB_H
+
+#ifdef HAVE_ZSTD_H
+InitInstance<ZStd> zstd;
+
+// Fastest level still compresses better than zlib's default one
+const int ZSTD_WIRE_LEVEL = 1;
+
+class ZStdCompressor : public WireCompressor
+{
+public:
+	explicit ZStdCompressor(int level)
+		: cctx(NULL), dctx(NULL), outFull(false)
+	{
+		cctx = zstd().ZSTD_createCCtx();
+		if (!cctx)
+			(Arg::Gds(isc_deflate_init) << Arg::Num(0)).raise();
+
+		const size_t ret = zstd().ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel,
+			level ? level : ZSTD_WIRE_LEVEL);
+		if (zstd().ZSTD_isError(ret))
+		{
+			zstd().ZSTD_freeCCtx(cctx);
+			(Arg::Gds(isc_deflate_init) << Arg::Num(level)).raise();
+		}
+
+		dctx = zstd().ZSTD_createDCtx();
+		if (!dctx)
+		{
+			zstd().ZSTD_freeCCtx(cctx);
+			(Arg::Gds(isc_inflate_init) << Arg::Num(0)).raise();
+		}
+	}
+
+	~ZStdCompressor()
+	{
+		zstd().ZSTD_freeCCtx(cctx);
+		zstd().ZSTD_freeDCtx(dctx);
+	}
+
+	bool deflate(Stream& strm, bool flush) override
+	{
+		ZSTD_inBuffer in = {strm.next_in, strm.avail_in, 0};
+		ZSTD_outBuffer out = {strm.next_out, strm.avail_out, 0};
+
+		const size_t ret = zstd().ZSTD_compressStream2(cctx, &out, &in,
+			flush ? ZSTD_e_flush : ZSTD_e_continue);
+		if (zstd().ZSTD_isError(ret))
+			return false;
+
+		advance(strm, in.pos, out.pos);
+		return true;
+	}
+
+	bool inflate(Stream& strm) override
+	{
+		ZSTD_inBuffer in = {strm.next_in, strm.avail_in, 0};
+		ZSTD_outBuffer out = {strm.next_out, strm.avail_out, 0};
+
+		const size_t ret = zstd().ZSTD_decompressStream(dctx, &out, &in);
+		if (zstd().ZSTD_isError(ret))
+			return false;
+
+		// When output is full decoder may keep more data in its buffers
+		outFull = (out.pos == out.size);
+		advance(strm, in.pos, out.pos);
+		return true;
+	}
+
+	bool pending() const override
+	{
+		return outFull;
+	}
+
+private:
+	static void advance(Stream& strm, size_t inPos, size_t outPos)
+	{
+		strm.next_in += inPos;
+		strm.avail_in -= inPos;
+		strm.next_out += outPos;
+		strm.avail_out -= outPos;
+	}
+
+	ZSTD_CCtx* cctx;
+	ZSTD_DCtx* dctx;
+	bool outFull;
+};
+#endif // HAVE_ZSTD_H
+
+#ifdef HAVE_LZ4FRAME_H
+InitInstance<LZ4> lz4;
+
+class LZ4Compressor : public WireCompressor
+{
+	// Input is compressed by chunks not larger than that
+	static const ULONG CHUNK_SIZE = 32768;
+	// Max size of frame header, LZ4F_HEADER_SIZE_MAX in newer lz4frame.h
+	static const ULONG HEADER_SIZE = 19;
+
+public:
+	explicit LZ4Compressor(int level)
+		: cctx(NULL), dctx(NULL), outFull(false),
+		  staged(*getDefaultMemoryPool()), stagedPos(0)
+	{
+		memset(&prefs, 0, sizeof(prefs));
+		prefs.autoFlush = 1;			// do not delay data in compressor
+		prefs.compressionLevel = level;
+
+		LZ4F_errorCode_t ret = lz4().LZ4F_createCompressionContext(&cctx, LZ4F_VERSION);
+		if (lz4().LZ4F_isError(ret))
+			(Arg::Gds(isc_deflate_init) << Arg::Num(0)).raise();
+
+		ret = lz4().LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION);
+		if (lz4().LZ4F_isError(ret))
+		{
+			lz4().LZ4F_freeCompressionContext(cctx);
+			(Arg::Gds(isc_inflate_init) << Arg::Num(0)).raise();
+		}
+
+		// Frame header goes out in front of the first compressed block
+		const size_t len = lz4().LZ4F_compressBegin(cctx, staged.getBuffer(HEADER_SIZE), HEADER_SIZE, &prefs);
+		if (lz4().LZ4F_isError(len))
+		{
+			lz4().LZ4F_freeCompressionContext(cctx);
+			lz4().LZ4F_freeDecompressionContext(dctx);
+			(Arg::Gds(isc_deflate_init) << Arg::Num(0)).raise();
+		}
+		staged.shrink(len);
+	}
+
+	~LZ4Compressor()
+	{
+		lz4().LZ4F_freeCompressionContext(cctx);
+		lz4().LZ4F_freeDecompressionContext(dctx);
+	}
+
+	// LZ4F_compressUpdate() needs output buffer large enough for the worst case,
+	// therefore compressed data is staged and copied to caller's buffer from there.
+	// Blocks are flushed immediately (autoFlush), so flush needs no special care.
+	bool deflate(Stream& strm, bool /*flush*/) override
+	{
+		for (;;)
+		{
+			if (stagedPos < staged.getCount())
+			{
+				const ULONG len = MIN(strm.avail_out, staged.getCount() - stagedPos);
+				memcpy(strm.next_out, staged.begin() + stagedPos, len);
+				strm.next_out += len;
+				strm.avail_out -= len;
+				stagedPos += len;
+
+				if (stagedPos < staged.getCount())
+					return true;		// output buffer is full
+			}
+
+			if (!strm.avail_in)
+				return true;
+
+			const ULONG chunk = MIN(strm.avail_in, CHUNK_SIZE);
+			const size_t bound = lz4().LZ4F_compressBound(chunk, &prefs);
+
+			const size_t len = lz4().LZ4F_compressUpdate(cctx, staged.getBuffer(bound), bound,
+				strm.next_in, chunk, NULL);
+			if (lz4().LZ4F_isError(len))
+				return false;
+
+			staged.shrink(len);
+			stagedPos = 0;
+			strm.next_in += chunk;
+			strm.avail_in -= chunk;
+		}
+	}
+
+	bool inflate(Stream& strm) override
+	{
+		size_t outLen = strm.avail_out;
+		size_t inLen = strm.avail_in;
+
+		const size_t ret = lz4().LZ4F_decompress(dctx, strm.next_out, &outLen,
+			strm.next_in, &inLen, NULL);
+		if (lz4().LZ4F_isError(ret))
+			return false;
+
+		strm.next_in += inLen;
+		strm.avail_in -= inLen;
+		strm.next_out += outLen;
+		strm.avail_out -= outLen;
+
+		outFull = !strm.avail_out;
+		return true;
+	}
+
+	bool pending() const override
+	{
+		return outFull;
+	}
+
+private:
+	LZ4F_cctx* cctx;
+	LZ4F_dctx* dctx;
+	LZ4F_preferences_t prefs;
+	bool outFull;
+	Array<UCHAR> staged;
+	FB_SIZE_T stagedPos;
+};
+#endif // HAVE_LZ4FRAME_H
+
+struct AlgorithmName
+{
+	WireCompressor::Algorithm algorithm;
+	const char* name;
+};
+
+const AlgorithmName algorithmNames[] =
+{
+	{WireCompressor::ZLIB, "zlib"},
+	{WireCompressor::ZSTD, "zstd"},
+	{WireCompressor::LZ4, "lz4"},
+	{WireCompressor::NONE, NULL}
+};
+
+// Boolean values, used before the list of algorithms was supported
+const char* const trueValues[] = {"true", "yes", "on", "y", "1", NULL};
+
+bool inList(const char* const* list, const string& value)
+{
+	for (; *list; ++list)
+	{
+		if (value == *list)
+			return true;
+	}
+
+	return false;
+}
+
+} // anonymous namespace
+
+
+void WireCompressor::parse(const char* setting, MethodList& methods)
+{
+/**************************************
+ *
+ *	p a r s e
+ *
+ **************************************
+ *
+ * Functional description
+ *	Parse WireCompression setting like "zstd:3, lz4, zlib"
+ *	into ordered list of available algorithms.
+ *
+ **************************************/
+	methods.clear();
+	if (!setting)
+		return;
+
+	string list(setting);
+	list.lower();
+
+	for (FB_SIZE_T pos = 0; pos < list.length(); )
+	{
+		const FB_SIZE_T start = list.find_first_not_of(" \t,;", pos);
+		if (start == string::npos)
+			break;
+
+		FB_SIZE_T end = list.find_first_of(" \t,;", start);
+		if (end == string::npos)
+			end = list.length();
+		pos = end;
+
+		string token(list.substr(start, end - start));
+
+		Method method;
+		method.algorithm = NONE;
+		method.level = 0;
+
+		const FB_SIZE_T colon = token.find(':');
+		if (colon != string::npos)
+		{
+			method.level = atoi(token.c_str() + colon + 1);
+			token.erase(colon);
+		}
+
+		if (inList(trueValues, token))
+			method.algorithm = ZLIB;
+
+		for (const AlgorithmName* an = algorithmNames; an->name; ++an)
+		{
+			if (token == an->name)
+				method.algorithm = an->algorithm;
+		}
+
+		if (method.algorithm == NONE || !isAvailable(method.algorithm))
+			continue;
+
+		bool found = false;
+		for (const Method* m = methods.begin(); m < methods.end(); ++m)
+		{
+			if (m->algorithm == method.algorithm)
+				found = true;
+		}
+
+		if (!found)
+			methods.add(method);
+	}
+}
+
+
+WireCompressor::Algorithm WireCompressor::select(USHORT requested, const UCHAR* order, FB_SIZE_T orderLength)
+{
+/**************************************
+ *
+ *	s e l e c t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Server side - choose algorithm among requested by client.
+ *	Client without CNCT_client_compress knows about zlib only.
+ *
+ **************************************/
+	if (!order || !orderLength)
+		return (requested & pflag_compress) && isAvailable(ZLIB) ? ZLIB : NONE;
+
+	for (const UCHAR* const end = order + orderLength; order < end; ++order)
+	{
+		const Algorithm algorithm = static_cast<Algorithm>(*order);
+		const USHORT flag = requestFlag(algorithm);
+
+		if (flag && (requested & flag) && isAvailable(algorithm))
+			return algorithm;
+	}
+
+	return NONE;
+}
+
+
+bool WireCompressor::isAvailable(Algorithm algorithm)
+{
+	switch (algorithm)
+	{
+#ifdef HAVE_ZLIB_H
+	case ZLIB:
+		return zlib();
+#endif
+#ifdef HAVE_ZSTD_H
+	case ZSTD:
+		return zstd();
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case LZ4:
+		return lz4();
+#endif
+	default:
+		return false;
+	}
+}
+
+
+const char* WireCompressor::getName(Algorithm algorithm)
+{
+	for (const AlgorithmName* an = algorithmNames; an->name; ++an)
+	{
+		if (an->algorithm == algorithm)
+			return an->name;
+	}
+
+	return "none";
+}
+
+
+USHORT WireCompressor::requestFlag(Algorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case ZLIB:
+		return pflag_compress;
+	case ZSTD:
+		return pflag_compress_zstd;
+	case LZ4:
+		return pflag_compress_lz4;
+	default:
+		return 0;
+	}
+}
+
+
+USHORT WireCompressor::acceptFlags(Algorithm algorithm)
+{
+	// pflag_compress is always present - that's what makes ports turn compression on
+	return algorithm == NONE ? 0 : pflag_compress | (algorithm == ZLIB ? 0 : requestFlag(algorithm));
+}
+
+
+WireCompressor::Algorithm WireCompressor::fromFlags(USHORT acceptType)
+{
+	if (!(acceptType & pflag_compress))
+		return NONE;
+	if (acceptType & pflag_compress_zstd)
+		return ZSTD;
+	if (acceptType & pflag_compress_lz4)
+		return LZ4;
+	return ZLIB;
+}
+
+
+WireCompressor* WireCompressor::create(Algorithm algorithm, int level)
+{
+	fb_assert(isAvailable(algorithm));
+
+	switch (algorithm)
+	{
+#ifdef HAVE_ZLIB_H
+	case ZLIB:
+		return FB_NEW ZLibCompressor(level);
+#endif
+#ifdef HAVE_ZSTD_H
+	case ZSTD:
+		return FB_NEW ZStdCompressor(level);
+#endif
+#ifdef HAVE_LZ4FRAME_H
+	case LZ4:
+		return FB_NEW LZ4Compressor(level);
+#endif
+	default:
+		return NULL;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ *	PROGRAM:	JRD Remote Interface/Server
+ *	MODULE:		compress.h
+ *	DESCRIPTION:	Wire compression algorithms
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#ifndef REMOTE_COMPRESS_H
+#define REMOTE_COMPRESS_H
+
+#include "../common/classes/alloc.h"
+#include "../common/classes/array.h"
+
+// Stream compressor used by a port for both directions of the wire.
+// Algorithm is negotiated during connect, see CNCT_client_compress.
+
+class WireCompressor : public Firebird::GlobalStorage
+{
+public:
+	// Values are sent over the wire in CNCT_client_compress, do not change them
+	enum Algorithm : UCHAR
+	{
+		NONE = 0,
+		ZLIB = 1,
+		ZSTD = 2,
+		LZ4 = 3
+	};
+
+	struct Method
+	{
+		Algorithm algorithm;
+		int level;			// 0 - library default
+	};
+
+	typedef Firebird::HalfStaticArray<Method, 4> MethodList;
+
+	struct Stream
+	{
+		const UCHAR* next_in;
+		ULONG avail_in;
+		UCHAR* next_out;
+		ULONG avail_out;
+	};
+
+	virtual ~WireCompressor() { }
+
+	// Both return false on error, stream is advanced like z_stream does
+	virtual bool deflate(Stream& strm, bool flush) = 0;
+	virtual bool inflate(Stream& strm) = 0;
+
+	// Decoder may hold decompressed data not fitting into last output buffer
+	virtual bool pending() const
+	{
+		return false;
+	}
+
+	// Parse WireCompression setting, leaving only algorithms available here
+	static void parse(const char* setting, MethodList& methods);
+
+	// Choose algorithm for the client offer, client's preference order is used
+	static Algorithm select(USHORT requested, const UCHAR* order, FB_SIZE_T orderLength);
+
+	static bool isAvailable(Algorithm algorithm);
+	static const char* getName(Algorithm algorithm);
+
+	// Flag in p_cnct_max_type requesting the algorithm
+	static USHORT requestFlag(Algorithm algorithm);
+	// Flags in p_acpt_type confirming the algorithm and back
+	static USHORT acceptFlags(Algorithm algorithm);
+	static Algorithm fromFlags(USHORT acceptType);
+
+	static WireCompressor* create(Algorithm algorithm, int level);
+};
+
+#endif // REMOTE_COMPRESS_H
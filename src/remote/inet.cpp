@@ -95,6 +95,11 @@
 #include <sys/select.h>
 #endif
 
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_POLL)
+#define INET_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #endif // !WIN_NT
 
 const int INET_RETRY_CALL = 5;
@@ -249,16 +254,83 @@ private:
 	}
 #endif
 
+#ifdef INET_EPOLL
+	// Main server's select (the one created with pool) uses epoll. Set of sockets is kept
+	// by the kernel and is not passed on each wait, sockets are armed in one-shot mode:
+	// after reporting an event socket is not checked until port is set again, exactly
+	// like it happens with poll() when port is not added to the set.
+	static const int SEL_MAX_EVENTS = 256;
+	static const int SEL_EPOLL_NONE = -1;		// poll() is used
+	static const int SEL_EPOLL_INIT = -2;		// epoll is not created yet
+	static const int SEL_EPOLL_FAILED = -3;		// epoll failed, switching to poll()
+
+	bool epollSet(rem_port* port)
+	{
+		if (slct_epoll == SEL_EPOLL_FAILED)
+			return false;
+
+		if (port->port_polled)
+			return true;
+
+		if (slct_epoll == SEL_EPOLL_INIT)
+		{
+			// Created when really needed - not in classic server's listener,
+			// which forks children
+			slct_epoll = epoll_create1(EPOLL_CLOEXEC);
+			if (slct_epoll < 0)
+			{
+				gds__log("INET/select: epoll_create failed, errno = %d, using poll()", errno);
+				slct_epoll = SEL_EPOLL_NONE;
+				return false;
+			}
+		}
+
+		epoll_event ev;
+		ev.events = EPOLLIN | EPOLLONESHOT;
+		ev.data.u64 = 0;
+		ev.data.fd = port->port_handle;
+
+		// Rearm socket which has already reported an event, or add new one
+		if (epoll_ctl(slct_epoll, EPOLL_CTL_MOD, port->port_handle, &ev) == 0 ||
+			(errno == ENOENT && epoll_ctl(slct_epoll, EPOLL_CTL_ADD, port->port_handle, &ev) == 0))
+		{
+			port->port_polled = true;
+			return true;
+		}
+
+		// Sockets already put into epoll set will not be polled in this round,
+		// therefore next select() returns at once and ports are set again
+		gds__log("INET/select: epoll_ctl failed, errno = %d, using poll()", errno);
+		close(slct_epoll);
+		slct_epoll = SEL_EPOLL_FAILED;
+		return false;
+	}
+#endif
+
 public:
 #ifdef HAVE_POLL
 	Select()
 		: slct_time(0), slct_count(0), slct_poll(*getDefaultMemoryPool()),
 		  slct_ready(*getDefaultMemoryPool())
+#ifdef INET_EPOLL
+		  , slct_epoll(SEL_EPOLL_NONE), slct_fired(*getDefaultMemoryPool())
+#endif
 	{ }
 
 	explicit Select(Firebird::MemoryPool& pool)
 		: slct_time(0), slct_count(0), slct_poll(pool), slct_ready(pool)
+#ifdef INET_EPOLL
+		  , slct_epoll(SEL_EPOLL_INIT), slct_fired(pool)
+#endif
 	{ }
+
+#ifdef INET_EPOLL
+	~Select()
+	{
+		if (slct_epoll >= 0)
+			close(slct_epoll);
+	}
+#endif
 #else
 	Select()
 		: slct_time(0), slct_count(0), slct_width(0)
@@ -334,7 +406,7 @@ public:
 #endif
 	}
 
-	HandleState ok(const rem_port* port)
+	HandleState ok(rem_port* port)
 	{
 #ifdef WIRE_COMPRESS_SUPPORT
 		if (port->port_z_data)
@@ -349,8 +421,20 @@ public:
 		}
 		return SEL_NO_DATA;
 #elif defined(HAVE_POLL)
-		pollfd* pf = nullptr;
 		FB_SIZE_T pos;
+#ifdef INET_EPOLL
+		if (slct_epoll >= 0)
+		{
+			if (n >= 0 && slct_fired.find(n, pos))
+			{
+				slct_fired.remove(pos);
+				port->port_polled = false;		// disarmed after one-shot event
+				return port->port_state == rem_port::PENDING ? SEL_READY : SEL_NO_DATA;
+			}
+			return n < 0 ? (port->port_flags & PORT_disconnect ? SEL_DISCONNECTED : SEL_BAD) : SEL_NO_DATA;
+		}
+#endif
+		pollfd* pf = nullptr;
 		if (slct_ready.find(n, pos))
 			pf = slct_ready[pos];
 
@@ -378,6 +462,11 @@ public:
 	void unset(SOCKET handle)
 	{
 #if defined(HAVE_POLL)
+#ifdef INET_EPOLL
+		FB_SIZE_T pos;
+		if (slct_fired.find(handle, pos))
+			slct_fired.remove(pos);
+#endif
 		pollfd* pf = getPollFd(handle);
 		if (pf)
 		{
@@ -414,6 +503,15 @@ public:
 #endif // HAVE_POLL
 	}
 
+	void set(rem_port* port)
+	{
+#ifdef INET_EPOLL
+		if (slct_epoll != SEL_EPOLL_NONE && epollSet(port))
+			return;
+#endif
+		set(port->port_handle);
+	}
+
 	void clear()
 	{
 		slct_count = 0;
@@ -432,6 +530,30 @@ public:
 
 	void select(timeval* timeout)
 	{
+#ifdef INET_EPOLL
+		if (slct_epoll == SEL_EPOLL_FAILED)
+		{
+			slct_epoll = SEL_EPOLL_NONE;
+			slct_count = 0;
+			return;
+		}
+
+		if (slct_epoll >= 0)
+		{
+			slct_fired.clear();
+
+			epoll_event events[SEL_MAX_EVENTS];
+			const int milliseconds = timeout ? timeout->tv_sec * 1000 + timeout->tv_usec / 1000 : -1;
+			slct_count = epoll_wait(slct_epoll, events, SEL_MAX_EVENTS, milliseconds);
+
+			// The rest of ready sockets (if any) will be reported by next call
+			for (int i = 0; i < slct_count; ++i)
+				slct_fired.add(events[i].data.fd);
+
+			return;
+		}
+#endif
+
 #ifdef HAVE_POLL
 		slct_ready.clear();
 		bool hasRequest = false;
@@ -490,6 +612,10 @@ private:
 
 	SortedArray<pollfd, InlineStorage<pollfd, 8>, int, PollToFD>  slct_poll;
 	SortedArray<pollfd*, InlineStorage<pollfd*, 8>, int, PollToFD>  slct_ready;
+#ifdef INET_EPOLL
+	int		slct_epoll;
+	SortedArray<SOCKET, InlineStorage<SOCKET, 64> >  slct_fired;
+#endif
 #else
 	int		slct_width;
 	fd_set	slct_fdset;
@@ -696,7 +822,25 @@ rem_port* INET_analyze(ClntAuthBlock* cBlock,
 
 	// Should compression be tried?
 
-	bool compression = config && (*config)->getWireCompression();
+	USHORT compression = 0;
+#ifdef WIRE_COMPRESS_SUPPORT
+	if (config)
+	{
+		WireCompressor::MethodList methods;
+		WireCompressor::parse((*config)->getWireCompression(), methods);
+
+		// Tell server the order in which we prefer algorithms
+		UCharBuffer order;
+		for (const WireCompressor::Method* m = methods.begin(); m < methods.end(); ++m)
+		{
+			compression |= WireCompressor::requestFlag(m->algorithm);
+			order.add(m->algorithm);
+		}
+
+		if (order.hasData())
+			user_id.insertBytes(CNCT_client_compress, order.begin(), order.getCount());
+	}
+#endif
 
 	// Establish connection to server
 	// If we want user verification, we can't speak anything less than version 7
@@ -716,18 +860,16 @@ rem_port* INET_analyze(ClntAuthBlock* cBlock,
 		REMOTE_PROTOCOL(PROTOCOL_VERSION15, ptype_lazy_send, 6),
 		REMOTE_PROTOCOL(PROTOCOL_VERSION16, ptype_lazy_send, 7),
 		REMOTE_PROTOCOL(PROTOCOL_VERSION17, ptype_lazy_send, 8),
-		REMOTE_PROTOCOL(PROTOCOL_VERSION18, ptype_lazy_send, 9)
+		REMOTE_PROTOCOL(PROTOCOL_VERSION18, ptype_lazy_send, 9),
+		REMOTE_PROTOCOL(PROTOCOL_INLINE_BLOB, ptype_lazy_send, 10)
 	};
 	fb_assert(FB_NELEM(protocols_to_try) <= FB_NELEM(cnct->p_cnct_versions));
 	cnct->p_cnct_count = FB_NELEM(protocols_to_try);
 
 	for (size_t i = 0; i < cnct->p_cnct_count; i++) {
 		cnct->p_cnct_versions[i] = protocols_to_try[i];
-		if (compression && cnct->p_cnct_versions[i].p_cnct_version >= PROTOCOL_VERSION13 &&
-			rem_port::checkCompression())
-		{
-			cnct->p_cnct_versions[i].p_cnct_max_type |= pflag_compress;
-		}
+		if (cnct->p_cnct_versions[i].p_cnct_version >= PROTOCOL_VERSION13)
+			cnct->p_cnct_versions[i].p_cnct_max_type |= compression;
 	}
 
 	rem_port* port = inet_try_connect(packet, rdb, file_name, node_name, dpb, config, ref_db_name, af);
@@ -838,7 +980,8 @@ rem_port* INET_analyze(ClntAuthBlock* cBlock,
 		port->port_flags |= PORT_symmetric;
 	}
 
-	bool compress = accept->p_acpt_type & pflag_compress;
+	const USHORT acceptType = accept->p_acpt_type;
+	bool compress = acceptType & pflag_compress;
 	accept->p_acpt_type &= ptype_MASK;
 
 	if (accept->p_acpt_type != ptype_out_of_band) {
@@ -851,7 +994,7 @@ rem_port* INET_analyze(ClntAuthBlock* cBlock,
 
 	if (compress)
 	{
-		port->initCompression();
+		port->initCompression(acceptType);
 		port->port_flags |= PORT_compressed;
 	}
 
@@ -2329,7 +2472,7 @@ static bool select_wait( rem_port* main_port, Select* selct)
 					// if process is shuting down - don't listen on main port
 					if (!INET_shutting_down || port != main_port)
 					{
-						selct->set(port->port_handle);
+						selct->set(port);
 						found = true;
 					}
 				}
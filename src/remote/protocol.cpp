@@ -111,6 +111,7 @@ static bool_t xdr_debug_packet(RemoteXdr*, enum xdr_op, PACKET*);
 #endif
 static bool_t xdr_longs(RemoteXdr*, CSTRING*);
 static bool_t xdr_message(RemoteXdr*, RMessage*, const rem_fmt*);
+static bool_t xdr_message_items(RemoteXdr*, UCHAR*, const rem_fmt*, const UCHAR*);
 static bool_t xdr_packed_message(RemoteXdr*, RMessage*, const rem_fmt*);
 static bool_t xdr_request(RemoteXdr*, USHORT, USHORT, USHORT);
 static bool_t xdr_slice(RemoteXdr*, lstring*, /*USHORT,*/ const UCHAR*);
@@ -122,6 +123,7 @@ static bool_t xdr_trrq_message(RemoteXdr*, USHORT);
 static bool_t xdr_bytes(RemoteXdr*, void*, ULONG);
 static bool_t xdr_blob_stream(RemoteXdr*, SSHORT, CSTRING*);
 static Rsr* getStatement(RemoteXdr*, USHORT);
+static const XdrItem* compile_format(const rem_fmt*);
 
 
 inline void fixupLength(const RemoteXdr* xdrs, ULONG& length)
@@ -666,6 +668,8 @@ bool_t xdr_protocol(RemoteXdr* xdrs, PACKET* p)
 			MAP(xdr_u_long, sqldata->p_sqldata_timeout);
 		if (port->port_protocol >= PROTOCOL_FETCH_SCROLL)
 			MAP(xdr_u_long, sqldata->p_sqldata_cursor_flags);
+		if (port->port_protocol >= PROTOCOL_INLINE_BLOB)
+			MAP(xdr_u_long, sqldata->p_sqldata_inline_blob_size);
 		DEBUG_PRINTSIZE(xdrs, p->p_operation);
 		return P_TRUE(xdrs, p);
 
@@ -719,6 +723,8 @@ bool_t xdr_protocol(RemoteXdr* xdrs, PACKET* p)
 			MAP(xdr_short, reinterpret_cast<SSHORT&>(sqldata->p_sqldata_fetch_op));
 			MAP(xdr_long, sqldata->p_sqldata_fetch_pos);
 		}
+		if (port->port_protocol >= PROTOCOL_INLINE_BLOB)
+			MAP(xdr_u_long, sqldata->p_sqldata_inline_blob_space);
 		DEBUG_PRINTSIZE(xdrs, p->p_operation);
 		return P_TRUE(xdrs, p);
 
@@ -1132,6 +1138,19 @@ bool_t xdr_protocol(RemoteXdr* xdrs, PACKET* p)
 			return P_TRUE(xdrs, p);
 		}
 
+	case op_inline_blob:
+		{
+			P_INLINE_BLOB* p_blob = &p->p_inline_blob;
+			MAP(xdr_short, reinterpret_cast<SSHORT&>(p_blob->p_tran_id));
+			MAP(xdr_short, reinterpret_cast<SSHORT&>(p_blob->p_stmt_id));
+			MAP(xdr_quad, p_blob->p_blob_id);
+			MAP(xdr_cstring, p_blob->p_blob_info);
+			MAP(xdr_cstring, p_blob->p_blob_data);
+			DEBUG_PRINTSIZE(xdrs, p->p_operation);
+
+			return P_TRUE(xdrs, p);
+		}
+
 	///case op_insert:
 	default:
 #ifdef DEV_BUILD
@@ -1545,14 +1564,231 @@ static bool_t xdr_message( RemoteXdr* xdrs, RMessage* message, const rem_fmt* fo
 	if (port->port_flags & PORT_symmetric)
 		return xdr_opaque(xdrs, reinterpret_cast<SCHAR*>(message->msg_address), format->fmt_length);
 
-	const dsc* desc = format->fmt_desc.begin();
-	for (const dsc* const end = format->fmt_desc.end(); desc < end; ++desc)
+	if (!xdr_message_items(xdrs, message->msg_address, format, NULL))
+		return FALSE;
+
+	DEBUG_PRINTSIZE(xdrs, op_void);
+	return TRUE;
+}
+
+
+static bool_t xdr_message_items(RemoteXdr* xdrs, UCHAR* buffer, const rem_fmt* format,
+	const UCHAR* nulls)
+{
+/**************************************
+ *
+ *	x d r _ m e s s a g e _ i t e m s
+ *
+ **************************************
+ *
+ * Functional description
+ *	Map items of a formatted message using its conversion plan.
+ *	Items are collected in a local buffer and passed to / taken from
+ *	the stream at once instead of mapping them one by one.
+ *	If NULL bitmap is given, only even items (odd ones are NULL
+ *	indicators) which are not NULL are mapped.
+ *
+ **************************************/
+	const XdrItem* const plan = compile_format(format);
+	const FB_SIZE_T count = format->fmt_desc.getCount();
+	const FB_SIZE_T step = nulls ? 2 : 1;
+	const bool swap = !xdrs->x_local;
+
+	UCHAR wire[1024];
+	ULONG used = 0;
+
+	if (xdrs->x_op == XDR_ENCODE)
 	{
-		if (!xdr_datum(xdrs, desc, message->msg_address))
+		for (FB_SIZE_T i = 0; i < count; i += step)
+		{
+			if (nulls && (nulls[i >> 4] & (1 << ((i >> 1) & 7))))
+				continue;
+
+			const XdrItem& item = plan[i];
+			UCHAR* const p = buffer + item.offset;
+
+			ULONG length = item.wire;
+			if (item.kind == XdrItem::VARYING)
+			{
+				const vary* const v = reinterpret_cast<const vary*>(p);
+				length = sizeof(SLONG) + ROUNDUP(MIN(item.length, v->vary_length), sizeof(SLONG));
+			}
+
+			if (item.kind == XdrItem::GENERIC || used + length > sizeof(wire))
+			{
+				if (used && !xdrs->x_putbytes(reinterpret_cast<SCHAR*>(wire), used))
+					return FALSE;
+
+				used = 0;
+
+				if (item.kind == XdrItem::GENERIC || length > sizeof(wire))
+				{
+					if (!xdr_datum(xdrs, &format->fmt_desc[i], buffer))
+						return FALSE;
+
+					continue;
+				}
+			}
+
+			UCHAR* out = wire + used;
+			used += length;
+
+			switch (item.kind)
+			{
+			case XdrItem::WORDS:
+				for (const UCHAR* w = item.words; w < item.words + item.count; w++, out += sizeof(SLONG))
+				{
+					const UCHAR* const from = p + (*w & ~XdrItem::SHORT_WORD);
+					SLONG l;
+
+					if (*w & XdrItem::SHORT_WORD)
+						l = *reinterpret_cast<const SSHORT*>(from);
+					else
+						memcpy(&l, from, sizeof(SLONG));
+
+					if (swap)
+						l = htonl(l);
+
+					memcpy(out, &l, sizeof(SLONG));
+				}
+				break;
+
+			case XdrItem::OPAQUE:
+				memcpy(out, p, item.length);
+				memset(out + item.length, 0, item.wire - item.length);
+				break;
+
+			case XdrItem::VARYING:
+				{
+					const vary* const v = reinterpret_cast<const vary*>(p);
+					SLONG l = (SSHORT) v->vary_length;
+
+					if (swap)
+						l = htonl(l);
+
+					memcpy(out, &l, sizeof(SLONG));
+					out += sizeof(SLONG);
+					length -= sizeof(SLONG);
+
+					const USHORT n = MIN(item.length, v->vary_length);
+					memcpy(out, v->vary_string, n);
+					memset(out + n, 0, length - n);
+				}
+				break;
+
+			default:
+				fb_assert(false);
+			}
+		}
+
+		return used ? xdrs->x_putbytes(reinterpret_cast<SCHAR*>(wire), used) : TRUE;
+	}
+
+	fb_assert(xdrs->x_op == XDR_DECODE);
+
+	for (FB_SIZE_T i = 0; i < count; )
+	{
+		// Collect items to be received at once: the ones of fixed length
+		// and the length word of varying one, which ends the collection
+
+		ULONG length = 0;
+		FB_SIZE_T end = i;
+
+		while (end < count)
+		{
+			if (nulls && (nulls[end >> 4] & (1 << ((end >> 1) & 7))))
+			{
+				end += step;
+				continue;
+			}
+
+			const XdrItem& item = plan[end];
+			const ULONG size = (item.kind == XdrItem::VARYING) ? sizeof(SLONG) : item.wire;
+
+			if (item.kind == XdrItem::GENERIC || length + size > sizeof(wire))
+				break;
+
+			length += size;
+			end += step;
+
+			if (item.kind == XdrItem::VARYING)
+				break;
+		}
+
+		if (end == i)
+		{
+			// Item is not handled by the plan or does not fit the buffer
+
+			if (!xdr_datum(xdrs, &format->fmt_desc[i], buffer))
+				return FALSE;
+
+			i += step;
+			continue;
+		}
+
+		if (length && !xdrs->x_getbytes(reinterpret_cast<SCHAR*>(wire), length))
 			return FALSE;
+
+		const UCHAR* in = wire;
+
+		for (; i < end; i += step)
+		{
+			if (nulls && (nulls[i >> 4] & (1 << ((i >> 1) & 7))))
+				continue;
+
+			const XdrItem& item = plan[i];
+			UCHAR* const p = buffer + item.offset;
+
+			switch (item.kind)
+			{
+			case XdrItem::WORDS:
+				for (const UCHAR* w = item.words; w < item.words + item.count; w++, in += sizeof(SLONG))
+				{
+					UCHAR* const to = p + (*w & ~XdrItem::SHORT_WORD);
+					SLONG l;
+					memcpy(&l, in, sizeof(SLONG));
+
+					if (swap)
+						l = ntohl(l);
+
+					if (*w & XdrItem::SHORT_WORD)
+						*reinterpret_cast<SSHORT*>(to) = (SSHORT) l;
+					else
+						memcpy(to, &l, sizeof(SLONG));
+				}
+				break;
+
+			case XdrItem::OPAQUE:
+				memcpy(p, in, item.length);
+				in += item.wire;
+				break;
+
+			case XdrItem::VARYING:
+				{
+					vary* const v = reinterpret_cast<vary*>(p);
+					SLONG l;
+					memcpy(&l, in, sizeof(SLONG));
+					in += sizeof(SLONG);
+
+					if (swap)
+						l = ntohl(l);
+
+					v->vary_length = (SSHORT) l;
+
+					if (!xdr_opaque(xdrs, v->vary_string, MIN(item.length, v->vary_length)))
+						return FALSE;
+
+					if (item.length > v->vary_length)
+						memset(v->vary_string + v->vary_length, 0, item.length - v->vary_length);
+				}
+				break;
+
+			default:
+				fb_assert(false);
+			}
+		}
 	}
 
-	DEBUG_PRINTSIZE(xdrs, op_void);
 	return TRUE;
 }
 
@@ -1637,17 +1873,8 @@ static bool_t xdr_packed_message( RemoteXdr* xdrs, RMessage* message, const rem_
 
 		// Second pass (even elements): process non-NULL items
 
-		desc = format->fmt_desc.begin();
-		for (const dsc* const end = format->fmt_desc.end(); desc < end; desc += 2)
-		{
-			const USHORT index = (USHORT) (desc - format->fmt_desc.begin()) / 2;
-
-			if (!nulls.isNull(index))
-			{
-				if (!xdr_datum(xdrs, desc, message->msg_address))
-					return FALSE;
-			}
-		}
+		if (!xdr_message_items(xdrs, message->msg_address, format, nulls.getData()))
+			return FALSE;
 	}
 	else	// XDR_DECODE
 	{
@@ -1673,17 +1900,8 @@ static bool_t xdr_packed_message( RemoteXdr* xdrs, RMessage* message, const rem_
 
 		// Second pass (even elements): process non-NULL items
 
-		desc = format->fmt_desc.begin();
-		for (const dsc* const end = format->fmt_desc.end(); desc < end; desc += 2)
-		{
-			const USHORT index = (USHORT) (desc - format->fmt_desc.begin()) / 2;
-
-			if (!nulls.isNull(index))
-			{
-				if (!xdr_datum(xdrs, desc, message->msg_address))
-					return FALSE;
-			}
-		}
+		if (!xdr_message_items(xdrs, message->msg_address, format, nulls.getData()))
+			return FALSE;
 	}
 
 	DEBUG_PRINTSIZE(xdrs, op_void);
@@ -2267,6 +2485,157 @@ static Rsr* getStatement(RemoteXdr* xdrs, USHORT statement_id)
 	return port->port_statement;
 }
 
+static const XdrItem* compile_format(const rem_fmt* format)
+{
+/**************************************
+ *
+ *	c o m p i l e _ f o r m a t
+ *
+ **************************************
+ *
+ * Functional description
+ *	Build the plan mapping message items to XDR the same way
+ *	as xdr_datum() does, once per format.
+ *
+ **************************************/
+	if (format->fmt_xdr.getCount() == format->fmt_desc.getCount())
+		return format->fmt_xdr.begin();
+
+	Firebird::Decimal64 d64;
+	Firebird::Decimal128 d128;
+	Firebird::Int128 i128;
+	const UCHAR dec64 = (UCHAR) (d64.getBytes() - reinterpret_cast<UCHAR*>(&d64));
+	const UCHAR dec128 = (UCHAR) (d128.getBytes() - reinterpret_cast<UCHAR*>(&d128));
+	const UCHAR int128 = (UCHAR) (i128.getBytes() - reinterpret_cast<UCHAR*>(&i128));
+
+	const UCHAR quadHigh = (UCHAR) offsetof(SQUAD, gds_quad_high);
+	const UCHAR quadLow = (UCHAR) offsetof(SQUAD, gds_quad_low);
+	const UCHAR S = XdrItem::SHORT_WORD;
+
+	format->fmt_xdr.clear();
+
+	for (const dsc* desc = format->fmt_desc.begin(); desc < format->fmt_desc.end(); ++desc)
+	{
+		XdrItem item;
+		item.offset = (ULONG)(IPTR) desc->dsc_address;
+		item.length = 0;
+		item.kind = XdrItem::WORDS;
+		item.count = 0;
+
+		const auto words = [&item](std::initializer_list<UCHAR> list)
+		{
+			fb_assert(list.size() <= FB_NELEM(item.words));
+
+			for (const UCHAR w : list)
+				item.words[item.count++] = w;
+		};
+
+		switch (desc->dsc_dtype)
+		{
+		case dtype_text:
+		case dtype_boolean:
+			item.kind = XdrItem::OPAQUE;
+			item.length = desc->dsc_length;
+			break;
+
+		case dtype_varying:
+			fb_assert(desc->dsc_length >= sizeof(USHORT));
+			item.kind = XdrItem::VARYING;
+			item.length = desc->dsc_length - sizeof(USHORT);
+			break;
+
+		case dtype_short:
+			words({S});
+			break;
+
+		case dtype_sql_time:
+		case dtype_sql_date:
+		case dtype_long:
+		case dtype_real:
+			words({0});
+			break;
+
+		case dtype_sql_time_tz:
+			words({0, S | 4});
+			break;
+
+		case dtype_ex_time_tz:
+			words({0, S | 4, S | 6});
+			break;
+
+		case dtype_double:
+			words({FB_LONG_DOUBLE_FIRST * 4, FB_LONG_DOUBLE_SECOND * 4});
+			break;
+
+		case dtype_timestamp:
+			words({0, 4});
+			break;
+
+		case dtype_timestamp_tz:
+			words({0, 4, S | 8});
+			break;
+
+		case dtype_ex_timestamp_tz:
+			words({0, 4, S | 8, S | 10});
+			break;
+
+		case dtype_int64:
+#ifndef WORDS_BIGENDIAN
+			words({4, 0});
+#else
+			words({0, 4});
+#endif
+			break;
+
+		case dtype_dec64:
+			words({UCHAR(dec64 + 4), dec64});
+			break;
+
+		case dtype_dec128:
+			words({UCHAR(dec128 + 12), UCHAR(dec128 + 8), UCHAR(dec128 + 4), dec128});
+			break;
+
+#ifndef WORDS_BIGENDIAN
+		case dtype_int128:
+			words({UCHAR(int128 + 12), UCHAR(int128 + 8), UCHAR(int128 + 4), int128});
+			break;
+#endif
+
+		case dtype_array:
+		case dtype_quad:
+		case dtype_blob:
+			words({quadHigh, quadLow});
+			break;
+
+		default:
+			item.kind = XdrItem::GENERIC;
+			break;
+		}
+
+		switch (item.kind)
+		{
+		case XdrItem::WORDS:
+			item.wire = item.count * sizeof(SLONG);
+			break;
+
+		case XdrItem::OPAQUE:
+			item.wire = ROUNDUP(item.length, sizeof(SLONG));
+			break;
+
+		case XdrItem::VARYING:
+			item.wire = sizeof(SLONG) + ROUNDUP(item.length, sizeof(SLONG));
+			break;
+
+		default:
+			item.wire = 0;
+		}
+
+		format->fmt_xdr.add(item);
+	}
+
+	return format->fmt_xdr.begin();
+}
+
 static bool_t xdr_blob_stream(RemoteXdr* xdrs, SSHORT statement_id, CSTRING* strmPortion)
 {
 	if (xdrs->x_op == XDR_FREE)
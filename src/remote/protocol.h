@@ -104,6 +104,15 @@ const USHORT PROTOCOL_VERSION17 = (FB_PROTOCOL_FLAG | 17);
 const USHORT PROTOCOL_VERSION18 = (FB_PROTOCOL_FLAG | 18);
 const USHORT PROTOCOL_FETCH_SCROLL = PROTOCOL_VERSION18;
 
+// Protocol 18 with inline blobs:
+//	- supports op_inline_blob
+//	- op_fetch and op_fetch_scroll pass the free space of client's inline blobs cache
+// It's numbered out of the sequence of the standard protocol versions, as other
+// implementations use protocol 19 and opcode 114 for inline blobs with a different
+// packet layout. Thus it's negotiated only if both peers are of this implementation.
+
+const USHORT PROTOCOL_INLINE_BLOB = (FB_PROTOCOL_FLAG | 0x1000 | 18);
+
 // Architecture types
 
 enum P_ARCH
@@ -137,6 +146,8 @@ const USHORT ptype_MASK			= 0xFF;	// Mask - up to 255 types of protocol
 //
 // upper byte is used for protocol flags
 const USHORT pflag_compress		= 0x100;	// Turn on compression if possible
+const USHORT pflag_compress_zstd	= 0x200;	// Compression with zstd instead of zlib
+const USHORT pflag_compress_lz4		= 0x400;	// Compression with LZ4 instead of zlib
 
 // Generic object id
 
@@ -318,6 +329,8 @@ enum P_OP
 	op_fetch_scroll			= 112,
 	op_info_cursor			= 113,
 
+	op_inline_blob			= 150,	// PROTOCOL_INLINE_BLOB only
+
 	op_max
 };
 
@@ -414,6 +427,7 @@ const UCHAR CNCT_plugin_name		= 8;	// Name of plugin, which generated that data
 const UCHAR CNCT_login				= 9;	// Same data as isc_dpb_user_name
 const UCHAR CNCT_plugin_list		= 10;	// List of plugins, available on client
 const UCHAR CNCT_client_crypt		= 11;	// Client encryption level (DISABLED/ENABLED/REQUIRED)
+const UCHAR CNCT_client_compress	= 12;	// Compression algorithms in client's preference order
 
 // Accept Block (Server response to connect block)
 
@@ -509,6 +523,15 @@ typedef struct p_blob
     CSTRING_CONST	p_blob_bpb;		// Blob parameter block
 } P_BLOB;
 
+typedef struct p_inline_blob
+{
+    OBJCT	p_tran_id;				// Transaction
+    OBJCT	p_stmt_id;				// Statement which fetched the blob
+    SQUAD	p_blob_id;				// Blob id
+    CSTRING	p_blob_info;			// Blob info (isc_info_blob_* items)
+    CSTRING	p_blob_data;			// Blob segments, each one prefixed by its length
+} P_INLINE_BLOB;
+
 typedef struct p_sgmt
 {
     OBJCT	p_sgmt_blob;			// Blob handle id
@@ -629,6 +652,8 @@ typedef struct p_sqldata
 	ULONG	p_sqldata_cursor_flags;		// cursor flags
 	P_FETCH	p_sqldata_fetch_op;			// Fetch operation
 	SLONG	p_sqldata_fetch_pos;		// Fetch position
+	ULONG	p_sqldata_inline_blob_size;	// max size of blob to be sent inline
+	ULONG	p_sqldata_inline_blob_space;	// free space of the client's inline blob cache
 } P_SQLDATA;
 
 typedef struct p_sqlfree
@@ -808,6 +833,7 @@ typedef struct packet
 	P_BATCH_REGBLOB p_batch_regblob;	// Register already existing BLOB in batch
 	P_BATCH_SETBPB p_batch_setbpb;		// Set default BPB for batch
 	P_REPLICATE p_replicate;	// replicate
+	P_INLINE_BLOB p_inline_blob;	// Blob sent along with fetched row
 
 public:
 	packet()
@@ -563,6 +563,7 @@ void REMOTE_reset_statement( Rsr* statement)
 	statement->rsr_msgs_waiting = 0;
 	statement->rsr_reorder_level = 0;
 	statement->rsr_batch_count = 0;
+	statement->rsr_prefetch.reset();
 
 	// only one entry
 
@@ -889,6 +890,129 @@ void Rsr::saveException(const Firebird::Exception& ex, bool overwrite)
 	}
 }
 
+bool Rsr::needPrefetch() const
+{
+	// Low in inventory
+
+	if (rsr_rows_pending <= rsr_reorder_level && rsr_msgs_waiting <= rsr_reorder_level)
+		return true;
+
+	// Keep as many rows requested as the application consumes during the round trip
+
+	return rsr_prefetch.limit && rsr_batch_count < Prefetch::MAX_BATCHES &&
+		rsr_rows_pending + rsr_msgs_waiting + getPrefetchBatch() <= rsr_prefetch.target();
+}
+
+USHORT Rsr::getPrefetchBatch() const
+{
+	// Don't split the prefetched rows into too many batches
+
+	const ULONG size = rsr_prefetch.limit ? rsr_prefetch.target() / 4 : 0;
+	return static_cast<USHORT>(MAX(size, rsr_prefetch.batch));
+}
+
+void Rsr::Prefetch::setup(ULONG bufferSize, ULONG rowLength, USHORT batchSize)
+{
+	batch = batchSize;
+	limit = rowLength ? MIN(bufferSize / rowLength, MAX_ROWS) : 0;
+
+	// Buffer is too small to hold more than the regular batches
+
+	if (limit < 2 * batch)
+		limit = 0;
+}
+
+void Rsr::Prefetch::reset()
+{
+	batches.clear();
+	returned = 0;
+}
+
+void Rsr::Prefetch::batchSent(ULONG rows, bool measure)
+{
+	// Batch sent while server still sends rows of previous ones is answered
+	// after them, its response time is not a round trip time
+
+	for (FB_SIZE_T i = 0; measure && i < batches.getCount(); i++)
+	{
+		if (batches[i].rows)
+			measure = false;
+	}
+
+	Batch b;
+	b.sent = measure ? fb_utils::query_performance_counter() : 0;
+	b.rows = rows;
+	batches.add(b);
+}
+
+void Rsr::Prefetch::responseReceived(bool row)
+{
+	if (batches.isEmpty())
+		return;
+
+	Batch& b = batches[0];
+
+	if (row && b.rows)
+		b.rows--;
+
+	if (!b.sent)
+		return;
+
+	const SINT64 sample = fb_utils::query_performance_counter() - b.sent;
+	b.sent = 0;
+
+	// Follow decrease at once, increase smoothly - the response could wait
+	// in the socket while the application was busy with other rows
+
+	if (!rtt || sample < rtt)
+		rtt = sample;
+	else
+		rtt += (sample - rtt) / 8;
+}
+
+ULONG Rsr::Prefetch::batchDone()
+{
+	if (batches.isEmpty())
+		return 0;
+
+	// Server may send less rows than requested, return the rest
+	const ULONG rest = batches[0].rows;
+	batches.remove((FB_SIZE_T) 0);
+	return rest;
+}
+
+void Rsr::Prefetch::fetchStarted()
+{
+	if (!limit || !returned)
+		return;
+
+	const SINT64 sample = MAX(fb_utils::query_performance_counter() - returned, 1);
+
+	if (!interval)
+		interval = sample;
+	else
+		interval += (sample - interval) / 8;
+}
+
+void Rsr::Prefetch::fetchDone()
+{
+	if (limit)
+		returned = fb_utils::query_performance_counter();
+}
+
+ULONG Rsr::Prefetch::target() const
+{
+	// Rows consumed by the application during the round trip, plus the batch
+	// being consumed and the one being received.
+	// Until both are measured, the regular reorder level works alone.
+
+	if (!rtt || !interval)
+		return batch;
+
+	const SINT64 ahead = rtt / interval + 2 * batch;
+	return static_cast<ULONG>(MIN(ahead, (SINT64) limit));
+}
+
 Firebird::string rem_port::getRemoteId() const
 {
 	fb_assert(port_protocol_id.hasData());
@@ -1366,10 +1490,6 @@ void rem_port::versionInfo(Firebird::string& version) const
 }
 
 
-#ifdef WIRE_COMPRESS_SUPPORT
-static Firebird::InitInstance<Firebird::ZLib> zlib;
-#endif // WIRE_COMPRESS_SUPPORT
-
 rem_port::~rem_port()
 {
 	delete port_srv_auth;
@@ -1394,14 +1514,6 @@ rem_port::~rem_port()
 #ifdef DEV_BUILD
 	--portCounter;
 #endif
-
-#ifdef WIRE_COMPRESS_SUPPORT
-	if (port_compressed)
-	{
-		zlib().deflateEnd(&port_send_stream);
-		zlib().inflateEnd(&port_recv_stream);
-	}
-#endif
 }
 
 bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer,
@@ -1411,13 +1523,14 @@ bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer
 	if (!port->port_compressed)
 		return packet_receive(port, buffer, buffer_length, length);
 
-	z_stream& strm = port->port_recv_stream;
+	WireCompressor::Stream& strm = port->port_recv_stream;
 	strm.avail_out = buffer_length;
 	strm.next_out = buffer;
+	UCHAR* const compressed = &port->port_compressed[REM_RECV_OFFSET(port->port_buff_size)];
 
 	for (;;)
 	{
-		if (strm.avail_in)
+		if (strm.avail_in || port->port_compressor->pending())
 		{
 #ifdef COMPRESS_DEBUG
 			fprintf(stderr, "Data to inflate %d port %p\n", strm.avail_in, port);
@@ -1427,7 +1540,7 @@ bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer
 #endif
 #endif
 
-			if (zlib().inflate(&strm, Z_NO_FLUSH) != Z_OK)
+			if (!port->port_compressor->inflate(strm))
 			{
 #ifdef COMPRESS_DEBUG
 				fprintf(stderr, "Inflate error\n");
@@ -1451,7 +1564,6 @@ bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer
 				return false;
 			}
 
-			UCHAR* compressed = &port->port_compressed[REM_RECV_OFFSET(port->port_buff_size)];
 			if (strm.next_in != compressed)
 			{
 				memmove(compressed, strm.next_in, strm.avail_in);
@@ -1459,10 +1571,10 @@ bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer
 			}
 		}
 		else
-			strm.next_in = &port->port_compressed[REM_RECV_OFFSET(port->port_buff_size)];
+			strm.next_in = compressed;
 
 		SSHORT l = (SSHORT) (port->port_buff_size - strm.avail_in);
-		if ((!packet_receive(port, strm.next_in, l, &l)) || (l <= 0))	// fixit - 2 ways to report errors in same routine
+		if ((!packet_receive(port, compressed + strm.avail_in, l, &l)) || (l <= 0))	// fixit - 2 ways to report errors in same routine
 		{
 			port->port_z_data = false;
 			return false;
@@ -1472,13 +1584,14 @@ bool REMOTE_inflate(rem_port* port, PacketReceive* packet_receive, UCHAR* buffer
 	}
 
 	*length = (SSHORT) (buffer_length - strm.avail_out);
-	if (strm.avail_in)	// Z-buffer still has some data - probably can call inflate() once more on them
+	// Z-buffer or decompressor still has some data - probably can call inflate() once more on them
+	if (strm.avail_in || port->port_compressor->pending())
 		port->port_z_data = true;
 	else
 		port->port_z_data = false;
 
 #ifdef COMPRESS_DEBUG
-	fprintf(stderr, "ZLib buffer %s\n", port->port_z_data ? "has data" : "is empty");
+	fprintf(stderr, "Compressed buffer %s\n", port->port_z_data ? "has data" : "is empty");
 #endif
 
 	return true;
@@ -1494,14 +1607,14 @@ bool REMOTE_deflate(RemoteXdr* xdrs, ProtoWrite* proto_write, PacketSend* packet
 	if (!(port->port_compressed && (port->port_flags & PORT_compressed)))
 		return proto_write(xdrs);
 
-	z_stream& strm = port->port_send_stream;
+	WireCompressor::Stream& strm = port->port_send_stream;
 	strm.avail_in = xdrs->x_private - xdrs->x_base;
-	strm.next_in = (Bytef*) xdrs->x_base;
+	strm.next_in = (UCHAR*) xdrs->x_base;
 
 	if (!strm.next_out)
 	{
 		strm.avail_out = port->port_buff_size;
-		strm.next_out = (Bytef*) &port->port_compressed[REM_SEND_OFFSET(port->port_buff_size)];
+		strm.next_out = &port->port_compressed[REM_SEND_OFFSET(port->port_buff_size)];
 	}
 
 	bool expectMoreOut = flush;
@@ -1515,13 +1628,10 @@ bool REMOTE_deflate(RemoteXdr* xdrs, ProtoWrite* proto_write, PacketSend* packet
 		fprintf(stderr, "\n");
 #endif
 #endif
-		int ret = zlib().deflate(&strm, flush ? Z_SYNC_FLUSH : Z_NO_FLUSH);
-		if (ret == Z_BUF_ERROR)
-			ret = 0;
-		if (ret != 0)
+		if (!port->port_compressor->deflate(strm, flush))
 		{
 #ifdef COMPRESS_DEBUG
-			fprintf(stderr, "Deflate error %d\n", ret);
+			fprintf(stderr, "Deflate error\n");
 #endif
 			return false;
 		}
@@ -1548,7 +1658,7 @@ bool REMOTE_deflate(RemoteXdr* xdrs, ProtoWrite* proto_write, PacketSend* packet
 			}
 
 			strm.avail_out = port->port_buff_size;
-			strm.next_out = (Bytef*)&port->port_compressed[REM_SEND_OFFSET(port->port_buff_size)];
+			strm.next_out = &port->port_compressed[REM_SEND_OFFSET(port->port_buff_size)];
 		}
 	}
 
@@ -1561,56 +1671,34 @@ bool REMOTE_deflate(RemoteXdr* xdrs, ProtoWrite* proto_write, PacketSend* packet
 #endif
 }
 
-bool rem_port::checkCompression()
+void rem_port::initCompression(USHORT acceptType)
 {
 #ifdef WIRE_COMPRESS_SUPPORT
-	return zlib();
-#else
-	return false;
-#endif
-}
+	const WireCompressor::Algorithm algorithm = WireCompressor::fromFlags(acceptType);
 
-void rem_port::initCompression()
-{
-#ifdef WIRE_COMPRESS_SUPPORT
-	if (port_protocol >= PROTOCOL_VERSION13 && !port_compressed && zlib())
+	if (port_protocol >= PROTOCOL_VERSION13 && !port_compressed &&
+		algorithm != WireCompressor::NONE && WireCompressor::isAvailable(algorithm))
 	{
-		port_send_stream.zalloc = Firebird::ZLib::allocFunc;
-		port_send_stream.zfree = Firebird::ZLib::freeFunc;
-		port_send_stream.opaque = Z_NULL;
-		int ret = zlib().deflateInit(&port_send_stream, Z_DEFAULT_COMPRESSION);
-		if (ret != Z_OK)
-			(Firebird::Arg::Gds(isc_deflate_init) << Firebird::Arg::Num(ret)).raise();
-		port_send_stream.next_out = NULL;
-
-		port_recv_stream.zalloc = Firebird::ZLib::allocFunc;
-		port_recv_stream.zfree = Firebird::ZLib::freeFunc;
-		port_recv_stream.opaque = Z_NULL;
-		port_recv_stream.avail_in = 0;
-		port_recv_stream.next_in = Z_NULL;
-		ret = zlib().inflateInit(&port_recv_stream);
-		if (ret != Z_OK)
+		// Level from our own setting - it affects only the data we send
+		int level = 0;
+		WireCompressor::MethodList methods;
+		WireCompressor::parse(getPortConfig()->getWireCompression(), methods);
+		for (const WireCompressor::Method* m = methods.begin(); m < methods.end(); ++m)
 		{
-			zlib().deflateEnd(&port_send_stream);
-			(Firebird::Arg::Gds(isc_inflate_init) << Firebird::Arg::Num(ret)).raise();
+			if (m->algorithm == algorithm)
+				level = m->level;
 		}
 
-		try
-		{
-			port_compressed.reset(FB_NEW_POOL(getPool()) UCHAR[port_buff_size * 2]);
-		}
-		catch (const Firebird::Exception&)
-		{
-			zlib().deflateEnd(&port_send_stream);
-			zlib().inflateEnd(&port_recv_stream);
-			throw;
-		}
+		port_compressor.reset(WireCompressor::create(algorithm, level));
+		port_compressed.reset(FB_NEW_POOL(getPool()) UCHAR[port_buff_size * 2]);
 
 		memset(port_compressed, 0, port_buff_size * 2);
+		memset(&port_send_stream, 0, sizeof(port_send_stream));
+		memset(&port_recv_stream, 0, sizeof(port_recv_stream));
 		port_recv_stream.next_in = &port_compressed[REM_RECV_OFFSET(port_buff_size)];
 
 #ifdef COMPRESS_DEBUG
-		fprintf(stderr, "Completed init port %p\n", this);
+		fprintf(stderr, "Completed init port %p, %s\n", this, WireCompressor::getName(algorithm));
 #endif
 	}
 #endif
@@ -59,10 +59,10 @@
 #endif
 #endif // !WIN_NT
 
-#if defined(HAVE_ZLIB_H)
+#if defined(HAVE_ZLIB_H) || defined(HAVE_ZSTD_H) || defined(HAVE_LZ4FRAME_H)
 #define WIRE_COMPRESS_SUPPORT 1
 //#define COMPRESS_DEBUG 1
-#include "../common/classes/zip.h"
+#include "../remote/compress.h"
 #endif
 
 #define DEB_RBATCH(x)	((void) 0)
@@ -204,11 +204,20 @@ struct Rtr : public Firebird::GlobalStorage, public TypedHandle<rem_type_rtr>
 	Firebird::Array<Rsr*> rtr_cursors;
 	Rtr**			rtr_self;
 
+	// Blobs received inline with the fetched rows, not opened yet (client)
+	Firebird::SortedArray<struct Rbl*, Firebird::EmptyStorage<struct Rbl*>,
+		FB_UINT64, struct Rbl> rtr_inline_blobs;
+	ULONG			rtr_inline_size;	// total size of the cached inline blobs
+
+	// Limit of memory used to cache inline blobs per transaction
+	static const ULONG MAX_INLINE_CACHE_SIZE = 16 * 1024 * 1024;
+
 public:
 	Rtr() :
 		rtr_rdb(0), rtr_next(0), rtr_blobs(0),
 		rtr_iface(NULL), rtr_id(0), rtr_limbo(0),
-		rtr_cursors(getPool()), rtr_self(NULL)
+		rtr_cursors(getPool()), rtr_self(NULL),
+		rtr_inline_blobs(getPool()), rtr_inline_size(0)
 	{ }
 
 	~Rtr()
@@ -239,6 +248,9 @@ struct Rbl : public Firebird::GlobalStorage, public TypedHandle<rem_type_rbl>
 	USHORT		rbl_source_interp;	// source interp (for writing)
 	USHORT		rbl_target_interp;	// destination interp (for reading)
 	Rbl**		rbl_self;
+	ISC_QUAD	rbl_blob_id;		// blob id (for inline blob)
+	OBJCT		rbl_stmt_id;		// statement which fetched the inline blob
+	Firebird::Array<UCHAR> rbl_info;	// blob info (for inline blob)
 
 public:
 	// Values for rbl_flags
@@ -246,7 +258,8 @@ public:
 		EOF_SET = 1,
 		SEGMENT = 2,
 		EOF_PENDING = 4,
-		CREATE = 8
+		CREATE = 8,
+		INLINE = 16			// whole blob was received with the row, no server object
 	};
 
 public:
@@ -255,8 +268,12 @@ public:
 		rbl_buffer(rbl_data.getBuffer(BLOB_LENGTH)), rbl_ptr(rbl_buffer), rbl_iface(NULL),
 		rbl_offset(0), rbl_id(0), rbl_flags(0),
 		rbl_buffer_length(BLOB_LENGTH), rbl_length(0), rbl_fragment_length(0),
-		rbl_source_interp(0), rbl_target_interp(0), rbl_self(NULL)
-	{ }
+		rbl_source_interp(0), rbl_target_interp(0), rbl_self(NULL),
+		rbl_stmt_id(INVALID_OBJECT), rbl_info(getPool())
+	{
+		rbl_blob_id.gds_quad_high = 0;
+		rbl_blob_id.gds_quad_low = 0;
+	}
 
 	~Rbl()
 	{
@@ -268,6 +285,16 @@ public:
 	}
 
 	static ISC_STATUS badHandle() { return isc_bad_segstr_handle; }
+
+	static FB_UINT64 generate(const ISC_QUAD& id)
+	{
+		return ((FB_UINT64) (ULONG) id.gds_quad_high << 32) | id.gds_quad_low;
+	}
+
+	static FB_UINT64 generate(const Rbl* item)
+	{
+		return generate(item->rbl_blob_id);
+	}
 };
 
 
@@ -309,16 +336,39 @@ struct rem_str : public pool_alloc_rpt<SCHAR>
 #include "../common/dsc.h"
 
 
+// How to map an item of the message to XDR, see compile_format() in protocol.cpp
+
+struct XdrItem
+{
+	enum Kind : UCHAR
+	{
+		WORDS,			// Sequence of 32-bit words
+		OPAQUE,			// Bytes padded to 32 bits
+		VARYING,		// Length word and opaque data
+		GENERIC			// Mapped by xdr_datum()
+	};
+
+	static const UCHAR SHORT_WORD = 0x80;	// Word is SSHORT extended to SLONG
+
+	ULONG offset;		// Offset of the item in message
+	ULONG wire;			// Max length on the wire
+	USHORT length;		// Length of opaque data
+	Kind kind;
+	UCHAR count;		// Number of words
+	UCHAR words[4];		// Offsets of words in the item, maybe with SHORT_WORD
+};
+
 struct rem_fmt : public Firebird::GlobalStorage
 {
 	ULONG		fmt_length;
 	ULONG		fmt_net_length;
 	Firebird::Array<dsc> fmt_desc;
+	mutable Firebird::Array<XdrItem> fmt_xdr;	// Built on first use
 
 public:
 	explicit rem_fmt(FB_SIZE_T rpt) :
 		fmt_length(0), fmt_net_length(0),
-		fmt_desc(getPool(), rpt)
+		fmt_desc(getPool(), rpt), fmt_xdr(getPool())
 	{
 		fmt_desc.grow(rpt);
 	}
@@ -488,6 +538,8 @@ struct Rsr : public Firebird::GlobalStorage, public TypedHandle<rem_type_rsr>
 	Firebird::string rsr_cursor_name;	// Name for cursor to be set on open
 	bool			rsr_delayed_format;	// Out format was delayed on execute, set it on fetch
 	unsigned int	rsr_timeout;		// Statement timeout to be set on open\execute
+	ULONG			rsr_inline_blob_size;	// Max size of blob to be sent inline with a row
+	ULONG			rsr_inline_blob_space;	// Free space of the client's inline blob cache
 	Rsr**			rsr_self;
 
 	ULONG			rsr_batch_size;		// Aligned message size for IBatch operations
@@ -528,6 +580,42 @@ struct Rsr : public Firebird::GlobalStorage, public TypedHandle<rem_type_rsr>
 	};
 	BatchStream		rsr_batch_stream;
 
+	// Adaptive prefetch of rows: network round trip time and the time the
+	// application spends per row are measured to keep enough rows requested
+	// in advance, so the application does not wait for the network.
+	struct Prefetch
+	{
+		static const USHORT MAX_BATCHES = 8;	// Max batches in pipeline
+		static const ULONG MAX_ROWS = MAX_SSHORT;	// rsr_msgs_waiting should not overflow
+
+		Prefetch()
+			: batches(*getDefaultMemoryPool()), rtt(0), interval(0), returned(0), limit(0), batch(0)
+		{ }
+
+		struct Batch
+		{
+			SINT64 sent;		// Send time, 0 - not to be measured
+			ULONG rows;			// Rows requested and not received yet
+		};
+
+		Firebird::HalfStaticArray<Batch, MAX_BATCHES> batches;	// Batches in pipeline
+		SINT64 rtt;				// Round trip time, counter ticks
+		SINT64 interval;		// Time the application spends per row, 0 - unknown yet
+		SINT64 returned;		// When the last row was returned to the application
+		ULONG limit;			// Max rows to keep ahead, 0 - adaptive mode is off
+		USHORT batch;			// Size of the regular batch
+
+		void setup(ULONG bufferSize, ULONG rowLength, USHORT batchSize);
+		void reset();
+		void batchSent(ULONG rows, bool measure);
+		void responseReceived(bool row);
+		ULONG batchDone();
+		void fetchStarted();
+		void fetchDone();
+		ULONG target() const;
+	};
+	Prefetch		rsr_prefetch;
+
 public:
 	// Values for rsr_flags.
 	enum : USHORT {
@@ -552,7 +640,8 @@ public:
 		rsr_format(0), rsr_message(0), rsr_buffer(0), rsr_status(0),
 		rsr_id(0), rsr_fmt_length(0),
 		rsr_rows_pending(0), rsr_msgs_waiting(0), rsr_reorder_level(0), rsr_batch_count(0),
-		rsr_cursor_name(getPool()), rsr_delayed_format(false), rsr_timeout(0), rsr_self(NULL),
+		rsr_cursor_name(getPool()), rsr_delayed_format(false), rsr_timeout(0),
+		rsr_inline_blob_size(0), rsr_inline_blob_space(0), rsr_self(NULL),
 		rsr_fetch_operation(fetch_next), rsr_fetch_position(0)
 	{ }
 
@@ -585,6 +674,9 @@ public:
 	void checkCursor();
 	void checkBatch();
 
+	bool needPrefetch() const;
+	USHORT getPrefetchBatch() const;
+
 	SLONG getCursorAdjustment() const
 	{
 		if (rsr_fetch_operation != fetch_next && rsr_fetch_operation != fetch_prior)
@@ -1063,7 +1155,8 @@ struct rem_port : public Firebird::GlobalStorage, public Firebird::RefCounted
 	USHORT			port_flags;			// Misc flags
 	std::atomic<bool>
 					port_partial_data,	// Physical packet doesn't contain all API packet
-					port_z_data;		// Zlib incoming buffer has data left after decompression
+					port_z_data;		// Incoming compressed buffer has data left after decompression
+	bool			port_polled;		// Socket is armed in server's epoll set
 	SLONG			port_connect_timeout;   // Connection timeout value
 	SLONG			port_dummy_packet_interval; // keep alive dummy packet interval
 	SLONG			port_dummy_timeout;	// time remaining until keepalive packet
@@ -1128,7 +1221,8 @@ struct rem_port : public Firebird::GlobalStorage, public Firebird::RefCounted
 	FB_UINT64 port_rcv_bytes;
 
 #ifdef WIRE_COMPRESS_SUPPORT
-	z_stream port_send_stream, port_recv_stream;
+	Firebird::AutoPtr<WireCompressor> port_compressor;
+	WireCompressor::Stream port_send_stream, port_recv_stream;
 	UCharArrayAutoPtr	port_compressed;
 #endif
 
@@ -1143,7 +1237,7 @@ public:
 		port_type(t), port_state(PENDING), port_clients(0), port_next(0),
 		port_parent(0), port_async(0), port_async_receive(0),
 		port_server(0), port_server_flags(0), port_protocol(0), port_buff_size(rpt / 2),
-		port_flags(0), port_partial_data(false), port_z_data(false),
+		port_flags(0), port_partial_data(false), port_z_data(false), port_polled(false),
 		port_connect_timeout(0), port_dummy_packet_interval(0),
 		port_dummy_timeout(0), port_handle(INVALID_SOCKET), port_channel(INVALID_SOCKET), port_context(0),
 		port_events_thread(0), port_thread_guard(0),
@@ -1187,8 +1281,7 @@ private:
 	friend class Firebird::RefPtr<rem_port>;
 
 public:
-	void initCompression();
-	static bool checkCompression();
+	void initCompression(USHORT acceptType);
 	void linkParent(rem_port* const parent);
 	void unlinkParent();
 	Firebird::RefPtr<const Firebird::Config> getPortConfig();
@@ -1368,6 +1461,7 @@ public:
 	ISC_STATUS	receive_after_start(P_DATA*, PACKET*, Firebird::IStatus*);
 	ISC_STATUS	receive_msg(P_DATA*, PACKET*);
 	ISC_STATUS	seek_blob(P_SEEK*, PACKET*);
+	void		send_inline_blobs(Rsr*, const UCHAR*, PACKET*);
 	ISC_STATUS	send_msg(P_DATA*, PACKET*);
 	ISC_STATUS	send_response(PACKET*, OBJCT, ULONG, const ISC_STATUS*, bool);
 	ISC_STATUS	send_response(PACKET* p, OBJCT obj, ULONG length, const Firebird::IStatus* status, bool defer_flag);
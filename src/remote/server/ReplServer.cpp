@@ -342,6 +342,35 @@ namespace
 #endif
 	};
 
+	// Track the transactions active at the current position of the journal
+
+	void trackTransaction(TransactionList& transactions, const Block* header,
+						  FB_UINT64 sequence, bool rewind)
+	{
+		const auto traNumber = header->traNumber;
+
+		if (header->flags & BLOCK_END_TRANS)
+		{
+			if (traNumber)
+			{
+				FB_SIZE_T pos;
+				if (transactions.find(traNumber, pos))
+					transactions.remove(pos);
+			}
+			else if (!rewind)
+			{
+				transactions.clear();
+			}
+		}
+		else if (header->flags & BLOCK_BEGIN_TRANS)
+		{
+			fb_assert(traNumber);
+
+			if (!rewind && !transactions.exist(traNumber))
+				transactions.add(ActiveTransaction(traNumber, sequence));
+		}
+	}
+
 	class Target : public GlobalStorage
 	{
 	public:
@@ -349,7 +378,9 @@ namespace
 			: m_config(config),
 			  m_attachment(nullptr), m_replicator(nullptr),
 			  m_sequence(0), m_connected(false),
-			  m_lastError(getPool()), m_errorSequence(0), m_errorOffset(0)
+			  m_lastError(getPool()), m_errorSequence(0), m_errorOffset(0),
+			  m_batch(getPool()), m_batchOffset(0),
+			  m_batchBlocks(getPool()), m_batchTransactions(getPool())
 		{
 		}
 
@@ -429,19 +460,54 @@ namespace
 			m_attachment = nullptr;
 			m_sequence = 0;
 			m_connected = false;
+			clearBatch();
 		}
 
-		void replicate(FB_UINT64 sequence, ULONG offset, ULONG length, const UCHAR* data)
+		void replicate(FB_UINT64 sequence, ULONG offset, ULONG length, const UCHAR* data,
+					   const TransactionList& transactions, bool rewind)
 		{
-#ifdef NO_DATABASE
-			return true;
-#else
-			fb_assert(m_replicator);
+			// Parallel apply needs many blocks at once to find the independent ones
+			if (m_config->applyParallelWorkers > 1)
+			{
+				if (m_batch.isEmpty())
+				{
+					m_batchOffset = offset;
+					m_batchTransactions.assign(transactions);
+				}
 
-			FbLocalStatus localStatus;
-			m_replicator->process(&localStatus, length, data);
-			checkCompletion(localStatus, sequence, offset);
-#endif
+				m_batch.add(data, length);
+
+				BatchBlock& block = m_batchBlocks.add();
+				block.offset = offset + length;
+				block.rewind = rewind;
+				return;
+			}
+
+			process(sequence, offset, length, data);
+		}
+
+		// Pass the pending blocks to the replica if there are enough of them,
+		// return true if nothing is pending anymore
+		bool flush(FB_UINT64 sequence, bool force, ControlFile& control)
+		{
+			if (m_batch.hasData() && (force || m_batch.getCount() >= MAX_BATCH_LENGTH))
+			{
+				try
+				{
+					process(sequence, m_batchOffset, m_batch.getCount(), m_batch.begin());
+				}
+				catch (const status_exception& ex)
+				{
+					// Workers could commit some transactions of the batch already,
+					// continue after them rather than apply them again
+					saveApplied(sequence, ex.value(), control);
+					throw;
+				}
+
+				clearBatch();
+			}
+
+			return m_batch.isEmpty();
 		}
 
 		bool isShutdown() const
@@ -503,6 +569,65 @@ namespace
 		}
 
 	private:
+		static const ULONG MAX_BATCH_LENGTH = 4 * 1024 * 1024;	// 4 MB
+
+		struct BatchBlock
+		{
+			ULONG offset;		// segment offset after the block
+			bool rewind;		// block is replayed
+		};
+
+		void clearBatch()
+		{
+			m_batch.clear();
+			m_batchBlocks.clear();
+			m_batchTransactions.clear();
+		}
+
+		// Save the position after the leading blocks of the batch the replica
+		// reports as applied, transactions are ended there in the journal order
+		void saveApplied(FB_UINT64 sequence, const ISC_STATUS* status, ControlFile& control)
+		{
+			ULONG applied = 0;
+
+			for (const ISC_STATUS* ptr = status; ptr[0] == isc_arg_gds; ptr = fb_utils::nextCode(ptr))
+			{
+				if (ptr[1] == isc_repl_applied && ptr[2] == isc_arg_number)
+					applied = (ULONG) ptr[3];
+			}
+
+			TransactionList transactions(getPool());
+			transactions.assign(m_batchTransactions);
+
+			ULONG length = 0, offset = 0;
+
+			for (const auto& block : m_batchBlocks)
+			{
+				const Block* const header = (const Block*) (m_batch.begin() + length);
+				length += sizeof(Block) + header->length;
+
+				if (length > applied)
+					break;
+
+				trackTransaction(transactions, header, sequence, block.rewind);
+				offset = block.offset;
+			}
+
+			if (offset)
+				control.savePartial(sequence, offset, transactions);
+		}
+
+		void process(FB_UINT64 sequence, ULONG offset, ULONG length, const UCHAR* data)
+		{
+#ifndef NO_DATABASE
+			fb_assert(m_replicator);
+
+			FbLocalStatus localStatus;
+			m_replicator->process(&localStatus, length, data);
+			checkCompletion(localStatus, sequence, offset);
+#endif
+		}
+
 		AutoPtr<const Replication::Config> m_config;
 		RefPtr<IAttachment> m_attachment;
 		RefPtr<IReplicator> m_replicator;
@@ -511,6 +636,10 @@ namespace
 		string m_lastError;
 		FB_UINT64 m_errorSequence;
 		ULONG m_errorOffset;
+		Array<UCHAR> m_batch;
+		ULONG m_batchOffset;
+		Array<BatchBlock> m_batchBlocks;
+		TransactionList m_batchTransactions;	// active at the batch start
 	};
 
 	typedef Array<Target*> TargetList;
@@ -598,29 +727,10 @@ namespace
 
 		if (!rewind || !traNumber || transactions.exist(traNumber))
 		{
-			target->replicate(sequence, offset, length, data);
+			target->replicate(sequence, offset, length, data, transactions, rewind);
 		}
 
-		if (header->flags & BLOCK_END_TRANS)
-		{
-			if (traNumber)
-			{
-				FB_SIZE_T pos;
-				if (transactions.find(traNumber, pos))
-					transactions.remove(pos);
-			}
-			else if (!rewind)
-			{
-				transactions.clear();
-			}
-		}
-		else if (header->flags & BLOCK_BEGIN_TRANS)
-		{
-			fb_assert(traNumber);
-
-			if (!rewind && !transactions.exist(traNumber))
-				transactions.add(ActiveTransaction(traNumber, sequence));
-		}
+		trackTransaction(transactions, header, sequence, rewind);
 	}
 
 	enum ProcessStatus { PROCESS_SUSPEND, PROCESS_CONTINUE, PROCESS_ERROR, PROCESS_SHUTDOWN };
@@ -872,9 +982,12 @@ namespace
 
 					totalLength += length;
 
-					control.savePartial(sequence, totalLength, transactions);
+					// Position is saved only when the blocks are applied
+					if (target->flush(sequence, false, control))
+						control.savePartial(sequence, totalLength, transactions);
 				}
 
+				target->flush(sequence, true, control);
 				control.saveComplete(sequence, transactions);
 
 				file.release();
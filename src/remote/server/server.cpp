@@ -709,7 +709,7 @@ public:
 				}
 
 				if (send->p_acpt.p_acpt_type & pflag_compress)
-					authPort->initCompression();
+					authPort->initCompression(send->p_acpt.p_acpt_type);
 				authPort->send(send);
 				if (send->p_acpt.p_acpt_type & pflag_compress)
 					authPort->port_flags |= PORT_compressed;
@@ -1239,6 +1239,8 @@ public:
 	static void shutdown();
 
 private:
+	static int getMinThreads();
+
 	Worker* m_next;
 	Worker* m_prev;
 	Semaphore m_sem;
@@ -1910,7 +1912,7 @@ static bool accept_connection(rem_port* port, P_CNCT* connect, PACKET* send)
 	P_ARCH architecture = arch_generic;
 	USHORT version = 0;
 	USHORT type = 0;
-	bool compress = false;
+	USHORT compressFlags = 0;
 	bool accepted = false;
 	USHORT weight = 0;
 	const p_cnct::p_cnct_repeat* protocol = connect->p_cnct_versions;
@@ -1920,7 +1922,8 @@ static bool accept_connection(rem_port* port, P_CNCT* connect, PACKET* send)
 	{
 		if ((protocol->p_cnct_version == PROTOCOL_VERSION10 ||
 			 (protocol->p_cnct_version >= PROTOCOL_VERSION11 &&
-			  protocol->p_cnct_version <= PROTOCOL_VERSION18)) &&
+			  protocol->p_cnct_version <= PROTOCOL_VERSION18) ||
+			 protocol->p_cnct_version == PROTOCOL_INLINE_BLOB) &&
 			 (protocol->p_cnct_architecture == arch_generic ||
 			  protocol->p_cnct_architecture == ARCHITECTURE) &&
 			protocol->p_cnct_weight >= weight)
@@ -1930,21 +1933,37 @@ static bool accept_connection(rem_port* port, P_CNCT* connect, PACKET* send)
 			version = protocol->p_cnct_version;
 			architecture = protocol->p_cnct_architecture;
 			type = MIN(protocol->p_cnct_max_type & ptype_MASK, ptype_lazy_send);
-			compress = protocol->p_cnct_max_type & pflag_compress;
+			compressFlags = protocol->p_cnct_max_type & ~ptype_MASK;
 		}
 	}
 
 	HANDSHAKE_DEBUG(fprintf(stderr, "Srv: accept_connection: protoaccept a=%d (v>=13)=%d %d %d\n",
 					accepted, version >= PROTOCOL_VERSION13, version, PROTOCOL_VERSION13));
 
+	Firebird::ClumpletReader id(Firebird::ClumpletReader::UnTagged,
+								connect->p_cnct_user_id.cstr_address,
+								connect->p_cnct_user_id.cstr_length);
+
+	// Choose compression algorithm in the order preferred by client
+	USHORT compress = 0;
+#ifdef WIRE_COMPRESS_SUPPORT
+	if (compressFlags)
+	{
+		const bool hasOrder = id.find(CNCT_client_compress);
+		const WireCompressor::Algorithm algorithm = WireCompressor::select(compressFlags,
+			hasOrder ? id.getBytes() : NULL, hasOrder ? id.getClumpLength() : 0);
+		compress = WireCompressor::acceptFlags(algorithm);
+	}
+#endif
+
 	send->p_acpd.p_acpt_version = port->port_protocol = version;
 	send->p_acpd.p_acpt_architecture = architecture;
-	send->p_acpd.p_acpt_type = type | (compress ? pflag_compress : 0);
+	send->p_acpd.p_acpt_type = type | compress;
 	send->p_acpd.p_acpt_authenticated = 0;
 
 	send->p_acpt.p_acpt_version = port->port_protocol = version;
 	send->p_acpt.p_acpt_architecture = architecture;
-	send->p_acpt.p_acpt_type = type | (compress ? pflag_compress : 0);
+	send->p_acpt.p_acpt_type = type | compress;
 
 	// modify the version string to reflect the chosen protocol
 	string buffer;
@@ -1961,10 +1980,6 @@ static bool accept_connection(rem_port* port, P_CNCT* connect, PACKET* send)
 
 	port->port_client_arch = connect->p_cnct_client;
 
-	Firebird::ClumpletReader id(Firebird::ClumpletReader::UnTagged,
-								connect->p_cnct_user_id.cstr_address,
-								connect->p_cnct_user_id.cstr_length);
-
 	if (accepted)
 	{
 		// Setup correct configuration for port
@@ -2130,7 +2145,7 @@ static bool accept_connection(rem_port* port, P_CNCT* connect, PACKET* send)
 
 	send->p_operation = returnData ? op_accept_data : op_accept;
 	if (send->p_acpt.p_acpt_type & pflag_compress)
-		port->initCompression();
+		port->initCompression(send->p_acpt.p_acpt_type);
 	port->send(send);
 	if (send->p_acpt.p_acpt_type & pflag_compress)
 		port->port_flags |= PORT_compressed;
@@ -2159,7 +2174,7 @@ void ConnectAuth::accept(PACKET* send, Auth::WriterImplementation*)
 		authPort->extractNewKeys(s);
 		send->p_acpd.p_acpt_authenticated = 1;
 		if (send->p_acpt.p_acpt_type & pflag_compress)
-			authPort->initCompression();
+			authPort->initCompression(send->p_acpt.p_acpt_type);
 		authPort->send(send);
 		if (send->p_acpt.p_acpt_type & pflag_compress)
 			authPort->port_flags |= PORT_compressed;
@@ -3880,6 +3895,8 @@ ISC_STATUS rem_port::execute_statement(P_OP op, P_SQLDATA* sqldata, PACKET* send
 		{
 			transaction->rtr_cursors.add(statement);
 			statement->rsr_delayed_format = !out_blr_length;
+			statement->rsr_inline_blob_size = (port_protocol >= PROTOCOL_INLINE_BLOB) ?
+				MIN(sqldata->p_sqldata_inline_blob_size, MAX_USHORT) : 0;
 		}
 	}
 	else
@@ -3944,6 +3961,11 @@ ISC_STATUS rem_port::fetch(P_SQLDATA * sqldata, PACKET* sendL, bool scroll)
 	const auto operation = scroll ? sqldata->p_sqldata_fetch_op : fetch_next;
 	const auto position = scroll ? sqldata->p_sqldata_fetch_pos : 0;
 
+	// Don't send more inline blobs than the client is able to keep
+
+	statement->rsr_inline_blob_space = (port_protocol >= PROTOCOL_INLINE_BLOB) ?
+		sqldata->p_sqldata_inline_blob_space : 0;
+
 	// Whether we're fetching in the forward direction
 	const bool forward =
 		(operation == fetch_next || operation == fetch_last ||
@@ -4190,7 +4212,10 @@ ISC_STATUS rem_port::fetch(P_SQLDATA * sqldata, PACKET* sendL, bool scroll)
 			statement->rsr_msgs_waiting--;
 		}
 
-		// There's a buffer waiting -- send it
+		// There's a buffer waiting -- send it, preceded by the small blobs it refers to
+
+		if (statement->rsr_inline_blob_size)
+			this->send_inline_blobs(statement, message->msg_address, sendL);
 
 		this->send_partial(sendL);
 
@@ -4297,6 +4322,166 @@ ISC_STATUS rem_port::fetch(P_SQLDATA * sqldata, PACKET* sendL, bool scroll)
 }
 
 
+void rem_port::send_inline_blobs(Rsr* statement, const UCHAR* message, PACKET* sendL)
+{
+/*****************************************
+ *
+ *	s e n d _ i n l i n e _ b l o b s
+ *
+ *****************************************
+ *
+ * Functional description
+ *	Send the contents of blobs referenced by the fetched row
+ *	that are not longer than the limit set by the client and
+ *	fit the free space of the client's cache. This saves the
+ *	client the round trips needed to open, read and close
+ *	every such blob.
+ *
+ *****************************************/
+	static const UCHAR blob_items[] =
+	{
+		isc_info_blob_num_segments,
+		isc_info_blob_max_segment,
+		isc_info_blob_total_length,
+		isc_info_blob_type,
+		isc_info_end
+	};
+
+	const rem_fmt* const format = statement->rsr_format;
+	Rtr* const transaction = statement->rsr_rtr;
+
+	if (!format || !transaction || !transaction->rtr_iface)
+		return;
+
+	const dsc* const end = format->fmt_desc.end();
+
+	for (const dsc* desc = format->fmt_desc.begin();
+		 desc < end && statement->rsr_inline_blob_space; desc++)
+	{
+		if (desc->dsc_dtype != dtype_blob)
+			continue;
+
+		// Every field of the SQL message is followed by its NULL indicator
+
+		const dsc* const null_desc = desc + 1;
+
+		if (null_desc < end && null_desc->dsc_dtype == dtype_short &&
+			*(SSHORT*) (message + (IPTR) null_desc->dsc_address))
+		{
+			continue;
+		}
+
+		ISC_QUAD blob_id;
+		memcpy(&blob_id, message + (IPTR) desc->dsc_address, sizeof(blob_id));
+
+		if (!blob_id.gds_quad_high && !blob_id.gds_quad_low)
+			continue;
+
+		LocalStatus ls;
+		CheckStatusWrapper status_vector(&ls);
+
+		ServBlob blob(statement->rsr_rdb->rdb_iface->openBlob(&status_vector,
+			transaction->rtr_iface, &blob_id, 0, NULL));
+
+		if (status_vector.getState() & IStatus::STATE_ERRORS)
+			continue;
+
+		UCHAR info[64];
+		blob->getInfo(&status_vector, sizeof(blob_items), blob_items, sizeof(info), info);
+
+		ULONG info_length = 0, total_length = MAX_ULONG;
+
+		if (!(status_vector.getState() & IStatus::STATE_ERRORS))
+		{
+			for (ClumpletReader p(ClumpletReader::InfoResponse, info, sizeof(info)); !p.isEof(); p.moveNext())
+			{
+				const UCHAR item = p.getClumpTag();
+
+				if (item == isc_info_end)
+				{
+					info_length = p.getCurOffset() + 1;
+					break;
+				}
+
+				if (item == isc_info_blob_total_length)
+					total_length = p.getInt();
+			}
+		}
+
+		// Read the whole blob as a sequence of segments, each one prefixed
+		// by its length, just like get_segment() does
+
+		HalfStaticArray<UCHAR, BLOB_LENGTH> data;
+		bool fits = info_length && total_length <= statement->rsr_inline_blob_size &&
+			total_length + info_length <= statement->rsr_inline_blob_space;
+		ULONG read = 0;
+
+		while (fits)
+		{
+			const FB_SIZE_T offset = data.getCount();
+			const ULONG remaining = total_length - read;
+
+			if (offset + 2 + remaining > MAX_USHORT)
+			{
+				fits = false;
+				break;
+			}
+
+			UCHAR* p = data.getBuffer(offset + 2 + remaining) + offset;
+
+			unsigned length = 0;
+			const int cc = blob->getSegment(&status_vector, remaining, p + 2, &length);
+
+			if (cc == IStatus::RESULT_NO_DATA)
+			{
+				data.shrink(offset);
+				break;
+			}
+
+			if (cc != IStatus::RESULT_OK)
+			{
+				fits = false;
+				break;
+			}
+
+			p[0] = (UCHAR) length;
+			p[1] = (UCHAR) (length >> 8);
+			data.shrink(offset + 2 + length);
+			read += length;
+		}
+
+		blob->close(&status_vector);
+
+		if (status_vector.getState() & IStatus::STATE_ERRORS)
+			fits = false;
+		else
+			blob = NULL;
+
+		if (!fits || data.getCount() + info_length > statement->rsr_inline_blob_space)
+			continue;
+
+		statement->rsr_inline_blob_space -= data.getCount() + info_length;
+
+		P_INLINE_BLOB* const p_blob = &sendL->p_inline_blob;
+		p_blob->p_tran_id = transaction->rtr_id;
+		p_blob->p_stmt_id = statement->rsr_id;
+		p_blob->p_blob_id = blob_id;
+		p_blob->p_blob_info.cstr_length = info_length;
+		p_blob->p_blob_info.cstr_address = info;
+		p_blob->p_blob_data.cstr_length = data.getCount();
+		p_blob->p_blob_data.cstr_address = data.begin();
+
+		const P_OP operation = sendL->p_operation;
+		sendL->p_operation = op_inline_blob;
+		this->send_partial(sendL);
+		sendL->p_operation = operation;
+
+		p_blob->p_blob_info.cstr_address = NULL;
+		p_blob->p_blob_data.cstr_address = NULL;
+	}
+}
+
+
 static bool get_next_msg_no(Rrq* request, USHORT incarnation, USHORT * msg_number)
 {
 /**************************************
@@ -7036,8 +7221,9 @@ bool Worker::wait(int timeout)
 	if (m_sem.tryEnter(0))
 		return true;
 
-	// don't exit last worker until server shutdown
-	if ((m_cntAll - m_cntGoing == 1) && !isShuttingDown())
+	// Keep one warm worker per CPU until server shutdown - thread creation
+	// should not be paid on each burst of requests after a pause
+	if ((m_cntAll - m_cntGoing <= getMinThreads()) && !isShuttingDown())
 		return true;
 
 	remove();
@@ -7047,6 +7233,27 @@ bool Worker::wait(int timeout)
 	return false;
 }
 
+int Worker::getMinThreads()
+{
+	// Initialized once in a thread-safe way, as workers call it concurrently
+
+	static const int minThreads = []()
+	{
+#ifdef WIN_NT
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		const int cpus = (int) si.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+		const int cpus = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#else
+		const int cpus = 1;
+#endif
+		return MAX(cpus, 1);
+	}();
+
+	return minThreads;
+}
+
 void Worker::setState(const bool active)
 {
 	if (m_active == active)
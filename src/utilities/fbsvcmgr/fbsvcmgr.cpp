@@ -563,6 +563,8 @@ const SvcSwitches nbackOptions[] =
 	{"nbk_clean_history", putSingleTag, 0, isc_spb_nbk_clean_history, 0},
 	{"nbk_keep_days", putIntArgument, 0, isc_spb_nbk_keep_days, 0},
 	{"nbk_keep_rows", putIntArgument, 0, isc_spb_nbk_keep_rows, 0},
+	{"nbk_compress", putIntArgument, 0, isc_spb_nbk_compress, 0},
+	{"nbk_parallel_workers", putIntArgument, 0, isc_spb_nbk_parallel_workers, 0},
 	{0, 0, 0, 0, 0}
 };
 
@@ -572,6 +574,7 @@ const SvcSwitches nrestOptions[] =
 	{"nbk_file", putStringArgument, 0, isc_spb_nbk_file, 0},
 	{"nbk_inplace", putOption, 0, isc_spb_nbk_inplace, 0},
 	{"nbk_sequence", putOption, 0, isc_spb_nbk_sequence, 0},
+	{"nbk_parallel_workers", putIntArgument, 0, isc_spb_nbk_parallel_workers, 0},
 	{0, 0, 0, 0, 0}
 };
 
@@ -0,0 +1,403 @@
+/*
+ *	PROGRAM:	Firebird utilities
+ *	MODULE:		BackupCodec.cpp
+ *	DESCRIPTION:	Parallel compression of nbackup files
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#include "firebird.h"
+#include "ibase.h"
+#include "../utilities/nbackup/BackupCodec.h"
+#include "../common/classes/init.h"
+#include "../common/classes/zip.h"
+#include "../common/StatusArg.h"
+
+using namespace Firebird;
+
+namespace
+{
+	const ULONG ZSTD_FRAME_MAGIC = 0xFD2FB528;
+	const ULONG SKIPPABLE_FRAME_MAGIC = 0x184D2A5E;
+	const ULONG SEEKABLE_MAGIC = 0x8F92EAB1;
+
+	const FB_SIZE_T SKIPPABLE_HEADER_LENGTH = 8;
+	const FB_SIZE_T SEEK_ENTRY_LENGTH = 8;
+	const ULONG MAX_FRAMES = 0x8000000;
+
+	// Frames to process per worker at once, it smooths the difference
+	// in compression speed of the frames
+	const int FRAMES_PER_WORKER = 2;
+
+	// Values of the seekable format are little endian whatever the platform is
+
+	void putLong(UCharBuffer& buffer, ULONG value)
+	{
+		const UCHAR bytes[4] = {(UCHAR) value, (UCHAR) (value >> 8),
+			(UCHAR) (value >> 16), (UCHAR) (value >> 24)};
+		buffer.add(bytes, sizeof(bytes));
+	}
+
+	ULONG getLong(const UCHAR* ptr)
+	{
+		return (ULONG) ptr[0] | ((ULONG) ptr[1] << 8) |
+			((ULONG) ptr[2] << 16) | ((ULONG) ptr[3] << 24);
+	}
+
+#ifdef HAVE_ZSTD_H
+	InitInstance<ZStd> zstd;
+#endif
+}
+
+
+BackupCodec::Item::Item(BackupCodec* codec)
+	: Task::WorkItem(codec),
+	  m_inuse(false),
+	  m_frame(0),
+	  m_context(NULL)
+{
+}
+
+BackupCodec::Item::~Item()
+{
+#ifdef HAVE_ZSTD_H
+	if (!m_context)
+		return;
+
+	if (getCodec()->m_compress)
+		zstd().ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(m_context));
+	else
+		zstd().ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(m_context));
+#endif
+}
+
+
+BackupCodec::BackupCodec(MemoryPool& pool, bool compress, int level, int workers)
+	: m_pool(pool),
+	  m_compress(compress),
+	  m_level(level),
+	  m_frames(pool),
+	  m_items(pool),
+	  m_entries(pool),
+	  m_coordinator(&pool),
+	  m_count(0),
+	  m_next(0),
+	  m_error(false),
+	  m_stream(NULL),
+	  m_streamPending(false)
+{
+	if (!isAvailable())
+		status_exception::raise(Arg::Gds(isc_nbackup_zstd_unavail));
+
+	workers = MAX(workers, 1);
+
+	for (int i = 0; i < workers; i++)
+		m_items.add(FB_NEW_POOL(m_pool) Item(this));
+
+	for (int i = 0; i < workers * FRAMES_PER_WORKER; i++)
+		m_frames.add();
+}
+
+BackupCodec::~BackupCodec()
+{
+	for (auto item : m_items)
+		delete item;
+
+#ifdef HAVE_ZSTD_H
+	if (m_stream)
+		zstd().ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(m_stream));
+#endif
+}
+
+bool BackupCodec::isAvailable()
+{
+#ifdef HAVE_ZSTD_H
+	return zstd();
+#else
+	return false;
+#endif
+}
+
+bool BackupCodec::isCompressed(const UCHAR* magic, FB_SIZE_T length)
+{
+	return length >= MAGIC_LENGTH && getLong(magic) == ZSTD_FRAME_MAGIC;
+}
+
+bool BackupCodec::process(unsigned count)
+{
+	fb_assert(count <= m_frames.getCount());
+
+	m_count = count;
+	m_next = 0;
+	m_error = false;
+
+	for (auto item : m_items)
+		item->m_inuse = false;
+
+	if (count)
+		m_coordinator.runSync(this);
+
+	return getResult(NULL);
+}
+
+void BackupCodec::addEntry(ULONG packedLength, ULONG plainLength)
+{
+	if (m_entries.getCount() >= MAX_FRAMES)
+		status_exception::raise(Arg::Gds(isc_random) << "Too many frames in backup file");
+
+	const Entry entry = {packedLength, plainLength};
+	m_entries.add(entry);
+}
+
+void BackupCodec::composeSeekTable(UCharBuffer& buffer) const
+{
+	const ULONG count = m_entries.getCount();
+
+	buffer.clear();
+	putLong(buffer, SKIPPABLE_FRAME_MAGIC);
+	putLong(buffer, count * SEEK_ENTRY_LENGTH + FOOTER_LENGTH);
+
+	for (const auto& entry : m_entries)
+	{
+		putLong(buffer, entry.packedLength);
+		putLong(buffer, entry.plainLength);
+	}
+
+	// Footer: number of frames, descriptor (no checksums) and magic
+	putLong(buffer, count);
+	buffer.add(0);
+	putLong(buffer, SEEKABLE_MAGIC);
+}
+
+ULONG BackupCodec::getSeekTableLength(const UCHAR* footer)
+{
+	if (getLong(footer + 5) != SEEKABLE_MAGIC)
+		return 0;
+
+	// Checksums and reserved bits are not supported
+	if (footer[4])
+		return 0;
+
+	const ULONG count = getLong(footer);
+
+	if (count > MAX_FRAMES)
+		return 0;
+
+	return SKIPPABLE_HEADER_LENGTH + count * SEEK_ENTRY_LENGTH + FOOTER_LENGTH;
+}
+
+bool BackupCodec::parseSeekTable(const UCHAR* data, ULONG length)
+{
+	m_entries.clear();
+
+	if (length < SKIPPABLE_HEADER_LENGTH + FOOTER_LENGTH ||
+		getSeekTableLength(data + length - FOOTER_LENGTH) != length ||
+		getLong(data) != SKIPPABLE_FRAME_MAGIC ||
+		getLong(data + 4) != length - SKIPPABLE_HEADER_LENGTH)
+	{
+		return false;
+	}
+
+	const ULONG count = getLong(data + length - FOOTER_LENGTH);
+	const UCHAR* ptr = data + SKIPPABLE_HEADER_LENGTH;
+
+	m_entries.grow(count);
+
+	for (auto& entry : m_entries)
+	{
+		entry.packedLength = getLong(ptr);
+		entry.plainLength = getLong(ptr + 4);
+		ptr += SEEK_ENTRY_LENGTH;
+
+		if (!entry.packedLength || entry.plainLength > FRAME_LENGTH)
+		{
+			m_entries.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool BackupCodec::decompressStream(const UCHAR* input, FB_SIZE_T inputLength, FB_SIZE_T& inputPos,
+								   UCHAR* output, FB_SIZE_T outputLength, FB_SIZE_T& outputPos)
+{
+#ifdef HAVE_ZSTD_H
+	ZSTD_DCtx* dctx = static_cast<ZSTD_DCtx*>(m_stream);
+
+	if (!dctx)
+	{
+		m_stream = dctx = zstd().ZSTD_createDCtx();
+		if (!dctx)
+			return false;
+	}
+
+	ZSTD_inBuffer in = {input, inputLength, inputPos};
+	ZSTD_outBuffer out = {output, outputLength, outputPos};
+
+	// Frames follow each other, the seek table frame is skipped by zstd.
+	// Zero result means the current frame is completed and flushed.
+	const size_t ret = zstd().ZSTD_decompressStream(dctx, &out, &in);
+
+	if (zstd().ZSTD_isError(ret))
+		return false;
+
+	inputPos = in.pos;
+	outputPos = out.pos;
+	m_streamPending = (ret != 0);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool BackupCodec::handler(WorkItem& wi)
+{
+	Item* const item = static_cast<Item*>(&wi);
+	Frame& frame = m_frames[item->m_frame];
+
+	try
+	{
+		if (m_compress ? compress(item, frame) : decompress(item, frame))
+			return true;
+	}
+	catch (const Exception&)
+	{
+		// Caller reports the error with the file name
+	}
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+	m_error = true;
+	return false;
+}
+
+bool BackupCodec::getWorkItem(WorkItem** pItem)
+{
+	Item* item = static_cast<Item*>(*pItem);
+
+	MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+	if (m_error || m_next >= m_count)
+		return false;
+
+	if (!item)
+	{
+		for (auto p : m_items)
+		{
+			if (!p->m_inuse)
+			{
+				p->m_inuse = true;
+				*pItem = item = p;
+				break;
+			}
+		}
+	}
+
+	if (!item)
+		return false;
+
+	item->m_frame = m_next++;
+	return true;
+}
+
+bool BackupCodec::getResult(IStatus* status)
+{
+	if (status)
+	{
+		status->init();
+
+		if (m_error)
+			(Arg::Gds(isc_random) << "Backup frame compression failed").copyTo(status);
+	}
+
+	return !m_error;
+}
+
+int BackupCodec::getMaxWorkers()
+{
+	return MIN(m_items.getCount(), m_count);
+}
+
+bool BackupCodec::compress(Item* item, Frame& frame)
+{
+#ifdef HAVE_ZSTD_H
+	ZSTD_CCtx* cctx = static_cast<ZSTD_CCtx*>(item->m_context);
+
+	if (!cctx)
+	{
+		item->m_context = cctx = zstd().ZSTD_createCCtx();
+		if (!cctx)
+			return false;
+
+		// Every frame is verified by its own checksum when decompressed
+		if (zstd().ZSTD_isError(zstd().ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, m_level)) ||
+			zstd().ZSTD_isError(zstd().ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1)))
+		{
+			return false;
+		}
+	}
+
+	const FB_SIZE_T length = frame.plain.getCount();
+	ZSTD_inBuffer in = {frame.plain.begin(), length, 0};
+	ZSTD_outBuffer out = {frame.packed.getBuffer(ZSTD_COMPRESSBOUND(length)), frame.packed.getCount(), 0};
+
+	// Whole input is passed with ZSTD_e_end, so the frame is completed
+	// (and its content size is stored) at once if the output has enough room
+
+	size_t ret;
+	while ((ret = zstd().ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_end)) != 0)
+	{
+		if (zstd().ZSTD_isError(ret))
+			return false;
+
+		out.dst = frame.packed.getBuffer(out.size + ret);
+		out.size = frame.packed.getCount();
+	}
+
+	frame.packed.shrink(out.pos);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool BackupCodec::decompress(Item* item, Frame& frame)
+{
+#ifdef HAVE_ZSTD_H
+	ZSTD_DCtx* dctx = static_cast<ZSTD_DCtx*>(item->m_context);
+
+	if (!dctx)
+	{
+		item->m_context = dctx = zstd().ZSTD_createDCtx();
+		if (!dctx)
+			return false;
+	}
+
+	ZSTD_inBuffer in = {frame.packed.begin(), frame.packed.getCount(), 0};
+	ZSTD_outBuffer out = {frame.plain.begin(), frame.plain.getCount(), 0};
+
+	// Frame must be complete and decompress exactly into the length
+	// recorded in the seek table
+	const size_t ret = zstd().ZSTD_decompressStream(dctx, &out, &in);
+
+	return !zstd().ZSTD_isError(ret) && ret == 0 &&
+		in.pos == in.size && out.pos == out.size;
+#else
+	return false;
+#endif
+}
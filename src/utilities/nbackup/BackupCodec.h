@@ -0,0 +1,160 @@
+/*
+ *	PROGRAM:	Firebird utilities
+ *	MODULE:		BackupCodec.h
+ *	DESCRIPTION:	Parallel compression of nbackup files
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ */
+
+#ifndef NBACKUP_BACKUP_CODEC_H
+#define NBACKUP_BACKUP_CODEC_H
+
+#include "../common/classes/alloc.h"
+#include "../common/classes/array.h"
+#include "../common/classes/objects_array.h"
+#include "../common/classes/locks.h"
+#include "../common/Task.h"
+
+// Compressed backup file is a sequence of independent zstd frames, each of
+// them holding FRAME_LENGTH bytes of the plain backup (the last one may be
+// shorter), followed by the seek table in a skippable frame as defined by
+// the zstd seekable format. Thus the file may be decompressed by the zstd
+// utility as well, while nbackup compresses and decompresses a batch of
+// frames at once using parallel workers. Backup read from a pipe can't be
+// rewound to get the seek table, it's decompressed sequentially instead.
+//
+// Codec doesn't do any I/O itself, the caller fills the frames of a batch,
+// processes them and then writes or consumes the results in order.
+
+class BackupCodec : public Firebird::Task
+{
+public:
+	static const ULONG FRAME_LENGTH = 4 * 1024 * 1024;
+
+	// Length of the zstd frame magic number and of the seek table footer
+	static const FB_SIZE_T MAGIC_LENGTH = 4;
+	static const FB_SIZE_T FOOTER_LENGTH = 9;
+
+	struct Frame
+	{
+		explicit Frame(MemoryPool& pool)
+			: plain(pool), packed(pool)
+		{}
+
+		Firebird::UCharBuffer plain;
+		Firebird::UCharBuffer packed;
+	};
+
+	struct Entry
+	{
+		ULONG packedLength;
+		ULONG plainLength;
+	};
+
+	BackupCodec(MemoryPool& pool, bool compress, int level, int workers);
+	~BackupCodec();
+
+	static bool isAvailable();
+	static bool isCompressed(const UCHAR* magic, FB_SIZE_T length);
+
+	// Batch of frames processed at once
+	unsigned getCapacity() const
+	{
+		return m_frames.getCount();
+	}
+
+	Frame& getFrame(unsigned n)
+	{
+		return m_frames[n];
+	}
+
+	// Compress or decompress the first count frames of the batch,
+	// frames to decompress must have their plain length reserved
+	bool process(unsigned count);
+
+	// Seek table
+	void addEntry(ULONG packedLength, ULONG plainLength);
+	void composeSeekTable(Firebird::UCharBuffer& buffer) const;
+
+	// Length of the whole seek table frame by its footer, zero if it's not valid
+	static ULONG getSeekTableLength(const UCHAR* footer);
+	bool parseSeekTable(const UCHAR* data, ULONG length);
+
+	FB_SIZE_T getEntryCount() const
+	{
+		return m_entries.getCount();
+	}
+
+	const Entry& getEntry(FB_SIZE_T n) const
+	{
+		return m_entries[n];
+	}
+
+	// Sequential decompression, used when the backup can't be rewound to read
+	// the seek table, e.g. when it's a pipe. Consumes the input and fills the
+	// output starting from the given positions and advances them.
+	bool decompressStream(const UCHAR* input, FB_SIZE_T inputLength, FB_SIZE_T& inputPos,
+						  UCHAR* output, FB_SIZE_T outputLength, FB_SIZE_T& outputPos);
+
+	// Whether the stream decompressed so far ends at the frame boundary
+	bool isStreamComplete() const
+	{
+		return !m_streamPending;
+	}
+
+	// Task implementation
+	bool handler(WorkItem& item) override;
+	bool getWorkItem(WorkItem** pItem) override;
+	bool getResult(Firebird::IStatus* status) override;
+	int getMaxWorkers() override;
+
+private:
+	class Item : public Task::WorkItem
+	{
+	public:
+		explicit Item(BackupCodec* codec);
+		~Item();
+
+		BackupCodec* getCodec() const
+		{
+			return reinterpret_cast<BackupCodec*>(m_task);
+		}
+
+		bool m_inuse;
+		unsigned m_frame;
+		void* m_context;	// ZSTD_CCtx or ZSTD_DCtx
+	};
+
+	bool compress(Item* item, Frame& frame);
+	bool decompress(Item* item, Frame& frame);
+
+	MemoryPool& m_pool;
+	const bool m_compress;
+	const int m_level;
+	Firebird::ObjectsArray<Frame> m_frames;
+	Firebird::HalfStaticArray<Item*, 8> m_items;
+	Firebird::Array<Entry> m_entries;
+	Firebird::Coordinator m_coordinator;
+	Firebird::Mutex m_mutex;
+	unsigned m_count;		// frames in the batch being processed
+	unsigned m_next;		// next frame to pick up by a worker
+	bool m_error;
+	void* m_stream;			// ZSTD_DCtx of the sequential decompression
+	bool m_streamPending;
+};
+
+#endif // NBACKUP_BACKUP_CODEC_H
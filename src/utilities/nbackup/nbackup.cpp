@@ -43,6 +43,7 @@
 #include "ibase.h"
 #include "../common/utils_proto.h"
 #include "../common/classes/array.h"
+#include "../common/classes/auto.h"
 #include "../common/classes/ClumpletWriter.h"
 #include "../utilities/nbackup/nbk_proto.h"
 #include "../jrd/license.h"
@@ -50,6 +51,9 @@
 #include "../common/classes/MsgPrint.h"
 #include "../common/classes/Switches.h"
 #include "../utilities/nbackup/nbkswi.h"
+#include "../utilities/nbackup/BackupCodec.h"
+#include "../common/Task.h"
+#include "../common/status.h"
 #include "../common/isc_f_proto.h"
 #include "../common/StatusArg.h"
 #include "../common/classes/objects_array.h"
@@ -92,6 +96,12 @@ namespace
 	using MsgFormat::SafeArg;
 	const USHORT nbackup_msg_fac = 24;
 
+	// Highest level supported by zstd
+	const int MAX_COMPRESS_LEVEL = 22;
+
+	// Input read at once when the compressed backup is decompressed sequentially
+	const FB_SIZE_T STREAM_CHUNK = 128 * 1024;
+
 	void printMsg(USHORT number, const SafeArg& arg, bool newLine = true)
 	{
 		char buffer[256];
@@ -275,12 +285,16 @@ public:
 
 	NBackup(UtilSvc* _uSvc, const PathName& _database, const string& _username, const string& _role,
 			const string& _password, bool _run_db_triggers, bool _direct_io, const string& _deco,
+			int _compress_level, int _parallel_workers,
 			CLEAN_HISTORY_KIND cleanHistKind, int keepHistValue)
 	  : uSvc(_uSvc), newdb(0), trans(0), database(_database),
 		username(_username), role(_role), password(_password),
 		run_db_triggers(_run_db_triggers), direct_io(_direct_io),
 		dbase(INVALID_HANDLE_VALUE), backup(INVALID_HANDLE_VALUE),
-		decompress(_deco), m_cleanHistKind(cleanHistKind), m_keepHistValue(keepHistValue),
+		decompress(_deco), compress_level(_compress_level), parallel_workers(_parallel_workers),
+		codec_frame(0), codec_frames(0), codec_offset(0), codec_entry(0),
+		codec_input(0), codec_stream(false),
+		m_cleanHistKind(cleanHistKind), m_keepHistValue(keepHistValue),
 		childId(0), db_size_pages(0),
 		m_odsNumber(0), m_silent(false), m_printed(false), m_flash_map(false)
 	{
@@ -338,6 +352,16 @@ private:
 	FILE_HANDLE dbase;
 	FILE_HANDLE backup;
 	string decompress;
+	int compress_level;		// zstd level, zero if backup is not compressed
+	int parallel_workers;
+	AutoPtr<BackupCodec> codec;
+	unsigned codec_frame;		// current frame of the batch
+	unsigned codec_frames;		// frames in the batch (restore only)
+	FB_SIZE_T codec_offset;		// position in the current frame (restore only)
+	FB_SIZE_T codec_entry;		// next frame of the seek table (restore only)
+	FB_SIZE_T codec_input;		// consumed part of the input (sequential restore only)
+	bool codec_stream;			// backup is decompressed sequentially (restore only)
+	UCharBuffer backup_peek;	// first bytes of the backup read to recognize it
 	const CLEAN_HISTORY_KIND m_cleanHistKind;
 	const int m_keepHistValue;
 #ifdef WIN_NT
@@ -354,8 +378,17 @@ private:
 
 	// IO functions
 	FB_SIZE_T read_file(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize);
+	FB_SIZE_T read_file_at(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize, SINT64 pos);
 	void write_file(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize);
 	void seek_file(FILE_HANDLE &file, SINT64 pos);
+	bool size_file(FILE_HANDLE &file, SINT64& size);
+
+	// Backup IO, compressed if codec is set
+	FB_SIZE_T read_backup(void *buffer, FB_SIZE_T bufsize);
+	void write_backup(void *buffer, FB_SIZE_T bufsize);
+	void flush_backup(bool last);
+	bool read_frames();
+	bool read_stream();
 
 	void pr_error(const ISC_STATUS* status, const char* operation);
 	void print_child_stderr();
@@ -377,8 +410,226 @@ private:
 
 	void open_backup_scan();
 	void open_backup_decompress();
+	void open_backup_codec();
 	void create_backup();
 	void close_backup();
+
+	// Incremental backup of the changed pages
+	class PageReader;
+	void backup_changed_pages(Ods::pag* header_page, ULONG page_size, ULONG prev_scn, ULONG backup_scn,
+		ULONG& page_reads, ULONG& page_writes);
+};
+
+
+// Reads runs of database pages in parallel, the runs are read by positional
+// IO, so workers share the database file handle. Pages to read are added in
+// ascending order, small gaps between them are read as well to make IO larger.
+
+class NBackup::PageReader : public Task
+{
+public:
+	struct Run
+	{
+		ULONG page;			// first page of the run
+		ULONG count;		// pages to read
+		FB_SIZE_T length;	// bytes actually read
+		UCHAR* data;
+	};
+
+	PageReader(NBackup* nbk, ULONG pageSize, int workers)
+		: m_nbk(nbk),
+		  m_pageSize(pageSize),
+		  m_batchPages(MAX(BATCH_LENGTH / pageSize, 1)),
+		  m_runPages(MAX(RUN_LENGTH / pageSize, 1)),
+		  m_gapPages(GAP_LENGTH / pageSize),
+		  m_pages(0),
+		  m_runs(*getDefaultMemoryPool()),
+		  m_buffer(*getDefaultMemoryPool()),
+		  m_items(*getDefaultMemoryPool()),
+		  m_coordinator(getDefaultMemoryPool()),
+		  m_next(0),
+		  m_stop(false)
+	{
+		UCHAR* const buf = m_buffer.getBuffer(m_batchPages * pageSize + SECTOR_ALIGNMENT);
+		m_data = FB_ALIGN(buf, SECTOR_ALIGNMENT);
+
+		for (int i = 0; i < MAX(workers, 1); i++)
+			m_items.add(FB_NEW_POOL(*getDefaultMemoryPool()) Item(this));
+	}
+
+	~PageReader()
+	{
+		for (auto item : m_items)
+			delete item;
+	}
+
+	bool isFull() const
+	{
+		return m_pages >= m_batchPages;
+	}
+
+	bool isEmpty() const
+	{
+		return m_runs.isEmpty();
+	}
+
+	// Page must be greater than the pages added before and the batch must not be full
+	void add(ULONG page)
+	{
+		fb_assert(!isFull());
+
+		if (m_runs.hasData())
+		{
+			Run& run = m_runs.back();
+			const ULONG end = run.page + run.count;
+			fb_assert(page >= end);
+
+			if (page - end <= m_gapPages &&
+				page - run.page < m_runPages &&
+				m_pages + page - end < m_batchPages)
+			{
+				m_pages += page + 1 - end;
+				run.count = page + 1 - run.page;
+				return;
+			}
+		}
+
+		const Run run = {page, 1, 0, m_data + (FB_SIZE_T) m_pages * m_pageSize};
+		m_runs.add(run);
+		m_pages++;
+	}
+
+	// Read all the runs of the batch
+	void read()
+	{
+		m_next = 0;
+		m_stop = false;
+
+		for (auto item : m_items)
+			item->m_inuse = false;
+
+		m_coordinator.runSync(this);
+
+		if (!m_status.isSuccess())
+			m_status.raise();
+	}
+
+	const Array<Run>& getRuns() const
+	{
+		return m_runs;
+	}
+
+	void clear()
+	{
+		m_runs.clear();
+		m_pages = 0;
+	}
+
+	bool handler(WorkItem& wi) override
+	{
+		Item* const item = static_cast<Item*>(&wi);
+		Run& run = m_runs[item->m_run];
+
+		try
+		{
+			run.length = m_nbk->read_file_at(m_nbk->dbase, run.data,
+				(FB_SIZE_T) run.count * m_pageSize, (SINT64) run.page * m_pageSize);
+		}
+		catch (const Exception& ex)
+		{
+			FbLocalStatus status;
+			ex.stuffException(&status);
+
+			MutexLockGuard guard(m_mutex, FB_FUNCTION);
+			if (m_status.isSuccess())
+				m_status.save(&status);
+			m_stop = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool getWorkItem(WorkItem** pItem) override
+	{
+		Item* item = static_cast<Item*>(*pItem);
+
+		MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+		if (m_stop || m_next >= m_runs.getCount())
+			return false;
+
+		if (!item)
+		{
+			for (auto p : m_items)
+			{
+				if (!p->m_inuse)
+				{
+					p->m_inuse = true;
+					*pItem = item = p;
+					break;
+				}
+			}
+		}
+
+		if (!item)
+			return false;
+
+		item->m_run = m_next++;
+		return true;
+	}
+
+	bool getResult(IStatus* status) override
+	{
+		if (status)
+		{
+			status->init();
+			status->setErrors(m_status.getErrors());
+		}
+
+		return m_status.isSuccess();
+	}
+
+	int getMaxWorkers() override
+	{
+		return MIN(m_items.getCount(), m_runs.getCount());
+	}
+
+private:
+	// Total length of the runs read at once, maximum length of a run
+	// and maximum length of unchanged pages read to join two runs
+	static const ULONG BATCH_LENGTH = 32 * 1024 * 1024;
+	static const ULONG RUN_LENGTH = 1024 * 1024;
+	static const ULONG GAP_LENGTH = 64 * 1024;
+
+	class Item : public Task::WorkItem
+	{
+	public:
+		explicit Item(PageReader* reader)
+			: Task::WorkItem(reader),
+			  m_inuse(false),
+			  m_run(0)
+		{}
+
+		bool m_inuse;
+		FB_SIZE_T m_run;
+	};
+
+	NBackup* const m_nbk;
+	const ULONG m_pageSize;
+	const ULONG m_batchPages;
+	const ULONG m_runPages;
+	const ULONG m_gapPages;
+	ULONG m_pages;				// pages in the batch
+	Array<Run> m_runs;
+	Array<UCHAR> m_buffer;
+	UCHAR* m_data;				// aligned buffer of the batch
+	HalfStaticArray<Item*, 8> m_items;
+	Coordinator m_coordinator;
+	Mutex m_mutex;
+	StatusHolder m_status;
+	FB_SIZE_T m_next;			// next run to pick up by a worker
+	bool m_stop;
 };
 
 
@@ -435,6 +686,55 @@ FB_SIZE_T NBackup::read_file(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize)
 	return 0; // silence compiler
 }
 
+FB_SIZE_T NBackup::read_file_at(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize, SINT64 pos)
+{
+	// Unlike read_file() it doesn't move the file pointer,
+	// thus may be used by a few threads at once
+
+	FB_SIZE_T rc = 0;
+	while (bufsize)
+	{
+#ifdef WIN_NT
+		OVERLAPPED overlapped;
+		memset(&overlapped, 0, sizeof(overlapped));
+
+		LARGE_INTEGER offset;
+		offset.QuadPart = pos;
+		overlapped.Offset = offset.LowPart;
+		overlapped.OffsetHigh = offset.HighPart;
+
+		DWORD res;
+		if (!ReadFile(file, buffer, bufsize, &res, &overlapped))
+		{
+			const DWORD err = GetLastError();
+			if (err == ERROR_HANDLE_EOF)
+				break;
+#else
+		const ssize_t res = os_utils::pread(file, buffer, bufsize, pos);
+		if (res < 0)
+		{
+			const int err = errno;
+			if (SYSCALL_INTERRUPTED(err))
+				continue;
+#endif
+			status_exception::raise(Arg::Gds(isc_nbackup_err_read) <<
+				(&file == &dbase ? dbname.c_str() :
+					&file == &backup ? bakname.c_str() : "unknown") <<
+				Arg::OsError(err));
+		}
+
+		if (!res)
+			break;
+
+		rc += res;
+		pos += res;
+		bufsize -= res;
+		buffer = &((UCHAR*) buffer)[res];
+	}
+
+	return rc;
+}
+
 void NBackup::write_file(FILE_HANDLE &file, void *buffer, FB_SIZE_T bufsize)
 {
 #ifdef WIN_NT
@@ -474,6 +774,219 @@ void NBackup::seek_file(FILE_HANDLE &file, SINT64 pos)
 		Arg::OsError());
 }
 
+bool NBackup::size_file(FILE_HANDLE &file, SINT64& size)
+{
+	// Only regular files have size, pipes and devices can't be rewound
+
+#ifdef WIN_NT
+	if (GetFileType(file) != FILE_TYPE_DISK)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file, &fileSize))
+	{
+		size = fileSize.QuadPart;
+		return true;
+	}
+#else
+	struct STAT st;
+	if (os_utils::fstat(file, &st) == 0)
+	{
+		if (!S_ISREG(st.st_mode))
+			return false;
+
+		size = st.st_size;
+		return true;
+	}
+#endif
+
+	status_exception::raise(Arg::Gds(isc_nbackup_err_seek) <<
+		(&file == &dbase ? dbname.c_str() :
+			&file == &backup ? bakname.c_str() : "unknown") <<
+		Arg::OsError());
+
+	return false; // silence compiler
+}
+
+FB_SIZE_T NBackup::read_backup(void *buffer, FB_SIZE_T bufsize)
+{
+	if (!codec)
+	{
+		// First bytes were read already to recognize the backup
+
+		const FB_SIZE_T rc = MIN(bufsize, backup_peek.getCount());
+		if (rc)
+		{
+			memcpy(buffer, backup_peek.begin(), rc);
+			backup_peek.removeCount(0, rc);
+
+			bufsize -= rc;
+			buffer = &((UCHAR*) buffer)[rc];
+		}
+
+		return bufsize ? rc + read_file(backup, buffer, bufsize) : rc;
+	}
+
+	FB_SIZE_T rc = 0;
+	while (bufsize)
+	{
+		if (codec_frame == codec_frames && !read_frames())
+			break;
+
+		const UCharBuffer& plain = codec->getFrame(codec_frame).plain;
+		const FB_SIZE_T step = MIN(bufsize, plain.getCount() - codec_offset);
+
+		memcpy(buffer, plain.begin() + codec_offset, step);
+
+		rc += step;
+		bufsize -= step;
+		buffer = &((UCHAR*) buffer)[step];
+
+		codec_offset += step;
+		if (codec_offset == plain.getCount())
+		{
+			codec_frame++;
+			codec_offset = 0;
+		}
+	}
+
+	return rc;
+}
+
+bool NBackup::read_frames()
+{
+	if (codec_stream)
+		return read_stream();
+
+	// Read the next batch of frames and decompress them in parallel
+
+	codec_frame = codec_frames = 0;
+	codec_offset = 0;
+
+	while (codec_frames < codec->getCapacity() && codec_entry < codec->getEntryCount())
+	{
+		const BackupCodec::Entry& entry = codec->getEntry(codec_entry++);
+		BackupCodec::Frame& frame = codec->getFrame(codec_frames++);
+
+		if (read_file(backup, frame.packed.getBuffer(entry.packedLength), entry.packedLength) !=
+				entry.packedLength)
+		{
+			status_exception::raise(Arg::Gds(isc_nbackup_err_eofbk) << bakname.c_str());
+		}
+
+		frame.plain.getBuffer(entry.plainLength);
+	}
+
+	if (!codec_frames)
+		return false;
+
+	if (!codec->process(codec_frames))
+		status_exception::raise(Arg::Gds(isc_nbackup_err_codec) << bakname.c_str());
+
+	return true;
+}
+
+bool NBackup::read_stream()
+{
+	// Decompress the next part of the backup as it comes, the first frame
+	// of the batch holds both the input read and the output
+
+	BackupCodec::Frame& frame = codec->getFrame(0);
+	UCHAR* const output = frame.plain.getBuffer(BackupCodec::FRAME_LENGTH);
+	FB_SIZE_T length = 0;
+
+	codec_frame = codec_frames = 0;
+	codec_offset = 0;
+
+	while (length < BackupCodec::FRAME_LENGTH)
+	{
+		if (codec_input == frame.packed.getCount())
+		{
+			const FB_SIZE_T count = read_file(backup, frame.packed.getBuffer(STREAM_CHUNK), STREAM_CHUNK);
+			frame.packed.shrink(count);
+			codec_input = 0;
+
+			if (!count)
+				break;
+		}
+
+		if (!codec->decompressStream(frame.packed.begin(), frame.packed.getCount(), codec_input,
+				output, BackupCodec::FRAME_LENGTH, length))
+		{
+			status_exception::raise(Arg::Gds(isc_nbackup_err_codec) << bakname.c_str());
+		}
+	}
+
+	frame.plain.shrink(length);
+
+	if (!length)
+	{
+		if (!codec->isStreamComplete())
+			status_exception::raise(Arg::Gds(isc_nbackup_err_eofbk) << bakname.c_str());
+
+		return false;
+	}
+
+	codec_frames = 1;
+	return true;
+}
+
+void NBackup::write_backup(void *buffer, FB_SIZE_T bufsize)
+{
+	if (!codec)
+	{
+		write_file(backup, buffer, bufsize);
+		return;
+	}
+
+	const UCHAR* ptr = static_cast<const UCHAR*>(buffer);
+	while (bufsize)
+	{
+		UCharBuffer& plain = codec->getFrame(codec_frame).plain;
+		const FB_SIZE_T step = MIN(bufsize, BackupCodec::FRAME_LENGTH - plain.getCount());
+
+		plain.add(ptr, step);
+		ptr += step;
+		bufsize -= step;
+
+		if (plain.getCount() == BackupCodec::FRAME_LENGTH && ++codec_frame == codec->getCapacity())
+			flush_backup(false);
+	}
+}
+
+void NBackup::flush_backup(bool last)
+{
+	if (!codec)
+		return;
+
+	// Compress filled frames (and the partial one) in parallel, write them in order
+
+	unsigned count = codec_frame;
+	if (count < codec->getCapacity() && codec->getFrame(count).plain.hasData())
+		count++;
+
+	if (!codec->process(count))
+		status_exception::raise(Arg::Gds(isc_nbackup_err_codec) << bakname.c_str());
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		BackupCodec::Frame& frame = codec->getFrame(i);
+
+		write_file(backup, frame.packed.begin(), frame.packed.getCount());
+		codec->addEntry(frame.packed.getCount(), frame.plain.getCount());
+		frame.plain.clear();
+	}
+
+	codec_frame = 0;
+
+	if (last)
+	{
+		UCharBuffer table;
+		codec->composeSeekTable(table);
+		write_file(backup, table.begin(), table.getCount());
+	}
+}
+
 void NBackup::open_database_write(bool exclusive)
 {
 #ifdef WIN_NT
@@ -617,16 +1130,83 @@ void NBackup::open_backup_scan()
 	backup = CreateFile(nm.c_str(), GENERIC_READ, 0,
 		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
 	if (backup != INVALID_HANDLE_VALUE)
+	{
+		open_backup_codec();
 		return;
+	}
 #else
 	backup = os_utils::open(nm.c_str(), O_RDONLY | O_LARGEFILE);
 	if (backup >= 0)
+	{
+		open_backup_codec();
 		return;
+	}
 #endif
 
 	status_exception::raise(Arg::Gds(isc_nbackup_err_openbk) << bakname.c_str() << Arg::OsError());
 }
 
+void NBackup::open_backup_codec()
+{
+	// Backup compressed by nbackup itself starts with zstd frame, otherwise
+	// it's read as is. The backup may be a pipe, so the first bytes are kept
+	// to be read again rather than the backup is rewound.
+
+	const FB_SIZE_T peeked = read_file(backup,
+		backup_peek.getBuffer(BackupCodec::MAGIC_LENGTH), BackupCodec::MAGIC_LENGTH);
+	backup_peek.shrink(peeked);
+
+	if (!BackupCodec::isCompressed(backup_peek.begin(), peeked))
+		return;
+
+	codec = FB_NEW_POOL(*getDefaultMemoryPool())
+		BackupCodec(*getDefaultMemoryPool(), false, 0, parallel_workers);
+
+	codec_frame = codec_frames = 0;
+	codec_offset = codec_entry = 0;
+	codec_stream = false;
+
+	// Regular file ending with the seek table is decompressed by batches
+	// of frames in parallel, otherwise frames are decompressed one by one
+
+	SINT64 size;
+	UCHAR footer[BackupCodec::FOOTER_LENGTH];
+	ULONG length = 0;
+
+	const bool regular = size_file(backup, size);
+
+	if (regular && size >= (SINT64) sizeof(footer))
+	{
+		if (read_file_at(backup, footer, sizeof(footer), size - sizeof(footer)) == sizeof(footer))
+			length = BackupCodec::getSeekTableLength(footer);
+	}
+
+	if (length)
+	{
+		UCharBuffer table;
+
+		if (length > size ||
+			read_file_at(backup, table.getBuffer(length), length, size - length) != length ||
+			!codec->parseSeekTable(table.begin(), length))
+		{
+			status_exception::raise(Arg::Gds(isc_nbackup_err_seektable) << bakname.c_str());
+		}
+
+		seek_file(backup, 0);
+		backup_peek.clear();
+		return;
+	}
+
+	// Positional reads may move the file pointer on some platforms
+	if (regular)
+		seek_file(backup, peeked);
+
+	codec_stream = true;
+	codec_input = 0;
+	codec->getFrame(0).packed.assign(backup_peek);
+	backup_peek.clear();
+}
+
 void NBackup::open_backup_decompress()
 {
 	string command = decompress;
@@ -803,6 +1383,9 @@ void NBackup::create_backup()
 
 void NBackup::close_backup()
 {
+	codec.reset();
+	backup_peek.clear();
+
 	if (bakname == "stdout")
 		return;
 
@@ -1336,6 +1919,13 @@ void NBackup::backup_database(int level, Guid& guid, const PathName& fname)
 		create_backup();
 		delete_backup = true;
 
+		if (compress_level)
+		{
+			codec = FB_NEW_POOL(*getDefaultMemoryPool())
+				BackupCodec(*getDefaultMemoryPool(), true, compress_level, parallel_workers);
+			codec_frame = 0;
+		}
+
 		open_database_scan();
 
 		// Read database header
@@ -1412,7 +2002,7 @@ void NBackup::backup_database(int level, Guid& guid, const PathName& fname)
 
 			memset(page_buff, 0, header->hdr_page_size);
 			memcpy(page_buff, &bh, sizeof(bh));
-			write_file(backup, page_buff, header->hdr_page_size);
+			write_backup(page_buff, header->hdr_page_size);
 			page_writes++;
 
 			seek_file(dbase, 0);
@@ -1420,119 +2010,71 @@ void NBackup::backup_database(int level, Guid& guid, const PathName& fname)
 				status_exception::raise(Arg::Gds(isc_nbackup_err_eofhdrdb) << dbname.c_str() << Arg::Num(2));
 		}
 
-		ULONG curPage = 0;
-		ULONG lastPage = FIRST_PIP_PAGE;
-		const ULONG pagesPerPIP = Ods::pagesPerPIP(header->hdr_page_size);
-
-		ULONG scnsSlot = 0;
-		const ULONG pagesPerSCN = Ods::pagesPerSCN(header->hdr_page_size);
-
-		Array<UCHAR> unaligned_scns_buffer;
-		Ods::scns_page* scns = NULL, *scns_buf = NULL;
-		{ // scope
-			UCHAR* buf = unaligned_scns_buffer.getBuffer(header->hdr_page_size + SECTOR_ALIGNMENT);
-			scns_buf = reinterpret_cast<Ods::scns_page*>(FB_ALIGN(buf, SECTOR_ALIGNMENT));
+		if (level)
+		{
+			backup_changed_pages(page_buff, header->hdr_page_size, prev_scn, backup_scn,
+				page_reads, page_writes);
 		}
-
-		while (true)
+		else
 		{
-			if (curPage && page_buff->pag_scn > backup_scn)
-			{
-				status_exception::raise(Arg::Gds(isc_nbackup_page_changed) << Arg::Num(curPage) <<
-										Arg::Num(page_buff->pag_scn) << Arg::Num(backup_scn));
-			}
-
-			if (!level || page_buff->pag_scn > prev_scn)
-			{
-				write_file(backup, page_buff, header->hdr_page_size);
-				page_writes++;
-			}
-
-			checkCtrlC(uSvc);
-
-			if ((db_size_pages != 0) && (db_size == 0))
-				break;
+			ULONG curPage = 0;
+			ULONG lastPage = FIRST_PIP_PAGE;
+			const ULONG pagesPerPIP = Ods::pagesPerPIP(header->hdr_page_size);
 
-			if (level)
+			while (true)
 			{
-				fb_assert(scnsSlot < pagesPerSCN);
-				fb_assert(scns && scns->scn_sequence * pagesPerSCN + scnsSlot == curPage ||
-						 !scns && curPage % pagesPerSCN == scnsSlot);
-
-				ULONG nextSCN = scns ? (scns->scn_sequence + 1) * pagesPerSCN : FIRST_SCN_PAGE;
-
-				while (true)
-				{
-					curPage++;
-					scnsSlot++;
-					if (!scns || scns->scn_pages[scnsSlot] > prev_scn ||
-						scnsSlot == pagesPerSCN ||
-						curPage == nextSCN ||
-						curPage == lastPage)
-					{
-						seek_file(dbase, (SINT64) curPage * header->hdr_page_size);
-						break;
-					}
-				}
-
-				if (scnsSlot == pagesPerSCN)
+				if (curPage && page_buff->pag_scn > backup_scn)
 				{
-					scnsSlot = 0;
-					scns = NULL;
+					status_exception::raise(Arg::Gds(isc_nbackup_page_changed) << Arg::Num(curPage) <<
+											Arg::Num(page_buff->pag_scn) << Arg::Num(backup_scn));
 				}
 
-				fb_assert(scnsSlot < pagesPerSCN);
-				fb_assert(scns && scns->scn_sequence * pagesPerSCN + scnsSlot == curPage ||
-						 !scns && curPage % pagesPerSCN == scnsSlot);
-			}
-			else
-				curPage++;
-
+				write_backup(page_buff, header->hdr_page_size);
+				page_writes++;
 
-			const FB_SIZE_T bytesDone = read_file(dbase, page_buff, header->hdr_page_size);
-			--db_size;
-			page_reads++;
-			if (bytesDone == 0)
-				break;
-			if (bytesDone != header->hdr_page_size)
-				status_exception::raise(Arg::Gds(isc_nbackup_dbsize_inconsistent));
+				checkCtrlC(uSvc);
 
-			if (level && page_buff->pag_type == pag_scns)
-			{
-				fb_assert(scnsSlot == 0 || scnsSlot == FIRST_SCN_PAGE);
+				if ((db_size_pages != 0) && (db_size == 0))
+					break;
 
-				// pick up next SCN's page
-				memcpy(scns_buf, page_buff, header->hdr_page_size);
-				scns = scns_buf;
-			}
+				curPage++;
 
+				const FB_SIZE_T bytesDone = read_file(dbase, page_buff, header->hdr_page_size);
+				--db_size;
+				page_reads++;
+				if (bytesDone == 0)
+					break;
+				if (bytesDone != header->hdr_page_size)
+					status_exception::raise(Arg::Gds(isc_nbackup_dbsize_inconsistent));
 
-			if (curPage == lastPage)
-			{
-				// Starting from ODS 11.1 we can expand file but never use some last
-				// pages in it. There are no need to backup this empty pages. More,
-				// we can't be sure its not used pages have right SCN assigned.
-				// How many pages are really used we know from page_inv_page::pip_used
-				// where stored number of pages allocated from this pointer page.
-				if (page_buff->pag_type == pag_pages)
+				if (curPage == lastPage)
 				{
-					Ods::page_inv_page* pip = (Ods::page_inv_page*) page_buff;
-					if (lastPage == FIRST_PIP_PAGE)
-						lastPage = pip->pip_used - 1;
+					// Starting from ODS 11.1 we can expand file but never use some last
+					// pages in it. There are no need to backup this empty pages. More,
+					// we can't be sure its not used pages have right SCN assigned.
+					// How many pages are really used we know from page_inv_page::pip_used
+					// where stored number of pages allocated from this pointer page.
+					if (page_buff->pag_type == pag_pages)
+					{
+						Ods::page_inv_page* pip = (Ods::page_inv_page*) page_buff;
+						if (lastPage == FIRST_PIP_PAGE)
+							lastPage = pip->pip_used - 1;
+						else
+							lastPage += pip->pip_used;
+
+						if (pip->pip_used < pagesPerPIP)
+							lastPage++;
+					}
 					else
-						lastPage += pip->pip_used;
-
-					if (pip->pip_used < pagesPerPIP)
-						lastPage++;
-				}
-				else
-				{
-					fb_assert(page_buff->pag_type == pag_undefined);
-					break;
+					{
+						fb_assert(page_buff->pag_type == pag_undefined);
+						break;
+					}
 				}
 			}
 		}
 		close_database();
+		flush_backup(true);
 		close_backup();
 
 		delete_backup = false; // Backup file is consistent. No need to delete it
@@ -1652,6 +2194,162 @@ void NBackup::backup_database(int level, Guid& guid, const PathName& fname)
 	}
 }
 
+void NBackup::backup_changed_pages(Ods::pag* header_page, ULONG page_size, ULONG prev_scn,
+	ULONG backup_scn, ULONG& page_reads, ULONG& page_writes)
+{
+	// Level N backup contains the pages changed since the previous level backup.
+	// SCN page tells which pages of its range are changed, so only the SCN pages
+	// and pointer pages are read serially while walking the database, the changed
+	// pages are collected into the batch of runs read by parallel workers.
+	// Then pages are checked and written in order.
+
+	const ULONG pagesPerPIP = Ods::pagesPerPIP(page_size);
+	const ULONG pagesPerSCN = Ods::pagesPerSCN(page_size);
+
+	// Header page is already read
+	if (header_page->pag_scn > prev_scn)
+	{
+		write_backup(header_page, page_size);
+		page_writes++;
+	}
+
+	PageReader reader(this, page_size, parallel_workers);
+
+	Array<UCHAR> unaligned_buffer;
+	UCHAR* const buffer = FB_ALIGN(unaligned_buffer.getBuffer(page_size + SECTOR_ALIGNMENT), SECTOR_ALIGNMENT);
+	const Ods::pag* const page = reinterpret_cast<Ods::pag*>(buffer);
+
+	Array<UCHAR> unaligned_scns_buffer;
+	Ods::scns_page* const scns = reinterpret_cast<Ods::scns_page*>(
+		FB_ALIGN(unaligned_scns_buffer.getBuffer(page_size + SECTOR_ALIGNMENT), SECTOR_ALIGNMENT));
+	bool scnsValid = false;
+
+	const auto writePages = [&]()
+	{
+		reader.read();
+
+		for (const auto& run : reader.getRuns())
+		{
+			if (run.length % page_size)
+				status_exception::raise(Arg::Gds(isc_nbackup_dbsize_inconsistent));
+
+			ULONG pageNum = run.page;
+			for (UCHAR* ptr = run.data; ptr < run.data + run.length; ptr += page_size, pageNum++)
+			{
+				const Ods::pag* const runPage = reinterpret_cast<Ods::pag*>(ptr);
+				page_reads++;
+
+				if (runPage->pag_scn > backup_scn)
+				{
+					status_exception::raise(Arg::Gds(isc_nbackup_page_changed) << Arg::Num(pageNum) <<
+											Arg::Num(runPage->pag_scn) << Arg::Num(backup_scn));
+				}
+
+				// Runs contain some unchanged pages as well
+				if (runPage->pag_scn > prev_scn)
+				{
+					write_backup(ptr, page_size);
+					page_writes++;
+				}
+			}
+
+			checkCtrlC(uSvc);
+		}
+
+		reader.clear();
+	};
+
+	const auto addPage = [&](ULONG pageNum)
+	{
+		if (reader.isFull())
+			writePages();
+
+		reader.add(pageNum);
+	};
+
+	const auto readPage = [&](ULONG pageNum, void* buf)
+	{
+		page_reads++;
+		return read_file_at(dbase, buf, page_size, (SINT64) pageNum * page_size) == page_size;
+	};
+
+	// Pages past the last one allocated from pointer pages are not backed up,
+	// we can't be sure they have right SCN assigned. The same way as for
+	// level 0 backup the page at lastPage is either the next pointer page
+	// or the end of the used pages.
+
+	ULONG lastPage = FIRST_PIP_PAGE;
+	const ULONG endPage = db_size_pages ? db_size_pages : MAX_ULONG;
+	bool done = false;
+
+	for (ULONG sequence = 0; !done; sequence++)
+	{
+		const ULONG firstPage = sequence * pagesPerSCN;
+		const ULONG scnPage = sequence ? firstPage : FIRST_SCN_PAGE;
+
+		if (firstPage / pagesPerSCN != sequence)
+			break;
+
+		for (ULONG slot = sequence ? 0 : 1; slot < pagesPerSCN; slot++)
+		{
+			const ULONG pageNum = firstPage + slot;
+
+			if (pageNum >= endPage)
+			{
+				done = true;
+				break;
+			}
+
+			if (pageNum == lastPage)
+			{
+				if (!readPage(pageNum, buffer))
+				{
+					done = true;
+					break;
+				}
+
+				if (page->pag_type != pag_pages)
+				{
+					fb_assert(page->pag_type == pag_undefined);
+					done = true;
+					break;
+				}
+
+				const Ods::page_inv_page* const pip = reinterpret_cast<const Ods::page_inv_page*>(page);
+				if (lastPage == FIRST_PIP_PAGE)
+					lastPage = pip->pip_used - 1;
+				else
+					lastPage += pip->pip_used;
+
+				if (pip->pip_used < pagesPerPIP)
+					lastPage++;
+
+				addPage(pageNum);
+			}
+			else if (pageNum == scnPage)
+			{
+				if (!readPage(pageNum, scns))
+				{
+					done = true;
+					break;
+				}
+
+				// Without SCN page every page of the range is checked
+				scnsValid = (scns->scn_header.pag_type == pag_scns && scns->scn_sequence == sequence);
+
+				addPage(pageNum);
+			}
+			else if (!scnsValid || scns->scn_pages[slot] > prev_scn)
+				addPage(pageNum);
+		}
+
+		scnsValid = false;
+	}
+
+	if (!reader.isEmpty())
+		writePages();
+}
+
 void NBackup::restore_database(const BackupFiles& files, bool repl_seq, bool inc_rest)
 {
 	// We set this flag when database file is in inconsistent state
@@ -1738,7 +2436,7 @@ void NBackup::restore_database(const BackupFiles& files, bool repl_seq, bool inc
 			if (curLevel)
 			{
 				inc_header bakheader;
-				if (read_file(backup, &bakheader, sizeof(bakheader)) != sizeof(bakheader))
+				if (read_backup(&bakheader, sizeof(bakheader)) != sizeof(bakheader))
 					status_exception::raise(Arg::Gds(isc_nbackup_err_eofhdrbk) << bakname.c_str());
 				if (memcmp(bakheader.signature, backup_signature, sizeof(backup_signature)) != 0)
 					status_exception::raise(Arg::Gds(isc_nbackup_invalid_incbk) << bakname.c_str());
@@ -1763,7 +2461,7 @@ void NBackup::restore_database(const BackupFiles& files, bool repl_seq, bool inc
 				{
 					char char_buf[1024];
 					FB_SIZE_T step = left > sizeof(char_buf) ? sizeof(char_buf) : left;
-					if (read_file(backup, &char_buf, step) != step)
+					if (read_backup(&char_buf, step) != step)
 						status_exception::raise(Arg::Gds(isc_nbackup_err_eofhdrbk) << bakname.c_str());
 					left -= step;
 				}
@@ -1774,7 +2472,7 @@ void NBackup::restore_database(const BackupFiles& files, bool repl_seq, bool inc
 				const auto page_ptr = page_buffer.begin();
 				while (true)
 				{
-					const FB_SIZE_T bytesDone = read_file(backup, page_ptr, bakheader.page_size);
+					const FB_SIZE_T bytesDone = read_backup(page_ptr, bakheader.page_size);
 					if (bytesDone == 0)
 						break;
 					if (bytesDone != bakheader.page_size) {
@@ -1795,7 +2493,7 @@ void NBackup::restore_database(const BackupFiles& files, bool repl_seq, bool inc
 					char buffer[65536];
 					while (true)
 					{
-						const FB_SIZE_T bytesRead = read_file(backup, buffer, sizeof(buffer));
+						const FB_SIZE_T bytesRead = read_backup(buffer, sizeof(buffer));
 						if (bytesRead == 0)
 							break;
 						write_file(dbase, buffer, bytesRead);
@@ -1904,6 +2602,8 @@ void nbackup(UtilSvc* uSvc)
 	string username, role, password;
 	PathName database, filename;
 	string decompress;
+	int compress_level = 0;
+	int parallel_workers = 0;
 	bool run_db_triggers = true;
 	bool direct_io =
 #ifdef WIN_NT
@@ -1987,6 +2687,24 @@ void nbackup(UtilSvc* uSvc)
  			decompress = argv[itr];
 			break;
 
+		case IN_SW_NBK_COMPRESS:
+			if (++itr >= argc)
+				missingParameterForSwitch(uSvc, argv[itr - 1]);
+
+			compress_level = atoi(argv[itr]);
+			if (compress_level < 1 || compress_level > MAX_COMPRESS_LEVEL)
+				usage(uSvc, isc_nbackup_wrong_param, argv[itr - 1]);
+			break;
+
+		case IN_SW_NBK_PARALLEL:
+			if (++itr >= argc)
+				missingParameterForSwitch(uSvc, argv[itr - 1]);
+
+			parallel_workers = atoi(argv[itr]);
+			if (parallel_workers < 1)
+				usage(uSvc, isc_nbackup_wrong_param, argv[itr - 1]);
+			break;
+
 		case IN_SW_NBK_FIXUP:
 			if (op != nbNone)
 				singleAction(uSvc);
@@ -2163,6 +2881,19 @@ void nbackup(UtilSvc* uSvc)
 		usage(uSvc, isc_nbackup_seq_misuse);
 	}
 
+	if (compress_level && op != nbBackup)
+	{
+		usage(uSvc, isc_nbackup_compress_misuse);
+	}
+
+	if (parallel_workers && op != nbBackup && op != nbRestore)
+	{
+		usage(uSvc, isc_nbackup_parallel_misuse);
+	}
+
+	if (!parallel_workers)
+		parallel_workers = uSvc->getParallelWorkers();
+
 	if (cleanHistory)
 	{
 		// CLEAN_HISTORY could be used with BACKUP only
@@ -2178,7 +2909,7 @@ void nbackup(UtilSvc* uSvc)
 	}
 
 	NBackup nbk(uSvc, database, username, role, password, run_db_triggers, direct_io,
-				decompress, cleanHistKind, keepHistValue);
+				decompress, compress_level, parallel_workers, cleanHistKind, keepHistValue);
 	try
 	{
 		switch (op)
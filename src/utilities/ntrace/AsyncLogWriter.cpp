@@ -0,0 +1,271 @@
+/*
+ *	PROGRAM:	SQL Trace plugin
+ *	MODULE:		AsyncLogWriter.cpp
+ *	DESCRIPTION:	Log writer queueing records for the background thread
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+*/
+
+#include "AsyncLogWriter.h"
+#include "os/platform.h"
+#include "../../common/isc_proto.h"
+#include "../../common/ThreadStart.h"
+#include "../../common/classes/array.h"
+#include "../../common/classes/init.h"
+#include "../../common/classes/locks.h"
+#include "../../common/classes/semaphore.h"
+#include "../../common/classes/timestamp.h"
+#include "../../common/StatusHolder.h"
+
+#ifdef WIN_NT
+#define NEWLINE "\r\n"
+#else
+#define NEWLINE "\n"
+#endif
+
+using namespace Firebird;
+
+namespace
+{
+	// Queues are checked at least that often
+	const int FLUSH_INTERVAL = 100;	// milliseconds
+
+	// Records are passed to the underlying writer by whole, a few at once
+	const FB_SIZE_T MAX_WRITE_LENGTH = 64 * 1024;
+
+	class AsyncLogThread
+	{
+	public:
+		explicit AsyncLogThread(MemoryPool& pool)
+			: m_writers(pool),
+			  m_thread(pool, threadRoutine),
+			  m_started(false),
+			  m_stop(false)
+		{}
+
+		void add(AsyncLogWriter* writer)
+		{
+			MutexLockGuard startGuard(m_startMutex, FB_FUNCTION);
+
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+				m_writers.add(writer);
+			}
+
+			if (!m_started)
+			{
+				m_stop = false;
+				m_thread.run(this);
+				m_started = true;
+			}
+		}
+
+		void remove(AsyncLogWriter* writer)
+		{
+			MutexLockGuard startGuard(m_startMutex, FB_FUNCTION);
+
+			{	// scope
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				FB_SIZE_T pos;
+				if (m_writers.find(writer, pos))
+					m_writers.remove(pos);
+
+				// The thread is stopped with the last writer, as the plugin
+				// module may be unloaded after that
+				if (m_writers.hasData() || !m_started)
+					return;
+
+				m_stop = true;
+			}
+
+			m_wakeup.release();
+			m_thread.waitForCompletion();
+			m_started = false;
+		}
+
+		void wakeup()
+		{
+			m_wakeup.release();
+		}
+
+		void exceptionHandler(const Exception& ex, ThreadFinishSync<AsyncLogThread*>::ThreadRoutine*)
+		{
+			iscLogException("Trace log writer thread", ex);
+		}
+
+	private:
+		static void threadRoutine(AsyncLogThread* logThread)
+		{
+			logThread->run();
+		}
+
+		void run()
+		{
+			while (true)
+			{
+				m_wakeup.tryEnter(0, FLUSH_INTERVAL);
+
+				MutexLockGuard guard(m_mutex, FB_FUNCTION);
+
+				for (auto writer : m_writers)
+					writer->flush();
+
+				if (m_stop)
+					break;
+			}
+		}
+
+		Mutex m_startMutex;
+		Mutex m_mutex;
+		Semaphore m_wakeup;
+		HalfStaticArray<AsyncLogWriter*, 16> m_writers;
+		ThreadFinishSync<AsyncLogThread*> m_thread;
+		bool m_started;
+		bool m_stop;
+	};
+
+	GlobalPtr<AsyncLogThread> logThread;
+}
+
+
+AsyncLogWriter::AsyncLogWriter(ITraceLogWriter* writer, ULONG queueSize)
+	: m_writer(writer),
+	  m_queue(*getDefaultMemoryPool(), queueSize),
+	  m_dropped(0),
+	  m_stopped(false)
+{
+	m_writer->addRef();
+	logThread->add(this);
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+	fb_assert(m_stopped);
+
+	for (string* record; (record = m_queue.pop()); )
+		delete record;
+
+	m_writer->release();
+}
+
+void AsyncLogWriter::stop()
+{
+	if (m_stopped)
+		return;
+
+	logThread->remove(this);
+	m_stopped = true;
+
+	flush();
+}
+
+FB_SIZE_T AsyncLogWriter::write(const void* buf, FB_SIZE_T size)
+{
+	MemoryPool& pool = *getDefaultMemoryPool();
+	string* const record = FB_NEW_POOL(pool) string(pool, static_cast<const char*>(buf), size);
+
+	if (!m_queue.push(record))
+	{
+		delete record;
+		++m_dropped;
+		logThread->wakeup();
+		return size;
+	}
+
+	// Don't wait for the next flush interval if the queue is being filled quickly
+	if (m_queue.getCount() == m_queue.getCapacity() / 2)
+		logThread->wakeup();
+
+	return size;
+}
+
+FB_SIZE_T AsyncLogWriter::write_s(CheckStatusWrapper* status, const void* buf, unsigned size)
+{
+	try
+	{
+		return write(buf, size);
+	}
+	catch (Exception &ex)
+	{
+		ex.stuffException(status);
+	}
+
+	return 0;
+}
+
+void AsyncLogWriter::flush()
+{
+	string buffer;
+
+	for (string* record; (record = m_queue.pop()); delete record)
+	{
+		if (buffer.hasData() && buffer.length() + record->length() > MAX_WRITE_LENGTH)
+			writeRecords(buffer);
+
+		buffer.append(*record);
+	}
+
+	const ULONG dropped = m_dropped.exchange(0);
+
+	if (dropped)
+	{
+		const TimeStamp stamp(TimeStamp::getCurrentTimeStamp());
+		struct tm times;
+		stamp.decode(&times);
+
+		string notice;
+		notice.printf("%04d-%02d-%02dT%02d:%02d:%02d.%04d (%d:%p) RECORDS_DROPPED" NEWLINE
+			"\t%" ULONGFORMAT " records were dropped as the log queue was full" NEWLINE NEWLINE,
+			times.tm_year + 1900, times.tm_mon + 1, times.tm_mday, times.tm_hour,
+			times.tm_min, times.tm_sec, (int) (stamp.value().timestamp_time % ISC_TIME_SECONDS_PRECISION),
+			get_process_id(), this, dropped);
+
+		buffer.append(notice);
+	}
+
+	if (buffer.hasData())
+		writeRecords(buffer);
+}
+
+void AsyncLogWriter::writeRecords(string& buffer)
+{
+	LocalStatus ls;
+	CheckStatusWrapper status(&ls);
+
+	m_writer->write_s(&status, buffer.c_str(), buffer.length());
+
+	if (ls.getState() & IStatus::STATE_ERRORS)
+	{
+		if (ls.getErrors()[1] == isc_interface_version_too_old)
+		{
+			try
+			{
+				m_writer->write(buffer.c_str(), buffer.length());
+			}
+			catch (const Exception& ex)
+			{
+				iscLogException("Trace log writer", ex);
+			}
+		}
+		else
+			iscLogStatus("Trace log writer", &ls);
+	}
+
+	buffer.erase();
+}
@@ -0,0 +1,69 @@
+/*
+ *	PROGRAM:	SQL Trace plugin
+ *	MODULE:		AsyncLogWriter.h
+ *	DESCRIPTION:	Log writer queueing records for the background thread
+ *
+ *  The contents of this file are subject to the Initial
+ *  Developer's Public License Version 1.0 (the "License");
+ *  you may not use this file except in compliance with the
+ *  License. You may obtain a copy of the License at
+ *  http://www.ibphoenix.com/main.nfs?a=ibphoenix&page=ibp_idpl.
+ *
+ *  Software distributed under the License is distributed AS IS,
+ *  WITHOUT WARRANTY OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing rights
+ *  and limitations under the License.
+ *
+ *  The Original Code was created for the Firebird Open Source RDBMS project.
+ *
+ *  All Rights Reserved.
+ *  Contributor(s): ______________________________________.
+ *
+*/
+
+#ifndef ASYNCLOGWRITER_H
+#define ASYNCLOGWRITER_H
+
+#include "firebird.h"
+#include "../../jrd/ntrace.h"
+#include "../../common/classes/fb_string.h"
+#include "../../common/classes/BoundedQueue.h"
+#include "../../common/classes/ImplementHelper.h"
+#include <atomic>
+
+
+// Log writer used when log_queue_size is set. Records written by the plugin
+// are put into the bounded lock-free queue and the underlying writer gets them
+// from the background thread, which serves queues of all plugin instances.
+// Thus the traced threads never wait for the log file I/O nor for the shared
+// trace log. If the queue is full, the record is dropped and counted, and the
+// number of dropped records is reported into the log later.
+
+class AsyncLogWriter final :
+	public Firebird::RefCntIface<Firebird::ITraceLogWriterImpl<AsyncLogWriter, Firebird::CheckStatusWrapper> >
+{
+public:
+	AsyncLogWriter(Firebird::ITraceLogWriter* writer, ULONG queueSize);
+	~AsyncLogWriter();
+
+	// TraceLogWriter implementation
+	FB_SIZE_T write(const void* buf, FB_SIZE_T size) override;
+	FB_SIZE_T write_s(Firebird::CheckStatusWrapper* status, const void* buf, unsigned size) override;
+
+	// Write all queued records and detach from the background thread,
+	// must be called before the last release
+	void stop();
+
+	// Called by the background thread only
+	void flush();
+
+private:
+	void writeRecords(Firebird::string& buffer);
+
+	Firebird::ITraceLogWriter* m_writer;
+	Firebird::BoundedQueue<Firebird::string> m_queue;
+	std::atomic<ULONG> m_dropped;
+	bool m_stopped;
+};
+
+#endif // ASYNCLOGWRITER_H
@@ -31,6 +31,7 @@
 
 #include "TracePluginImpl.h"
 #include "PluginLogWriter.h"
+#include "AsyncLogWriter.h"
 #include "os/platform.h"
 #include "firebird/impl/consts_pub.h"
 #include "../../common/isc_f_proto.h"
@@ -92,6 +93,7 @@ TracePluginImpl::TracePluginImpl(IPluginBase* plugin,
 	session_id(initInfo->getTraceSessionID()),
 	session_name(*getDefaultMemoryPool()),
 	logWriter(initInfo->getLogWriter()),
+	asyncLogWriter(NULL),
 	config(configuration),
 	record(*getDefaultMemoryPool()),
 	connections(getDefaultMemoryPool()),
@@ -173,6 +175,16 @@ TracePluginImpl::TracePluginImpl(IPluginBase* plugin,
 	if (!config.exclude_gds_codes.isEmpty())
 		str2Array(config.exclude_gds_codes, exclude_codes);
 
+	// Records are written by the background thread, the traced threads
+	// only put them into the queue
+	if (config.log_queue_size)
+	{
+		asyncLogWriter = FB_NEW AsyncLogWriter(logWriter, config.log_queue_size);
+		asyncLogWriter->addRef();
+		logWriter->release();
+		logWriter = asyncLogWriter;
+	}
+
 	operational = true;
 	log_init();
 }
@@ -1258,6 +1270,12 @@ void TracePluginImpl::log_finalize()
 		logRecord("TRACE_FINI");
 	}
 
+	if (asyncLogWriter)
+	{
+		asyncLogWriter->stop();
+		asyncLogWriter = NULL;
+	}
+
 	logWriter->release();
 	logWriter = NULL;
 }
@@ -41,6 +41,8 @@
 // Bring in off_t
 #include <sys/types.h>
 
+class AsyncLogWriter;
+
 class TracePluginImpl final :
 	public Firebird::RefCntIface<Firebird::ITracePluginImpl<TracePluginImpl, Firebird::CheckStatusWrapper> >
 {
@@ -153,6 +155,7 @@ private:
 	const int session_id;				// trace session ID, set by Firebird
 	Firebird::string session_name;		// trace session name, set by Firebird
 	Firebird::ITraceLogWriter* logWriter;
+	AsyncLogWriter* asyncLogWriter;		// same as logWriter if records are queued
 	TracePluginConfig config;	// Immutable, thus thread-safe
 	Firebird::string record;
 
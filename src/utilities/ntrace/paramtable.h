@@ -42,6 +42,7 @@ STR_PARAMETER(exclude_gds_codes, "")
 BOOL_PARAMETER(log_initfini, true)
 BOOL_PARAMETER(enabled, false)
 UINT_PARAMETER(max_log_size, 0)
+UINT_PARAMETER(log_queue_size, 0)
 
 #ifdef DATABASE_PARAMS
 BOOL_PARAMETER(log_connections, false)